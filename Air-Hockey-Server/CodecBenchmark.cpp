@@ -0,0 +1,139 @@
+#include "CodecBenchmark.h"
+#include "../Air-Hockey/Match.h"
+#include "../Air-Hockey/SnapshotCodec.h"
+#include "../Air-Hockey/NetSocket.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Times each pass over the recording is repeated for timing
+static const int TIMING_PASSES = 20;
+
+//Results land here so the timed loops can't be optimised away
+static volatile int benchmarkSink;
+
+// Simple bot: chase the puck up and down, resting now and then
+static unsigned char BotInput(Match& a_match, int a_slot, int a_tick)
+{
+	if ((a_tick / 240 + a_slot) % 3 == 0)
+		return 0;
+
+	float puckZ = a_match.GetPuck()->GetPosition().z;
+	float paddleZ = a_match.GetPaddle(a_slot)->GetPosition().z;
+
+	if (puckZ > paddleZ + 0.1f)
+		return PADDLE_UP;
+	if (puckZ < paddleZ - 0.1f)
+		return PADDLE_DOWN;
+	return 0;
+}
+
+int RunCodecBenchmark(int a_ticks)
+{
+	//Record the match up front; only the codec is being measured
+	std::vector<QuantizedState> states(a_ticks);
+	Match match;
+	MatchState state;
+
+	for (int i = 0; i < a_ticks; i++)
+	{
+		match.Step(NET_TICK_DT, BotInput(match, 0, i), BotInput(match, 1, i));
+		match.GetState(state);
+		SnapshotCodec::Quantize(state, states[i]);
+	}
+
+	printf("%d ticks, raw MatchState %d bytes\n", a_ticks, (int)sizeof(MatchState));
+	printf("%-10s %8s %6s %6s %6s %12s %12s\n", "ack lag", "avg B", "p50", "p99", "max", "encode ns", "decode ns");
+
+	//0 means no baseline at all
+	const int lags[] = { 1, 4, 12, 30, 63, 0 };
+	int failures = 0;
+
+	std::vector<int> sizes(a_ticks);
+	std::vector<unsigned char> packets((size_t)a_ticks * SnapshotCodec::MAX_SIZE);
+
+	for (int lag : lags)
+	{
+		SnapshotHistory server;
+		SnapshotHistory client;
+		uint32_t newest = 0;
+
+		//One pass to get sizes and check every state round trips
+		for (int i = 0; i < a_ticks; i++)
+		{
+			server.Store(states[i]);
+
+			uint32_t ack = lag > 0 && states[i].Tick > (uint32_t)lag ? states[i].Tick - lag : 0;
+			unsigned char* packet = &packets[(size_t)i * SnapshotCodec::MAX_SIZE];
+			sizes[i] = SnapshotCodec::WriteSnapshot(server, ack, states[i], packet, SnapshotCodec::MAX_SIZE);
+
+			QuantizedState decoded;
+			if (sizes[i] < 0 || !SnapshotCodec::ReadSnapshot(client, newest, packet, sizes[i], decoded) ||
+				memcmp(&decoded, &states[i], sizeof(QuantizedState)) != 0)
+			{
+				failures++;
+				continue;
+			}
+
+			client.Store(decoded);
+			newest = decoded.Tick;
+		}
+
+		//Timing passes replay the same work without the checks
+		uint64_t encodeStart = NetTimeUs();
+		int checksum = 0;
+		for (int pass = 0; pass < TIMING_PASSES; pass++)
+		{
+			SnapshotHistory history;
+			for (int i = 0; i < a_ticks; i++)
+			{
+				history.Store(states[i]);
+				uint32_t ack = lag > 0 && states[i].Tick > (uint32_t)lag ? states[i].Tick - lag : 0;
+				unsigned char scratch[SnapshotCodec::MAX_SIZE];
+				checksum += SnapshotCodec::WriteSnapshot(history, ack, states[i], scratch, SnapshotCodec::MAX_SIZE);
+			}
+		}
+		uint64_t encodeUs = NetTimeUs() - encodeStart;
+
+		uint64_t decodeStart = NetTimeUs();
+		for (int pass = 0; pass < TIMING_PASSES; pass++)
+		{
+			SnapshotHistory history;
+			uint32_t newestTick = 0;
+			for (int i = 0; i < a_ticks; i++)
+			{
+				QuantizedState decoded;
+				if (SnapshotCodec::ReadSnapshot(history, newestTick, &packets[(size_t)i * SnapshotCodec::MAX_SIZE], sizes[i], decoded))
+				{
+					history.Store(decoded);
+					newestTick = decoded.Tick;
+					checksum += decoded.PuckX;
+				}
+			}
+		}
+		uint64_t decodeUs = NetTimeUs() - decodeStart;
+
+		//Sizes once the first baseline is acked
+		std::vector<int> steady(sizes.begin() + (lag > 0 ? lag + 1 : 0), sizes.end());
+		std::sort(steady.begin(), steady.end());
+		double total = 0.0;
+		for (size_t i = 0; i < steady.size(); i++)
+			total += steady[i];
+
+		char label[24];
+		if (lag > 0)
+			snprintf(label, sizeof(label), "%d ticks", lag);
+		else
+			snprintf(label, sizeof(label), "none");
+
+		double operations = (double)a_ticks * TIMING_PASSES;
+		printf("%-10s %8.2f %6d %6d %6d %12.1f %12.1f\n", label, total / steady.size(),
+			steady[steady.size() / 2], steady[steady.size() * 99 / 100], steady.back(),
+			encodeUs * 1000.0 / operations, decodeUs * 1000.0 / operations);
+		benchmarkSink = checksum;
+	}
+
+	printf("round trip failures: %d\n", failures);
+	return failures == 0 ? 0 : 1;
+}
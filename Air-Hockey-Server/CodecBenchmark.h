@@ -0,0 +1,10 @@
+#pragma once
+
+// --------------------------------------------------------
+// Plays a_ticks ticks of a bot match, then encodes and
+// decodes every tick against baselines a few ticks old
+// (as clients with different round trips would ack them).
+// Prints bytes per snapshot and encode/decode throughput,
+// and checks every decoded state matches.
+// --------------------------------------------------------
+int RunCodecBenchmark(int a_ticks);
@@ -0,0 +1,92 @@
+#include "EntityBenchmark.h"
+#include "../Air-Hockey/EntityRegistry.h"
+#include "../Air-Hockey/NetSocket.h"
+#include <cstdio>
+#include <vector>
+
+//Results land here so the timed loops can't be optimised away
+static volatile float benchmarkSink;
+
+static const float FRAME_DT = 1.0f / 120.0f;
+
+int RunEntityBenchmark(int a_pucks, int a_frames)
+{
+	int replaced = a_pucks / 8 > 0 ? a_pucks / 8 : 1;
+	float sink = 0.0f;
+
+	//Every puck on the heap, found through a list of pointers
+	std::vector<Puck*> heap;
+	heap.reserve(a_pucks);
+	for (int i = 0; i < a_pucks; i++)
+		heap.push_back(new Puck(0, 0));
+
+	uint64_t start = NetTimeUs();
+	for (int frame = 0; frame < a_frames; frame++)
+	{
+		for (int i = 0; i < replaced; i++)
+		{
+			int victim = (frame * 7919 + i * 104729) % (int)heap.size();
+			delete heap[victim];
+			heap[victim] = heap.back();
+			heap.pop_back();
+		}
+		for (int i = 0; i < replaced; i++)
+			heap.push_back(new Puck(0, 0));
+
+		for (size_t i = 0; i < heap.size(); i++)
+		{
+			heap[i]->Update(FRAME_DT);
+			sink += heap[i]->GetPosition().x;
+		}
+	}
+	uint64_t heapUs = NetTimeUs() - start;
+
+	for (size_t i = 0; i < heap.size(); i++)
+		delete heap[i];
+
+	//Same churn out of one pool
+	EntityPool<Puck> pool(a_pucks);
+	std::vector<EntityHandle> handles;
+	handles.reserve(a_pucks);
+	for (int i = 0; i < a_pucks; i++)
+		handles.push_back(pool.Create((Mesh*)0, (Material*)0));
+
+	int stale = 0;
+	int staleCaught = 0;
+
+	start = NetTimeUs();
+	for (int frame = 0; frame < a_frames; frame++)
+	{
+		for (int i = 0; i < replaced; i++)
+		{
+			int victim = (frame * 7919 + i * 104729) % (int)handles.size();
+			EntityHandle dead = handles[victim];
+			pool.Destroy(dead);
+			handles[victim] = handles.back();
+			handles.pop_back();
+
+			//The slot is reused right away; the old handle must not find it
+			stale++;
+			if (!pool.Get(dead))
+				staleCaught++;
+		}
+		for (int i = 0; i < replaced; i++)
+			handles.push_back(pool.Create((Mesh*)0, (Material*)0));
+
+		pool.ForEach([&sink](Puck* a_puck)
+		{
+			a_puck->Update(FRAME_DT);
+			sink += a_puck->GetPosition().x;
+		});
+	}
+	uint64_t poolUs = NetTimeUs() - start;
+	benchmarkSink = sink;
+
+	double updates = (double)a_pucks * a_frames;
+	printf("%d pucks, %d frames, %d replaced per frame\n", a_pucks, a_frames, replaced);
+	printf("new/delete  %7.1f ns/entity\n", heapUs * 1000.0 / updates);
+	printf("pool        %7.1f ns/entity  (%d live of %d)\n", poolUs * 1000.0 / updates, pool.GetCount(), pool.GetCapacity());
+	printf("stale handles caught %d of %d\n", staleCaught, stale);
+
+	return staleCaught == stale && pool.GetCount() == a_pucks ? 0 : 1;
+}
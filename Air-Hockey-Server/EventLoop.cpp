@@ -0,0 +1,127 @@
+#ifdef _WIN32
+#include <winsock2.h>
+typedef SOCKET NativeSocket;
+#else
+#include <sys/select.h>
+typedef int NativeSocket;
+#endif
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+#include "EventLoop.h"
+
+EventLoop::EventLoop()
+{
+	count = 0;
+
+#ifdef __linux__
+	epollHandle = epoll_create1(0);
+#else
+	epollHandle = -1;
+#endif
+}
+
+EventLoop::~EventLoop()
+{
+#ifdef __linux__
+	if (epollHandle != -1)
+		close((int)epollHandle);
+#endif
+}
+
+bool EventLoop::Add(UdpSocket* a_socket, EventHandler* a_handler)
+{
+	if (count == MAX_SOCKETS || !a_socket->IsOpen())
+		return false;
+
+#ifdef __linux__
+	//The event carries the socket so a wakeup needs no lookup
+	epoll_event event = {};
+	event.events = EPOLLIN;
+	event.data.u32 = (uint32_t)count;
+	if (epoll_ctl((int)epollHandle, EPOLL_CTL_ADD, (int)a_socket->GetPollHandle(), &event) != 0)
+		return false;
+#endif
+
+	sockets[count] = a_socket;
+	handlers[count] = a_handler;
+	count++;
+	return true;
+}
+
+void EventLoop::Remove(UdpSocket* a_socket)
+{
+	for (int i = 0; i < count; i++)
+	{
+		if (sockets[i] != a_socket)
+			continue;
+
+#ifdef __linux__
+		epoll_ctl((int)epollHandle, EPOLL_CTL_DEL, (int)a_socket->GetPollHandle(), 0);
+#endif
+
+		//Shift down, and re-point epoll at the new positions
+		for (int j = i; j < count - 1; j++)
+		{
+			sockets[j] = sockets[j + 1];
+			handlers[j] = handlers[j + 1];
+
+#ifdef __linux__
+			epoll_event event = {};
+			event.events = EPOLLIN;
+			event.data.u32 = (uint32_t)j;
+			epoll_ctl((int)epollHandle, EPOLL_CTL_MOD, (int)sockets[j]->GetPollHandle(), &event);
+#endif
+		}
+		count--;
+		return;
+	}
+}
+
+int EventLoop::Poll(int a_timeoutMs)
+{
+#ifdef __linux__
+	epoll_event events[MAX_SOCKETS];
+	int ready = epoll_wait((int)epollHandle, events, MAX_SOCKETS, a_timeoutMs);
+
+	for (int i = 0; i < ready; i++)
+	{
+		int index = (int)events[i].data.u32;
+		if (index < count)
+			handlers[index]->OnReadable(sockets[index]);
+	}
+
+	return ready < 0 ? 0 : ready;
+#else
+	fd_set readable;
+	FD_ZERO(&readable);
+
+	NativeSocket highest = 0;
+	for (int i = 0; i < count; i++)
+	{
+		NativeSocket handle = (NativeSocket)sockets[i]->GetPollHandle();
+		FD_SET(handle, &readable);
+		if (handle > highest)
+			highest = handle;
+	}
+
+	timeval timeout;
+	timeout.tv_sec = a_timeoutMs / 1000;
+	timeout.tv_usec = (a_timeoutMs % 1000) * 1000;
+
+	int ready = select((int)highest + 1, &readable, 0, 0, &timeout);
+	if (ready <= 0)
+		return 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		if (FD_ISSET((NativeSocket)sockets[i]->GetPollHandle(), &readable))
+			handlers[i]->OnReadable(sockets[i]);
+	}
+
+	return ready;
+#endif
+}
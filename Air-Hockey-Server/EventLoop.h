@@ -0,0 +1,39 @@
+#pragma once
+#include "../Air-Hockey/NetSocket.h"
+
+// --------------------------------------------------------
+// Something that wants to hear when a socket has packets
+// --------------------------------------------------------
+class EventHandler
+{
+public:
+	virtual ~EventHandler() {}
+	virtual void OnReadable(UdpSocket* a_socket) = 0;
+};
+
+// --------------------------------------------------------
+// Readiness loop over a handful of sockets.  Uses epoll on
+// Linux and select() everywhere else.
+// --------------------------------------------------------
+class EventLoop
+{
+public:
+	EventLoop();
+	~EventLoop();
+
+	bool Add(UdpSocket* a_socket, EventHandler* a_handler);
+	void Remove(UdpSocket* a_socket);
+
+	// Waits up to a_timeoutMs for packets and calls the handler of every
+	// ready socket.  Returns how many sockets were ready
+	int Poll(int a_timeoutMs);
+
+private:
+	static const int MAX_SOCKETS = 16;
+
+	UdpSocket* sockets[MAX_SOCKETS];
+	EventHandler* handlers[MAX_SOCKETS];
+	int count;
+
+	intptr_t epollHandle;
+};
@@ -0,0 +1,70 @@
+#include "LatencyHistogram.h"
+#include <cstring>
+
+LatencyHistogram::LatencyHistogram()
+{
+	Reset();
+}
+
+void LatencyHistogram::Reset()
+{
+	memset(buckets, 0, sizeof(buckets));
+	count = 0;
+	max = 0;
+}
+
+int LatencyHistogram::BucketFor(uint32_t a_us)
+{
+	if (a_us < EXACT_BUCKETS)
+		return (int)a_us;
+
+	int highBit = 31;
+	while (!(a_us & (1u << highBit)))
+		highBit--;
+
+	//Keep the top SUB_BUCKET_BITS below the leading one
+	int shift = highBit - SUB_BUCKET_BITS;
+	int subBucket = (int)((a_us >> shift) & ((1 << SUB_BUCKET_BITS) - 1));
+	return EXACT_BUCKETS + (shift - 1) * (1 << SUB_BUCKET_BITS) + subBucket;
+}
+
+uint32_t LatencyHistogram::ValueFor(int a_bucket)
+{
+	if (a_bucket < EXACT_BUCKETS)
+		return (uint32_t)a_bucket;
+
+	int shift = (a_bucket - EXACT_BUCKETS) / (1 << SUB_BUCKET_BITS) + 1;
+	uint32_t subBucket = (uint32_t)((a_bucket - EXACT_BUCKETS) % (1 << SUB_BUCKET_BITS));
+
+	//Upper edge of the bucket, so percentiles never under-report
+	return (((1u << SUB_BUCKET_BITS) | subBucket) << shift) + ((1u << shift) - 1);
+}
+
+void LatencyHistogram::Record(uint64_t a_us)
+{
+	uint32_t us = a_us > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)a_us;
+
+	buckets[BucketFor(us)]++;
+	count++;
+	if (us > max)
+		max = us;
+}
+
+uint32_t LatencyHistogram::Percentile(double a_fraction)
+{
+	if (count == 0)
+		return 0;
+
+	uint64_t target = (uint64_t)(a_fraction * (double)count);
+	if (target >= count)
+		target = count - 1;
+
+	uint64_t seen = 0;
+	for (int i = 0; i < BUCKET_COUNT; i++)
+	{
+		seen += buckets[i];
+		if (seen > target)
+			return ValueFor(i) < max ? ValueFor(i) : max;
+	}
+	return max;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+
+// --------------------------------------------------------
+// Fixed-size log-linear histogram of microsecond timings.
+// Values under 128us are exact, larger ones are bucketed to
+// within 1/64 of their value.  Recording never allocates.
+// --------------------------------------------------------
+class LatencyHistogram
+{
+public:
+	LatencyHistogram();
+
+	void Record(uint64_t a_us);
+	void Reset();
+
+	// a_fraction is 0..1, e.g. 0.99 for p99
+	uint32_t Percentile(double a_fraction);
+
+	uint64_t GetCount() { return count; }
+	uint32_t GetMax() { return max; }
+
+private:
+	static const int EXACT_BUCKETS = 128;
+	static const int SUB_BUCKET_BITS = 6;
+	static const int BUCKET_COUNT = EXACT_BUCKETS + (32 - 7) * (1 << SUB_BUCKET_BITS);
+
+	uint32_t buckets[BUCKET_COUNT];
+	uint64_t count;
+	uint32_t max;
+
+	static int BucketFor(uint32_t a_us);
+	static uint32_t ValueFor(int a_bucket);
+};
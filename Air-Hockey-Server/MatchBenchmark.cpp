@@ -0,0 +1,201 @@
+#include "MatchBenchmark.h"
+#include "../Air-Hockey/Match.h"
+#include "../Air-Hockey/FixedTimestep.h"
+#include "../Air-Hockey/NetSocket.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// How fast the puck always moves (see Puck)
+static const float PUCK_SPEED = 3.0f;
+
+// Simple bot: chase the puck up and down, resting a second now and then
+static unsigned char BotInput(Match& a_match, int a_slot, float a_time)
+{
+	if (((int)a_time + a_slot) % 3 == 0)
+		return 0;
+
+	float puckZ = a_match.GetPuck()->GetPosition().z;
+	float paddleZ = a_match.GetPaddle(a_slot)->GetPosition().z;
+
+	if (puckZ > paddleZ + 0.1f)
+		return PADDLE_UP;
+	if (puckZ < paddleZ - 0.1f)
+		return PADDLE_DOWN;
+	return 0;
+}
+
+// The frame times of one pattern, a_seconds long in total
+static std::vector<float> MakeFrames(int a_pattern, int a_seconds)
+{
+	std::vector<float> frames;
+	uint32_t seed = 12345;
+	float total = 0.0f;
+	while (total < (float)a_seconds)
+	{
+		float dt;
+		seed = seed * 1664525u + 1013904223u;
+		switch (a_pattern)
+		{
+		case 0: dt = 1.0f / 60.0f; break;
+		case 1: dt = 1.0f / 144.0f; break;
+		default:
+			//2 to 40 ms, and every few hundred frames a hitch of up to 1.5 s
+			dt = 0.002f + (seed >> 8) % 38000 / 1000000.0f;
+			if (a_pattern == 3 && (seed >> 4) % 400 == 0)
+				dt = 0.5f + (seed >> 12) % 1000 / 1000.0f;
+			break;
+		}
+		frames.push_back(dt);
+		total += dt;
+	}
+	return frames;
+}
+
+struct TimestepRun
+{
+	MatchState Final;
+	uint64_t Steps;
+	uint64_t DroppedSteps;
+	int MostStepsInFrame;
+	double SnappedJudder;		// Mean distance per frame the puck's drawn motion is off from its speed
+	double BlendedJudder;
+	uint64_t StepUs;
+};
+
+// Each frame's drawn puck motion against how far it really moves in that time
+static void AddJudder(const MatchState& a_shown, const MatchState& a_lastShown, float a_dt, double& a_judder, int& a_frames)
+{
+	//Goals move the puck back to the middle
+	if (a_shown.Score[0] != a_lastShown.Score[0] || a_shown.Score[1] != a_lastShown.Score[1])
+		return;
+
+	float dx = a_shown.PuckX - a_lastShown.PuckX;
+	float dz = a_shown.PuckZ - a_lastShown.PuckZ;
+	a_judder += fabs(sqrt(dx * dx + dz * dz) - PUCK_SPEED * a_dt);
+	a_frames++;
+}
+
+// Steps by each frame's own time, the way local play used to
+static TimestepRun RunVariable(const std::vector<float>& a_frames)
+{
+	TimestepRun run = {};
+	Match match;
+	float time = 0.0f;
+
+	uint64_t start = NetTimeUs();
+	for (size_t f = 0; f < a_frames.size(); f++)
+	{
+		match.Step(a_frames[f], BotInput(match, 0, time), BotInput(match, 1, time));
+		time += a_frames[f];
+		run.Steps++;
+	}
+	run.StepUs = NetTimeUs() - start;
+	run.MostStepsInFrame = 1;
+	match.GetState(run.Final);
+	return run;
+}
+
+// Fixed steps until a_steps have run, however many frames that takes
+static TimestepRun RunFixed(const std::vector<float>& a_frames, uint64_t a_steps)
+{
+	TimestepRun run = {};
+	Match match;
+	FixedTimestep clock(MATCH_STEP_DT, MATCH_MAX_STEPS);
+
+	MatchState previous;
+	MatchState current;
+	match.GetState(current);
+	previous = current;
+	MatchState lastSnapped = current;
+	MatchState lastBlended = current;
+	int snappedFrames = 0;
+	int blendedFrames = 0;
+
+	for (size_t f = 0; run.Steps < a_steps; f = (f + 1) % a_frames.size())
+	{
+		int steps = clock.Advance(a_frames[f]);
+		if (steps > run.MostStepsInFrame)
+			run.MostStepsInFrame = steps;
+
+		uint64_t start = NetTimeUs();
+		for (int i = 0; i < steps && run.Steps < a_steps; i++)
+		{
+			float time = run.Steps * MATCH_STEP_DT;
+			previous = current;
+			match.Step(MATCH_STEP_DT, BotInput(match, 0, time), BotInput(match, 1, time));
+			match.GetState(current);
+			run.Steps++;
+		}
+		run.StepUs += NetTimeUs() - start;
+
+		//Hitches drop time, so the puck really does jump after them
+		if (steps == MATCH_MAX_STEPS)
+		{
+			lastSnapped = current;
+			Match::Interpolate(previous, current, clock.GetAlpha(), lastBlended);
+			continue;
+		}
+
+		MatchState blended;
+		Match::Interpolate(previous, current, clock.GetAlpha(), blended);
+		AddJudder(current, lastSnapped, a_frames[f], run.SnappedJudder, snappedFrames);
+		AddJudder(blended, lastBlended, a_frames[f], run.BlendedJudder, blendedFrames);
+		lastSnapped = current;
+		lastBlended = blended;
+	}
+
+	run.SnappedJudder = snappedFrames ? run.SnappedJudder / snappedFrames : 0.0;
+	run.BlendedJudder = blendedFrames ? run.BlendedJudder / blendedFrames : 0.0;
+	run.DroppedSteps = clock.GetDroppedSteps();
+	match.GetState(run.Final);
+	return run;
+}
+
+static float PuckDistance(const MatchState& a_first, const MatchState& a_second)
+{
+	float dx = a_first.PuckX - a_second.PuckX;
+	float dz = a_first.PuckZ - a_second.PuckZ;
+	return sqrt(dx * dx + dz * dz);
+}
+
+int RunTimestepBenchmark(int a_seconds)
+{
+	const int PATTERNS = 4;
+	const char* names[PATTERNS] = { "60 fps", "144 fps", "jittery", "hitches" };
+	uint64_t steps = (uint64_t)a_seconds * MATCH_STEP_RATE;
+
+	TimestepRun variable[PATTERNS];
+	TimestepRun fixed[PATTERNS];
+	for (int p = 0; p < PATTERNS; p++)
+	{
+		std::vector<float> frames = MakeFrames(p, a_seconds);
+		variable[p] = RunVariable(frames);
+		fixed[p] = RunFixed(frames, steps);
+	}
+
+	printf("%d s of play, fixed steps at %d Hz (at most %d a frame)\n", a_seconds, MATCH_STEP_RATE, MATCH_MAX_STEPS);
+	printf("%-8s %22s %22s %18s %16s %10s %8s\n", "frames", "variable: puck off by", "fixed: puck off by", "uneven: snapped", "interpolated", "dropped", "ns/step");
+
+	bool ok = true;
+	for (int p = 0; p < PATTERNS; p++)
+	{
+		const TimestepRun& run = fixed[p];
+		bool same = memcmp(&run.Final, &fixed[0].Final, sizeof(MatchState)) == 0;
+		printf("%-8s %22.3f %22.3f %18.5f %16.5f %10llu %8.1f\n", names[p],
+			PuckDistance(variable[p].Final, fixed[0].Final), PuckDistance(run.Final, fixed[0].Final),
+			run.SnappedJudder, run.BlendedJudder, (unsigned long long)run.DroppedSteps,
+			run.StepUs * 1000.0 / (double)run.Steps);
+
+		//Same steps, same inputs: the same match, to the bit
+		ok = ok && same && run.MostStepsInFrame <= MATCH_MAX_STEPS;
+	}
+
+	//Only the hitches are too long to catch up on, and 144 fps
+	//against 240 Hz steps is the uneven case interpolation fixes
+	ok = ok && fixed[3].DroppedSteps > 0 && fixed[0].DroppedSteps == 0 && fixed[1].DroppedSteps == 0 &&
+		fixed[1].BlendedJudder < fixed[1].SnappedJudder;
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+// --------------------------------------------------------
+// Plays a_seconds of a bot match under a few frame-time
+// patterns (steady 60 and 144 fps, jittery, and jittery
+// with long hitches), once stepping by each frame's time
+// and once through a FixedTimestep at MATCH_STEP_RATE.
+// Prints how far each run's puck ended from the steady
+// 60 fps fixed run, how unevenly the puck moved frame to
+// frame drawn at the latest step and drawn between the
+// last two, and the steps dropped after hitches.  Checks
+// that every fixed run ends in exactly the same state,
+// that no frame ran more than MATCH_MAX_STEPS steps, and
+// that interpolating evens the motion out.
+// --------------------------------------------------------
+int RunTimestepBenchmark(int a_seconds);
@@ -0,0 +1,232 @@
+#include "MatchShard.h"
+#include <cstdio>
+#include <mutex>
+
+#ifdef _WIN32
+#include <Windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Caps on work per wakeup so a packet flood can't starve the tick
+static const int MAX_PACKETS_PER_WAKEUP = 512;
+static const int RECEIVE_BATCH_SIZE = 64;
+
+// A shard this many ticks behind gives up on them rather than spiralling
+static const int MAX_TICKS_BEHIND = 8;
+
+static const uint64_t TICK_PERIOD_US = 1000000 / NET_TICK_RATE;
+static const int MATCH_ID_COUNT = 65536;
+
+//Shards share stdout
+static std::mutex reportLock;
+
+MatchShard::MatchShard(int a_index, int a_shardCount, int a_capacity)
+{
+	index = a_index;
+	shardCount = a_shardCount;
+	capacity = a_capacity;
+
+	matches = new ServerMatch[capacity];
+	matchCount = 0;
+
+	matchLookup = new int[MATCH_ID_COUNT];
+	for (int i = 0; i < MATCH_ID_COUNT; i++)
+		matchLookup[i] = -1;
+
+	running = false;
+	ticksRun = 0;
+	ticksSkipped = 0;
+	reportIntervalUs = 0;
+
+	packets = new PacketBatch(RECEIVE_BATCH_SIZE, NET_MAX_PACKET_SIZE);
+}
+
+MatchShard::~MatchShard()
+{
+	Stop();
+
+	delete[] matches;
+	delete[] matchLookup;
+	delete packets;
+}
+
+bool MatchShard::Open(uint16_t a_port, NetIoMode a_ioMode)
+{
+	return socket.Open(a_port, a_ioMode);
+}
+
+void MatchShard::Start()
+{
+	if (running)
+		return;
+
+	running = true;
+	thread = std::thread(&MatchShard::Run, this);
+}
+
+void MatchShard::Stop()
+{
+	running = false;
+	if (thread.joinable())
+		thread.join();
+}
+
+ServerMatch* MatchShard::FindOrCreateMatch(uint16_t a_id, bool a_create)
+{
+	int position = matchLookup[a_id];
+	if (position != -1)
+		return &matches[position];
+
+	//Only connects start matches, and only on the shard that owns the id
+	if (!a_create || matchCount == capacity || NetShardForMatch(a_id, shardCount) != index)
+		return 0;
+
+	position = matchCount++;
+	matches[position].Reset(a_id);
+	matchLookup[a_id] = position;
+	return &matches[position];
+}
+
+void MatchShard::RemoveMatch(int a_position)
+{
+	matchLookup[matches[a_position].GetID()] = -1;
+
+	//Move the last match into the hole to keep the pool packed
+	int last = matchCount - 1;
+	if (a_position != last)
+	{
+		matches[a_position] = matches[last];
+		matchLookup[matches[a_position].GetID()] = a_position;
+	}
+	matchCount--;
+}
+
+void MatchShard::ReceivePackets()
+{
+	for (int received = 0; received < MAX_PACKETS_PER_WAKEUP;)
+	{
+		int count = socket.ReceiveBatch(*packets);
+		if (count == 0)
+			break;
+
+		for (int i = 0; i < count; i++)
+		{
+			int size = packets->GetSize(i);
+			if (size < (int)sizeof(NetHeader))
+				continue;
+
+			const unsigned char* data = packets->GetData(i);
+			const NetHeader* header = (const NetHeader*)data;
+			ServerMatch* match = FindOrCreateMatch(header->MatchID, header->Type == NET_CONNECT);
+			if (match)
+				match->HandlePacket(packets->GetAddress(i), data, size, &socket, &sender);
+		}
+		received += count;
+	}
+}
+
+void MatchShard::TickMatches(uint32_t a_nowMs)
+{
+	//Simulate everything first, then send, so each pass stays in one kind of work
+	for (int i = 0; i < matchCount; i++)
+		matches[i].Tick(a_nowMs);
+
+	for (int i = 0; i < matchCount; i++)
+		matches[i].SendSnapshots(&socket, &sender);
+
+	//Matches everyone has left (or timed out of) are recycled
+	for (int i = matchCount - 1; i >= 0; i--)
+	{
+		if (matches[i].GetClientCount() == 0)
+			RemoveMatch(i);
+	}
+
+	sender.Flush(&socket);
+}
+
+static void PinThreadToCore(int a_core)
+{
+#ifdef _WIN32
+	SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << (a_core % (sizeof(DWORD_PTR) * 8)));
+#elif defined(__linux__)
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	CPU_SET(a_core % CPU_SETSIZE, &cpus);
+	pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#endif
+}
+
+void MatchShard::Run()
+{
+	PinThreadToCore(index);
+
+	uint64_t nextTick = NetTimeUs() + TICK_PERIOD_US;
+	uint64_t reportStart = NetTimeUs();
+
+	while (running)
+	{
+		uint64_t now = NetTimeUs();
+
+		//Sleep on the socket until the next tick is due
+		if (now < nextTick)
+		{
+			if (socket.Wait((int)(nextTick - now)))
+				ReceivePackets();
+			continue;
+		}
+
+		//Catch anything that arrived right at the deadline
+		ReceivePackets();
+
+		tickLateness.Record(now - nextTick);
+		TickMatches((uint32_t)(now / 1000));
+
+		uint64_t done = NetTimeUs();
+		tickWork.Record(done - now);
+		ticksRun++;
+
+		nextTick += TICK_PERIOD_US;
+		if (done > nextTick + MAX_TICKS_BEHIND * TICK_PERIOD_US)
+		{
+			ticksSkipped += (done - nextTick) / TICK_PERIOD_US;
+			nextTick = done + TICK_PERIOD_US;
+		}
+
+		if (reportIntervalUs && done - reportStart >= reportIntervalUs)
+		{
+			Report((float)(done - reportStart) / 1000000.0f);
+			reportStart = done;
+		}
+	}
+}
+
+void MatchShard::Report(float a_seconds)
+{
+	int clients = 0;
+	for (int i = 0; i < matchCount; i++)
+		clients += matches[i].GetClientCount();
+
+	NetIoStats io = socket.GetStats();
+
+	{
+		std::lock_guard<std::mutex> lock(reportLock);
+		printf("shard %d  port %u  matches %d  clients %d  ticks %.0f/s  skipped %llu  "
+			"work us p50 %u p99 %u p999 %u max %u  late us p50 %u p99 %u p999 %u  "
+			"io %s  pps in %.0f out %.0f  syscalls/tick %.1f\n",
+			index, (unsigned)socket.GetPort(), matchCount, clients, (double)ticksRun / a_seconds,
+			(unsigned long long)ticksSkipped,
+			tickWork.Percentile(0.5), tickWork.Percentile(0.99), tickWork.Percentile(0.999), tickWork.GetMax(),
+			tickLateness.Percentile(0.5), tickLateness.Percentile(0.99), tickLateness.Percentile(0.999),
+			NetIoModeName(socket.GetIoMode()), (double)io.PacketsIn / a_seconds, (double)io.PacketsOut / a_seconds,
+			ticksRun ? (double)io.Syscalls / ticksRun : 0.0);
+		fflush(stdout);
+	}
+
+	tickWork.Reset();
+	tickLateness.Reset();
+	ticksRun = 0;
+	ticksSkipped = 0;
+	socket.ResetStats();
+}
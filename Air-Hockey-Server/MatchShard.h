@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <thread>
+#include "../Air-Hockey/ServerMatch.h"
+#include "LatencyHistogram.h"
+
+// --------------------------------------------------------
+// One core's worth of matches.  Each shard owns a socket,
+// a thread running its own event loop, and a contiguous
+// pool of matches that are all ticked together off a single
+// timer instead of one timer per match.
+// --------------------------------------------------------
+class MatchShard
+{
+public:
+	MatchShard(int a_index, int a_shardCount, int a_capacity);
+	~MatchShard();
+
+	// Binds the shard's socket; call before Start()
+	bool Open(uint16_t a_port, NetIoMode a_ioMode);
+
+	void Start();
+	void Stop();
+
+	// Prints tick latency percentiles every this many seconds (0 = never)
+	void SetReportInterval(float a_seconds) { reportIntervalUs = (uint64_t)(a_seconds * 1000000.0f); }
+
+	int GetIndex() { return index; }
+	uint16_t GetPort() { return socket.GetPort(); }
+	int GetMatchCount() { return matchCount; }
+	LatencySimulator* GetSimulator() { return &sender; }
+
+private:
+	int index;
+	int shardCount;
+
+	UdpSocket socket;
+	LatencySimulator sender;
+
+	//Active matches are packed at the front so a tick walks one array
+	ServerMatch* matches;
+	int matchCount;
+	int capacity;
+
+	//MatchID -> position in matches, -1 if not hosted here
+	int* matchLookup;
+
+	std::thread thread;
+	std::atomic<bool> running;
+
+	//Time spent ticking the whole batch, and how late each batch started
+	LatencyHistogram tickWork;
+	LatencyHistogram tickLateness;
+	uint64_t ticksRun;
+	uint64_t ticksSkipped;
+	uint64_t reportIntervalUs;
+
+	//Received packets land here, one batch per socket call
+	PacketBatch* packets;
+
+	void Run();
+	void ReceivePackets();
+	void TickMatches(uint32_t a_nowMs);
+	void Report(float a_seconds);
+
+	ServerMatch* FindOrCreateMatch(uint16_t a_id, bool a_create);
+	void RemoveMatch(int a_position);
+};
@@ -0,0 +1,96 @@
+#include "NetBenchmark.h"
+#include "../Air-Hockey/NetSocket.h"
+#include <cstdio>
+#include <cstring>
+
+// About the size of a delta snapshot with its header
+static const int PACKET_SIZE = 24;
+
+static const int RECEIVE_BATCH_SIZE = 64;
+
+//Spins until everything sent this tick is in, or gives up on the rest
+static int Drain(UdpSocket& a_receiver, PacketBatch& a_batch, int a_expected, uint64_t& a_busyUs)
+{
+	int received = 0;
+	uint64_t start = NetTimeUs();
+	uint64_t deadline = start + 20000;
+	while (received < a_expected)
+	{
+		int count = a_receiver.ReceiveBatch(a_batch);
+		received += count;
+		if (count == 0 && !a_receiver.Wait(1000) && NetTimeUs() > deadline)
+			break;
+	}
+	a_busyUs += NetTimeUs() - start;
+	return received;
+}
+
+static bool RunMode(NetIoMode a_mode, int a_packetsPerTick, int a_ticks)
+{
+	UdpSocket sender;
+	UdpSocket receiver;
+	if (!sender.Open(0, a_mode) || !receiver.Open(0, a_mode))
+	{
+		printf("Couldn't open sockets\n");
+		return false;
+	}
+
+	//Ring mode falls back when io_uring isn't built in
+	if (sender.GetIoMode() != a_mode)
+	{
+		printf("%-8s not available in this build\n", NetIoModeName(a_mode));
+		return true;
+	}
+
+	PacketBatch packets(RECEIVE_BATCH_SIZE);
+	NetAddress to = NetMakeAddress(127, 0, 0, 1, receiver.GetPort());
+
+	unsigned char payload[PACKET_SIZE];
+	memset(payload, 0xA5, sizeof(payload));
+
+	uint64_t sendUs = 0;
+	uint64_t receiveUs = 0;
+	uint64_t received = 0;
+
+	sender.ResetStats();
+	receiver.ResetStats();
+
+	for (int tick = 0; tick < a_ticks; tick++)
+	{
+		uint64_t start = NetTimeUs();
+		for (int i = 0; i < a_packetsPerTick; i++)
+		{
+			payload[0] = (unsigned char)i;
+			sender.Queue(to, payload, sizeof(payload));
+		}
+		sender.Flush();
+		sendUs += NetTimeUs() - start;
+
+		received += Drain(receiver, packets, a_packetsPerTick, receiveUs);
+	}
+
+	NetIoStats sent = sender.GetStats();
+	NetIoStats got = receiver.GetStats();
+	uint64_t total = (uint64_t)a_packetsPerTick * a_ticks;
+
+	//Each side ran alone on this core, so its packets over its own time is per-core throughput
+	printf("%-8s send %9.0f pps/core  %6.2f syscalls/tick   receive %9.0f pps/core  %6.2f syscalls/tick   lost %llu\n",
+		NetIoModeName(a_mode),
+		sendUs ? sent.PacketsOut * 1000000.0 / sendUs : 0.0, (double)sent.Syscalls / a_ticks,
+		receiveUs ? received * 1000000.0 / receiveUs : 0.0, (double)got.Syscalls / a_ticks,
+		(unsigned long long)(total - received));
+	return true;
+}
+
+int RunIoBenchmark(int a_packetsPerTick, int a_ticks)
+{
+	printf("%d ticks of %d packets, %d bytes each\n", a_ticks, a_packetsPerTick, PACKET_SIZE);
+
+	NetIoMode modes[] = { NET_IO_SINGLE, NET_IO_BATCHED, NET_IO_RING };
+	for (int i = 0; i < 3; i++)
+	{
+		if (!RunMode(modes[i], a_packetsPerTick, a_ticks))
+			return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+// --------------------------------------------------------
+// Pushes a_ticks bursts of a_packetsPerTick snapshot-sized
+// packets over loopback with each socket I/O mode in turn,
+// and prints packets per second per core and syscalls per
+// tick for the sending and receiving side.
+// --------------------------------------------------------
+int RunIoBenchmark(int a_packetsPerTick, int a_ticks);
@@ -0,0 +1,101 @@
+#include "RelayBenchmark.h"
+#include "SpectatorRelay.h"
+#include "../Air-Hockey/Match.h"
+#include "../Air-Hockey/SpectatorClient.h"
+#include <cstdio>
+#include <cstring>
+
+int RunRelayBenchmark(int a_spectators, int a_ticks)
+{
+	const uint16_t matchID = 1;
+
+	SpectatorRelay relay;
+	NetAddress noServer = {};
+	if (!relay.Start(0, noServer, 1))
+	{
+		printf("Couldn't open relay socket\n");
+		return 1;
+	}
+
+	//Everything in 127/8 is loopback, so each fake spectator gets its own
+	//address and all of them land on one socket nobody reads
+	UdpSocket sink;
+	sink.Open(0);
+
+	uint32_t now = NetTimeMs();
+	for (int i = 0; i < a_spectators; i++)
+	{
+		NetAddress address;
+		address.IP = 0x7F010000u + (uint32_t)i;
+		address.Port = sink.GetPort();
+		relay.Subscribe(matchID, address, 0, now);
+	}
+
+	SpectatorClient watcher;
+	watcher.Connect(NetMakeAddress(127, 0, 0, 1, relay.GetPort()), matchID);
+	relay.RunOnce(100);
+
+	Match match;
+	MatchState state;
+	MatchState seen;
+	MatchState expected;
+	QuantizedState quantized;
+	int mismatches = 0;
+	uint64_t busyUs = 0;
+
+	for (int tick = 0; tick < a_ticks; tick++)
+	{
+		//Paddles sweep up and down so they change some ticks and not others
+		unsigned char p1 = (tick / 90) % 2 ? PADDLE_UP : PADDLE_DOWN;
+		unsigned char p2 = (tick / 150) % 2 ? PADDLE_DOWN : 0;
+		match.Step(NET_TICK_DT, p1, p2);
+		match.GetState(state);
+
+		//Fake spectators ack keyframes at different lags, spreading them across baselines
+		if (state.Tick % NET_KEYFRAME_INTERVAL == 1 && state.Tick > NET_KEYFRAME_INTERVAL)
+		{
+			uint32_t newest = state.Tick - 1;
+			for (int i = 0; i < a_spectators; i++)
+			{
+				NetAddress address;
+				address.IP = 0x7F010000u + (uint32_t)i;
+				address.Port = sink.GetPort();
+
+				uint32_t lag = (uint32_t)(i % NET_SPECTATOR_BASELINES) * NET_KEYFRAME_INTERVAL;
+				relay.Subscribe(matchID, address, newest > lag ? newest - lag : 0, NetTimeMs());
+			}
+		}
+
+		uint64_t start = NetTimeUs();
+		relay.Publish(matchID, state);
+		busyUs += NetTimeUs() - start;
+
+		//Lets the relay hear the real spectator's acks
+		relay.RunOnce(0);
+		watcher.Update();
+
+		//Spectators see the state at wire precision
+		SnapshotCodec::Quantize(state, quantized);
+		SnapshotCodec::Dequantize(quantized, expected);
+
+		if (watcher.HasState())
+		{
+			watcher.GetState(seen);
+			if (seen.Tick == state.Tick && memcmp(&seen, &expected, sizeof(MatchState)) != 0)
+				mismatches++;
+		}
+	}
+
+	RelayStats stats = relay.GetStats();
+	double seconds = (double)a_ticks / NET_TICK_RATE;
+	double usPerTick = (double)busyUs / a_ticks;
+	double perCore = usPerTick > 0.0 ? (a_spectators + 1) * (1000000.0 / NET_TICK_RATE) / usPerTick : 0.0;
+
+	printf("spectators %d  ticks %d  encodes/tick %.2f  avg packet %.1f bytes\n",
+		a_spectators + 1, a_ticks, (double)stats.Encodes / a_ticks, (double)stats.BytesOut / stats.PacketsOut);
+	printf("fan-out %.1f us/tick  spectators/core at %d Hz: %.0f\n", usPerTick, NET_TICK_RATE, perCore);
+	printf("bytes/spectator/s %.0f  real spectator states %u  mismatches %d\n",
+		(double)stats.BytesOut / (a_spectators + 1) / seconds, watcher.GetStatesReceived(), mismatches);
+
+	return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+// --------------------------------------------------------
+// Fans a simulated match out to a_spectators fake spectators
+// on one core as fast as it can for a_ticks ticks, checks a
+// real SpectatorClient decodes every state, and prints
+// spectators-per-core and bytes per spectator per second.
+// --------------------------------------------------------
+int RunRelayBenchmark(int a_spectators, int a_ticks);
@@ -0,0 +1,660 @@
+#include "RenderBenchmark.h"
+#include "../Air-Hockey/RecordingBackend.h"
+#include "../Air-Hockey/FilteringBackend.h"
+#include "../Air-Hockey/GameEntity.h"
+#include "../Air-Hockey/Mesh.h"
+#include "../Air-Hockey/Material.h"
+#include "../Air-Hockey/RenderQueue.h"
+#include "../Air-Hockey/ShaderReflection.h"
+#include "../Air-Hockey/TransientRing.h"
+#include "../Air-Hockey/PassRecorder.h"
+#include "../Air-Hockey/TripleBuffer.h"
+#include "../Air-Hockey/NetSocket.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+//Draws every entity once per frame and returns the time taken in us, not counting the hashing.
+//a_recorder is where the commands end up, hashed if a_firstHash is given
+static uint64_t DrawFrames(RenderBackend& a_backend, RecordingBackend& a_recorder, ID3D11Buffer* a_objectBuffer, std::vector<GameEntity*>& a_entities, int a_frames, uint64_t* a_firstHash, int* a_mismatches)
+{
+	uint64_t elapsed = 0;
+	for (int frame = 0; frame < a_frames; frame++)
+	{
+		uint64_t start = NetTimeUs();
+		a_backend.BeginFrame();
+
+		for (size_t i = 0; i < a_entities.size(); i++)
+		{
+			XMFLOAT4X4 world = a_entities[i]->GetWorldMatrix();
+			a_backend.UpdateBuffer(a_objectBuffer, &world, sizeof(world));
+			a_backend.SetConstantBuffer(RENDER_STAGE_VERTEX, 0, a_objectBuffer);
+			a_entities[i]->Draw(&a_backend);
+		}
+		elapsed += NetTimeUs() - start;
+
+		//Nothing moves, so every recorded frame must match the first
+		if (a_firstHash && !a_recorder.GetCommands().empty())
+		{
+			uint64_t hash = a_recorder.HashCommands();
+			if (frame == 0)
+				*a_firstHash = hash;
+			else if (hash != *a_firstHash)
+				(*a_mismatches)++;
+		}
+	}
+	return elapsed;
+}
+
+int RunRenderBenchmark(int a_entities, int a_frames)
+{
+	RecordingBackend recorder(true);
+	RecordingBackend counter(false);
+
+	//A quad is enough; only the calls matter here
+	Vertex vertices[4] = {};
+	vertices[0].Position = XMFLOAT3(-1, 0, -1);
+	vertices[1].Position = XMFLOAT3(1, 0, -1);
+	vertices[2].Position = XMFLOAT3(1, 0, 1);
+	vertices[3].Position = XMFLOAT3(-1, 0, 1);
+	for (int i = 0; i < 4; i++)
+		vertices[i].Normal = XMFLOAT3(0, 1, 0);
+	unsigned int indices[6] = { 0, 2, 1, 0, 3, 2 };
+
+	Mesh* recordedMesh = new Mesh(vertices, 4, indices, 6, &recorder);
+	Mesh* countedMesh = new Mesh(vertices, 4, indices, 6, &counter);
+	ID3D11Buffer* recordedObject = recorder.CreateBuffer(RENDER_BUFFER_CONSTANT, sizeof(XMFLOAT4X4), 0, false);
+	ID3D11Buffer* countedObject = counter.CreateBuffer(RENDER_BUFFER_CONSTANT, sizeof(XMFLOAT4X4), 0, false);
+
+	std::vector<GameEntity*> recorded;
+	std::vector<GameEntity*> counted;
+	for (int i = 0; i < a_entities; i++)
+	{
+		GameEntity* entity = new GameEntity(recordedMesh, 0);
+		entity->SetPosition((float)(i % 64), 0.0f, (float)(i / 64));
+		recorded.push_back(entity);
+
+		entity = new GameEntity(countedMesh, 0);
+		entity->SetPosition((float)(i % 64), 0.0f, (float)(i / 64));
+		counted.push_back(entity);
+	}
+
+	uint64_t firstHash = 0;
+	int mismatches = 0;
+	uint64_t recordUs = DrawFrames(recorder, recorder, recordedObject, recorded, a_frames, &firstHash, &mismatches);
+	uint64_t countUs = DrawFrames(counter, counter, countedObject, counted, a_frames, 0, 0);
+
+	//The same draws again, with redundant binds dropped before they're recorded
+	RecordingBackend filteredRecorder(true);
+	FilteringBackend filtered(&filteredRecorder);
+	uint64_t filterUs = DrawFrames(filtered, filteredRecorder, recordedObject, recorded, a_frames, 0, 0);
+	const RenderFilterStats& filterStats = filtered.GetFilterStats();
+
+	const RenderFrameStats& stats = recorder.GetFrameStats();
+	size_t commands = recorder.GetCommands().size();
+
+	double draws = (double)a_entities * a_frames;
+	printf("%d entities, %d frames\n", a_entities, a_frames);
+	printf("recording   %7.1f ns/draw  (%d commands/frame, hash %016llx)\n", recordUs * 1000.0 / draws, (int)commands, (unsigned long long)firstHash);
+	printf("null        %7.1f ns/draw\n", countUs * 1000.0 / draws);
+	printf("filtered    %7.1f ns/draw  (%d commands/frame, binds issued %u dropped %u)\n", filterUs * 1000.0 / draws,
+		(int)filteredRecorder.GetCommands().size(), filterStats.Issued, filterStats.Filtered);
+	printf("per frame: draws %u  indices %u  state changes %u  uploads %u (%llu bytes)\n",
+		stats.Draws, stats.Indices, stats.StateChanges, stats.Uploads, (unsigned long long)stats.BytesUploaded);
+	printf("frames differing from the first %d of %d\n", mismatches, a_frames - 1);
+
+	//Both backends must have counted the same frame
+	const RenderFrameStats& nullStats = counter.GetFrameStats();
+	bool ok = mismatches == 0 &&
+		stats.Draws == (uint32_t)a_entities &&
+		stats.Uploads == (uint32_t)a_entities &&
+		commands == (size_t)a_entities * 5 &&
+		nullStats.Draws == stats.Draws &&
+		nullStats.StateChanges == stats.StateChanges;
+
+	//One mesh and one object buffer: after the first frame every bind is redundant
+	ok = ok && filterStats.Issued == (a_frames > 1 ? 0u : 3u) &&
+		filterStats.Issued + filterStats.Filtered == stats.StateChanges &&
+		filtered.GetFrameStats().StateChanges == stats.StateChanges &&
+		filteredRecorder.GetFrameStats().Draws == stats.Draws;
+
+	for (int i = 0; i < a_entities; i++)
+	{
+		delete recorded[i];
+		delete counted[i];
+	}
+	delete recordedMesh;
+	delete countedMesh;
+	recorder.ReleaseBuffer(recordedObject);
+	counter.ReleaseBuffer(countedObject);
+
+	//Every buffer made through a backend went back to it
+	if (recorder.GetLiveBuffers() != 0 || counter.GetLiveBuffers() != 0)
+	{
+		printf("leaked buffers %d\n", recorder.GetLiveBuffers() + counter.GetLiveBuffers());
+		ok = false;
+	}
+
+	return ok ? 0 : 1;
+}
+
+int RunQueueBenchmark(int a_entities, int a_frames, bool a_instanced)
+{
+	const int SHADERS = 4;
+	const int MATERIALS = 8;
+	const int TEXTURES = 16;
+	const int MESHES = 16;
+
+	RecordingBackend backend(false);
+
+	//Never loaded; the queue only needs them to tell draws apart
+	SimpleVertexShader* vertexShaders[SHADERS];
+	SimpleVertexShader* instancedShaders[SHADERS];
+	SimplePixelShader* pixelShaders[SHADERS];
+	for (int i = 0; i < SHADERS; i++)
+	{
+		vertexShaders[i] = new SimpleVertexShader(0, &backend);
+		instancedShaders[i] = new SimpleVertexShader(0, &backend);
+		pixelShaders[i] = new SimplePixelShader(0, &backend);
+	}
+
+	Material* materials[MATERIALS];
+	for (int i = 0; i < MATERIALS; i++)
+		materials[i] = new Material(vertexShaders[i % SHADERS], pixelShaders[i % SHADERS]);
+
+	Vertex vertices[3] = {};
+	unsigned int indices[3] = { 0, 1, 2 };
+	Mesh* meshes[MESHES];
+	for (int i = 0; i < MESHES; i++)
+		meshes[i] = new Mesh(vertices, 3, indices, 3, &backend);
+
+	//Only compared, never used
+	ID3D11ShaderResourceView* textures[TEXTURES];
+	for (int i = 0; i < TEXTURES; i++)
+		textures[i] = (ID3D11ShaderResourceView*)(uintptr_t)((i + 1) << 4);
+
+	unsigned int random = 0x2545F491;
+	std::vector<GameEntity*> entities;
+	std::vector<int> textureOf;
+	for (int i = 0; i < a_entities; i++)
+	{
+		random ^= random << 13; random ^= random >> 17; random ^= random << 5;
+		GameEntity* entity = new GameEntity(meshes[random % MESHES], materials[(random >> 8) % MATERIALS]);
+		entity->SetPosition((float)(random % 97) - 48.0f, 0.0f, (float)((random >> 12) % 89));
+		entities.push_back(entity);
+		textureOf.push_back((random >> 20) % TEXTURES);
+	}
+
+	XMFLOAT4X4 view;
+	XMFLOAT4X4 projection;
+	XMStoreFloat4x4(&view, XMMatrixTranspose(XMMatrixLookAtLH(XMVectorSet(0, 10, -20, 0), XMVectorSet(0, 0, 40, 0), XMVectorSet(0, 1, 0, 0))));
+	XMStoreFloat4x4(&projection, XMMatrixTranspose(XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 200.0f)));
+
+	RenderQueue queue;
+	if (a_instanced)
+	{
+		for (int i = 0; i < SHADERS; i++)
+			queue.SetInstancedShader(vertexShaders[i], instancedShaders[i]);
+	}
+	uint64_t sortUs = 0;
+	uint64_t walkUs = 0;
+	int unsorted = 0;
+	uint32_t groups = 0;
+
+	for (int frame = 0; frame < a_frames; frame++)
+	{
+		for (int i = 0; i < a_entities; i++)
+		{
+			XMFLOAT3 position = entities[i]->GetPosition();
+			entities[i]->SetPosition(position.x, position.y, position.z + ((i & 1) ? 0.01f : -0.01f));
+		}
+
+		queue.BeginFrame();
+		backend.BeginFrame();
+		queue.Begin();
+		queue.SetCamera(view, projection);
+		for (int i = 0; i < a_entities; i++)
+		{
+			Material* material = entities[i]->getMaterial();
+			queue.Submit(RENDER_PASS_OPAQUE, entities[i], material->getVertexShader(), material->getPixelShader(), textures[textureOf[i]], 0);
+		}
+
+		uint64_t start = NetTimeUs();
+		queue.Sort();
+		sortUs += NetTimeUs() - start;
+
+		start = NetTimeUs();
+		queue.Execute(&backend);
+		walkUs += NetTimeUs() - start;
+
+		//Keys come out in order, and state only changes between groups of equal state
+		groups = 0;
+		for (int i = 0; i < queue.GetCount(); i++)
+		{
+			if (i > 0 && queue.GetSortedKey(i) < queue.GetSortedKey(i - 1))
+				unsorted++;
+			if (i == 0 || (queue.GetSortedKey(i) >> RenderQueue::DEPTH_BITS) != (queue.GetSortedKey(i - 1) >> RenderQueue::DEPTH_BITS))
+				groups++;
+		}
+	}
+
+	const RenderQueueStats& stats = queue.GetFrameStats();
+	uint32_t binds = stats.ShaderBinds + stats.TextureBinds + stats.MeshBinds;
+	double items = (double)a_entities * a_frames;
+	printf("%d entities, %d frames, %d shaders %d materials %d textures %d meshes\n", a_entities, a_frames, SHADERS, MATERIALS, TEXTURES, MESHES);
+	printf("sort        %7.1f ns/entity\n", sortUs * 1000.0 / items);
+	printf("walk        %7.1f ns/entity\n", walkUs * 1000.0 / items);
+	printf("binds per frame %u (shaders %u textures %u meshes %u) for %u state groups; every bind on every draw is %d\n",
+		binds, stats.ShaderBinds, stats.TextureBinds, stats.MeshBinds, groups, a_entities * 4);
+	printf("draws %u (%u instanced, drawing %u entities), out of order keys %d\n",
+		backend.GetFrameStats().Draws, stats.InstancedDraws, stats.Instances, unsorted);
+
+	//Instanced, every group of equal state is exactly one draw
+	const RenderFrameStats& drawn = backend.GetFrameStats();
+	bool ok = unsorted == 0 &&
+		drawn.Draws - stats.InstancedDraws + stats.Instances == (uint32_t)a_entities &&
+		(!a_instanced || drawn.Draws == groups) &&
+		stats.MeshBinds <= groups &&
+		stats.TextureBinds <= groups &&
+		stats.ShaderBinds <= 2 * MATERIALS;
+
+	for (int i = 0; i < a_entities; i++)
+		delete entities[i];
+	for (int i = 0; i < MESHES; i++)
+		delete meshes[i];
+	for (int i = 0; i < MATERIALS; i++)
+		delete materials[i];
+	for (int i = 0; i < SHADERS; i++)
+	{
+		delete vertexShaders[i];
+		delete instancedShaders[i];
+		delete pixelShaders[i];
+	}
+
+	return ok ? 0 : 1;
+}
+
+int RunReflectBenchmark(const char* a_shaderFile, int a_passes)
+{
+	std::ifstream file(a_shaderFile, std::ios::binary);
+	std::vector<char> shader((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	ShaderReflection parsed;
+	if (shader.empty() || !parsed.Parse(&shader[0], shader.size()))
+	{
+		printf("%s isn't a compiled shader with reflection data\n", a_shaderFile);
+		return 1;
+	}
+
+	printf("%s: program type %04x, %d constant buffers, %d resources, %d inputs, %d outputs\n", a_shaderFile, parsed.ProgramType,
+		(int)parsed.ConstantBuffers.size(), (int)parsed.Resources.size(), (int)parsed.Inputs.size(), (int)parsed.Outputs.size());
+	for (size_t b = 0; b < parsed.ConstantBuffers.size(); b++)
+	{
+		const ReflectedConstantBuffer& buffer = parsed.ConstantBuffers[b];
+		printf("  cbuffer %s : b%u, %u bytes, %d variables\n", buffer.Name.c_str(), buffer.BindPoint, buffer.Size, (int)buffer.Variables.size());
+	}
+
+	//Both ways from memory, so only the work itself is timed
+	std::vector<uint8_t> cached;
+	parsed.Serialize(&shader[0], cached);
+
+	ShaderReflection reflection;
+	uint64_t start = NetTimeUs();
+	for (int i = 0; i < a_passes; i++)
+		reflection.Parse(&shader[0], shader.size());
+	uint64_t parseUs = NetTimeUs() - start;
+
+	ShaderReflection fromCache;
+	start = NetTimeUs();
+	for (int i = 0; i < a_passes; i++)
+		fromCache.Deserialize(&shader[0], &cached[0], cached.size());
+	uint64_t cacheUs = NetTimeUs() - start;
+
+	//Then through the file, as LoadShaderFile() does: the first load
+	//may parse (no cache yet), the second must not
+	std::string path(a_shaderFile);
+	std::wstring widePath(path.begin(), path.end());
+	std::wstring cachePath = ShaderReflection::CachePathFor(widePath);
+	ShaderReflection loaded;
+	bool hit = false;
+	loaded.Load(&shader[0], shader.size(), cachePath, &hit);
+	loaded.Load(&shader[0], shader.size(), cachePath, &hit);
+
+	//A cache from any other shader must be refused
+	std::vector<char> changed = shader;
+	changed[4] ^= 1;
+	ShaderReflection stale;
+	bool refused = !stale.Deserialize(&changed[0], &cached[0], cached.size());
+
+	printf("parse       %7.2f us/pass\n", parseUs / (double)a_passes);
+	printf("cache       %7.2f us/pass (%d bytes)\n", cacheUs / (double)a_passes, (int)cached.size());
+	printf("round trip %s, cache file %s, stale cache %s\n", fromCache == parsed && loaded == parsed ? "matches" : "DIFFERS",
+		hit ? "read back" : "not used", refused ? "refused" : "ACCEPTED");
+
+	return fromCache == parsed && loaded == parsed && hit && refused ? 0 : 1;
+}
+
+int RunReflectCheck(const std::vector<const char*>& a_shaderFiles)
+{
+	int failed = 0;
+	for (size_t i = 0; i < a_shaderFiles.size(); i++)
+	{
+		if (RunReflectBenchmark(a_shaderFiles[i], 1) != 0)
+		{
+			printf("%s FAILED\n", a_shaderFiles[i]);
+			failed++;
+		}
+	}
+
+	printf("%d of %d shaders reflected correctly\n", (int)a_shaderFiles.size() - failed, (int)a_shaderFiles.size());
+	return failed == 0 && !a_shaderFiles.empty() ? 0 : 1;
+}
+
+int RunRingBenchmark(int a_emitters, int a_frames)
+{
+	//As big as a particle's four vertices
+	const int MAX_PARTICLES = 1000;
+	const unsigned int QUAD_BYTES = 4 * 40;
+
+	RecordingBackend wholeBackend(false);
+	RecordingBackend ringBackend(false);
+	std::vector<unsigned char> vertices(MAX_PARTICLES * QUAD_BYTES);
+
+	std::vector<ID3D11Buffer*> emitterBuffers;
+	for (int e = 0; e < a_emitters; e++)
+		emitterBuffers.push_back(wholeBackend.CreateBuffer(RENDER_BUFFER_VERTEX, MAX_PARTICLES * QUAD_BYTES, 0, true));
+
+	//Room for a quarter of the worst case
+	TransientRing* ring = new TransientRing(&ringBackend, a_emitters * MAX_PARTICLES * QUAD_BYTES / 4);
+
+	uint64_t wholeBytes = 0;
+	uint64_t ringBytes = 0;
+	uint64_t wholeUs = 0;
+	uint64_t ringUs = 0;
+	uint32_t overflowFrames = 0;
+	int lastOverflow = -1;
+	uint32_t maxUsed = 0;
+
+	for (int frame = 0; frame < a_frames; frame++)
+	{
+		wholeBackend.BeginFrame();
+		ringBackend.BeginFrame();
+		ring->BeginFrame();
+
+		uint64_t start = NetTimeUs();
+		for (int e = 0; e < a_emitters; e++)
+			wholeBackend.WriteBuffer(emitterBuffers[e], &vertices[0], MAX_PARTICLES * QUAD_BYTES);
+		wholeUs += NetTimeUs() - start;
+
+		start = NetTimeUs();
+		for (int e = 0; e < a_emitters; e++)
+		{
+			//Each emitter's population rises and falls on its own schedule
+			int living = (frame * 7 + e * 131) % (MAX_PARTICLES + 1);
+			if (living > 0)
+				ring->Upload(&vertices[0], living * QUAD_BYTES);
+		}
+		ringUs += NetTimeUs() - start;
+
+		wholeBytes += wholeBackend.GetFrameStats().BytesUploaded;
+		ringBytes += ringBackend.GetFrameStats().BytesUploaded;
+		const TransientRingStats& stats = ring->GetFrameStats();
+		if (stats.Overflows > 0)
+		{
+			overflowFrames++;
+			lastOverflow = frame;
+		}
+		if (stats.BytesUsed > maxUsed)
+			maxUsed = (uint32_t)stats.BytesUsed;
+	}
+
+	uint32_t capacity = ring->GetFrameStats().Capacity;
+	double uploads = (double)a_emitters * a_frames;
+	printf("%d emitters, %d frames\n", a_emitters, a_frames);
+	printf("whole buffers  %7.1f ns/upload, %7.1f KB/frame\n", wholeUs * 1000.0 / uploads, wholeBytes / 1024.0 / a_frames);
+	printf("ring           %7.1f ns/upload, %7.1f KB/frame (most in one frame %u KB of %u KB)\n",
+		ringUs * 1000.0 / uploads, ringBytes / 1024.0 / a_frames, maxUsed / 1024, capacity / 1024);
+	printf("frames that overflowed %u, last at frame %d\n", overflowFrames, lastOverflow);
+
+	//Once grown it holds any frame, and it never sends more than the old way
+	bool ok = ringBytes <= wholeBytes &&
+		(a_frames < 300 || (overflowFrames > 0 && lastOverflow < 300)) &&
+		maxUsed <= capacity;
+
+	delete ring;
+	for (int e = 0; e < a_emitters; e++)
+		wholeBackend.ReleaseBuffer(emitterBuffers[e]);
+	if (ringBackend.GetLiveBuffers() != 0 || wholeBackend.GetLiveBuffers() != 0)
+	{
+		printf("leaked buffers %d\n", ringBackend.GetLiveBuffers() + wholeBackend.GetLiveBuffers());
+		ok = false;
+	}
+
+	return ok ? 0 : 1;
+}
+
+int RunPassBenchmark(int a_entities, int a_frames, int a_threads)
+{
+	const int PASSES = 6;
+	const int MESHES = 16;
+	const int TEXTURES = 16;
+
+	RecordingBackend backend(true);
+	JobPool jobs(a_threads);
+	PassRecorder* recorder = new PassRecorder(&backend, &jobs, PASSES, 64 * 1024);
+
+	//A pair of shaders per pass, since passes mustn't share them
+	SimpleVertexShader* vertexShaders[PASSES];
+	SimplePixelShader* pixelShaders[PASSES];
+	for (int i = 0; i < PASSES; i++)
+	{
+		vertexShaders[i] = new SimpleVertexShader(0, &backend);
+		pixelShaders[i] = new SimplePixelShader(0, &backend);
+	}
+
+	Vertex vertices[3] = {};
+	unsigned int indices[3] = { 0, 1, 2 };
+	Mesh* meshes[MESHES];
+	for (int i = 0; i < MESHES; i++)
+		meshes[i] = new Mesh(vertices, 3, indices, 3, &backend);
+
+	ID3D11ShaderResourceView* textures[TEXTURES];
+	for (int i = 0; i < TEXTURES; i++)
+		textures[i] = (ID3D11ShaderResourceView*)(uintptr_t)((i + 1) << 4);
+
+	unsigned int random = 0x2545F491;
+	std::vector<GameEntity*> entities;
+	std::vector<int> textureOf;
+	for (int i = 0; i < a_entities; i++)
+	{
+		random ^= random << 13; random ^= random >> 17; random ^= random << 5;
+		GameEntity* entity = new GameEntity(meshes[random % MESHES], 0);
+		entity->SetPosition((float)(random % 97) - 48.0f, 0.0f, (float)((random >> 12) % 89));
+		entities.push_back(entity);
+		textureOf.push_back((random >> 20) % TEXTURES);
+	}
+
+	//Each pass looks at the scene from its own side
+	XMFLOAT4X4 views[PASSES];
+	XMFLOAT4X4 projection;
+	for (int i = 0; i < PASSES; i++)
+	{
+		float angle = XM_2PI * i / PASSES;
+		XMStoreFloat4x4(&views[i], XMMatrixTranspose(XMMatrixLookAtLH(XMVectorSet(sinf(angle) * 60, 20, cosf(angle) * 60 + 44, 0), XMVectorSet(0, 0, 44, 0), XMVectorSet(0, 1, 0, 0))));
+	}
+	XMStoreFloat4x4(&projection, XMMatrixTranspose(XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 200.0f)));
+
+	std::function<void(int, RenderPassContext&)> recordPass = [&](int a_pass, RenderPassContext& a_context)
+	{
+		a_context.Queue->Begin();
+		a_context.Queue->SetCamera(views[a_pass], projection);
+		for (int i = 0; i < a_entities; i++)
+			a_context.Queue->Submit(RENDER_PASS_OPAQUE, entities[i], vertexShaders[a_pass], pixelShaders[a_pass], textures[textureOf[i]], 0);
+		a_context.Queue->Execute(a_context.Backend);
+	};
+
+	//Each frame twice, one after another and then at once, from the same positions
+	uint64_t recordUs[2] = { 0, 0 };
+	uint64_t submitUs = 0;
+	int mismatches = 0;
+	uint32_t draws = 0;
+	for (int frame = 0; frame < a_frames; frame++)
+	{
+		for (int i = 0; i < a_entities; i++)
+		{
+			XMFLOAT3 position = entities[i]->GetPosition();
+			entities[i]->SetPosition(position.x, position.y, position.z + ((i & 1) ? 0.01f : -0.01f));
+		}
+
+		uint64_t hashes[2];
+		for (int parallel = 0; parallel < 2; parallel++)
+		{
+			backend.BeginFrame();
+			recorder->BeginFrame();
+			recorder->SetParallel(parallel != 0);
+
+			uint64_t start = NetTimeUs();
+			recorder->Record(recordPass);
+			recordUs[parallel] += NetTimeUs() - start;
+
+			start = NetTimeUs();
+			recorder->Submit(0, PASSES);
+			submitUs += NetTimeUs() - start;
+
+			hashes[parallel] = backend.HashCommands();
+			draws = backend.GetFrameStats().Draws;
+		}
+		if (hashes[0] != hashes[1])
+			mismatches++;
+	}
+
+	printf("%d passes of %d entities, %d frames, %d threads\n", PASSES, a_entities, a_frames, jobs.GetThreadCount());
+	printf("recorded in turn %8.1f us/frame\n", recordUs[0] / (double)a_frames);
+	printf("recorded at once %8.1f us/frame (%.2fx)\n", recordUs[1] / (double)a_frames, recordUs[1] ? (double)recordUs[0] / recordUs[1] : 0.0);
+	printf("submitted        %8.1f us/frame\n", submitUs / (2.0 * a_frames));
+	printf("draws per frame %u, frames that differed %d\n", draws, mismatches);
+
+	bool ok = mismatches == 0 && recorder->IsDeferred() && draws > 0;
+
+	for (int i = 0; i < a_entities; i++)
+		delete entities[i];
+	for (int i = 0; i < MESHES; i++)
+		delete meshes[i];
+	for (int i = 0; i < PASSES; i++)
+	{
+		delete vertexShaders[i];
+		delete pixelShaders[i];
+	}
+	delete recorder;
+	if (backend.GetLiveBuffers() != 0)
+	{
+		printf("leaked buffers %d\n", backend.GetLiveBuffers());
+		ok = false;
+	}
+
+	return ok ? 0 : 1;
+}
+
+//About the size of a few entities' transforms and the camera
+struct BenchSnapshot
+{
+	uint64_t Step;
+	uint64_t Values[63];
+};
+
+struct SnapshotRun
+{
+	uint64_t WriteUs;
+	uint64_t SlowestPublishUs;
+	int Acquired;
+	int Torn;
+	int OutOfOrder;
+};
+
+//One thread publishes a_publishes snapshots while this one takes the newest
+//until it has seen the last, sleeping a_stallUs after each it gets
+static SnapshotRun RunSnapshots(int a_publishes, int a_stallUs)
+{
+	TripleBuffer<BenchSnapshot>* buffer = new TripleBuffer<BenchSnapshot>();
+	SnapshotRun run = {};
+
+	std::thread writer([buffer, a_publishes, &run]()
+	{
+		uint64_t start = NetTimeUs();
+		for (int step = 1; step <= a_publishes; step++)
+		{
+			uint64_t publishStart = NetTimeUs();
+			BenchSnapshot& snapshot = buffer->GetWriteBuffer();
+			snapshot.Step = step;
+			for (int i = 0; i < 63; i++)
+				snapshot.Values[i] = step;
+			buffer->Publish();
+
+			uint64_t publishUs = NetTimeUs() - publishStart;
+			if (publishUs > run.SlowestPublishUs)
+				run.SlowestPublishUs = publishUs;
+		}
+		run.WriteUs = NetTimeUs() - start;
+	});
+
+	uint64_t lastStep = 0;
+	while (lastStep < (uint64_t)a_publishes)
+	{
+		if (!buffer->Acquire())
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		//Every field from the same publish, and never an older one
+		const BenchSnapshot& snapshot = buffer->GetReadBuffer();
+		for (int i = 0; i < 63; i++)
+		{
+			if (snapshot.Values[i] != snapshot.Step)
+			{
+				run.Torn++;
+				break;
+			}
+		}
+		if (snapshot.Step <= lastStep)
+			run.OutOfOrder++;
+		lastStep = snapshot.Step;
+		run.Acquired++;
+
+		if (a_stallUs > 0)
+			std::this_thread::sleep_for(std::chrono::microseconds(a_stallUs));
+	}
+
+	writer.join();
+	delete buffer;
+	return run;
+}
+
+int RunSnapshotBenchmark(int a_publishes, int a_stallUs)
+{
+	SnapshotRun runs[2];
+	runs[0] = RunSnapshots(a_publishes, 0);
+	runs[1] = RunSnapshots(a_publishes, a_stallUs);
+
+	printf("%d snapshots of %d bytes\n", a_publishes, (int)sizeof(BenchSnapshot));
+	for (int r = 0; r < 2; r++)
+	{
+		const SnapshotRun& run = runs[r];
+		double rate = run.WriteUs ? a_publishes * 1000000.0 / run.WriteUs : 0.0;
+		printf("%s %8.0f publishes/s, slowest %4llu us; reader took %d (%d skipped), torn %d, out of order %d\n",
+			r == 0 ? "reader keeping up      " : "reader stalling        ", rate, (unsigned long long)run.SlowestPublishUs,
+			run.Acquired, a_publishes - run.Acquired, run.Torn, run.OutOfOrder);
+	}
+	if (a_stallUs > 0)
+		printf("(stalling %d us per snapshot)\n", a_stallUs);
+
+	//A slow reader must not hold the writer back: it just skips more
+	bool ok = true;
+	for (int r = 0; r < 2; r++)
+		ok = ok && runs[r].Torn == 0 && runs[r].OutOfOrder == 0 && runs[r].Acquired > 0;
+	ok = ok && runs[1].WriteUs <= runs[0].WriteUs * 2 + 1000;
+
+	return ok ? 0 : 1;
+}
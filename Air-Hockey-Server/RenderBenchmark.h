@@ -0,0 +1,73 @@
+#pragma once
+#include <vector>
+
+// --------------------------------------------------------
+// Draws a_entities entities for a_frames frames through the
+// recording backend, the way Game draws them: one world
+// matrix upload and one GameEntity::Draw() each.  Prints ns
+// per draw with and without the command list, the per-frame
+// counters, and checks that every frame recorded the same
+// commands.  Then again through a FilteringBackend, which
+// must drop every bind after the first frame.
+// --------------------------------------------------------
+int RunRenderBenchmark(int a_entities, int a_frames);
+
+// --------------------------------------------------------
+// Submits a_entities entities spread over a few shaders,
+// materials, textures and meshes to a RenderQueue, in random
+// order, for a_frames frames while they move.  Prints ns per
+// entity to sort and to walk, and how many binds the sorted
+// walk issued against binding everything for every draw.
+// With a_instanced, runs sharing all their state must each
+// become a single instanced draw.
+// --------------------------------------------------------
+int RunQueueBenchmark(int a_entities, int a_frames, bool a_instanced);
+
+// --------------------------------------------------------
+// Reflects the compiled shader a_shaderFile a_passes times,
+// parsing the .cso and reading back its cache.  Prints what
+// it found, us per pass each way, and checks that the cache
+// reads back exactly what parsing produced.  Writes the
+// cache next to the file, as the game does.
+// --------------------------------------------------------
+int RunReflectBenchmark(const char* a_shaderFile, int a_passes);
+
+// --------------------------------------------------------
+// Runs the checks of RunReflectBenchmark() once on each of
+// a_shaderFiles (every .cso the build produced), so a parser
+// change can be tried against all of them.  Fails if any one
+// doesn't reflect, or doesn't read back from its cache.
+// --------------------------------------------------------
+int RunReflectCheck(const std::vector<const char*>& a_shaderFiles);
+
+// --------------------------------------------------------
+// a_emitters particle emitters of up to 1000 particles each,
+// filling and emptying over a_frames frames, sent the old
+// way (every emitter's whole dynamic buffer, every frame)
+// and through a TransientRing (only living particles, packed
+// into one buffer).  The ring starts too small, so it must
+// overflow, grow once, and then never overflow again.
+// --------------------------------------------------------
+int RunRingBenchmark(int a_emitters, int a_frames);
+
+// --------------------------------------------------------
+// Six views of a_entities entities each, like the game's
+// shadow and scene passes, recorded through a PassRecorder
+// on a_threads extra threads (0 = one per core) and
+// submitted in order, for a_frames frames.  Prints us per
+// frame to record them one after another and all at once,
+// and checks that both send exactly the same commands.
+// --------------------------------------------------------
+int RunPassBenchmark(int a_entities, int a_frames, int a_threads);
+
+// --------------------------------------------------------
+// One thread publishes a_publishes snapshots through a
+// TripleBuffer, as Game::Update does, while another takes
+// the newest until it has the last: first as fast as it
+// can, then sleeping a_stallUs after each, like a render
+// thread held up by the GPU.  Prints the writer's rate and
+// slowest publish both ways and how many snapshots the
+// reader skipped, and checks that it never saw a torn or
+// an older one and that stalling didn't slow the writer.
+// --------------------------------------------------------
+int RunSnapshotBenchmark(int a_publishes, int a_stallUs);
@@ -0,0 +1,267 @@
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "MatchShard.h"
+#include "SpectatorRelay.h"
+#include "RelayBenchmark.h"
+#include "CodecBenchmark.h"
+#include "NetBenchmark.h"
+#include "TransformBenchmark.h"
+#include "EntityBenchmark.h"
+#include "RenderBenchmark.h"
+#include "MatchBenchmark.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+// --------------------------------------------------------
+// Headless dedicated server hosting many matches per process.
+//
+//   Air-Hockey-Server [--port 27015] [--shards N] [--matches 256] [--report 5]
+//                     [--latency ms --jitter ms --loss percent]
+//                     [--io single|batched|ring]
+//
+// Shard i listens on port + i and hosts every match whose id
+// maps to it (see NetShardPort), so clients pick the port
+// from the match id they were given.
+//
+// Spectator relay, fed by a server started as above:
+//
+//   Air-Hockey-Server --relay 28000 --server 127.0.0.1:27015 --shards N [--report 5]
+//                     [--io single|batched|ring]
+//
+// Relay fan-out, snapshot codec, socket I/O, transform, entity, render and timestep benchmarks:
+//
+//   Air-Hockey-Server --bench-relay 10000 [--ticks 1200]
+//   Air-Hockey-Server --bench-codec [--ticks 7200]
+//   Air-Hockey-Server --bench-io 256 [--ticks 2000]
+//   Air-Hockey-Server --bench-transforms 10000 [--frames 600]
+//   Air-Hockey-Server --bench-scene 65536 [--frames 600] [--threads 0]
+//   Air-Hockey-Server --bench-entities 4096 [--frames 600]
+//   Air-Hockey-Server --bench-render 4096 [--frames 600]
+//   Air-Hockey-Server --bench-queue 4096 [--frames 600] [--instanced 1]
+//   Air-Hockey-Server --bench-reflect VertexShader.cso [--passes 10000]
+//   Air-Hockey-Server --check-reflect x64/Debug/*.cso
+//   Air-Hockey-Server --bench-ring 4 [--frames 600]
+//   Air-Hockey-Server --bench-passes 2048 [--frames 300] [--threads 0]
+//   Air-Hockey-Server --bench-snapshots 200000 [--stall-us 2000]
+//   Air-Hockey-Server --bench-timestep 60
+// --------------------------------------------------------
+
+static std::atomic<bool> quit(false);
+
+static void OnSignal(int)
+{
+	quit = true;
+}
+
+static const char* FindArg(int argc, char* argv[], const char* name)
+{
+	for (int i = 1; i < argc - 1; i++)
+	{
+		if (strcmp(argv[i], name) == 0)
+			return argv[i + 1];
+	}
+	return 0;
+}
+
+//Every argument after --check-reflect, up to the next option
+static std::vector<const char*> ShaderArgs(int argc, char* argv[])
+{
+	std::vector<const char*> files;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--check-reflect") != 0)
+			continue;
+
+		for (i++; i < argc && strncmp(argv[i], "--", 2) != 0; i++)
+			files.push_back(argv[i]);
+		break;
+	}
+	return files;
+}
+
+static bool HasFlag(int argc, char* argv[], const char* name)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], name) == 0)
+			return true;
+	}
+	return false;
+}
+
+static int IntArg(int argc, char* argv[], const char* name, int fallback)
+{
+	const char* value = FindArg(argc, argv, name);
+	return value ? atoi(value) : fallback;
+}
+
+// Reads --io, batched unless asked otherwise
+static NetIoMode IoArg(int argc, char* argv[])
+{
+	const char* value = FindArg(argc, argv, "--io");
+	if (value && strcmp(value, "single") == 0)
+		return NET_IO_SINGLE;
+	if (value && strcmp(value, "ring") == 0)
+		return NET_IO_RING;
+	return NET_IO_BATCHED;
+}
+
+// Reads "a.b.c.d:port"
+static bool ParseAddress(const char* text, NetAddress& address)
+{
+	unsigned int a, b, c, d, port;
+	if (sscanf(text, "%u.%u.%u.%u:%u", &a, &b, &c, &d, &port) != 5)
+		return false;
+
+	address = NetMakeAddress((uint8_t)a, (uint8_t)b, (uint8_t)c, (uint8_t)d, (uint16_t)port);
+	return true;
+}
+
+static int RunRelay(int argc, char* argv[], int defaultShards)
+{
+	NetAddress server;
+	const char* serverArg = FindArg(argc, argv, "--server");
+	if (!serverArg || !ParseAddress(serverArg, server))
+	{
+		printf("--relay needs --server a.b.c.d:port\n");
+		return 1;
+	}
+
+	SpectatorRelay relay;
+	if (!relay.Start((uint16_t)IntArg(argc, argv, "--relay", 0), server, IntArg(argc, argv, "--shards", defaultShards), IoArg(argc, argv)))
+	{
+		printf("Couldn't open relay sockets\n");
+		return 1;
+	}
+
+	relay.SetReportInterval((float)IntArg(argc, argv, "--report", 5));
+	printf("Relaying to spectators on port %d\n", relay.GetPort());
+
+	signal(SIGINT, OnSignal);
+	signal(SIGTERM, OnSignal);
+
+	while (!quit)
+		relay.RunOnce(50);
+
+	printf("Shutting down\n");
+	return 0;
+}
+
+static int RunShards(int argc, char* argv[], int shardCount)
+{
+	uint16_t basePort = (uint16_t)IntArg(argc, argv, "--port", NET_DEFAULT_PORT);
+	shardCount = IntArg(argc, argv, "--shards", shardCount);
+	int matchesPerShard = IntArg(argc, argv, "--matches", 256);
+	int reportSeconds = IntArg(argc, argv, "--report", 5);
+	int latency = IntArg(argc, argv, "--latency", 0);
+	int jitter = IntArg(argc, argv, "--jitter", 0);
+	int loss = IntArg(argc, argv, "--loss", 0);
+	NetIoMode ioMode = IoArg(argc, argv);
+
+	std::vector<MatchShard*> shards;
+	for (int i = 0; i < shardCount; i++)
+	{
+		MatchShard* shard = new MatchShard(i, shardCount, matchesPerShard);
+		if (!shard->Open((uint16_t)(basePort + i), ioMode))
+		{
+			printf("Couldn't open port %d for shard %d\n", basePort + i, i);
+			delete shard;
+			break;
+		}
+
+		shard->SetReportInterval((float)reportSeconds);
+		shard->GetSimulator()->SetConditions(latency, jitter, (float)loss);
+		shards.push_back(shard);
+	}
+
+	if ((int)shards.size() == shardCount)
+	{
+		printf("Hosting up to %d matches on %d shards, ports %d-%d, %s socket I/O\n",
+			shardCount * matchesPerShard, shardCount, basePort, basePort + shardCount - 1, NetIoModeName(ioMode));
+
+		signal(SIGINT, OnSignal);
+		signal(SIGTERM, OnSignal);
+
+		for (size_t i = 0; i < shards.size(); i++)
+			shards[i]->Start();
+
+		while (!quit)
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+		printf("Shutting down\n");
+	}
+
+	bool started = (int)shards.size() == shardCount;
+	for (size_t i = 0; i < shards.size(); i++)
+		delete shards[i];
+
+	return started ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+	int shardCount = (int)std::thread::hardware_concurrency();
+	if (shardCount < 1)
+		shardCount = 1;
+
+#ifdef _WIN32
+	//Default timer resolution is ~15ms, far coarser than a tick
+	timeBeginPeriod(1);
+#endif
+
+	if (!UdpSocket::InitNetworking())
+	{
+		printf("Couldn't start networking\n");
+		return 1;
+	}
+
+	int result;
+	if (HasFlag(argc, argv, "--bench-codec"))
+		result = RunCodecBenchmark(IntArg(argc, argv, "--ticks", 7200));
+	else if (HasFlag(argc, argv, "--bench-io"))
+		result = RunIoBenchmark(IntArg(argc, argv, "--bench-io", 256), IntArg(argc, argv, "--ticks", 2000));
+	else if (HasFlag(argc, argv, "--bench-transforms"))
+		result = RunTransformBenchmark(IntArg(argc, argv, "--bench-transforms", 10000), IntArg(argc, argv, "--frames", 600));
+	else if (HasFlag(argc, argv, "--bench-scene"))
+		result = RunSceneBenchmark(IntArg(argc, argv, "--bench-scene", 65536), IntArg(argc, argv, "--frames", 600), IntArg(argc, argv, "--threads", 0));
+	else if (HasFlag(argc, argv, "--bench-entities"))
+		result = RunEntityBenchmark(IntArg(argc, argv, "--bench-entities", 4096), IntArg(argc, argv, "--frames", 600));
+	else if (HasFlag(argc, argv, "--bench-render"))
+		result = RunRenderBenchmark(IntArg(argc, argv, "--bench-render", 4096), IntArg(argc, argv, "--frames", 600));
+	else if (HasFlag(argc, argv, "--bench-queue"))
+		result = RunQueueBenchmark(IntArg(argc, argv, "--bench-queue", 4096), IntArg(argc, argv, "--frames", 600), IntArg(argc, argv, "--instanced", 1) != 0);
+	else if (HasFlag(argc, argv, "--bench-passes"))
+		result = RunPassBenchmark(IntArg(argc, argv, "--bench-passes", 2048), IntArg(argc, argv, "--frames", 300), IntArg(argc, argv, "--threads", 0));
+	else if (HasFlag(argc, argv, "--bench-snapshots"))
+		result = RunSnapshotBenchmark(IntArg(argc, argv, "--bench-snapshots", 200000), IntArg(argc, argv, "--stall-us", 2000));
+	else if (HasFlag(argc, argv, "--bench-timestep"))
+		result = RunTimestepBenchmark(IntArg(argc, argv, "--bench-timestep", 60));
+	else if (HasFlag(argc, argv, "--bench-ring"))
+		result = RunRingBenchmark(IntArg(argc, argv, "--bench-ring", 4), IntArg(argc, argv, "--frames", 600));
+	else if (HasFlag(argc, argv, "--check-reflect"))
+		result = RunReflectCheck(ShaderArgs(argc, argv));
+	else if (FindArg(argc, argv, "--bench-reflect"))
+		result = RunReflectBenchmark(FindArg(argc, argv, "--bench-reflect"), IntArg(argc, argv, "--passes", 10000));
+	else if (HasFlag(argc, argv, "--bench-relay"))
+		result = RunRelayBenchmark(IntArg(argc, argv, "--bench-relay", 1000), IntArg(argc, argv, "--ticks", 1200));
+	else if (HasFlag(argc, argv, "--relay"))
+		result = RunRelay(argc, argv, shardCount);
+	else
+		result = RunShards(argc, argv, shardCount);
+
+	UdpSocket::ShutdownNetworking();
+
+#ifdef _WIN32
+	timeEndPeriod(1);
+#endif
+	return result;
+}
@@ -0,0 +1,340 @@
+#include "SpectatorRelay.h"
+#include <cstdio>
+#include <cstring>
+
+// Caps on work per wakeup so one busy socket can't starve the other
+static const int MAX_PACKETS_PER_WAKEUP = 512;
+static const int RECEIVE_BATCH_SIZE = 64;
+
+static const uint32_t MAINTAIN_INTERVAL_MS = 100;
+
+SpectatorRelay::SpectatorRelay()
+{
+	serverShards = 1;
+	memset(&server, 0, sizeof(server));
+	memset(&stats, 0, sizeof(stats));
+	memset(&reportStart, 0, sizeof(reportStart));
+	reportStartMs = 0;
+	reportIntervalMs = 0;
+	lastMaintainMs = 0;
+	packets = new PacketBatch(RECEIVE_BATCH_SIZE, NET_MAX_PACKET_SIZE);
+}
+
+SpectatorRelay::~SpectatorRelay()
+{
+	Stop();
+	delete packets;
+}
+
+bool SpectatorRelay::Start(uint16_t a_port, const NetAddress& a_server, int a_serverShards, NetIoMode a_ioMode)
+{
+	Stop();
+
+	if (!downstream.Open(a_port, a_ioMode) || !upstream.Open(0, a_ioMode))
+	{
+		Stop();
+		return false;
+	}
+
+	loop.Add(&downstream, this);
+	loop.Add(&upstream, this);
+
+	server = a_server;
+	serverShards = a_serverShards;
+	reportStartMs = NetTimeMs();
+	lastMaintainMs = reportStartMs;
+	return true;
+}
+
+void SpectatorRelay::Stop()
+{
+	loop.Remove(&downstream);
+	loop.Remove(&upstream);
+	downstream.Close();
+	upstream.Close();
+
+	for (auto it = matches.begin(); it != matches.end(); ++it)
+		delete it->second;
+	matches.clear();
+	spectatorLookup.clear();
+}
+
+void SpectatorRelay::RunOnce(int a_timeoutMs)
+{
+	loop.Poll(a_timeoutMs);
+
+	uint32_t now = NetTimeMs();
+	if (now - lastMaintainMs >= MAINTAIN_INTERVAL_MS)
+	{
+		Maintain(now);
+		lastMaintainMs = now;
+	}
+
+	if (reportIntervalMs && now - reportStartMs >= reportIntervalMs)
+		Report(now);
+}
+
+void SpectatorRelay::OnReadable(UdpSocket* a_socket)
+{
+	uint64_t start = NetTimeUs();
+	uint32_t now = (uint32_t)(start / 1000);
+
+	for (int received = 0; received < MAX_PACKETS_PER_WAKEUP;)
+	{
+		int count = a_socket->ReceiveBatch(*packets);
+		if (count == 0)
+			break;
+
+		for (int i = 0; i < count; i++)
+		{
+			int size = packets->GetSize(i);
+			if (size < (int)sizeof(NetHeader))
+				continue;
+
+			const unsigned char* data = packets->GetData(i);
+			const NetHeader* header = (const NetHeader*)data;
+
+			if (a_socket == &downstream && header->Type == NET_SPECTATE && size >= (int)sizeof(SpectatePacket))
+			{
+				Subscribe(header->MatchID, packets->GetAddress(i), ((const SpectatePacket*)data)->AckKeyframe, now);
+			}
+			else if (a_socket == &upstream && header->Type == NET_MATCH_STATE && size >= (int)sizeof(MatchStatePacket))
+			{
+				stats.StatesIn++;
+				Publish(header->MatchID, ((const MatchStatePacket*)data)->State);
+			}
+		}
+		received += count;
+	}
+
+	stats.BusyUs += NetTimeUs() - start;
+}
+
+void SpectatorRelay::Subscribe(uint16_t a_matchID, const NetAddress& a_address, uint32_t a_ackKeyframe, uint32_t a_nowMs)
+{
+	uint64_t key = AddressKey(a_address);
+
+	auto existing = spectatorLookup.find(key);
+	if (existing != spectatorLookup.end())
+	{
+		//Already watching this match, just take the new ack
+		if (existing->second == a_matchID)
+		{
+			std::vector<RelaySpectator>& spectators = matches[a_matchID]->Spectators;
+			for (size_t i = 0; i < spectators.size(); i++)
+			{
+				if (spectators[i].Address == a_address)
+				{
+					if ((int32_t)(a_ackKeyframe - spectators[i].AckKeyframe) > 0)
+						spectators[i].AckKeyframe = a_ackKeyframe;
+					spectators[i].LastHeardMs = a_nowMs;
+					break;
+				}
+			}
+			return;
+		}
+
+		//Switched matches, leave the old one
+		std::vector<RelaySpectator>& old = matches[existing->second]->Spectators;
+		for (size_t i = 0; i < old.size(); i++)
+		{
+			if (old[i].Address == a_address)
+			{
+				old[i] = old.back();
+				old.pop_back();
+				break;
+			}
+		}
+	}
+
+	RelayedMatch*& match = matches[a_matchID];
+	if (!match)
+	{
+		match = new RelayedMatch();
+		match->MatchID = a_matchID;
+		match->HasState = false;
+		memset(match->Keyframes, 0, sizeof(match->Keyframes));
+		SubscribeUpstream(*match, a_nowMs);
+	}
+
+	RelaySpectator spectator;
+	spectator.Address = a_address;
+	spectator.AckKeyframe = a_ackKeyframe;
+	spectator.LastHeardMs = a_nowMs;
+	match->Spectators.push_back(spectator);
+
+	spectatorLookup[key] = a_matchID;
+}
+
+void SpectatorRelay::SubscribeUpstream(RelayedMatch& a_match, uint32_t a_nowMs)
+{
+	if (!upstream.IsOpen() || server.Port == 0)
+		return;
+
+	SpectatePacket packet = {};
+	packet.Header.Type = NET_SPECTATE;
+	packet.Header.MatchID = a_match.MatchID;
+
+	NetAddress shard = server;
+	shard.Port = NetShardPort(server.Port, a_match.MatchID, serverShards);
+	upstream.Send(shard, &packet, sizeof(packet));
+
+	a_match.LastSubscribeMs = a_nowMs;
+}
+
+void SpectatorRelay::Publish(uint16_t a_matchID, const MatchState& a_state)
+{
+	auto found = matches.find(a_matchID);
+	if (found == matches.end())
+		return;
+
+	RelayedMatch& match = *found->second;
+
+	//Out of order or duplicate ticks are dropped
+	if (match.HasState && (int32_t)(a_state.Tick - match.Latest.Tick) <= 0)
+		return;
+
+	QuantizedState quantized;
+	SnapshotCodec::Quantize(a_state, quantized);
+	Broadcast(match, quantized);
+
+	match.Latest = quantized;
+	match.HasState = true;
+}
+
+int SpectatorRelay::Encode(RelayedMatch& a_match, const QuantizedState& a_state, int a_group, bool a_keyframe)
+{
+	SpectatorStatePacket* packet = (SpectatorStatePacket*)encoded[a_group];
+	packet->Header.Type = NET_SPECTATOR_STATE;
+	packet->Header.Slot = 0;
+	packet->Header.MatchID = a_match.MatchID;
+	packet->Tick = a_state.Tick;
+	packet->Flags = a_keyframe ? SPECTATOR_STATE_KEYFRAME : 0;
+
+	const QuantizedState* baseline = 0;
+	if (a_group == FULL_GROUP)
+	{
+		packet->BaselineTick = 0;
+		packet->Flags |= SPECTATOR_STATE_FULL;
+	}
+	else
+	{
+		baseline = &a_match.Keyframes[a_group];
+		packet->BaselineTick = baseline->Tick;
+	}
+
+	stats.Encodes++;
+	BitWriter writer(encoded[a_group] + sizeof(SpectatorStatePacket), SnapshotCodec::MAX_SIZE);
+	SnapshotCodec::Encode(baseline, a_state, writer);
+
+	//A header with no fields would decode as garbage
+	int size = writer.Finish();
+	if (size < 0)
+	{
+		stats.EncodeFailures++;
+		return -1;
+	}
+	return sizeof(SpectatorStatePacket) + size;
+}
+
+void SpectatorRelay::Broadcast(RelayedMatch& a_match, const QuantizedState& a_state)
+{
+	bool keyframe = a_state.Tick % NET_KEYFRAME_INTERVAL == 0;
+
+	//Encoded lazily, so a baseline nobody holds costs nothing (0 until
+	//it's encoded, -1 if it couldn't be)
+	int sizes[NET_SPECTATOR_BASELINES + 1];
+	for (int i = 0; i <= NET_SPECTATOR_BASELINES; i++)
+		sizes[i] = 0;
+
+	std::vector<RelaySpectator>& spectators = a_match.Spectators;
+	for (size_t i = 0; i < spectators.size(); i++)
+	{
+		const RelaySpectator& spectator = spectators[i];
+
+		//Spectators whose keyframe has been replaced get the full state
+		int group = FULL_GROUP;
+		if (spectator.AckKeyframe != 0)
+		{
+			int slot = KeyframeSlot(spectator.AckKeyframe);
+			if (a_match.Keyframes[slot].Tick == spectator.AckKeyframe)
+				group = slot;
+		}
+
+		if (sizes[group] == 0)
+			sizes[group] = Encode(a_match, a_state, group, keyframe);
+		if (sizes[group] < 0)
+			continue;
+
+		downstream.Queue(spectator.Address, encoded[group], sizes[group]);
+		stats.PacketsOut++;
+		stats.BytesOut += sizes[group];
+	}
+	downstream.Flush();
+
+	//Stored after sending so this tick's packets never reference themselves
+	if (keyframe)
+		a_match.Keyframes[KeyframeSlot(a_state.Tick)] = a_state;
+}
+
+void SpectatorRelay::Maintain(uint32_t a_nowMs)
+{
+	for (auto it = matches.begin(); it != matches.end();)
+	{
+		RelayedMatch& match = *it->second;
+
+		std::vector<RelaySpectator>& spectators = match.Spectators;
+		for (size_t i = 0; i < spectators.size();)
+		{
+			if ((int32_t)(a_nowMs - spectators[i].LastHeardMs) > (int32_t)NET_SPECTATE_TIMEOUT_MS)
+			{
+				spectatorLookup.erase(AddressKey(spectators[i].Address));
+				spectators[i] = spectators.back();
+				spectators.pop_back();
+			}
+			else
+			{
+				i++;
+			}
+		}
+
+		//Nobody watching: stop renewing and let the server time us out
+		if (spectators.empty())
+		{
+			delete it->second;
+			it = matches.erase(it);
+			continue;
+		}
+
+		if (a_nowMs - match.LastSubscribeMs >= NET_SPECTATE_KEEPALIVE_MS)
+			SubscribeUpstream(match, a_nowMs);
+		++it;
+	}
+}
+
+void SpectatorRelay::Report(uint32_t a_nowMs)
+{
+	float seconds = (a_nowMs - reportStartMs) / 1000.0f;
+	uint64_t packets = stats.PacketsOut - reportStart.PacketsOut;
+	uint64_t bytes = stats.BytesOut - reportStart.BytesOut;
+	uint64_t states = stats.StatesIn - reportStart.StatesIn;
+	uint64_t encodes = stats.Encodes - reportStart.Encodes;
+	uint64_t failures = stats.EncodeFailures - reportStart.EncodeFailures;
+	double busy = (double)(stats.BusyUs - reportStart.BusyUs) / (seconds * 1000000.0);
+
+	uint64_t syscalls = downstream.GetStats().Syscalls + upstream.GetStats().Syscalls;
+
+	int spectators = GetSpectatorCount();
+	printf("relay  matches %d  spectators %d  ticks in %.0f/s  encodes/tick %.2f  packets out %.0f/s  "
+		"bytes/spectator/s %.0f  busy %.1f%%  spectators/core %.0f  io %s  syscalls/packet %.3f  encode failures %llu\n",
+		(int)matches.size(), spectators, states / seconds, states ? (double)encodes / states : 0.0, packets / seconds,
+		spectators ? bytes / seconds / spectators : 0.0, busy * 100.0, busy > 0.0 ? spectators / busy : 0.0,
+		NetIoModeName(downstream.GetIoMode()), packets ? (double)syscalls / packets : 0.0, (unsigned long long)failures);
+	fflush(stdout);
+
+	downstream.ResetStats();
+	upstream.ResetStats();
+
+	reportStart = stats;
+	reportStartMs = a_nowMs;
+}
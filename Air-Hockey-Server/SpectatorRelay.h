@@ -0,0 +1,112 @@
+#pragma once
+#include <unordered_map>
+#include <vector>
+#include "EventLoop.h"
+#include "../Air-Hockey/NetProtocol.h"
+#include "../Air-Hockey/SnapshotCodec.h"
+
+struct RelaySpectator
+{
+	NetAddress Address;
+	uint32_t AckKeyframe;
+	uint32_t LastHeardMs;
+};
+
+// --------------------------------------------------------
+// One match the relay is pulling from the server, with the
+// keyframes it encodes spectator deltas against
+// --------------------------------------------------------
+struct RelayedMatch
+{
+	uint16_t MatchID;
+	uint32_t LastSubscribeMs;
+
+	//Keyframe for tick t lives in slot (t / NET_KEYFRAME_INTERVAL) % NET_SPECTATOR_BASELINES
+	QuantizedState Keyframes[NET_SPECTATOR_BASELINES];
+
+	QuantizedState Latest;
+	bool HasState;
+
+	std::vector<RelaySpectator> Spectators;
+};
+
+struct RelayStats
+{
+	uint64_t StatesIn;		// Ticks received from the server
+	uint64_t Encodes;		// Deltas encoded (at most one per baseline per tick)
+	uint64_t EncodeFailures;	// Deltas that didn't fit a packet, so weren't sent
+	uint64_t PacketsOut;
+	uint64_t BytesOut;
+	uint64_t BusyUs;		// Time spent handling packets
+};
+
+// --------------------------------------------------------
+// Subscribes once to each watched match on the server and
+// fans every tick out to its spectators.  Each tick is
+// encoded once per keyframe spectators hold (plus once in
+// full for anyone without one), and those same bytes go
+// to every spectator in the group.
+// --------------------------------------------------------
+class SpectatorRelay : public EventHandler
+{
+public:
+	SpectatorRelay();
+	~SpectatorRelay();
+
+	// Listens for spectators on a_port and pulls state from a server
+	// whose shards start at a_server's port
+	bool Start(uint16_t a_port, const NetAddress& a_server, int a_serverShards, NetIoMode a_ioMode = NET_IO_BATCHED);
+	void Stop();
+
+	// Handles packets for up to a_timeoutMs, then does housekeeping
+	void RunOnce(int a_timeoutMs);
+
+	void OnReadable(UdpSocket* a_socket);
+
+	// Adds or refreshes a spectator, as a NET_SPECTATE packet would
+	void Subscribe(uint16_t a_matchID, const NetAddress& a_address, uint32_t a_ackKeyframe, uint32_t a_nowMs);
+
+	// Sends a new tick of a match to its spectators, as a
+	// NET_MATCH_STATE packet from the server would
+	void Publish(uint16_t a_matchID, const MatchState& a_state);
+
+	// Prints throughput every this many seconds (0 = never)
+	void SetReportInterval(float a_seconds) { reportIntervalMs = (uint32_t)(a_seconds * 1000.0f); }
+
+	uint16_t GetPort() { return downstream.GetPort(); }
+	int GetSpectatorCount() { return (int)spectatorLookup.size(); }
+	RelayStats GetStats() { return stats; }
+
+private:
+	EventLoop loop;
+	UdpSocket downstream;	// Spectators
+	UdpSocket upstream;		// Server
+	NetAddress server;
+	int serverShards;
+
+	std::unordered_map<uint16_t, RelayedMatch*> matches;
+
+	//Spectator address -> the match they watch
+	std::unordered_map<uint64_t, uint16_t> spectatorLookup;
+
+	RelayStats stats;
+	RelayStats reportStart;
+	uint32_t reportStartMs;
+	uint32_t reportIntervalMs;
+	uint32_t lastMaintainMs;
+
+	//One encoded packet per baseline, plus the full one at the end
+	static const int FULL_GROUP = NET_SPECTATOR_BASELINES;
+	unsigned char encoded[NET_SPECTATOR_BASELINES + 1][sizeof(SpectatorStatePacket) + SnapshotCodec::MAX_SIZE];
+
+	PacketBatch* packets;
+
+	void Broadcast(RelayedMatch& a_match, const QuantizedState& a_state);
+	int Encode(RelayedMatch& a_match, const QuantizedState& a_state, int a_group, bool a_keyframe);
+	void SubscribeUpstream(RelayedMatch& a_match, uint32_t a_nowMs);
+	void Maintain(uint32_t a_nowMs);
+	void Report(uint32_t a_nowMs);
+
+	static uint64_t AddressKey(const NetAddress& a_address) { return ((uint64_t)a_address.IP << 16) | a_address.Port; }
+	static int KeyframeSlot(uint32_t a_tick) { return (int)((a_tick / NET_KEYFRAME_INTERVAL) % NET_SPECTATOR_BASELINES); }
+};
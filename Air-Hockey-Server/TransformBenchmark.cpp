@@ -0,0 +1,239 @@
+#include "TransformBenchmark.h"
+#include "../Air-Hockey/GameEntity.h"
+#include "../Air-Hockey/JobPool.h"
+#include "../Air-Hockey/NetSocket.h"
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+//Results land here so the timed loops can't be optimised away
+static volatile float benchmarkSink;
+
+// Somewhere for object i to be on frame f; everything moves every frame
+static void Animate(int a_index, int a_frame, float& x, float& y, float& z, float& yaw)
+{
+	float t = a_frame * (1.0f / 120.0f) + a_index * 0.01f;
+	x = (float)(a_index % 64) * 0.1f + 0.5f * std::sin(t);
+	y = -0.2f;
+	z = (float)(a_index / 64) * 0.1f + 0.5f * std::cos(t);
+	yaw = t;
+}
+
+int RunTransformBenchmark(int a_objects, int a_frames)
+{
+	std::vector<GameEntity*> separate(a_objects);
+	std::vector<GameEntity*> batched(a_objects);
+	TransformSystem transforms;
+
+	for (int i = 0; i < a_objects; i++)
+	{
+		separate[i] = new GameEntity(0, 0);
+		batched[i] = new GameEntity(0, 0);
+		separate[i]->SetScale(0.5f, 0.1f, 0.5f);
+		batched[i]->SetScale(0.5f, 0.1f, 0.5f);
+		batched[i]->AttachTransform(&transforms);
+	}
+
+	float x, y, z, yaw;
+	float sink = 0.0f;
+
+	//Each entity builds its own matrix when asked for it
+	uint64_t start = NetTimeUs();
+	for (int frame = 0; frame < a_frames; frame++)
+	{
+		for (int i = 0; i < a_objects; i++)
+		{
+			Animate(i, frame, x, y, z, yaw);
+			separate[i]->SetPosition(x, y, z);
+			separate[i]->SetRotation(0.0f, yaw, 0.0f);
+			sink += separate[i]->GetWorldMatrix()._41;
+		}
+	}
+	uint64_t separateUs = NetTimeUs() - start;
+
+	//Same moves, then one pass over the packed arrays
+	start = NetTimeUs();
+	for (int frame = 0; frame < a_frames; frame++)
+	{
+		for (int i = 0; i < a_objects; i++)
+		{
+			Animate(i, frame, x, y, z, yaw);
+			batched[i]->SetPosition(x, y, z);
+			batched[i]->SetRotation(0.0f, yaw, 0.0f);
+		}
+
+		transforms.BeginFrame();
+		transforms.UpdateWorldMatrices();
+
+		for (int i = 0; i < a_objects; i++)
+			sink += batched[i]->GetWorldMatrix()._41;
+	}
+	uint64_t batchedUs = NetTimeUs() - start;
+	benchmarkSink = sink;
+
+	//Both paths should land on the same matrices
+	float worst = 0.0f;
+	for (int i = 0; i < a_objects; i++)
+	{
+		XMFLOAT4X4 a = separate[i]->GetWorldMatrix();
+		XMFLOAT4X4 b = batched[i]->GetWorldMatrix();
+		for (int r = 0; r < 4; r++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				float difference = std::fabs(a.m[r][c] - b.m[r][c]);
+				if (difference > worst)
+					worst = difference;
+			}
+		}
+	}
+
+	double matrices = (double)a_objects * a_frames;
+	printf("%d objects, %d frames, every object moving\n", a_objects, a_frames);
+	printf("per entity  %7.1f ns/matrix\n", separateUs * 1000.0 / matrices);
+	printf("batched     %7.1f ns/matrix  (rebuilt last frame %u)\n", batchedUs * 1000.0 / matrices, transforms.GetRebuilds());
+	printf("largest difference %g\n", worst);
+
+	for (int i = 0; i < a_objects; i++)
+	{
+		batched[i]->DetachTransform();
+		delete separate[i];
+		delete batched[i];
+	}
+
+	return worst < 1e-4f ? 0 : 1;
+}
+
+static const int SCENE_TREE_SIZE = 256;
+static const int SCENE_FANOUT = 4;
+
+//Parent of node i, or -1 for the root of its tree
+static int SceneParent(int a_index)
+{
+	int local = a_index % SCENE_TREE_SIZE;
+	if (local == 0)
+		return -1;
+	return a_index - local + (local - 1) / SCENE_FANOUT;
+}
+
+static void BuildScene(TransformSystem& a_scene, std::vector<TransformHandle>& a_handles)
+{
+	for (size_t i = 0; i < a_handles.size(); i++)
+	{
+		a_handles[i] = a_scene.Create();
+
+		//Children sit around their parent and a little smaller
+		int parent = SceneParent((int)i);
+		if (parent == -1)
+		{
+			a_scene.SetPosition(a_handles[i], (float)(i / SCENE_TREE_SIZE % 64), 0.0f, (float)(i / SCENE_TREE_SIZE / 64));
+			continue;
+		}
+
+		float angle = (float)(i % SCENE_FANOUT) * 1.5708f;
+		a_scene.SetParent(a_handles[i], a_handles[parent]);
+		a_scene.SetPosition(a_handles[i], std::cos(angle), 0.5f, std::sin(angle));
+		a_scene.SetScale(a_handles[i], 0.5f, 0.5f, 0.5f);
+	}
+}
+
+//Moves every eighth root, a different eighth each frame
+static void MoveScene(TransformSystem& a_scene, std::vector<TransformHandle>& a_handles, int a_frame)
+{
+	int trees = (int)a_handles.size() / SCENE_TREE_SIZE;
+	for (int tree = a_frame % 8; tree < trees; tree += 8)
+	{
+		TransformHandle root = a_handles[tree * SCENE_TREE_SIZE];
+		a_scene.SetRotation(root, 0.0f, a_frame * 0.01f, 0.0f);
+	}
+}
+
+static double TimeScene(TransformSystem& a_scene, std::vector<TransformHandle>& a_handles, int a_frames, unsigned int& a_propagated)
+{
+	//First update sorts and builds everything; not part of the steady state
+	a_scene.UpdateWorldMatrices();
+
+	uint64_t propagated = 0;
+	uint64_t start = NetTimeUs();
+	for (int frame = 0; frame < a_frames; frame++)
+	{
+		a_scene.BeginFrame();
+		MoveScene(a_scene, a_handles, frame);
+		a_scene.UpdateWorldMatrices();
+		propagated += a_scene.GetPropagated();
+	}
+	a_scene.BeginFrame();
+	propagated += a_scene.GetPropagated();
+	uint64_t elapsedUs = NetTimeUs() - start;
+
+	a_propagated = (unsigned int)(propagated / (a_frames > 0 ? a_frames : 1));
+	return elapsedUs * 1000.0 / ((double)a_handles.size() * a_frames);
+}
+
+//Largest difference from worlds built one node at a time, parents first
+static float CheckScene(TransformSystem& a_scene, std::vector<TransformHandle>& a_handles)
+{
+	std::vector<XMFLOAT4X4> reference(a_handles.size());
+	float worst = 0.0f;
+
+	for (size_t i = 0; i < a_handles.size(); i++)
+	{
+		XMFLOAT3 p = a_scene.GetPosition(a_handles[i]);
+		XMFLOAT3 r = a_scene.GetRotation(a_handles[i]);
+		XMFLOAT3 s = a_scene.GetScale(a_handles[i]);
+		XMMATRIX world = XMMatrixScaling(s.x, s.y, s.z) * XMMatrixRotationRollPitchYaw(r.x, r.y, r.z) * XMMatrixTranslation(p.x, p.y, p.z);
+
+		int parent = SceneParent((int)i);
+		if (parent != -1)
+			world = world * XMMatrixTranspose(XMLoadFloat4x4(&reference[parent]));
+		XMStoreFloat4x4(&reference[i], XMMatrixTranspose(world));
+
+		const XMFLOAT4X4& stored = a_scene.GetWorldMatrix(a_handles[i]);
+		for (int row = 0; row < 4; row++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				float difference = std::fabs(stored.m[row][c] - reference[i].m[row][c]);
+				if (difference > worst)
+					worst = difference;
+			}
+		}
+	}
+	return worst;
+}
+
+int RunSceneBenchmark(int a_nodes, int a_frames, int a_threads)
+{
+	//Whole trees only
+	int trees = a_nodes / SCENE_TREE_SIZE;
+	if (trees < 1)
+		trees = 1;
+	a_nodes = trees * SCENE_TREE_SIZE;
+
+	JobPool jobs(a_threads);
+	TransformSystem single(a_nodes);
+	TransformSystem pooled(a_nodes);
+	pooled.SetJobPool(&jobs);
+
+	std::vector<TransformHandle> singleHandles(a_nodes);
+	std::vector<TransformHandle> pooledHandles(a_nodes);
+	BuildScene(single, singleHandles);
+	BuildScene(pooled, pooledHandles);
+
+	unsigned int singlePropagated = 0;
+	unsigned int pooledPropagated = 0;
+	double singleNs = TimeScene(single, singleHandles, a_frames, singlePropagated);
+	double pooledNs = TimeScene(pooled, pooledHandles, a_frames, pooledPropagated);
+
+	float worst = CheckScene(single, singleHandles);
+	float pooledWorst = CheckScene(pooled, pooledHandles);
+	if (pooledWorst > worst)
+		worst = pooledWorst;
+
+	printf("%d nodes in %d trees, %d levels, %d frames, 1/8 of roots moving\n", a_nodes, trees, single.GetDepth(), a_frames);
+	printf("1 thread    %7.2f ns/node  (%u worlds re-evaluated per frame)\n", singleNs, singlePropagated);
+	printf("%d threads   %7.2f ns/node  (%u worlds re-evaluated per frame)\n", jobs.GetThreadCount(), pooledNs, pooledPropagated);
+	printf("largest difference %g\n", worst);
+
+	return worst < 1e-3f ? 0 : 1;
+}
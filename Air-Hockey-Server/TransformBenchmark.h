@@ -0,0 +1,19 @@
+#pragma once
+
+// --------------------------------------------------------
+// Moves a_objects entities every frame for a_frames frames
+// and builds their world matrices, once one heap entity at
+// a time and once as a single batched TransformSystem pass.
+// Prints ns per matrix for both and checks they agree.
+// --------------------------------------------------------
+int RunTransformBenchmark(int a_objects, int a_frames);
+
+// --------------------------------------------------------
+// Builds a forest of a_nodes transforms (trees of 256, four
+// children per node) and moves an eighth of the roots each
+// frame.  Propagates on one thread and on a JobPool, prints
+// ns per node and how many worlds were re-evaluated, and
+// checks both against matrices built by walking parents.
+// a_threads of 0 sizes the pool to the machine.
+// --------------------------------------------------------
+int RunSceneBenchmark(int a_nodes, int a_frames, int a_threads);
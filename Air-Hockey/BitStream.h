@@ -0,0 +1,145 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+// --------------------------------------------------------
+// Little-endian bit packing over a caller-owned buffer.
+// Bits collect in a 64-bit scratch word and move to the
+// buffer 32 at a time, so a write is a shift, an or and
+// at most one store.  Neither class ever allocates.
+// --------------------------------------------------------
+class BitWriter
+{
+public:
+	BitWriter(unsigned char* a_buffer, int a_capacity)
+	{
+		buffer = a_buffer;
+		capacity = a_capacity;
+		bytes = 0;
+		scratch = 0;
+		scratchBits = 0;
+		overflowed = false;
+	}
+
+	// Writes the low a_bits (up to 32) of a_value
+	void Write(uint32_t a_value, int a_bits)
+	{
+		scratch |= (uint64_t)(a_value & (uint32_t)((1ull << a_bits) - 1)) << scratchBits;
+		scratchBits += a_bits;
+
+		if (scratchBits >= 32)
+			FlushWord();
+	}
+
+	// Pads to a whole byte and returns the number of bytes written
+	int Finish()
+	{
+		while (scratchBits > 0 && !overflowed)
+		{
+			if (bytes == capacity)
+			{
+				overflowed = true;
+				break;
+			}
+			buffer[bytes++] = (unsigned char)scratch;
+			scratch >>= 8;
+			scratchBits -= 8;
+		}
+		scratchBits = 0;
+		return overflowed ? -1 : bytes;
+	}
+
+	bool Overflowed() { return overflowed; }
+
+private:
+	unsigned char* buffer;
+	int capacity;
+	int bytes;
+	uint64_t scratch;
+	int scratchBits;
+	bool overflowed;
+
+	void FlushWord()
+	{
+		if (bytes + 4 > capacity)
+		{
+			overflowed = true;
+			scratchBits = 0;
+			return;
+		}
+
+		uint32_t word = (uint32_t)scratch;
+		memcpy(buffer + bytes, &word, 4);
+		bytes += 4;
+		scratch >>= 32;
+		scratchBits -= 32;
+	}
+};
+
+class BitReader
+{
+public:
+	BitReader(const unsigned char* a_data, int a_size)
+	{
+		data = a_data;
+		size = a_size;
+		bytes = 0;
+		scratch = 0;
+		scratchBits = 0;
+		overflowed = false;
+	}
+
+	// Returns the next a_bits (up to 32) without consuming them.
+	// Reading past the end yields zeros and sets Overflowed()
+	uint32_t Peek(int a_bits)
+	{
+		if (scratchBits < a_bits)
+			Refill();
+
+		return (uint32_t)(scratch & ((1ull << a_bits) - 1));
+	}
+
+	void Skip(int a_bits)
+	{
+		if (scratchBits < a_bits)
+			Refill();
+
+		if (scratchBits < a_bits)
+		{
+			overflowed = true;
+			scratch = 0;
+			scratchBits = 0;
+			return;
+		}
+
+		scratch >>= a_bits;
+		scratchBits -= a_bits;
+	}
+
+	uint32_t Read(int a_bits)
+	{
+		uint32_t value = Peek(a_bits);
+		Skip(a_bits);
+		return value;
+	}
+
+	bool Overflowed() { return overflowed; }
+
+private:
+	const unsigned char* data;
+	int size;
+	int bytes;
+	uint64_t scratch;
+	int scratchBits;
+	bool overflowed;
+
+	void Refill()
+	{
+		//Top up a byte at a time; only runs every few fields
+		while (scratchBits <= 56 && bytes < size)
+		{
+			scratch |= (uint64_t)data[bytes++] << scratchBits;
+			scratchBits += 8;
+		}
+	}
+};
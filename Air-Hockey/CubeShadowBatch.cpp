@@ -0,0 +1,141 @@
+#include "CubeShadowBatch.h"
+#include "Mesh.h"
+
+static constexpr SimpleShaderName SHADER_FACE_VIEW_PROJ("faceViewProj");
+
+CubeShadowBatch::CubeShadowBatch(SimpleVertexShader* a_vs, SimpleGeometryShader* a_gs)
+{
+	vs = a_vs;
+	gs = a_gs;
+	instanceBuffer = 0;
+	instanceOwner = 0;
+	instanceCapacity = 0;
+	ring = 0;
+	lastDraws = 0;
+	lastInstances = 0;
+}
+
+CubeShadowBatch::~CubeShadowBatch()
+{
+	if (instanceBuffer)
+		instanceOwner->ReleaseBuffer(instanceBuffer);
+}
+
+void CubeShadowBatch::Begin(const XMFLOAT4X4 a_views[6], const XMFLOAT4X4& a_proj)
+{
+	casters.clear();
+	lastDraws = 0;
+	lastInstances = 0;
+
+	//Both are transposed, so (view * proj)^T = proj^T * view^T
+	XMMATRIX proj = XMLoadFloat4x4(&a_proj);
+	for (int i = 0; i < 6; i++)
+		XMStoreFloat4x4(&faceViewProj[i], XMMatrixMultiply(proj, XMLoadFloat4x4(&a_views[i])));
+}
+
+void CubeShadowBatch::Add(GameEntity* a_caster, unsigned int a_faces)
+{
+	if (!a_caster->GetMesh() || (a_faces & ALL_FACES) == 0)
+		return;
+
+	Caster caster;
+	caster.CasterMesh = a_caster->GetMesh();
+	caster.Entity = a_caster;
+	caster.Faces = a_faces & ALL_FACES;
+	casters.push_back(caster);
+}
+
+void CubeShadowBatch::UploadInstances(RenderBackend* a_backend)
+{
+	uint32_t needed = (uint32_t)instanceData.size();
+
+	if (ring)
+	{
+		TransientAllocation allocation = ring->Upload(&instanceData[0], needed * sizeof(Instance));
+		a_backend->SetInstanceBuffer(allocation.Buffer, sizeof(Instance), allocation.Offset);
+		return;
+	}
+
+	//Grows to fit the most instances yet and stays there
+	if (needed > instanceCapacity || a_backend != instanceOwner)
+	{
+		if (instanceBuffer)
+			instanceOwner->ReleaseBuffer(instanceBuffer);
+
+		uint32_t capacity = instanceCapacity > 0 ? instanceCapacity : 64;
+		while (capacity < needed)
+			capacity *= 2;
+
+		instanceBuffer = a_backend->CreateBuffer(RENDER_BUFFER_VERTEX, capacity * sizeof(Instance), 0, true);
+		instanceOwner = a_backend;
+		instanceCapacity = capacity;
+	}
+
+	a_backend->WriteBuffer(instanceBuffer, &instanceData[0], needed * sizeof(Instance));
+	a_backend->SetInstanceBuffer(instanceBuffer, sizeof(Instance), 0);
+}
+
+void CubeShadowBatch::Execute(RenderBackend* a_backend)
+{
+	if (casters.empty())
+		return;
+
+	//Instances grouped by mesh; a scene has a handful of meshes, so
+	//each group is found by scanning for the first caster not yet taken
+	instanceData.clear();
+	groupStart.clear();
+	groupMesh.clear();
+	taken.assign(casters.size(), 0);
+	for (size_t first = 0; first < casters.size(); first++)
+	{
+		if (taken[first])
+			continue;
+
+		Mesh* mesh = casters[first].CasterMesh;
+		groupStart.push_back((uint32_t)instanceData.size());
+		groupMesh.push_back(mesh);
+
+		for (size_t c = first; c < casters.size(); c++)
+		{
+			if (taken[c] || casters[c].CasterMesh != mesh)
+				continue;
+			taken[c] = 1;
+
+			Instance instance;
+			instance.World = casters[c].Entity->GetWorldMatrix();
+			instance.Padding[0] = instance.Padding[1] = instance.Padding[2] = 0;
+			for (uint32_t face = 0; face < 6; face++)
+			{
+				if (casters[c].Faces & (1 << face))
+				{
+					instance.Face = face;
+					instanceData.push_back(instance);
+				}
+			}
+		}
+	}
+	groupStart.push_back((uint32_t)instanceData.size());
+
+	UploadInstances(a_backend);
+
+	vs->SetTarget(a_backend);
+	gs->SetTarget(a_backend);
+	vs->SetData(SHADER_FACE_VIEW_PROJ, faceViewProj, sizeof(faceViewProj));
+	vs->CopyAllBufferData();
+	vs->SetShader();
+	gs->SetShader();
+	a_backend->SetShader(RENDER_STAGE_PIXEL, 0);
+
+	for (size_t g = 0; g < groupMesh.size(); g++)
+	{
+		Mesh* mesh = groupMesh[g];
+		a_backend->SetVertexBuffer(mesh->GetVertexBuffer(), sizeof(Vertex), 0);
+		a_backend->SetIndexBuffer(mesh->GetIndexBuffer());
+		a_backend->DrawIndexedInstanced(mesh->GetIndexCount(), groupStart[g + 1] - groupStart[g], 0, 0, groupStart[g]);
+		lastDraws++;
+	}
+	lastInstances = (int)instanceData.size();
+
+	//Nothing else drawn expects a geometry shader
+	a_backend->SetShader(RENDER_STAGE_GEOMETRY, 0);
+}
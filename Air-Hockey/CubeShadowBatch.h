@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+#include "RenderBackend.h"
+#include "SimpleShader.h"
+#include "GameEntity.h"
+#include "TransientRing.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Draws casters into any of a cube map's six faces at once.
+//
+// Every (caster, face) pair becomes one instance: its world
+// matrix and the face number.  CubeShadowVS picks that face's
+// view * projection and CubeShadowGS sends the triangle to
+// that face of the texture array, so the whole cube is one
+// instanced draw per mesh instead of a draw per caster per
+// face.  The depth view bound must cover all six faces.
+// --------------------------------------------------------
+class CubeShadowBatch
+{
+public:
+	CubeShadowBatch(SimpleVertexShader* a_vs, SimpleGeometryShader* a_gs);
+	~CubeShadowBatch();
+
+	// Views as the shaders get them (transposed), one per face.
+	// Clears the casters and the counts below
+	void Begin(const XMFLOAT4X4 a_views[6], const XMFLOAT4X4& a_proj);
+
+	// Draws a_caster into every face whose bit is set in a_faces
+	void Add(GameEntity* a_caster, unsigned int a_faces);
+
+	// One upload, then one draw per mesh
+	void Execute(RenderBackend* a_backend);
+
+	// Where the instances go; 0 (the default) keeps a buffer of the
+	// batch's own.  a_ring must write through the backend drawn with
+	void SetTransientRing(TransientRing* a_ring) { ring = a_ring; }
+
+	// What the last Execute() since Begin() drew
+	int GetLastDraws() { return lastDraws; }
+	int GetLastInstances() { return lastInstances; }
+
+	static const unsigned int ALL_FACES = 0x3F;
+
+private:
+	//Matches CubeShadowVS's per-instance input, padded to 16 bytes
+	struct Instance
+	{
+		XMFLOAT4X4 World;
+		uint32_t Face;
+		uint32_t Padding[3];
+	};
+
+	struct Caster
+	{
+		Mesh* CasterMesh;
+		GameEntity* Entity;
+		unsigned int Faces;
+	};
+
+	SimpleVertexShader* vs;
+	SimpleGeometryShader* gs;
+	XMFLOAT4X4 faceViewProj[6];
+
+	std::vector<Caster> casters;
+	std::vector<Instance> instanceData;
+
+	//Where each mesh's instances start, kept to save allocating every frame
+	std::vector<uint32_t> groupStart;
+	std::vector<Mesh*> groupMesh;
+	std::vector<char> taken;
+
+	ID3D11Buffer* instanceBuffer;
+	RenderBackend* instanceOwner;
+	uint32_t instanceCapacity;
+	TransientRing* ring;
+
+	int lastDraws;
+	int lastInstances;
+
+	void UploadInstances(RenderBackend* a_backend);
+};
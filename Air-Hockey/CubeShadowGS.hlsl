@@ -0,0 +1,32 @@
+// Same as CubeShadowVS's output
+struct VertexToGeometry
+{
+	float4 position		: SV_POSITION;
+	nointerpolation uint face : FACE;
+};
+
+// SV_RenderTargetArrayIndex picks the slice of the bound
+// texture array - here, the cube face - a triangle lands in
+struct GeometryToPixel
+{
+	float4 position		: SV_POSITION;
+	uint slice			: SV_RenderTargetArrayIndex;
+};
+
+// --------------------------------------------------------
+// Passes each triangle through untouched, into the cube face
+// its instance was drawn for.  Vertex shaders can only write
+// the slice themselves on newer hardware; this works on all
+// feature level 11 cards.
+// --------------------------------------------------------
+[maxvertexcount(3)]
+void main(triangle VertexToGeometry input[3], inout TriangleStream<GeometryToPixel> output)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		GeometryToPixel vertex;
+		vertex.position = input[i].position;
+		vertex.slice = input[0].face;
+		output.Append(vertex);
+	}
+}
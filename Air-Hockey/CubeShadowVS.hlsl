@@ -0,0 +1,61 @@
+// Constant Buffer
+// - Allows us to define a buffer of individual variables 
+//    which will (eventually) hold data from our C++ code
+// - All non-pipeline variables that get their values from 
+//    our C++ code must be defined inside a Constant Buffer
+// - The name of the cbuffer itself is unimportant
+// - One view * projection per cube face, so every face is
+//    drawn by the same draw call
+cbuffer externalData : register(b0)
+{
+	matrix faceViewProj[6];
+};
+
+// Struct representing a single vertex worth of data
+// - This should match the vertex definition in our C++ code
+// - By "match", I mean the size, order and number of members
+// - The name of the struct itself is unimportant, but should be descriptive
+// - Each variable must have a semantic, which defines its usage
+struct VertexShaderInput
+{ 
+	// Data type
+	//  |
+	//  |   Name          Semantic
+	//  |    |                |
+	//  v    v                v
+	float3 position		: POSITION;     // XYZ position
+	float3 normal		: NORMAL;       // Normal
+	float2 uv           : TEXCOORD;     // UV
+
+	// The world matrix, as GetWorldMatrix() gives it (transposed), a row
+	// at a time, and which face this instance is drawn into.
+	// "_PER_INSTANCE" puts these in input slot 1
+	float4 world0		: WORLD_PER_INSTANCE0;
+	float4 world1		: WORLD_PER_INSTANCE1;
+	float4 world2		: WORLD_PER_INSTANCE2;
+	float4 world3		: WORLD_PER_INSTANCE3;
+	uint face			: FACE_PER_INSTANCE;
+};
+
+// Goes to CubeShadowGS, which sends the triangle to its face
+struct VertexToGeometry
+{
+	float4 position		: SV_POSITION;
+	nointerpolation uint face : FACE;
+};
+
+// --------------------------------------------------------
+// The entry point (main method) for our vertex shader
+// --------------------------------------------------------
+VertexToGeometry main( VertexShaderInput input )
+{
+	VertexToGeometry output;
+
+	// Undo the transpose the C++ side does for constant buffers
+	matrix world = transpose(matrix(input.world0, input.world1, input.world2, input.world3));
+
+	output.position = mul(mul(float4(input.position, 1.0f), world), faceViewProj[input.face]);
+	output.face = input.face;
+
+	return output;
+}
@@ -0,0 +1,336 @@
+#include "D3D11Backend.h"
+#include <cstring>
+
+// A finished deferred context's calls
+class D3D11CommandList : public RenderCommandList
+{
+public:
+	D3D11CommandList() { List = 0; }
+	~D3D11CommandList() { if (List) List->Release(); }
+
+	ID3D11CommandList* List;
+};
+
+D3D11Backend::D3D11Backend(ID3D11Device* a_device, ID3D11DeviceContext* a_context)
+{
+	device = a_device;
+	context = a_context;
+	ownsContext = false;
+}
+
+D3D11Backend::~D3D11Backend()
+{
+	if (ownsContext)
+		context->Release();
+}
+
+ID3D11Buffer* D3D11Backend::CreateBuffer(RenderBufferType a_type, unsigned int a_bytes, const void* a_initialData, bool a_dynamic)
+{
+	D3D11_BUFFER_DESC desc = {};
+	desc.ByteWidth = a_bytes;
+	switch (a_type)
+	{
+	case RENDER_BUFFER_VERTEX: desc.BindFlags = D3D11_BIND_VERTEX_BUFFER; break;
+	case RENDER_BUFFER_INDEX: desc.BindFlags = D3D11_BIND_INDEX_BUFFER; break;
+	case RENDER_BUFFER_CONSTANT: desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER; break;
+	}
+
+	if (a_dynamic)
+	{
+		desc.Usage = D3D11_USAGE_DYNAMIC;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	}
+	else
+	{
+		//Constant buffers get UpdateBuffer(); everything else never changes
+		desc.Usage = a_type == RENDER_BUFFER_CONSTANT || !a_initialData ? D3D11_USAGE_DEFAULT : D3D11_USAGE_IMMUTABLE;
+	}
+
+	D3D11_SUBRESOURCE_DATA data = {};
+	data.pSysMem = a_initialData;
+
+	ID3D11Buffer* buffer = 0;
+	device->CreateBuffer(&desc, a_initialData ? &data : 0, &buffer);
+	return buffer;
+}
+
+void D3D11Backend::ReleaseBuffer(ID3D11Buffer* a_buffer)
+{
+	if (a_buffer)
+		a_buffer->Release();
+}
+
+ID3D11RasterizerState* D3D11Backend::CreateRasterizerState(const D3D11_RASTERIZER_DESC& a_desc)
+{
+	ID3D11RasterizerState* state = 0;
+	device->CreateRasterizerState(&a_desc, &state);
+	return state;
+}
+
+ID3D11DepthStencilState* D3D11Backend::CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& a_desc)
+{
+	ID3D11DepthStencilState* state = 0;
+	device->CreateDepthStencilState(&a_desc, &state);
+	return state;
+}
+
+ID3D11BlendState* D3D11Backend::CreateBlendState(const D3D11_BLEND_DESC& a_desc)
+{
+	ID3D11BlendState* state = 0;
+	device->CreateBlendState(&a_desc, &state);
+	return state;
+}
+
+ID3D11SamplerState* D3D11Backend::CreateSamplerState(const D3D11_SAMPLER_DESC& a_desc)
+{
+	ID3D11SamplerState* state = 0;
+	device->CreateSamplerState(&a_desc, &state);
+	return state;
+}
+
+void D3D11Backend::ReleaseState(ID3D11DeviceChild* a_state)
+{
+	if (a_state)
+		a_state->Release();
+}
+
+void D3D11Backend::UpdateBuffer(ID3D11Buffer* a_buffer, const void* a_data, unsigned int a_bytes)
+{
+	context->UpdateSubresource(a_buffer, 0, 0, a_data, 0, 0);
+	frame.Uploads++;
+	frame.BytesUploaded += a_bytes;
+}
+
+void D3D11Backend::WriteBuffer(ID3D11Buffer* a_buffer, const void* a_data, unsigned int a_bytes)
+{
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	if (FAILED(context->Map(a_buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		return;
+
+	memcpy(mapped.pData, a_data, a_bytes);
+	context->Unmap(a_buffer, 0);
+	frame.Uploads++;
+	frame.BytesUploaded += a_bytes;
+}
+
+void D3D11Backend::WriteBufferRange(ID3D11Buffer* a_buffer, unsigned int a_offset, const void* a_data, unsigned int a_bytes, bool a_discard)
+{
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	if (FAILED(context->Map(a_buffer, 0, a_discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE, 0, &mapped)))
+		return;
+
+	memcpy((unsigned char*)mapped.pData + a_offset, a_data, a_bytes);
+	context->Unmap(a_buffer, 0);
+	frame.Uploads++;
+	frame.BytesUploaded += a_bytes;
+}
+
+void D3D11Backend::SetVertexBuffer(ID3D11Buffer* a_buffer, unsigned int a_stride, unsigned int a_offset)
+{
+	context->IASetVertexBuffers(0, 1, &a_buffer, &a_stride, &a_offset);
+	frame.StateChanges++;
+}
+
+void D3D11Backend::SetIndexBuffer(ID3D11Buffer* a_buffer)
+{
+	context->IASetIndexBuffer(a_buffer, DXGI_FORMAT_R32_UINT, 0);
+	frame.StateChanges++;
+}
+
+void D3D11Backend::SetInstanceBuffer(ID3D11Buffer* a_buffer, unsigned int a_stride, unsigned int a_offset)
+{
+	context->IASetVertexBuffers(1, 1, &a_buffer, &a_stride, &a_offset);
+	frame.StateChanges++;
+}
+
+void D3D11Backend::SetInputLayout(ID3D11InputLayout* a_layout)
+{
+	context->IASetInputLayout(a_layout);
+	frame.StateChanges++;
+}
+
+void D3D11Backend::SetShader(RenderStage a_stage, ID3D11DeviceChild* a_shader)
+{
+	switch (a_stage)
+	{
+	case RENDER_STAGE_VERTEX: context->VSSetShader((ID3D11VertexShader*)a_shader, 0, 0); break;
+	case RENDER_STAGE_HULL: context->HSSetShader((ID3D11HullShader*)a_shader, 0, 0); break;
+	case RENDER_STAGE_DOMAIN: context->DSSetShader((ID3D11DomainShader*)a_shader, 0, 0); break;
+	case RENDER_STAGE_GEOMETRY: context->GSSetShader((ID3D11GeometryShader*)a_shader, 0, 0); break;
+	case RENDER_STAGE_PIXEL: context->PSSetShader((ID3D11PixelShader*)a_shader, 0, 0); break;
+	case RENDER_STAGE_COMPUTE: context->CSSetShader((ID3D11ComputeShader*)a_shader, 0, 0); break;
+	default: return;
+	}
+	frame.StateChanges++;
+}
+
+void D3D11Backend::SetConstantBuffer(RenderStage a_stage, unsigned int a_slot, ID3D11Buffer* a_buffer)
+{
+	switch (a_stage)
+	{
+	case RENDER_STAGE_VERTEX: context->VSSetConstantBuffers(a_slot, 1, &a_buffer); break;
+	case RENDER_STAGE_HULL: context->HSSetConstantBuffers(a_slot, 1, &a_buffer); break;
+	case RENDER_STAGE_DOMAIN: context->DSSetConstantBuffers(a_slot, 1, &a_buffer); break;
+	case RENDER_STAGE_GEOMETRY: context->GSSetConstantBuffers(a_slot, 1, &a_buffer); break;
+	case RENDER_STAGE_PIXEL: context->PSSetConstantBuffers(a_slot, 1, &a_buffer); break;
+	case RENDER_STAGE_COMPUTE: context->CSSetConstantBuffers(a_slot, 1, &a_buffer); break;
+	default: return;
+	}
+	frame.StateChanges++;
+}
+
+void D3D11Backend::SetShaderResource(RenderStage a_stage, unsigned int a_slot, ID3D11ShaderResourceView* a_srv)
+{
+	switch (a_stage)
+	{
+	case RENDER_STAGE_VERTEX: context->VSSetShaderResources(a_slot, 1, &a_srv); break;
+	case RENDER_STAGE_HULL: context->HSSetShaderResources(a_slot, 1, &a_srv); break;
+	case RENDER_STAGE_DOMAIN: context->DSSetShaderResources(a_slot, 1, &a_srv); break;
+	case RENDER_STAGE_GEOMETRY: context->GSSetShaderResources(a_slot, 1, &a_srv); break;
+	case RENDER_STAGE_PIXEL: context->PSSetShaderResources(a_slot, 1, &a_srv); break;
+	case RENDER_STAGE_COMPUTE: context->CSSetShaderResources(a_slot, 1, &a_srv); break;
+	default: return;
+	}
+	frame.StateChanges++;
+}
+
+void D3D11Backend::SetSampler(RenderStage a_stage, unsigned int a_slot, ID3D11SamplerState* a_sampler)
+{
+	switch (a_stage)
+	{
+	case RENDER_STAGE_VERTEX: context->VSSetSamplers(a_slot, 1, &a_sampler); break;
+	case RENDER_STAGE_HULL: context->HSSetSamplers(a_slot, 1, &a_sampler); break;
+	case RENDER_STAGE_DOMAIN: context->DSSetSamplers(a_slot, 1, &a_sampler); break;
+	case RENDER_STAGE_GEOMETRY: context->GSSetSamplers(a_slot, 1, &a_sampler); break;
+	case RENDER_STAGE_PIXEL: context->PSSetSamplers(a_slot, 1, &a_sampler); break;
+	case RENDER_STAGE_COMPUTE: context->CSSetSamplers(a_slot, 1, &a_sampler); break;
+	default: return;
+	}
+	frame.StateChanges++;
+}
+
+void D3D11Backend::SetUnorderedAccess(unsigned int a_slot, ID3D11UnorderedAccessView* a_uav, unsigned int a_initialCount)
+{
+	context->CSSetUnorderedAccessViews(a_slot, 1, &a_uav, &a_initialCount);
+	frame.StateChanges++;
+}
+
+void D3D11Backend::SetRasterizerState(ID3D11RasterizerState* a_state)
+{
+	context->RSSetState(a_state);
+	frame.StateChanges++;
+}
+
+void D3D11Backend::SetBlendState(ID3D11BlendState* a_state, const float a_factor[4], unsigned int a_sampleMask)
+{
+	context->OMSetBlendState(a_state, a_factor, a_sampleMask);
+	frame.StateChanges++;
+}
+
+void D3D11Backend::SetDepthStencilState(ID3D11DepthStencilState* a_state, unsigned int a_stencilRef)
+{
+	context->OMSetDepthStencilState(a_state, a_stencilRef);
+	frame.StateChanges++;
+}
+
+void D3D11Backend::SetRenderTarget(ID3D11RenderTargetView* a_target, ID3D11DepthStencilView* a_depth)
+{
+	//Depth-only passes bind no colour target at all
+	context->OMSetRenderTargets(a_target ? 1 : 0, a_target ? &a_target : 0, a_depth);
+	frame.StateChanges++;
+}
+
+void D3D11Backend::SetViewport(float a_width, float a_height)
+{
+	D3D11_VIEWPORT viewport = {};
+	viewport.Width = a_width;
+	viewport.Height = a_height;
+	viewport.MinDepth = 0.0f;
+	viewport.MaxDepth = 1.0f;
+	context->RSSetViewports(1, &viewport);
+	frame.StateChanges++;
+}
+
+void D3D11Backend::ClearRenderTarget(ID3D11RenderTargetView* a_target, const float a_color[4])
+{
+	context->ClearRenderTargetView(a_target, a_color);
+	frame.Clears++;
+}
+
+void D3D11Backend::ClearDepth(ID3D11DepthStencilView* a_depth, float a_value, bool a_stencil)
+{
+	//Stencil is zeroed too, on views that have one
+	context->ClearDepthStencilView(a_depth, D3D11_CLEAR_DEPTH | (a_stencil ? D3D11_CLEAR_STENCIL : 0), a_value, 0);
+	frame.Clears++;
+}
+
+void D3D11Backend::CopyResource(ID3D11Resource* a_dest, ID3D11Resource* a_source)
+{
+	context->CopyResource(a_dest, a_source);
+	frame.Copies++;
+}
+
+void D3D11Backend::DrawIndexed(unsigned int a_indexCount, unsigned int a_startIndex, int a_baseVertex)
+{
+	context->DrawIndexed(a_indexCount, a_startIndex, a_baseVertex);
+	frame.Draws++;
+	frame.Indices += a_indexCount;
+}
+
+void D3D11Backend::DrawIndexedInstanced(unsigned int a_indexCount, unsigned int a_instanceCount, unsigned int a_startIndex, int a_baseVertex, unsigned int a_startInstance)
+{
+	context->DrawIndexedInstanced(a_indexCount, a_instanceCount, a_startIndex, a_baseVertex, a_startInstance);
+	frame.Draws++;
+	frame.Indices += a_indexCount * a_instanceCount;
+	frame.Instances += a_instanceCount;
+}
+
+void D3D11Backend::Draw(unsigned int a_vertexCount, unsigned int a_startVertex)
+{
+	context->Draw(a_vertexCount, a_startVertex);
+	frame.Draws++;
+	frame.Indices += a_vertexCount;
+}
+
+void D3D11Backend::Dispatch(unsigned int a_groupsX, unsigned int a_groupsY, unsigned int a_groupsZ)
+{
+	context->Dispatch(a_groupsX, a_groupsY, a_groupsZ);
+	frame.Draws++;
+}
+
+RenderBackend* D3D11Backend::CreateDeferred()
+{
+	ID3D11DeviceContext* deferred = 0;
+	if (FAILED(device->CreateDeferredContext(0, &deferred)))
+		return 0;
+
+	//Everything here is drawn as triangle lists, and a new context
+	//starts without a topology
+	deferred->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	D3D11Backend* backend = new D3D11Backend(device, deferred);
+	backend->ownsContext = true;
+	return backend;
+}
+
+RenderCommandList* D3D11Backend::FinishCommandList()
+{
+	//The deferred context goes back to the D3D defaults for the next list
+	D3D11CommandList* list = new D3D11CommandList();
+	context->FinishCommandList(FALSE, &list->List);
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	TakeFrameStats(list);
+	return list;
+}
+
+void D3D11Backend::ExecuteCommandList(RenderCommandList* a_list)
+{
+	D3D11CommandList* list = (D3D11CommandList*)a_list;
+	if (list->List)
+		context->ExecuteCommandList(list->List, FALSE);
+
+	//Not restoring state clears the topology too
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	AddFrameStats(list->Stats);
+	delete list;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <d3d11.h>
+#include "RenderBackend.h"
+
+// --------------------------------------------------------
+// RenderBackend on a D3D11 device and immediate context.
+// Each call maps onto one or two context calls.
+//
+// Deferred backends get a deferred context of their own;
+// their lists are ID3D11CommandLists, run without keeping
+// the immediate context's state.
+// --------------------------------------------------------
+class D3D11Backend : public RenderBackend
+{
+public:
+	D3D11Backend(ID3D11Device* a_device, ID3D11DeviceContext* a_context);
+	~D3D11Backend();
+
+	ID3D11Buffer* CreateBuffer(RenderBufferType a_type, unsigned int a_bytes, const void* a_initialData, bool a_dynamic);
+	void ReleaseBuffer(ID3D11Buffer* a_buffer);
+	void UpdateBuffer(ID3D11Buffer* a_buffer, const void* a_data, unsigned int a_bytes);
+	void WriteBuffer(ID3D11Buffer* a_buffer, const void* a_data, unsigned int a_bytes);
+	void WriteBufferRange(ID3D11Buffer* a_buffer, unsigned int a_offset, const void* a_data, unsigned int a_bytes, bool a_discard);
+
+	ID3D11RasterizerState* CreateRasterizerState(const D3D11_RASTERIZER_DESC& a_desc);
+	ID3D11DepthStencilState* CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& a_desc);
+	ID3D11BlendState* CreateBlendState(const D3D11_BLEND_DESC& a_desc);
+	ID3D11SamplerState* CreateSamplerState(const D3D11_SAMPLER_DESC& a_desc);
+	void ReleaseState(ID3D11DeviceChild* a_state);
+
+	void SetVertexBuffer(ID3D11Buffer* a_buffer, unsigned int a_stride, unsigned int a_offset);
+	void SetIndexBuffer(ID3D11Buffer* a_buffer);
+	void SetInstanceBuffer(ID3D11Buffer* a_buffer, unsigned int a_stride, unsigned int a_offset);
+	void SetInputLayout(ID3D11InputLayout* a_layout);
+
+	void SetShader(RenderStage a_stage, ID3D11DeviceChild* a_shader);
+	void SetConstantBuffer(RenderStage a_stage, unsigned int a_slot, ID3D11Buffer* a_buffer);
+	void SetShaderResource(RenderStage a_stage, unsigned int a_slot, ID3D11ShaderResourceView* a_srv);
+	void SetSampler(RenderStage a_stage, unsigned int a_slot, ID3D11SamplerState* a_sampler);
+	void SetUnorderedAccess(unsigned int a_slot, ID3D11UnorderedAccessView* a_uav, unsigned int a_initialCount);
+
+	void SetRasterizerState(ID3D11RasterizerState* a_state);
+	void SetBlendState(ID3D11BlendState* a_state, const float a_factor[4], unsigned int a_sampleMask);
+	void SetDepthStencilState(ID3D11DepthStencilState* a_state, unsigned int a_stencilRef);
+	void SetRenderTarget(ID3D11RenderTargetView* a_target, ID3D11DepthStencilView* a_depth);
+	void SetViewport(float a_width, float a_height);
+
+	void ClearRenderTarget(ID3D11RenderTargetView* a_target, const float a_color[4]);
+	void ClearDepth(ID3D11DepthStencilView* a_depth, float a_value, bool a_stencil);
+	void CopyResource(ID3D11Resource* a_dest, ID3D11Resource* a_source);
+
+	void DrawIndexed(unsigned int a_indexCount, unsigned int a_startIndex, int a_baseVertex);
+	void DrawIndexedInstanced(unsigned int a_indexCount, unsigned int a_instanceCount, unsigned int a_startIndex, int a_baseVertex, unsigned int a_startInstance);
+	void Draw(unsigned int a_vertexCount, unsigned int a_startVertex);
+	void Dispatch(unsigned int a_groupsX, unsigned int a_groupsY, unsigned int a_groupsZ);
+
+	RenderBackend* CreateDeferred();
+	RenderCommandList* FinishCommandList();
+	void ExecuteCommandList(RenderCommandList* a_list);
+
+	ID3D11DeviceContext* GetContext() { return context; }
+
+private:
+	ID3D11Device* device;
+	ID3D11DeviceContext* context;
+
+	//Deferred contexts are made here, and released here too
+	bool ownsContext;
+};
@@ -1,7 +1,9 @@
 #include "DXCore.h"
 
 #include <WindowsX.h>
+#include <mmsystem.h>
 #include <sstream>
+#include <thread>
 
 // Define the static instance variable so our OS-level 
 // message handling function below can talk to our object
@@ -49,13 +51,18 @@ DXCore::DXCore(
 
 	// Initialize fields
 	fpsFrameCount = 0;
+	renderFrameCount = 0;
 	fpsTimeElapsed = 0.0f;
+	rendering = false;
+	pendingSize = 0;
+	drawnSize = windowWidth << 16 | windowHeight;
 	
 	device = 0;
 	context = 0;
 	swapChain = 0;
 	backBufferRTV = 0;
 	depthStencilView = 0;
+	updateInterval = 0.0f;
 
 	// Query performance counter for accurate timing information
 	__int64 perfFreq;
@@ -338,7 +345,8 @@ void DXCore::OnResize()
 // --------------------------------------------------------
 // This is the main game loop, handling the following:
 //  - OS-level messages coming in from Windows itself
-//  - Calling update & draw back and forth, forever
+//  - Calling update every updateInterval, while the
+//    render thread calls draw as often as it can
 // --------------------------------------------------------
 HRESULT DXCore::Run()
 {
@@ -353,6 +361,14 @@ HRESULT DXCore::Run()
 	// Give subclass a chance to initialize
 	Init();
 
+	// Drawing from here on happens on the render thread only
+	rendering = true;
+	std::thread renderThread(&DXCore::RenderLoop, this);
+
+	// Waits between Updates would otherwise round up to the
+	// system's timer tick, which can be 15ms or more
+	timeBeginPeriod(1);
+
 	// Our overall game and message loop
 	MSG msg = {};
 	while (msg.message != WM_QUIT)
@@ -367,23 +383,70 @@ HRESULT DXCore::Run()
 		}
 		else
 		{
+			// Sleep until the next Update is due, or a message
+			// arrives; the last part of a millisecond is spun
+			__int64 now;
+			QueryPerformanceCounter((LARGE_INTEGER*)&now);
+			double wait = updateInterval - (now - previousTime) * perfCounterSeconds;
+			if (wait > 0.0)
+			{
+				if (wait >= 0.001)
+					MsgWaitForMultipleObjects(0, NULL, FALSE, (DWORD)(wait * 1000.0), QS_ALLINPUT);
+				continue;
+			}
+
 			// Update timer and title bar (if necessary)
 			UpdateTimer();
 			if(titleBarStats)
 				UpdateTitleBarStats();
 
-			// The game loop
+			// The game loop; Draw picks up what it can
 			Update(deltaTime, totalTime);
-			Draw(deltaTime, totalTime);
 		}
 	}
 
+	timeEndPeriod(1);
+	rendering = false;
+	renderThread.join();
+
 	// We'll end up here once we get a WM_QUIT message,
 	// which usually comes from the user closing the window
 	return (HRESULT)msg.wParam;
 }
 
 
+// --------------------------------------------------------
+// The render thread: draws whatever Update has handed over
+// most recently, as fast as it can, with its own timer.
+// Window resizes are picked up at the start of a frame, so
+// nothing else touches the swap chain or the context
+// --------------------------------------------------------
+void DXCore::RenderLoop()
+{
+	__int64 previous = startTime;
+	while (rendering)
+	{
+		unsigned int size = pendingSize.exchange(0);
+		if (size)
+		{
+			width = size >> 16;
+			height = size & 0xFFFF;
+			OnResize();
+			drawnSize = size;
+		}
+
+		__int64 now;
+		QueryPerformanceCounter((LARGE_INTEGER*)&now);
+		float renderDelta = max((float)((now - previous) * perfCounterSeconds), 0.0f);
+		float renderTotal = (float)((now - startTime) * perfCounterSeconds);
+		previous = now;
+
+		Draw(renderDelta, renderTotal);
+		renderFrameCount++;
+	}
+}
+
+
 // --------------------------------------------------------
 // Sends an OS-level window close message to our process, which
 // will be handled by our message processing function
@@ -435,16 +498,19 @@ void DXCore::UpdateTitleBarStats()
 		return;
 
 	// How long did each frame take?  (Approx)
-	float mspf = 1000.0f / (float)fpsFrameCount;
+	int frames = renderFrameCount.exchange(0);
+	float mspf = frames > 0 ? 1000.0f / (float)frames : 0.0f;
 
 	// Quick and dirty title bar text (mostly for debugging)
+	unsigned int size = drawnSize;
 	std::ostringstream output;
 	output.precision(6);
 	output << titleBarText <<
-		"    Width: "		<< width <<
-		"    Height: "		<< height <<
-		"    FPS: "			<< fpsFrameCount <<
-		"    Frame Time: "	<< mspf << "ms";
+		"    Width: "		<< (size >> 16) <<
+		"    Height: "		<< (size & 0xFFFF) <<
+		"    FPS: "			<< frames <<
+		"    Frame Time: "	<< mspf << "ms" <<
+		"    Updates: "		<< fpsFrameCount;
 
 	// Append the version of DirectX the app is using
 	switch (dxFeatureLevel)
@@ -535,9 +601,19 @@ LRESULT DXCore::ProcessMessage(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lPara
 
 	// Sent when the window size changes
 	case WM_SIZE:
+		// Once the render thread is drawing, it resizes
+		// our required buffers itself, before its next frame
+		if (rendering)
+		{
+			if (LOWORD(lParam) > 0 && HIWORD(lParam) > 0)
+				pendingSize = (unsigned int)LOWORD(lParam) << 16 | HIWORD(lParam);
+			return 0;
+		}
+
 		// Save the new client area dimensions.
 		width = LOWORD(lParam);
 		height = HIWORD(lParam);
+		drawnSize = width << 16 | height;
 
 		// If DX is initialized, resize 
 		// our required buffers
@@ -3,10 +3,12 @@
 #include <Windows.h>
 #include <d3d11.h>
 #include <string>
+#include <atomic>
 
 // We can include the correct library files here
 // instead of in Visual Studio settings if we want
 #pragma comment(lib, "d3d11.lib")
+#pragma comment(lib, "winmm.lib")
 
 class DXCore
 {
@@ -38,7 +40,9 @@ public:
 	void Quit();
 	virtual void OnResize();
 	
-	// Pure virtual methods for setup and game functionality
+	// Pure virtual methods for setup and game functionality.  Update
+	// runs on this thread and Draw on a render thread of its own, at
+	// the same time, so they shouldn't share anything unguarded
 	virtual void Init()										= 0;
 	virtual void Update(float deltaTime, float totalTime)	= 0;
 	virtual void Draw(float deltaTime, float totalTime)		= 0;
@@ -69,6 +73,10 @@ protected:
 	ID3D11RenderTargetView* backBufferRTV;
 	ID3D11DepthStencilView* depthStencilView;
 
+	// Seconds from one Update to the next; the loop waits out the
+	// rest (still handling messages).  0 runs them back to back
+	float updateInterval;
+
 	// Helper function for allocating a console window
 	void CreateConsoleWindow(int bufferLines, int bufferColumns, int windowLines, int windowColumns);
 
@@ -81,11 +89,21 @@ private:
 	__int64 currentTime;
 	__int64 previousTime;
 
-	// FPS calculation
+	// FPS calculation (updates on this thread, frames on the render thread)
 	int fpsFrameCount;
+	std::atomic<int> renderFrameCount;
 	float fpsTimeElapsed;
+
+	// Render thread; it resizes the buffers itself, so a new size
+	// waits here (width << 16 | height, 0 if none) for its next frame.
+	// width and height are its own from then on, and the size it's
+	// drawing at is copied out for this thread's title bar
+	std::atomic<bool> rendering;
+	std::atomic<unsigned int> pendingSize;
+	std::atomic<unsigned int> drawnSize;
 	
 	void UpdateTimer();			// Updates the timer for this frame
 	void UpdateTitleBarStats();	// Puts debug info in the title bar
+	void RenderLoop();			// Draws until Run() is done
 };
 
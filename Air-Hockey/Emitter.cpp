@@ -1,5 +1,9 @@
 #include "Emitter.h"
 
+static constexpr SimpleShaderName SHADER_VIEW("view");
+static constexpr SimpleShaderName SHADER_PROJECTION("projection");
+static constexpr SimpleShaderName SHADER_PARTICLE("particle");
+
 
 
 Emitter::Emitter()
@@ -55,13 +59,6 @@ Emitter::Emitter(DirectX::XMFLOAT3 pos,
 		particleVertices[i + 3].UV = XMFLOAT2(0, 1);
 	}
 
-	D3D11_BUFFER_DESC vbDesc = {};
-	vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	vbDesc.Usage = D3D11_USAGE_DYNAMIC;
-	vbDesc.ByteWidth = sizeof(ParticleVertex) * 4 * maxParticles;
-	device->CreateBuffer(&vbDesc, 0, &vertexBuffer);
-
 	unsigned int* indices = new unsigned int[maxParticles * 6];
 	int indexCount = 0;
 	for (int i = 0; i < maxParticles * 4; i += 4) {
@@ -101,7 +98,6 @@ Emitter::~Emitter()
 {
 	delete[] particles;
 	delete[] particleVertices;
-	vertexBuffer->Release();
 	indexBuffer->Release();
 }
 
@@ -210,79 +206,75 @@ void Emitter::SpawnParticle()
 	livingParticleCount++;
 }
 
-void Emitter::CopyParticlesToGPU(ID3D11DeviceContext * context)
+void Emitter::Capture(std::vector<Particle>& a_particles)
 {
-	if (livingParticleCount || active) {
-		if (firstAliveIndex < firstDeadIndex) {
-			for (int i = firstAliveIndex; i < firstDeadIndex; i++)
-				CopyOneParticle(i);
-		}
-		else {
-			for (int i = firstAliveIndex; i < max; i++)
-				CopyOneParticle(i);
-			for (int i = 0; i < firstDeadIndex; i++)
-				CopyOneParticle(i);
-		}
+	//The living are one range of the ring, or two if they wrap around
+	a_particles.clear();
+	if (livingParticleCount == 0)
+		return;
 
-		D3D11_MAPPED_SUBRESOURCE mapped = {};
-		context->Map(vertexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+	if (firstAliveIndex < firstDeadIndex) {
+		a_particles.insert(a_particles.end(), particles + firstAliveIndex, particles + firstDeadIndex);
+	}
+	else {
+		a_particles.insert(a_particles.end(), particles + firstAliveIndex, particles + max);
+		a_particles.insert(a_particles.end(), particles, particles + firstDeadIndex);
+	}
+}
 
-		memcpy(mapped.pData, particleVertices, sizeof(ParticleVertex) * 4 * max);
+TransientAllocation Emitter::CopyParticlesToGPU(TransientRing * ring, const std::vector<Particle>& a_particles)
+{
+	//Captured packed, so only the living are sent and it's one draw
+	for (size_t i = 0; i < a_particles.size(); i++)
+		CopyOneParticle(a_particles[i], (int)i);
 
-		context->Unmap(vertexBuffer, 0);
-	}
+	return ring->Upload(particleVertices, sizeof(ParticleVertex) * 4 * (unsigned int)a_particles.size());
 }
 
-void Emitter::CopyOneParticle(int index)
+void Emitter::CopyOneParticle(const Particle& particle, int slot)
 {
-	int i = index * 4;
-
-	particleVertices[i + 0].Position = particles[index].Position;
-	particleVertices[i + 1].Position = particles[index].Position;
-	particleVertices[i + 2].Position = particles[index].Position;
-	particleVertices[i + 3].Position = particles[index].Position;
-
-	particleVertices[i + 0].Size = particles[index].Size;
-	particleVertices[i + 1].Size = particles[index].Size;
-	particleVertices[i + 2].Size = particles[index].Size;
-	particleVertices[i + 3].Size = particles[index].Size;
-
-	particleVertices[i + 0].Color = particles[index].Color;
-	particleVertices[i + 1].Color = particles[index].Color;
-	particleVertices[i + 2].Color = particles[index].Color;
-	particleVertices[i + 3].Color = particles[index].Color;
+	int i = slot * 4;
+
+	particleVertices[i + 0].Position = particle.Position;
+	particleVertices[i + 1].Position = particle.Position;
+	particleVertices[i + 2].Position = particle.Position;
+	particleVertices[i + 3].Position = particle.Position;
+
+	particleVertices[i + 0].Size = particle.Size;
+	particleVertices[i + 1].Size = particle.Size;
+	particleVertices[i + 2].Size = particle.Size;
+	particleVertices[i + 3].Size = particle.Size;
+
+	particleVertices[i + 0].Color = particle.Color;
+	particleVertices[i + 1].Color = particle.Color;
+	particleVertices[i + 2].Color = particle.Color;
+	particleVertices[i + 3].Color = particle.Color;
 }
 
-void Emitter::Draw(ID3D11DeviceContext * context, Camera * camera)
+void Emitter::Draw(RenderBackend * backend, TransientRing * ring, const std::vector<Particle>& a_particles, const XMFLOAT4X4& a_view, const XMFLOAT4X4& a_projection)
 {
+	if (a_particles.empty())
+		return;
+
 	//if (active) {
-		CopyParticlesToGPU(context);
+		TransientAllocation vertices = CopyParticlesToGPU(ring, a_particles);
 
 		//set up buffers
-		UINT stride = sizeof(ParticleVertex);
-		UINT offset = 0;
-		context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-		context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+		backend->SetVertexBuffer(vertices.Buffer, sizeof(ParticleVertex), vertices.Offset);
+		backend->SetIndexBuffer(indexBuffer);
 
-		vs->SetMatrix4x4("view", camera->getViewMatrix());
-		vs->SetMatrix4x4("projection", camera->getProjMatrix());
+		vs->SetTarget(backend);
+		ps->SetTarget(backend);
+		vs->SetMatrix4x4(SHADER_VIEW, a_view);
+		vs->SetMatrix4x4(SHADER_PROJECTION, a_projection);
 		vs->SetShader();
 		vs->CopyAllBufferData();
 
-		ps->SetShaderResourceView("particle", texture);
+		ps->SetShaderResourceView(SHADER_PARTICLE, texture);
 		ps->SetShader();
 		ps->CopyAllBufferData();
 
 
-		if (firstAliveIndex < firstDeadIndex)
-		{
-			context->DrawIndexed(livingParticleCount * 6, firstAliveIndex * 6, 0);
-		}
-		else
-		{
-			context->DrawIndexed(firstDeadIndex * 6, 0, 0);
-
-			context->DrawIndexed((max - firstAliveIndex) * 6, firstAliveIndex * 6, 0);
-		}
+		backend->DrawIndexed((unsigned int)a_particles.size() * 6, 0, 0);
 	//}
 }
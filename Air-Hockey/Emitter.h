@@ -4,6 +4,7 @@
 
 #include "Material.h"
 #include "Camera.h"
+#include "TransientRing.h"
 
 
 struct Particle
@@ -58,12 +59,20 @@ public:
 
 	void Update(float dt);
 
+	//Still emitting, or has particles left to fade out
+	bool IsAlive() { return active || livingParticleCount > 0; }
+
 	void UpdateSingleParticle(float dt, int index);
 	void SpawnParticle();
 
-	void CopyParticlesToGPU(ID3D11DeviceContext* context);
-	void CopyOneParticle(int index);
-	void Draw(ID3D11DeviceContext* context, Camera* camera);
+	//Copies the living particles out, oldest first, for drawing later
+	//(from another thread, while this one keeps updating)
+	void Capture(std::vector<Particle>& a_particles);
+
+	//Captured particles' quads go into a_ring
+	TransientAllocation CopyParticlesToGPU(TransientRing* ring, const std::vector<Particle>& a_particles);
+	void CopyOneParticle(const Particle& particle, int slot);
+	void Draw(RenderBackend* backend, TransientRing* ring, const std::vector<Particle>& a_particles, const DirectX::XMFLOAT4X4& a_view, const DirectX::XMFLOAT4X4& a_projection);
 
 private:
 	//cyclical buffer stuff
@@ -79,7 +88,6 @@ private:
 	//drawing stuff
 	ParticleVertex* particleVertices;
 	Material* mat;//make new mat with texture, ps, vs. if using more textures need new materials or to separate out the components in this class
-	ID3D11Buffer* vertexBuffer;
 	ID3D11Buffer* indexBuffer;
 	ID3D11ShaderResourceView* texture;
 	SimpleVertexShader* vs;
@@ -0,0 +1,8 @@
+#include "EntityRegistry.h"
+
+EntityRegistry::EntityRegistry() :
+	Props(MAX_PROPS),
+	Paddles(MAX_PADDLES),
+	Pucks(MAX_PUCKS)
+{
+}
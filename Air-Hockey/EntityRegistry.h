@@ -0,0 +1,179 @@
+#pragma once
+#include <cstdint>
+#include <new>
+#include "GameEntity.h"
+#include "Paddle.h"
+#include "Puck.h"
+
+// Refers to one entity in an EntityPool.  The generation changes
+// every time the slot is reused, so a handle kept after its entity
+// was destroyed is caught instead of finding whatever moved in
+struct EntityHandle
+{
+	uint32_t Index;
+	uint32_t Generation;	// 0 is never handed out
+
+	bool operator==(const EntityHandle& other) const { return Index == other.Index && Generation == other.Generation; }
+	bool operator!=(const EntityHandle& other) const { return !(*this == other); }
+};
+
+const EntityHandle INVALID_ENTITY = { 0xFFFFFFFF, 0 };
+
+// --------------------------------------------------------
+// A fixed number of one kind of entity in one allocation.
+// Create() and Destroy() are O(1) and never touch the heap:
+// they construct in place into a free slot.  Entities never
+// move, so pointers from Get() stay good until Destroy().
+//
+// Live slots are also listed densely, so ForEach() visits
+// only live entities without walking the holes.
+// --------------------------------------------------------
+template<typename T>
+class EntityPool
+{
+public:
+	EntityPool(int a_capacity)
+	{
+		capacity = a_capacity;
+		count = 0;
+
+		storage = new Slot[capacity];
+		generations = new uint32_t[capacity];
+		freeSlots = new int[capacity];
+		live = new int[capacity];
+		livePositions = new int[capacity];
+
+		//Handed out lowest index first
+		for (int i = 0; i < capacity; i++)
+		{
+			generations[i] = 1;
+			freeSlots[i] = capacity - 1 - i;
+			livePositions[i] = -1;
+		}
+		freeCount = capacity;
+	}
+
+	~EntityPool()
+	{
+		while (count > 0)
+			DestroySlot(live[count - 1]);
+
+		delete[] storage;
+		delete[] generations;
+		delete[] freeSlots;
+		delete[] live;
+		delete[] livePositions;
+	}
+
+	// Constructs a T with the given arguments; INVALID_ENTITY if the pool is full
+	template<typename... Args>
+	EntityHandle Create(Args... a_args)
+	{
+		if (freeCount == 0)
+			return INVALID_ENTITY;
+
+		int slot = freeSlots[--freeCount];
+		new (storage[slot].Bytes) T(a_args...);
+
+		livePositions[slot] = count;
+		live[count++] = slot;
+
+		EntityHandle handle = { (uint32_t)slot, generations[slot] };
+		return handle;
+	}
+
+	// False if the handle was already stale
+	bool Destroy(EntityHandle a_handle)
+	{
+		if (!IsValid(a_handle))
+			return false;
+
+		DestroySlot((int)a_handle.Index);
+		return true;
+	}
+
+	bool IsValid(EntityHandle a_handle)
+	{
+		return a_handle.Index < (uint32_t)capacity &&
+			generations[a_handle.Index] == a_handle.Generation &&
+			livePositions[a_handle.Index] != -1;
+	}
+
+	// 0 for stale handles
+	T* Get(EntityHandle a_handle)
+	{
+		return IsValid(a_handle) ? At((int)a_handle.Index) : 0;
+	}
+
+	// Calls a_function(T*) for every live entity
+	template<typename F>
+	void ForEach(F a_function)
+	{
+		for (int i = 0; i < count; i++)
+			a_function(At(live[i]));
+	}
+
+	int GetCount() { return count; }
+	int GetCapacity() { return capacity; }
+
+private:
+	//Raw, correctly aligned room for one T
+	struct Slot
+	{
+		alignas(T) unsigned char Bytes[sizeof(T)];
+	};
+
+	Slot* storage;
+	uint32_t* generations;
+	int* freeSlots;
+	int freeCount;
+
+	//Slots in use, packed, and where each slot sits in that list (-1 when free)
+	int* live;
+	int* livePositions;
+	int count;
+	int capacity;
+
+	T* At(int a_slot) { return reinterpret_cast<T*>(storage[a_slot].Bytes); }
+
+	void DestroySlot(int a_slot)
+	{
+		//Its transform would otherwise stay in the system forever
+		T* entity = At(a_slot);
+		entity->DetachTransform();
+		entity->~T();
+
+		//Swap the last live slot into the hole
+		int position = livePositions[a_slot];
+		int last = live[--count];
+		live[position] = last;
+		livePositions[last] = position;
+		livePositions[a_slot] = -1;
+
+		//Skip 0 when wrapping so no live handle is ever generation 0
+		if (++generations[a_slot] == 0)
+			generations[a_slot] = 1;
+		freeSlots[freeCount++] = a_slot;
+	}
+};
+
+// --------------------------------------------------------
+// Every runtime-spawned entity in the scene, one pool per
+// type.  Meshes and materials are shared and stay owned
+// by Game; destroying an entity never frees them.
+// --------------------------------------------------------
+class EntityRegistry
+{
+public:
+	EntityRegistry();
+
+	static const int MAX_PROPS = 256;
+	static const int MAX_PADDLES = 8;
+	static const int MAX_PUCKS = 64;
+
+	EntityPool<GameEntity> Props;
+	EntityPool<Paddle> Paddles;
+	EntityPool<Puck> Pucks;
+
+	int GetCount() { return Props.GetCount() + Paddles.GetCount() + Pucks.GetCount(); }
+};
@@ -0,0 +1,396 @@
+#include "FilteringBackend.h"
+#include <cstring>
+
+//Bound to nothing real, so it never matches what's being set
+static const char unknownObject = 0;
+static const void* const UNKNOWN = &unknownObject;
+
+FilteringBackend::FilteringBackend(RenderBackend* a_target)
+{
+	target = a_target;
+	ownsTarget = false;
+	memset(&filter, 0, sizeof(filter));
+	memset(&lastFilter, 0, sizeof(lastFilter));
+	Invalidate();
+}
+
+FilteringBackend::~FilteringBackend()
+{
+	if (ownsTarget)
+		delete target;
+}
+
+void FilteringBackend::Invalidate()
+{
+	for (int s = 0; s < RENDER_STAGE_COUNT; s++)
+	{
+		shaders[s] = UNKNOWN;
+		for (unsigned int i = 0; i < TRACKED_SLOTS; i++)
+		{
+			constantBuffers[s][i] = UNKNOWN;
+			samplers[s][i] = UNKNOWN;
+		}
+	}
+	InvalidateResources();
+
+	vertexBuffer.Buffer = UNKNOWN;
+	instanceBuffer.Buffer = UNKNOWN;
+	indexBuffer = UNKNOWN;
+	inputLayout = UNKNOWN;
+	rasterizerState = UNKNOWN;
+	blendState = UNKNOWN;
+	depthStencilState = UNKNOWN;
+	renderTarget = UNKNOWN;
+	depthTarget = UNKNOWN;
+	viewportWidth = -1.0f;
+	viewportHeight = -1.0f;
+}
+
+//D3D quietly unbinds a resource that becomes a render target, so
+//after one changes no resource binding can be trusted
+void FilteringBackend::InvalidateResources()
+{
+	for (int s = 0; s < RENDER_STAGE_COUNT; s++)
+	{
+		for (unsigned int i = 0; i < TRACKED_SLOTS; i++)
+			resources[s][i] = UNKNOWN;
+	}
+}
+
+void FilteringBackend::BeginFrame()
+{
+	RenderBackend::BeginFrame();
+	target->BeginFrame();
+	lastFilter = filter;
+	memset(&filter, 0, sizeof(filter));
+}
+
+bool FilteringBackend::Bind(const void*& a_bound, const void* a_object)
+{
+	frame.StateChanges++;
+	if (a_bound == a_object)
+	{
+		filter.Filtered++;
+		return false;
+	}
+
+	a_bound = a_object;
+	filter.Issued++;
+	return true;
+}
+
+bool FilteringBackend::Bind(BoundBuffer& a_bound, const void* a_buffer, unsigned int a_stride, unsigned int a_offset)
+{
+	frame.StateChanges++;
+	if (a_bound.Buffer == a_buffer && a_bound.Stride == a_stride && a_bound.Offset == a_offset)
+	{
+		filter.Filtered++;
+		return false;
+	}
+
+	a_bound.Buffer = a_buffer;
+	a_bound.Stride = a_stride;
+	a_bound.Offset = a_offset;
+	filter.Issued++;
+	return true;
+}
+
+ID3D11Buffer* FilteringBackend::CreateBuffer(RenderBufferType a_type, unsigned int a_bytes, const void* a_initialData, bool a_dynamic)
+{
+	return target->CreateBuffer(a_type, a_bytes, a_initialData, a_dynamic);
+}
+
+void FilteringBackend::ReleaseBuffer(ID3D11Buffer* a_buffer)
+{
+	//Its address may be handed out again; it mustn't look bound then
+	if (vertexBuffer.Buffer == a_buffer)
+		vertexBuffer.Buffer = UNKNOWN;
+	if (instanceBuffer.Buffer == a_buffer)
+		instanceBuffer.Buffer = UNKNOWN;
+	if (indexBuffer == a_buffer)
+		indexBuffer = UNKNOWN;
+	for (int s = 0; s < RENDER_STAGE_COUNT; s++)
+	{
+		for (unsigned int i = 0; i < TRACKED_SLOTS; i++)
+		{
+			if (constantBuffers[s][i] == a_buffer)
+				constantBuffers[s][i] = UNKNOWN;
+		}
+	}
+
+	target->ReleaseBuffer(a_buffer);
+}
+
+ID3D11RasterizerState* FilteringBackend::CreateRasterizerState(const D3D11_RASTERIZER_DESC& a_desc)
+{
+	return target->CreateRasterizerState(a_desc);
+}
+
+ID3D11DepthStencilState* FilteringBackend::CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& a_desc)
+{
+	return target->CreateDepthStencilState(a_desc);
+}
+
+ID3D11BlendState* FilteringBackend::CreateBlendState(const D3D11_BLEND_DESC& a_desc)
+{
+	return target->CreateBlendState(a_desc);
+}
+
+ID3D11SamplerState* FilteringBackend::CreateSamplerState(const D3D11_SAMPLER_DESC& a_desc)
+{
+	return target->CreateSamplerState(a_desc);
+}
+
+//Like a buffer, a released state's address may come back as a new one
+void FilteringBackend::ReleaseState(ID3D11DeviceChild* a_state)
+{
+	if (rasterizerState == (const void*)a_state)
+		rasterizerState = UNKNOWN;
+	if (depthStencilState == (const void*)a_state)
+		depthStencilState = UNKNOWN;
+	if (blendState == (const void*)a_state)
+		blendState = UNKNOWN;
+	for (int s = 0; s < RENDER_STAGE_COUNT; s++)
+	{
+		for (unsigned int i = 0; i < TRACKED_SLOTS; i++)
+		{
+			if (samplers[s][i] == (const void*)a_state)
+				samplers[s][i] = UNKNOWN;
+		}
+	}
+
+	target->ReleaseState(a_state);
+}
+
+void FilteringBackend::UpdateBuffer(ID3D11Buffer* a_buffer, const void* a_data, unsigned int a_bytes)
+{
+	target->UpdateBuffer(a_buffer, a_data, a_bytes);
+	frame.Uploads++;
+	frame.BytesUploaded += a_bytes;
+}
+
+void FilteringBackend::WriteBuffer(ID3D11Buffer* a_buffer, const void* a_data, unsigned int a_bytes)
+{
+	target->WriteBuffer(a_buffer, a_data, a_bytes);
+	frame.Uploads++;
+	frame.BytesUploaded += a_bytes;
+}
+
+void FilteringBackend::WriteBufferRange(ID3D11Buffer* a_buffer, unsigned int a_offset, const void* a_data, unsigned int a_bytes, bool a_discard)
+{
+	target->WriteBufferRange(a_buffer, a_offset, a_data, a_bytes, a_discard);
+	frame.Uploads++;
+	frame.BytesUploaded += a_bytes;
+}
+
+void FilteringBackend::SetVertexBuffer(ID3D11Buffer* a_buffer, unsigned int a_stride, unsigned int a_offset)
+{
+	if (Bind(vertexBuffer, a_buffer, a_stride, a_offset))
+		target->SetVertexBuffer(a_buffer, a_stride, a_offset);
+}
+
+void FilteringBackend::SetIndexBuffer(ID3D11Buffer* a_buffer)
+{
+	if (Bind(indexBuffer, a_buffer))
+		target->SetIndexBuffer(a_buffer);
+}
+
+void FilteringBackend::SetInstanceBuffer(ID3D11Buffer* a_buffer, unsigned int a_stride, unsigned int a_offset)
+{
+	if (Bind(instanceBuffer, a_buffer, a_stride, a_offset))
+		target->SetInstanceBuffer(a_buffer, a_stride, a_offset);
+}
+
+void FilteringBackend::SetInputLayout(ID3D11InputLayout* a_layout)
+{
+	if (Bind(inputLayout, a_layout))
+		target->SetInputLayout(a_layout);
+}
+
+void FilteringBackend::SetShader(RenderStage a_stage, ID3D11DeviceChild* a_shader)
+{
+	if (Bind(shaders[a_stage], a_shader))
+		target->SetShader(a_stage, a_shader);
+}
+
+void FilteringBackend::SetConstantBuffer(RenderStage a_stage, unsigned int a_slot, ID3D11Buffer* a_buffer)
+{
+	if (a_slot >= TRACKED_SLOTS)
+	{
+		frame.StateChanges++;
+		filter.Issued++;
+		target->SetConstantBuffer(a_stage, a_slot, a_buffer);
+	}
+	else if (Bind(constantBuffers[a_stage][a_slot], a_buffer))
+		target->SetConstantBuffer(a_stage, a_slot, a_buffer);
+}
+
+void FilteringBackend::SetShaderResource(RenderStage a_stage, unsigned int a_slot, ID3D11ShaderResourceView* a_srv)
+{
+	if (a_slot >= TRACKED_SLOTS)
+	{
+		frame.StateChanges++;
+		filter.Issued++;
+		target->SetShaderResource(a_stage, a_slot, a_srv);
+	}
+	else if (Bind(resources[a_stage][a_slot], a_srv))
+		target->SetShaderResource(a_stage, a_slot, a_srv);
+}
+
+void FilteringBackend::SetSampler(RenderStage a_stage, unsigned int a_slot, ID3D11SamplerState* a_sampler)
+{
+	if (a_slot >= TRACKED_SLOTS)
+	{
+		frame.StateChanges++;
+		filter.Issued++;
+		target->SetSampler(a_stage, a_slot, a_sampler);
+	}
+	else if (Bind(samplers[a_stage][a_slot], a_sampler))
+		target->SetSampler(a_stage, a_slot, a_sampler);
+}
+
+//The initial count matters every time, so these are never dropped
+void FilteringBackend::SetUnorderedAccess(unsigned int a_slot, ID3D11UnorderedAccessView* a_uav, unsigned int a_initialCount)
+{
+	frame.StateChanges++;
+	filter.Issued++;
+	target->SetUnorderedAccess(a_slot, a_uav, a_initialCount);
+}
+
+void FilteringBackend::SetRasterizerState(ID3D11RasterizerState* a_state)
+{
+	if (Bind(rasterizerState, a_state))
+		target->SetRasterizerState(a_state);
+}
+
+void FilteringBackend::SetBlendState(ID3D11BlendState* a_state, const float a_factor[4], unsigned int a_sampleMask)
+{
+	frame.StateChanges++;
+	if (blendState == a_state && memcmp(blendFactor, a_factor, sizeof(blendFactor)) == 0 && sampleMask == a_sampleMask)
+	{
+		filter.Filtered++;
+		return;
+	}
+
+	blendState = a_state;
+	memcpy(blendFactor, a_factor, sizeof(blendFactor));
+	sampleMask = a_sampleMask;
+	filter.Issued++;
+	target->SetBlendState(a_state, a_factor, a_sampleMask);
+}
+
+void FilteringBackend::SetDepthStencilState(ID3D11DepthStencilState* a_state, unsigned int a_stencilRef)
+{
+	frame.StateChanges++;
+	if (depthStencilState == a_state && stencilRef == a_stencilRef)
+	{
+		filter.Filtered++;
+		return;
+	}
+
+	depthStencilState = a_state;
+	stencilRef = a_stencilRef;
+	filter.Issued++;
+	target->SetDepthStencilState(a_state, a_stencilRef);
+}
+
+void FilteringBackend::SetRenderTarget(ID3D11RenderTargetView* a_target, ID3D11DepthStencilView* a_depth)
+{
+	frame.StateChanges++;
+	if (renderTarget == a_target && depthTarget == a_depth)
+	{
+		filter.Filtered++;
+		return;
+	}
+
+	renderTarget = a_target;
+	depthTarget = a_depth;
+	InvalidateResources();
+	filter.Issued++;
+	target->SetRenderTarget(a_target, a_depth);
+}
+
+void FilteringBackend::SetViewport(float a_width, float a_height)
+{
+	frame.StateChanges++;
+	if (viewportWidth == a_width && viewportHeight == a_height)
+	{
+		filter.Filtered++;
+		return;
+	}
+
+	viewportWidth = a_width;
+	viewportHeight = a_height;
+	filter.Issued++;
+	target->SetViewport(a_width, a_height);
+}
+
+void FilteringBackend::ClearRenderTarget(ID3D11RenderTargetView* a_target, const float a_color[4])
+{
+	target->ClearRenderTarget(a_target, a_color);
+	frame.Clears++;
+}
+
+void FilteringBackend::ClearDepth(ID3D11DepthStencilView* a_depth, float a_value, bool a_stencil)
+{
+	target->ClearDepth(a_depth, a_value, a_stencil);
+	frame.Clears++;
+}
+
+void FilteringBackend::CopyResource(ID3D11Resource* a_dest, ID3D11Resource* a_source)
+{
+	target->CopyResource(a_dest, a_source);
+	frame.Copies++;
+}
+
+void FilteringBackend::DrawIndexed(unsigned int a_indexCount, unsigned int a_startIndex, int a_baseVertex)
+{
+	target->DrawIndexed(a_indexCount, a_startIndex, a_baseVertex);
+	frame.Draws++;
+	frame.Indices += a_indexCount;
+}
+
+void FilteringBackend::DrawIndexedInstanced(unsigned int a_indexCount, unsigned int a_instanceCount, unsigned int a_startIndex, int a_baseVertex, unsigned int a_startInstance)
+{
+	target->DrawIndexedInstanced(a_indexCount, a_instanceCount, a_startIndex, a_baseVertex, a_startInstance);
+	frame.Draws++;
+	frame.Indices += a_indexCount * a_instanceCount;
+	frame.Instances += a_instanceCount;
+}
+
+void FilteringBackend::Draw(unsigned int a_vertexCount, unsigned int a_startVertex)
+{
+	target->Draw(a_vertexCount, a_startVertex);
+	frame.Draws++;
+	frame.Indices += a_vertexCount;
+}
+
+void FilteringBackend::Dispatch(unsigned int a_groupsX, unsigned int a_groupsY, unsigned int a_groupsZ)
+{
+	target->Dispatch(a_groupsX, a_groupsY, a_groupsZ);
+	frame.Draws++;
+}
+
+RenderBackend* FilteringBackend::CreateDeferred()
+{
+	RenderBackend* deferred = target->CreateDeferred();
+	if (!deferred)
+		return 0;
+
+	FilteringBackend* backend = new FilteringBackend(deferred);
+	backend->ownsTarget = true;
+	return backend;
+}
+
+RenderCommandList* FilteringBackend::FinishCommandList()
+{
+	RenderCommandList* list = target->FinishCommandList();
+	Invalidate();
+	return list;
+}
+
+void FilteringBackend::ExecuteCommandList(RenderCommandList* a_list)
+{
+	target->ExecuteCommandList(a_list);
+	Invalidate();
+}
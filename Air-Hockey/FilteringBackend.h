@@ -0,0 +1,131 @@
+#pragma once
+#include "RenderBackend.h"
+
+// Set* calls a frame made, and how many of them were dropped
+struct RenderFilterStats
+{
+	uint32_t Issued;		// Passed on to the target
+	uint32_t Filtered;		// Set what was already bound
+};
+
+// --------------------------------------------------------
+// RenderBackend in front of another one that remembers
+// what's bound - shaders, constant buffers, resources,
+// samplers, vertex/index buffers, input layout, fixed-
+// function state, render target and viewport - and drops
+// every Set* call that wouldn't change anything.
+//
+// Everything else goes straight through.  Its own frame
+// counters are what was asked of it; the target's are what
+// actually reached it.
+//
+// Anything that changes the context without going through
+// here (SpriteBatch, say) leaves it out of date; call
+// Invalidate() afterwards.  Finishing or running a command
+// list invalidates by itself, since both leave nothing bound.
+//
+// Its deferred backends filter in front of a deferred
+// backend of the target, which they own.
+// --------------------------------------------------------
+class FilteringBackend : public RenderBackend
+{
+public:
+	FilteringBackend(RenderBackend* a_target);
+	~FilteringBackend();
+
+	ID3D11Buffer* CreateBuffer(RenderBufferType a_type, unsigned int a_bytes, const void* a_initialData, bool a_dynamic);
+	void ReleaseBuffer(ID3D11Buffer* a_buffer);
+	void UpdateBuffer(ID3D11Buffer* a_buffer, const void* a_data, unsigned int a_bytes);
+	void WriteBuffer(ID3D11Buffer* a_buffer, const void* a_data, unsigned int a_bytes);
+	void WriteBufferRange(ID3D11Buffer* a_buffer, unsigned int a_offset, const void* a_data, unsigned int a_bytes, bool a_discard);
+
+	ID3D11RasterizerState* CreateRasterizerState(const D3D11_RASTERIZER_DESC& a_desc);
+	ID3D11DepthStencilState* CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& a_desc);
+	ID3D11BlendState* CreateBlendState(const D3D11_BLEND_DESC& a_desc);
+	ID3D11SamplerState* CreateSamplerState(const D3D11_SAMPLER_DESC& a_desc);
+	void ReleaseState(ID3D11DeviceChild* a_state);
+
+	void SetVertexBuffer(ID3D11Buffer* a_buffer, unsigned int a_stride, unsigned int a_offset);
+	void SetIndexBuffer(ID3D11Buffer* a_buffer);
+	void SetInstanceBuffer(ID3D11Buffer* a_buffer, unsigned int a_stride, unsigned int a_offset);
+	void SetInputLayout(ID3D11InputLayout* a_layout);
+
+	void SetShader(RenderStage a_stage, ID3D11DeviceChild* a_shader);
+	void SetConstantBuffer(RenderStage a_stage, unsigned int a_slot, ID3D11Buffer* a_buffer);
+	void SetShaderResource(RenderStage a_stage, unsigned int a_slot, ID3D11ShaderResourceView* a_srv);
+	void SetSampler(RenderStage a_stage, unsigned int a_slot, ID3D11SamplerState* a_sampler);
+	void SetUnorderedAccess(unsigned int a_slot, ID3D11UnorderedAccessView* a_uav, unsigned int a_initialCount);
+
+	void SetRasterizerState(ID3D11RasterizerState* a_state);
+	void SetBlendState(ID3D11BlendState* a_state, const float a_factor[4], unsigned int a_sampleMask);
+	void SetDepthStencilState(ID3D11DepthStencilState* a_state, unsigned int a_stencilRef);
+	void SetRenderTarget(ID3D11RenderTargetView* a_target, ID3D11DepthStencilView* a_depth);
+	void SetViewport(float a_width, float a_height);
+
+	void ClearRenderTarget(ID3D11RenderTargetView* a_target, const float a_color[4]);
+	void ClearDepth(ID3D11DepthStencilView* a_depth, float a_value, bool a_stencil);
+	void CopyResource(ID3D11Resource* a_dest, ID3D11Resource* a_source);
+
+	void DrawIndexed(unsigned int a_indexCount, unsigned int a_startIndex, int a_baseVertex);
+	void DrawIndexedInstanced(unsigned int a_indexCount, unsigned int a_instanceCount, unsigned int a_startIndex, int a_baseVertex, unsigned int a_startInstance);
+	void Draw(unsigned int a_vertexCount, unsigned int a_startVertex);
+	void Dispatch(unsigned int a_groupsX, unsigned int a_groupsY, unsigned int a_groupsZ);
+
+	RenderBackend* CreateDeferred();
+	RenderCommandList* FinishCommandList();
+	void ExecuteCommandList(RenderCommandList* a_list);
+
+	// Starts the target's frame too
+	void BeginFrame();
+
+	// Forgets everything bound, so the next Set* of each goes through
+	void Invalidate();
+
+	const RenderFilterStats& GetFilterStats() { return filter; }
+	const RenderFilterStats& GetLastFilterStats() { return lastFilter; }
+
+	RenderBackend* GetTarget() { return target; }
+
+	// Slots past these always go through
+	static const unsigned int TRACKED_SLOTS = 16;
+
+private:
+	RenderBackend* target;
+	bool ownsTarget;
+
+	struct BoundBuffer
+	{
+		const void* Buffer;
+		unsigned int Stride;
+		unsigned int Offset;
+	};
+
+	//What the target has bound, or UNKNOWN
+	const void* shaders[RENDER_STAGE_COUNT];
+	const void* constantBuffers[RENDER_STAGE_COUNT][TRACKED_SLOTS];
+	const void* resources[RENDER_STAGE_COUNT][TRACKED_SLOTS];
+	const void* samplers[RENDER_STAGE_COUNT][TRACKED_SLOTS];
+	BoundBuffer vertexBuffer;
+	BoundBuffer instanceBuffer;
+	const void* indexBuffer;
+	const void* inputLayout;
+	const void* rasterizerState;
+	const void* blendState;
+	float blendFactor[4];
+	unsigned int sampleMask;
+	const void* depthStencilState;
+	unsigned int stencilRef;
+	const void* renderTarget;
+	const void* depthTarget;
+	float viewportWidth;
+	float viewportHeight;
+
+	RenderFilterStats filter;
+	RenderFilterStats lastFilter;
+
+	// True (and counted as issued) if a_bound wasn't already a_object,
+	// which it is afterwards
+	bool Bind(const void*& a_bound, const void* a_object);
+	bool Bind(BoundBuffer& a_bound, const void* a_buffer, unsigned int a_stride, unsigned int a_offset);
+	void InvalidateResources();
+};
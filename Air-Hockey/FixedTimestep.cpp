@@ -0,0 +1,43 @@
+#include "FixedTimestep.h"
+
+FixedTimestep::FixedTimestep(float a_stepSeconds, int a_maxSteps)
+{
+	step = a_stepSeconds;
+	maxSteps = a_maxSteps > 0 ? a_maxSteps : 1;
+	Reset();
+}
+
+void FixedTimestep::Reset()
+{
+	accumulator = 0.0f;
+	steps = 0;
+	droppedSteps = 0;
+	cappedFrames = 0;
+}
+
+int FixedTimestep::Advance(float a_dt)
+{
+	if (a_dt > 0.0f)
+		accumulator += a_dt;
+
+	int count = 0;
+	while (accumulator >= step && count < maxSteps)
+	{
+		accumulator -= step;
+		count++;
+	}
+
+	//Too far behind to catch up; keep the fraction so drawing doesn't jump
+	if (accumulator >= step)
+	{
+		int behind = (int)(accumulator / step);
+		droppedSteps += behind;
+		accumulator -= behind * step;
+		if (accumulator >= step)
+			accumulator = 0.0f;
+		cappedFrames++;
+	}
+
+	steps += count;
+	return count;
+}
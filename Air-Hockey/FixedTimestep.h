@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+
+// --------------------------------------------------------
+// Turns variable frame times into whole fixed steps, so a
+// simulation advances the same way at any frame rate.
+// Time that doesn't make up a whole step carries over to
+// the next frame, and GetAlpha() says how far into the
+// next step it reaches, for drawing between the last two
+// states instead of snapping to the latest.
+//
+// A frame gets at most a_maxSteps steps.  Time beyond that
+// (a long hitch, or steps costing more than they simulate)
+// is dropped rather than owed, which would otherwise make
+// every later frame run more steps and fall further behind.
+// --------------------------------------------------------
+class FixedTimestep
+{
+public:
+	FixedTimestep(float a_stepSeconds, int a_maxSteps);
+
+	// Forgets any time carried over
+	void Reset();
+
+	// Adds a frame's time and returns how many steps to run for it
+	int Advance(float a_dt);
+
+	// 0 right on a step, almost 1 just before the next
+	float GetAlpha() { return accumulator / step; }
+
+	float GetStepSeconds() { return step; }
+
+	// Steps handed out, and steps' worth of time thrown away, ever
+	uint64_t GetSteps() { return steps; }
+	uint64_t GetDroppedSteps() { return droppedSteps; }
+
+	// Frames that hit a_maxSteps
+	uint32_t GetCappedFrames() { return cappedFrames; }
+
+private:
+	float step;
+	int maxSteps;
+	float accumulator;
+
+	uint64_t steps;
+	uint64_t droppedSteps;
+	uint32_t cappedFrames;
+};
@@ -0,0 +1,95 @@
+#include "Frustum.h"
+
+Frustum::Frustum()
+{
+	//Everything passes until matrices are set
+	for (int g = 0; g < PLANE_GROUPS; g++)
+	{
+		planeX[g] = planeY[g] = planeZ[g] = XMFLOAT4(0, 0, 0, 0);
+		planeW[g] = XMFLOAT4(1, 1, 1, 1);
+		absX[g] = absY[g] = absZ[g] = XMFLOAT4(0, 0, 0, 0);
+	}
+}
+
+void Frustum::SetMatrices(const XMFLOAT4X4& a_view, const XMFLOAT4X4& a_proj)
+{
+	//(view * proj) transposed; each row is a column of the real matrix
+	XMFLOAT4X4 m;
+	XMStoreFloat4x4(&m, XMMatrixMultiply(XMLoadFloat4x4(&a_proj), XMLoadFloat4x4(&a_view)));
+
+	//Gribb/Hartmann plane extraction, with D3D's 0..1 depth range
+	XMVECTOR r0 = XMLoadFloat4((const XMFLOAT4*)m.m[0]);
+	XMVECTOR r1 = XMLoadFloat4((const XMFLOAT4*)m.m[1]);
+	XMVECTOR r2 = XMLoadFloat4((const XMFLOAT4*)m.m[2]);
+	XMVECTOR r3 = XMLoadFloat4((const XMFLOAT4*)m.m[3]);
+
+	XMFLOAT4 planes[PLANE_GROUPS * 4];
+	XMStoreFloat4(&planes[0], XMPlaneNormalize(XMVectorAdd(r3, r0)));		// Left
+	XMStoreFloat4(&planes[1], XMPlaneNormalize(XMVectorSubtract(r3, r0)));	// Right
+	XMStoreFloat4(&planes[2], XMPlaneNormalize(XMVectorAdd(r3, r1)));		// Bottom
+	XMStoreFloat4(&planes[3], XMPlaneNormalize(XMVectorSubtract(r3, r1)));	// Top
+	XMStoreFloat4(&planes[4], XMPlaneNormalize(r2));						// Near
+	XMStoreFloat4(&planes[5], XMPlaneNormalize(XMVectorSubtract(r3, r2)));	// Far
+	planes[6] = planes[4];
+	planes[7] = planes[4];
+
+	for (int g = 0; g < PLANE_GROUPS; g++)
+	{
+		const XMFLOAT4* p = planes + g * 4;
+		planeX[g] = XMFLOAT4(p[0].x, p[1].x, p[2].x, p[3].x);
+		planeY[g] = XMFLOAT4(p[0].y, p[1].y, p[2].y, p[3].y);
+		planeZ[g] = XMFLOAT4(p[0].z, p[1].z, p[2].z, p[3].z);
+		planeW[g] = XMFLOAT4(p[0].w, p[1].w, p[2].w, p[3].w);
+
+		XMStoreFloat4(&absX[g], XMVectorAbs(XMLoadFloat4(&planeX[g])));
+		XMStoreFloat4(&absY[g], XMVectorAbs(XMLoadFloat4(&planeY[g])));
+		XMStoreFloat4(&absZ[g], XMVectorAbs(XMLoadFloat4(&planeZ[g])));
+	}
+}
+
+bool Frustum::IntersectsSphere(const XMFLOAT3& a_center, float a_radius) const
+{
+	XMVECTOR x = XMVectorReplicate(a_center.x);
+	XMVECTOR y = XMVectorReplicate(a_center.y);
+	XMVECTOR z = XMVectorReplicate(a_center.z);
+	XMVECTOR negRadius = XMVectorReplicate(-a_radius);
+
+	for (int g = 0; g < PLANE_GROUPS; g++)
+	{
+		//Signed distance from the center to four planes
+		XMVECTOR distance = XMVectorMultiplyAdd(x, XMLoadFloat4(&planeX[g]), XMLoadFloat4(&planeW[g]));
+		distance = XMVectorMultiplyAdd(y, XMLoadFloat4(&planeY[g]), distance);
+		distance = XMVectorMultiplyAdd(z, XMLoadFloat4(&planeZ[g]), distance);
+
+		//Entirely behind any one plane means outside
+		if (!XMVector4GreaterOrEqual(distance, negRadius))
+			return false;
+	}
+	return true;
+}
+
+bool Frustum::IntersectsBox(const XMFLOAT3& a_center, const XMFLOAT3& a_extents) const
+{
+	XMVECTOR x = XMVectorReplicate(a_center.x);
+	XMVECTOR y = XMVectorReplicate(a_center.y);
+	XMVECTOR z = XMVectorReplicate(a_center.z);
+	XMVECTOR ex = XMVectorReplicate(a_extents.x);
+	XMVECTOR ey = XMVectorReplicate(a_extents.y);
+	XMVECTOR ez = XMVectorReplicate(a_extents.z);
+
+	for (int g = 0; g < PLANE_GROUPS; g++)
+	{
+		XMVECTOR distance = XMVectorMultiplyAdd(x, XMLoadFloat4(&planeX[g]), XMLoadFloat4(&planeW[g]));
+		distance = XMVectorMultiplyAdd(y, XMLoadFloat4(&planeY[g]), distance);
+		distance = XMVectorMultiplyAdd(z, XMLoadFloat4(&planeZ[g]), distance);
+
+		//How far the box's nearest corner reaches toward each plane
+		XMVECTOR reach = XMVectorMultiply(ex, XMLoadFloat4(&absX[g]));
+		reach = XMVectorMultiplyAdd(ey, XMLoadFloat4(&absY[g]), reach);
+		reach = XMVectorMultiplyAdd(ez, XMLoadFloat4(&absZ[g]), reach);
+
+		if (!XMVector4GreaterOrEqual(XMVectorAdd(distance, reach), XMVectorZero()))
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <DirectXMath.h>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// The six planes of a camera or shadow projection, used to
+// skip drawing things that can't end up on screen.
+//
+// Planes are kept split by component (all x's, all y's...)
+// in two groups of four, so one test checks four planes at
+// once with plain multiply-adds.
+// --------------------------------------------------------
+class Frustum
+{
+public:
+	Frustum();
+
+	// Takes view and projection as the shaders get them (transposed)
+	void SetMatrices(const XMFLOAT4X4& a_view, const XMFLOAT4X4& a_proj);
+
+	// Conservative: may say true for things just outside a corner
+	bool IntersectsSphere(const XMFLOAT3& a_center, float a_radius) const;
+	bool IntersectsBox(const XMFLOAT3& a_center, const XMFLOAT3& a_extents) const;
+
+private:
+	static const int PLANE_GROUPS = 2;
+
+	//Plane components, plane i in lane i % 4 of group i / 4.  The two
+	//spare lanes repeat the near plane so they never cull anything extra
+	XMFLOAT4 planeX[PLANE_GROUPS];
+	XMFLOAT4 planeY[PLANE_GROUPS];
+	XMFLOAT4 planeZ[PLANE_GROUPS];
+	XMFLOAT4 planeW[PLANE_GROUPS];
+
+	//Absolute normals, for how far a box reaches toward each plane
+	XMFLOAT4 absX[PLANE_GROUPS];
+	XMFLOAT4 absY[PLANE_GROUPS];
+	XMFLOAT4 absZ[PLANE_GROUPS];
+};
@@ -6,6 +6,16 @@
 // For the DirectX Math library
 using namespace DirectX;
 
+//Hashed at compile time; what the opaque and sky passes set on their shaders
+static constexpr SimpleShaderName SHADER_SHADOW_SAMPLER("ShadowSampler");
+static constexpr SimpleShaderName SHADER_SHADOW_MAP("ShadowMap");
+static constexpr SimpleShaderName SHADER_SHADOW_CUBE_MAP("ShadowCubeMap");
+static constexpr SimpleShaderName SHADER_SKY_TEXTURE("SkyTexture");
+static constexpr SimpleShaderName SHADER_BASIC_SAMPLER("basicSampler");
+static constexpr SimpleShaderName SHADER_SKY_SAMPLER("BasicSampler");
+static constexpr SimpleShaderName SHADER_VIEW("view");
+static constexpr SimpleShaderName SHADER_PROJECTION("projection");
+
 // --------------------------------------------------------
 // Constructor
 //
@@ -35,6 +45,35 @@ Game::Game(HINSTANCE hInstance)
 	paused = false;
 	lastHit = 0;
 
+	localMatch = new Match();
+	localSteps = new FixedTimestep(MATCH_STEP_DT, MATCH_MAX_STEPS);
+	localMatch->GetState(localCurrent);
+	localPrevious = localCurrent;
+	localAlpha = 0.0f;
+	submittedDraws = 0;
+	culledDraws = 0;
+	lastSubmittedDraws = 0;
+	lastCulledDraws = 0;
+
+	transforms = new TransformSystem();
+	entities = new EntityRegistry();
+	jobs = new JobPool();
+	transforms->SetJobPool(jobs);
+
+	//A pool only takes one caller at a time, and the passes are
+	//recorded on the render thread while Update uses the other
+	renderJobs = new JobPool();
+	simSteps = 0;
+	lastDrawnStep = 0;
+
+	//Nothing changes between match steps but how far between two
+	//of them to draw, so there's no point running Update more often
+	updateInterval = MATCH_STEP_DT;
+	onlineActive = false;
+	server = 0;
+	onlineClients[0] = 0;
+	onlineClients[1] = 0;
+
 	mainCamera->SetSpeed(0.05f);
 
 
@@ -58,7 +97,6 @@ Game::~Game()
 	paddleTextureSRV->Release();
 	designNormMapSRV->Release();
 	puckSRV->Release();
-	sampler->Release();
 
 	delete designMaterial;
 	delete paddleMaterial;
@@ -85,18 +123,26 @@ Game::~Game()
 	delete mainCamera;
 
 
-	//delete paddles puck and table.
-	delete player1;
-	delete player2;
-	delete puck;
-	delete table;
-	delete TEST_ENTITY;
+	//Shut down online play and the local match
+	StopOnline();
+	UdpSocket::ShutdownNetworking();
+	delete localMatch;
+	delete localSteps;
+
+	//Paddles, puck and table go with their pools
+	delete entities;
+	delete transforms;
+	delete jobs;
+	for (int i = 0; i < DRAWN_COUNT; i++)
+		delete drawn[i];
 
 	//delete shadow related things
 	shadowDepthView->Release();
 	shadowMapSRV->Release();
-	shadowSampler->Release();
-	shadowRasterizer->Release();
+	shadowMapTex->Release();
+	staticShadowDepthView->Release();
+	staticShadowTex->Release();
+	delete shadowCache;
 
 	pShadowMapSRV->Release();
 
@@ -106,19 +152,23 @@ Game::~Game()
 	{
 		pShadowCubeDepthView[i]->Release();
 	}
+	pShadowCubeArrayDepthView->Release();
 	
 
 	pShadowCubeTex->Release();
 	
 
 	delete shadowVS;
+	delete instancedVS;
+	delete shadowInstancedVS;
+	delete cubeShadows;
+	delete cubeShadowVS;
+	delete cubeShadowGS;
 
 	//Delete Skybox things
 	delete skyVS;
 	delete skyPS;
 	skySRV->Release();
-	skyRasterState->Release();
-	skyDepthState->Release();
 
 	//delete Particle things
 	delete particleVS;
@@ -129,9 +179,13 @@ Game::~Game()
 	delete emitter3;
 
 	particleTexture->Release();
-	particleBlendState->Release();
-	particleDepthState->Release();
 
+	//Shaders above and the passes' buffers came from it
+	delete passes;
+	delete renderJobs;
+	delete renderStates;
+	delete renderer;
+	delete deviceBackend;
 }
 
 // --------------------------------------------------------
@@ -143,6 +197,14 @@ void Game::Init()
 	// Helper methods for loading shaders, creating some basic
 	// geometry to draw and some simple camera matrices.
 	//  - You'll be expanding and/or replacing these later
+	deviceBackend = new D3D11Backend(device, context);
+	renderer = new FilteringBackend(deviceBackend);
+	renderStates = new RenderStateCache(renderer);
+
+	//A queue, transient ring and shared constants per pass; has to exist
+	//before any shader loads, so they leave the shared buffers to it.
+	//Rings start small and grow to what their pass needs
+	passes = new PassRecorder(renderer, renderJobs, PASS_COUNT, 64 * 1024);
 	LoadShaders();
 	LoadLights();
 	CreateMatrices();
@@ -209,14 +271,14 @@ void Game::Init()
 	skyRD.CullMode = D3D11_CULL_FRONT;
 	skyRD.FillMode = D3D11_FILL_SOLID;
 	skyRD.DepthClipEnable = false;
-	device->CreateRasterizerState(&skyRD, &skyRasterState);
+	skyRasterState = renderStates->GetRasterizerState(skyRD);
 
 	//Depth state for accepting pixels with the same depth as the existing depth
 	D3D11_DEPTH_STENCIL_DESC skyDS = {};
 	skyDS.DepthEnable = true;
 	skyDS.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;//switch to all if it looks weird
 	skyDS.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
-	device->CreateDepthStencilState(&skyDS, &skyDepthState);
+	skyDepthState = renderStates->GetDepthStencilState(skyDS);
 
 	//Initialize Score
 	player1Score = 0;
@@ -239,6 +301,9 @@ void Game::Init()
 	shadowTexDesc.SampleDesc.Quality = 0;
 	shadowTexDesc.Usage = D3D11_USAGE_DEFAULT;
 	device->CreateTexture2D(&shadowTexDesc, 0, &shadowMapTex);
+
+	//Only the casters that never move, copied into shadowMapTex each time it's redrawn
+	device->CreateTexture2D(&shadowTexDesc, 0, &staticShadowTex);
 	
 	shadowTexDesc.ArraySize = 6;
 	shadowTexDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
@@ -252,7 +317,10 @@ void Game::Init()
 	shadowDepthDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
 	shadowDepthDesc.Texture2D.MipSlice = 0;
 	device->CreateDepthStencilView(shadowMapTex, &shadowDepthDesc, &shadowDepthView);
-	shadowMapTex->Release();
+	device->CreateDepthStencilView(staticShadowTex, &shadowDepthDesc, &staticShadowDepthView);
+
+	//One entry per directional map and per cube face
+	shadowCache = new ShadowCache(SHADOW_VIEW_CUBE + 6);
 
 	D3D11_DEPTH_STENCIL_VIEW_DESC CubeDepthDesc = {};
 	CubeDepthDesc.Format = DXGI_FORMAT_D32_FLOAT;
@@ -265,6 +333,11 @@ void Game::Init()
 		device->CreateDepthStencilView(pShadowCubeTex, &CubeDepthDesc, &pShadowCubeDepthView[i]);
 	}
 
+	//All six at once, for drawing every face in one go
+	CubeDepthDesc.Texture2DArray.FirstArraySlice = 0;
+	CubeDepthDesc.Texture2DArray.ArraySize = 6;
+	device->CreateDepthStencilView(pShadowCubeTex, &CubeDepthDesc, &pShadowCubeArrayDepthView);
+
 	//not sure if I want a TextureCube or 2DArray. Both seem to work the same
 	D3D11_SHADER_RESOURCE_VIEW_DESC cubeSRVDesc = {};
 	cubeSRVDesc.Format = DXGI_FORMAT_R32_FLOAT;
@@ -298,7 +371,7 @@ void Game::Init()
 	shadowSamplerDesc.BorderColor[0] = 1.0f;
 	shadowSamplerDesc.BorderColor[0] = 1.0f;
 	shadowSamplerDesc.BorderColor[0] = 1.0f;
-	device->CreateSamplerState(&shadowSamplerDesc, &shadowSampler);
+	shadowSampler = renderStates->GetSamplerState(shadowSamplerDesc);
 
 	D3D11_RASTERIZER_DESC shadowRastDesc = {};
 	shadowRastDesc.FillMode = D3D11_FILL_SOLID;
@@ -307,7 +380,7 @@ void Game::Init()
 	shadowRastDesc.DepthBias = 1000;
 	shadowRastDesc.DepthBiasClamp = 0.0f;
 	shadowRastDesc.SlopeScaledDepthBias = 1.0f;
-	device->CreateRasterizerState(&shadowRastDesc, &shadowRasterizer);
+	shadowRasterizer = renderStates->GetRasterizerState(shadowRastDesc);
 	
 	//Create a sampler state
 	D3D11_SAMPLER_DESC samplerDesc = {};
@@ -318,14 +391,14 @@ void Game::Init()
 	samplerDesc.MaxAnisotropy = 16;
 	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
 
-	device->CreateSamplerState(&samplerDesc, &sampler);
+	sampler = renderStates->GetSamplerState(samplerDesc);
 	
 	//depth state for particles
 	D3D11_DEPTH_STENCIL_DESC dsDesc = {};
 	dsDesc.DepthEnable = true;
 	dsDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO; //turns off depth writing
 	dsDesc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
-	device->CreateDepthStencilState(&dsDesc, &particleDepthState);
+	particleDepthState = renderStates->GetDepthStencilState(dsDesc);
 
 	//additive blending for particles
 	D3D11_BLEND_DESC blend = {};
@@ -339,7 +412,7 @@ void Game::Init()
 	blend.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
 	blend.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ONE;
 	blend.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
-	device->CreateBlendState(&blend, &particleBlendState);
+	particleBlendState = renderStates->GetBlendState(blend);
 
 	/*Emitter(DirectX::XMFLOAT3 pos,
 		DirectX::XMFLOAT3 vel,
@@ -433,11 +506,16 @@ void Game::Init()
 	);
 	particleTimer = 0;
 
+	UdpSocket::InitNetworking();
+
 	// Tell the input assembler stage of the pipeline what kind of
 	// geometric primitives (points, lines or triangles) we want to draw.  
 	// Essentially: "What kind of shape should the GPU draw with our data?"
 	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
+	//The render thread starts drawing as soon as this returns
+	PublishSnapshot();
+
 	std::cout << "\nGame Has Started\n";
 
 }
@@ -450,28 +528,47 @@ void Game::Init()
 // --------------------------------------------------------
 void Game::LoadShaders()
 {
-	vertexShader = new SimpleVertexShader(device, context);
+	vertexShader = new SimpleVertexShader(device, renderer);
 	vertexShader->LoadShaderFile(L"VertexShader.cso");
 
-	pixelShader = new SimplePixelShader(device, context);
+	pixelShader = new SimplePixelShader(device, renderer);
 	pixelShader->LoadShaderFile(L"PixelShader.cso");
 
 	//Load in shaders for shadow
-	shadowVS = new SimpleVertexShader(device, context);
+	shadowVS = new SimpleVertexShader(device, renderer);
 	shadowVS->LoadShaderFile(L"ShadowVs.cso");
 
+	//Drawn instead whenever the queue finds things to batch
+	instancedVS = new SimpleVertexShader(device, renderer);
+	instancedVS->LoadShaderFile(L"VertexShaderInstanced.cso");
+	passes->GetPass(PASS_OPAQUE).Queue->SetInstancedShader(vertexShader, instancedVS);
+
+	shadowInstancedVS = new SimpleVertexShader(device, renderer);
+	shadowInstancedVS->LoadShaderFile(L"ShadowVSInstanced.cso");
+	passes->GetPass(PASS_SHADOW).Queue->SetInstancedShader(shadowVS, shadowInstancedVS);
+
+	//Point light shadows, all six faces in one draw per mesh
+	cubeShadowVS = new SimpleVertexShader(device, renderer);
+	cubeShadowVS->LoadShaderFile(L"CubeShadowVS.cso");
+
+	cubeShadowGS = new SimpleGeometryShader(device, renderer);
+	cubeShadowGS->LoadShaderFile(L"CubeShadowGS.cso");
+
+	cubeShadows = new CubeShadowBatch(cubeShadowVS, cubeShadowGS);
+	cubeShadows->SetTransientRing(passes->GetPass(PASS_CUBE_SHADOW).Ring);
+
 	//Load in shaders for sky
-	skyVS = new SimpleVertexShader(device, context);
+	skyVS = new SimpleVertexShader(device, renderer);
 	skyVS->LoadShaderFile(L"SkyVS.cso");
 
-	skyPS = new SimplePixelShader(device, context);
+	skyPS = new SimplePixelShader(device, renderer);
 	skyPS->LoadShaderFile(L"SkyPS.cso");
 
 	//load particle shaders
-	particleVS = new SimpleVertexShader(device, context);
+	particleVS = new SimpleVertexShader(device, renderer);
 	particleVS->LoadShaderFile(L"ParticleVS.cso");
 
-	particlePS = new SimplePixelShader(device, context);
+	particlePS = new SimplePixelShader(device, renderer);
 	particlePS->LoadShaderFile(L"ParticlePS.cso");
 
 	/*CREATE MATERIALS*/
@@ -494,102 +591,29 @@ void Game::LoadLights()
 	pointLight.Position = XMFLOAT3(0.0f, -0.1f, 0.0f);
 }
 
-void Game::CreateShadowMapDirectionalOnly()
-{
-	context->OMSetRenderTargets(0, 0, shadowDepthView);
-	context->ClearDepthStencilView(shadowDepthView, D3D11_CLEAR_DEPTH, 1.0f, 0);
-	context->RSSetState(shadowRasterizer);
-
-	//viewport setup
-	D3D11_VIEWPORT viewport = {};
-	viewport.TopLeftX = 0;
-	viewport.TopLeftY = 0;
-	viewport.Width = (float)shadowMapSize;
-	viewport.Height = (float)shadowMapSize;
-	viewport.MinDepth = 0.0f;
-	viewport.MaxDepth = 1.0f;
-	context->RSSetViewports(1, &viewport);
-
-	//set shaders
-	shadowVS->SetShader();
-	shadowVS->SetMatrix4x4("view", shadowViewMatrix);
-	shadowVS->SetMatrix4x4("projection", shadowProjMatrix);
-
-	context->PSSetShader(0, 0, 0);
-
-	shadowVS->SetMatrix4x4("world", player1->GetWorldMatrix());
-	shadowVS->CopyAllBufferData();
-	player1->Draw(context);
-
-	shadowVS->SetMatrix4x4("world", player2->GetWorldMatrix());
-	shadowVS->CopyAllBufferData();
-	player2->Draw(context);
-
-	shadowVS->SetMatrix4x4("world", table->GetWorldMatrix());
-	shadowVS->CopyAllBufferData();
-	table->Draw(context);
-
-	shadowVS->SetMatrix4x4("world", puck->GetWorldMatrix());
-	shadowVS->CopyAllBufferData();
-	puck->Draw(context);
-
-	//setting things back to normal
-	context->OMSetRenderTargets(1, &backBufferRTV, depthStencilView);
-	context->RSSetState(0);
-
-	viewport.Width = this->width;
-	viewport.Height = this->height;
-	context->RSSetViewports(1, &viewport);
-
-}
-//Makes the Shadow Map (call each frame at the beginning) (Currently works with the directional light)
-void Game::CreateShadowMap()
+// --------------------------------------------------------
+// Works out which shadow views changed since they were
+// last drawn, before the passes that draw them are
+// recorded (the cache isn't theirs to share)
+// --------------------------------------------------------
+void Game::PrepareShadowMaps(const FrameSnapshot& a_frame)
 {
-	context->OMSetRenderTargets(0, 0, shadowDepthView);
-	context->ClearDepthStencilView(shadowDepthView, D3D11_CLEAR_DEPTH, 1.0f, 0);
-	context->RSSetState(shadowRasterizer);
-
-	//viewport setup
-	D3D11_VIEWPORT viewport = {};
-	viewport.TopLeftX = 0;
-	viewport.TopLeftY = 0;
-	viewport.Width = (float)shadowMapSize;
-	viewport.Height = (float)shadowMapSize;
-	viewport.MinDepth = 0.0f;
-	viewport.MaxDepth = 1.0f;
-	context->RSSetViewports(1, &viewport);
-
-	//set shaders
-	shadowVS->SetShader();
-	shadowVS->SetMatrix4x4("view", shadowViewMatrix);
-	shadowVS->SetMatrix4x4("projection", shadowProjMatrix);
-
-	context->PSSetShader(0, 0, 0);
-
-	shadowVS->SetMatrix4x4("world", player1->GetWorldMatrix());
-	shadowVS->CopyAllBufferData();
-	player1->Draw(context);
-
-	shadowVS->SetMatrix4x4("world", player2->GetWorldMatrix());
-	shadowVS->CopyAllBufferData();
-	player2->Draw(context);
-
-	shadowVS->SetMatrix4x4("world", table->GetWorldMatrix());
-	shadowVS->CopyAllBufferData();
-	table->Draw(context);
-
-	shadowVS->SetMatrix4x4("world", puck->GetWorldMatrix());
-	shadowVS->CopyAllBufferData();
-	puck->Draw(context);
-
-	/*/setting things back to normal
-	context->OMSetRenderTargets(1, &backBufferRTV, depthStencilView);
-	context->RSSetState(0);
-
-	viewport.Width = this->width;
-	viewport.Height = this->height;
-	context->RSSetViewports(1, &viewport);
-	/*/
+	//Where the snapshot has the light, not where it's moving to now
+	const PointLight& pointLight = a_frame.PLight;
+
+	//The table never moves, so it's drawn into its own map once
+	//and copied in under the moving casters every time they move
+	ShadowSignature staticCasters;
+	staticCasters.AddCaster(drawn[DRAWN_TABLE]);
+	staticShadowStale = shadowCache->NeedsUpdate(SHADOW_VIEW_STATIC, staticCasters.Get());
+
+	//Paused, or nothing moved: last frame's map is still right
+	ShadowSignature dynamicCasters;
+	dynamicCasters.Add(staticCasters.Get());
+	dynamicCasters.AddCaster(drawn[DRAWN_PLAYER1]);
+	dynamicCasters.AddCaster(drawn[DRAWN_PLAYER2]);
+	dynamicCasters.AddCaster(drawn[DRAWN_PUCK]);
+	dynamicShadowStale = shadowCache->NeedsUpdate(SHADOW_VIEW_DIRECTIONAL, dynamicCasters.Get());
 
 	//Point Light Shadows (dear god)
 	pShadowView1 = XMMatrixLookAtLH(XMVectorSet(pointLight.Position.x, pointLight.Position.y, pointLight.Position.z, 1), XMVectorSet(pointLight.Position.x + 1, pointLight.Position.y, pointLight.Position.z, 1), XMVectorSet(0, 1, 0, 1));
@@ -599,8 +623,6 @@ void Game::CreateShadowMap()
 	pShadowView5 = XMMatrixLookAtLH(XMVectorSet(pointLight.Position.x, pointLight.Position.y, pointLight.Position.z, 1), XMVectorSet(pointLight.Position.x, pointLight.Position.y, pointLight.Position.z + 1, 1), XMVectorSet(0, 1, 0, 1));
 	pShadowView6 = XMMatrixLookAtLH(XMVectorSet(pointLight.Position.x, pointLight.Position.y, pointLight.Position.z, 1), XMVectorSet(pointLight.Position.x, pointLight.Position.y, pointLight.Position.z - 1, 1), XMVectorSet(0, 1, 0, 1));
 
-	//pShadowViewMatrix[0] = {};
-
 	XMStoreFloat4x4(&pShadowViewMatrix[0], XMMatrixTranspose(pShadowView1));
 	XMStoreFloat4x4(&pShadowViewMatrix[1], XMMatrixTranspose(pShadowView2));
 	XMStoreFloat4x4(&pShadowViewMatrix[2], XMMatrixTranspose(pShadowView3));
@@ -608,55 +630,238 @@ void Game::CreateShadowMap()
 	XMStoreFloat4x4(&pShadowViewMatrix[4], XMMatrixTranspose(pShadowView5));
 	XMStoreFloat4x4(&pShadowViewMatrix[5], XMMatrixTranspose(pShadowView6));
 
-
-	context->RSSetViewports(1, &viewport);
+	//Which faces each caster shows up in, and which faces need redrawing
+	GameEntity* cubeCasters[3] = { drawn[DRAWN_PLAYER1], drawn[DRAWN_PLAYER2], drawn[DRAWN_PUCK] };
+	cubeStaleFaces = 0;
+	for (int c = 0; c < 3; c++)
+		cubeCasterFaces[c] = 0;
 	for (int i = 0; i < 6; i++)
 	{
-		context->OMSetRenderTargets(0, 0, pShadowCubeDepthView[i]);
-		context->ClearDepthStencilView(pShadowCubeDepthView[i], D3D11_CLEAR_DEPTH, 1.0f, 0);
-		context->RSSetState(shadowRasterizer);
-		
+		//Each face only sees a quarter of the world around the light
+		Frustum faceFrustum;
+		faceFrustum.SetMatrices(pShadowViewMatrix[i], pShadowProjMatrix);
+
+		//A face is only redrawn when the light or something it sees moved
+		//(or something left it, which changes what it sees too)
+		ShadowSignature faceCasters;
+		faceCasters.Add(&pointLight.Position, sizeof(pointLight.Position));
+		for (int c = 0; c < 3; c++)
+		{
+			if (cubeCasters[c]->IsVisible(faceFrustum))
+			{
+				cubeCasterFaces[c] |= 1 << i;
+				faceCasters.AddCaster(cubeCasters[c]);
+			}
+		}
+		if (shadowCache->NeedsUpdate(SHADOW_VIEW_CUBE + i, faceCasters.Get()))
+			cubeStaleFaces |= 1 << i;
+	}
 
-		shadowVS->SetShader();
-		shadowVS->SetMatrix4x4("view", pShadowViewMatrix[i]);
-		shadowVS->SetMatrix4x4("projection", pShadowProjMatrix);
+	for (int c = 0; c < 3; c++)
+	{
+		for (int i = 0; i < 6; i++)
+		{
+			if (!(cubeStaleFaces & (1 << i)))
+				continue;
+			if (cubeCasterFaces[c] & (1 << i))
+				submittedDraws++;
+			else
+				culledDraws++;
+		}
+	}
+}
 
-		context->PSSetShader(0, 0, 0);
+// --------------------------------------------------------
+// The directional light's shadow map, if it's stale
+// --------------------------------------------------------
+void Game::RecordShadowMap(RenderPassContext& a_pass)
+{
+	RenderBackend* backend = a_pass.Backend;
+	backend->SetRasterizerState(shadowRasterizer);
 
-		shadowVS->SetMatrix4x4("world", player1->GetWorldMatrix());
-		shadowVS->CopyAllBufferData();
-		player1->Draw(context);
+	//viewport setup
+	backend->SetViewport((float)shadowMapSize, (float)shadowMapSize);
 
-		shadowVS->SetMatrix4x4("world", player2->GetWorldMatrix());
-		shadowVS->CopyAllBufferData();
-		player2->Draw(context);
+	if (staticShadowStale)
+	{
+		backend->SetRenderTarget(0, staticShadowDepthView);
+		backend->ClearDepth(staticShadowDepthView, 1.0f, false);
 
-		shadowVS->SetMatrix4x4("world", puck->GetWorldMatrix());
-		shadowVS->CopyAllBufferData();
-		puck->Draw(context);
+		a_pass.Queue->Begin();
+		a_pass.Queue->SetCamera(shadowViewMatrix, shadowProjMatrix);
+		DrawShadowCaster(a_pass.Queue, drawn[DRAWN_TABLE], shadowFrustum);
+		a_pass.Queue->Execute(backend);
 	}
 
+	if (dynamicShadowStale)
+	{
+		backend->CopyResource(shadowMapTex, staticShadowTex);
+		backend->SetRenderTarget(0, shadowDepthView);
 
-	context->OMSetRenderTargets(1, &backBufferRTV, depthStencilView);
-	context->RSSetState(0);
+		//depth only, drawn from the light
+		a_pass.Queue->Begin();
+		a_pass.Queue->SetCamera(shadowViewMatrix, shadowProjMatrix);
 
-	viewport.Width = this->width;
-	viewport.Height = this->height;
-	context->RSSetViewports(1, &viewport);
+		DrawShadowCaster(a_pass.Queue, drawn[DRAWN_PLAYER1], shadowFrustum);
+		DrawShadowCaster(a_pass.Queue, drawn[DRAWN_PLAYER2], shadowFrustum);
+		DrawShadowCaster(a_pass.Queue, drawn[DRAWN_PUCK], shadowFrustum);
 
-	
+		a_pass.Queue->Execute(backend);
+	}
+}
 
+// --------------------------------------------------------
+// The point light's stale cube faces, all in one batch
+// --------------------------------------------------------
+void Game::RecordCubeShadowMap(RenderPassContext& a_pass)
+{
+	RenderBackend* backend = a_pass.Backend;
+	backend->SetRasterizerState(shadowRasterizer);
+	backend->SetViewport((float)shadowMapSize, (float)shadowMapSize);
+
+	for (int i = 0; i < 6; i++)
+	{
+		if (cubeStaleFaces & (1 << i))
+			backend->ClearDepth(pShadowCubeDepthView[i], 1.0f, false);
+	}
+
+	//Every stale face at once: one instance per caster per face it's in
+	GameEntity* cubeCasters[3] = { drawn[DRAWN_PLAYER1], drawn[DRAWN_PLAYER2], drawn[DRAWN_PUCK] };
+	cubeShadows->Begin(pShadowViewMatrix, pShadowProjMatrix);
+	if (cubeStaleFaces)
+	{
+		backend->SetRenderTarget(0, pShadowCubeArrayDepthView);
+
+		for (int c = 0; c < 3; c++)
+			cubeShadows->Add(cubeCasters[c], cubeCasterFaces[c] & cubeStaleFaces);
+
+		cubeShadows->Execute(backend);
+	}
+}
+
+// --------------------------------------------------------
+// The scene from the main camera, lit and shadowed
+// --------------------------------------------------------
+void Game::RecordOpaque(RenderPassContext& a_pass, const FrameSnapshot& a_frame, const Frustum& a_frustum)
+{
+	RenderBackend* backend = a_pass.Backend;
+	backend->SetRenderTarget(backBufferRTV, depthStencilView);
+	backend->SetViewport((float)this->width, (float)this->height);
+
+	pixelShader->SetTarget(backend);
+	pixelShader->SetSamplerState(SHADER_SHADOW_SAMPLER, shadowSampler);
+	pixelShader->SetShaderResourceView(SHADER_SHADOW_MAP, shadowMapSRV);
+	pixelShader->SetShaderResourceView(SHADER_SHADOW_CUBE_MAP, pShadowMapSRV);
 	
-	//for (int i = 0; i < 6; i++)
-	//{
-	//	cubeData[i].pSysMem = pShadowCubeTex[i];
-	//	cubeData[i].SysMemPitch = shadowMapSize / 8;
-	//	cubeData[i].SysMemSlicePitch = 0;
-	//}
-
-	//device->CreateTexture2D(&cubeMapDesc, &cubeData[0], &pShadowCubeTexture);
+	pixelShader->SetShaderResourceView(SHADER_SKY_TEXTURE, skySRV);
+
+	pixelShader->SetSamplerState(SHADER_BASIC_SAMPLER, sampler);
+
+	//Drawing objects, in whatever order binds the least
+	a_pass.Queue->Begin();
+	a_pass.Queue->SetCamera(a_frame.View, a_frame.Projection);
+
+	DrawEntity(a_pass.Queue, drawn[DRAWN_PLAYER1], a_frustum, RENDER_PASS_OPAQUE, paddleTextureSRV, TEST_TEXTURE);
+	DrawEntity(a_pass.Queue, drawn[DRAWN_PLAYER2], a_frustum, RENDER_PASS_OPAQUE, paddleTextureSRV, TEST_TEXTURE);
+	DrawEntity(a_pass.Queue, drawn[DRAWN_PUCK], a_frustum, RENDER_PASS_OPAQUE, puckSRV, designNormMapSRV);
+	DrawEntity(a_pass.Queue, drawn[DRAWN_TABLE], a_frustum, RENDER_PASS_OPAQUE, designTextureSRV, designNormMapSRV);
+
+	/**///Test entity drawing
+	if (a_frame.DebugMode) 
+	{
+		DrawEntity(a_pass.Queue, drawn[DRAWN_MARKER], a_frustum, RENDER_PASS_DEBUG, designTextureSRV, designNormMapSRV);
+	}
+
+	a_pass.Queue->Execute(backend);
+}
+
+// --------------------------------------------------------
+// Every emitter's living particles, blended over the scene
+// --------------------------------------------------------
+void Game::RecordParticles(RenderPassContext& a_pass, const FrameSnapshot& a_frame)
+{
+	RenderBackend* backend = a_pass.Backend;
+	backend->SetRenderTarget(backBufferRTV, depthStencilView);
+	backend->SetViewport((float)this->width, (float)this->height);
+
+	//Particle states
+	float blend[4] = { 1,1,1,1 };
+	backend->SetBlendState(particleBlendState, blend, 0xffffffff);
+	backend->SetDepthStencilState(particleDepthState, 0);
+	if (!a_frame.DebugMode) {
+		Emitter* emitters[EMITTER_COUNT] = { emitter, emitter1, emitter2, emitter3 };
+		for (int i = 0; i < EMITTER_COUNT; i++)
+			emitters[i]->Draw(backend, a_pass.Ring, a_frame.Particles[i], a_frame.View, a_frame.Projection);
+	}
+}
+
+// --------------------------------------------------------
+// The sky, wherever nothing else was drawn
+// --------------------------------------------------------
+void Game::RecordSky(RenderPassContext& a_pass, const FrameSnapshot& a_frame)
+{
+	RenderBackend* backend = a_pass.Backend;
+	backend->SetRenderTarget(backBufferRTV, depthStencilView);
+	backend->SetViewport((float)this->width, (float)this->height);
+
+	//draw the sky LAST, this should make it so it draws wherever there isn't
+	//already something there and sets the depth to 1.0
+	// Set the buffers
+	backend->SetVertexBuffer(cube->GetVertexBuffer(), sizeof(Vertex), 0);
+	backend->SetIndexBuffer(cube->GetIndexBuffer());
+
+	// Set up the sky shaders
+	skyVS->SetTarget(backend);
+	skyVS->SetMatrix4x4(SHADER_VIEW, a_frame.View);
+	skyVS->SetMatrix4x4(SHADER_PROJECTION, a_frame.Projection);
+	skyVS->CopyAllBufferData();
+	skyVS->SetShader();
 	
+	//skyPS->SetShaderResourceView("SkyTexture", pShadowMapSRV); //Shadow Cube Tex for Debugging
+	skyPS->SetTarget(backend);
+	skyPS->SetShaderResourceView(SHADER_SKY_TEXTURE, skySRV);
+	skyPS->SetSamplerState(SHADER_SKY_SAMPLER, sampler);
+	skyPS->SetShader();
+
+	// Set up the render state options
+	backend->SetRasterizerState(skyRasterState);
+	backend->SetDepthStencilState(skyDepthState, 0);
+
+	//Draw sky
+	backend->DrawIndexed(cube->GetIndexCount(), 0, 0);
+}
+
+// --------------------------------------------------------
+// Queues one entity for the shadow map being drawn, unless
+// it's outside the shadow projection
+// --------------------------------------------------------
+void Game::DrawShadowCaster(RenderQueue* a_queue, GameEntity* a_entity, const Frustum& a_frustum)
+{
+	if (!a_entity->IsVisible(a_frustum))
+	{
+		culledDraws++;
+		return;
+	}
+
+	a_queue->Submit(RENDER_PASS_SHADOW, a_entity, shadowVS, 0, 0, 0);
+	submittedDraws++;
+}
 
+// --------------------------------------------------------
+// Queues one entity with its material's shaders and the
+// given textures, unless the camera can't see it
+// --------------------------------------------------------
+void Game::DrawEntity(RenderQueue* a_queue, GameEntity* a_entity, const Frustum& a_frustum, RenderPass a_pass, ID3D11ShaderResourceView* a_texture, ID3D11ShaderResourceView* a_normalMap)
+{
+	if (!a_entity->IsVisible(a_frustum))
+	{
+		culledDraws++;
+		return;
+	}
+
+	Material* material = a_entity->getMaterial();
+	a_queue->Submit(a_pass, a_entity, material->getVertexShader(), material->getPixelShader(), a_texture, a_normalMap);
+	submittedDraws++;
 }
 
 // --------------------------------------------------------
@@ -672,6 +877,7 @@ void Game::CreateMatrices()
 	XMMATRIX shadowProj = XMMatrixOrthographicLH(10.0f, 10.0f, 0.1f, 100.0f);
 
 	XMStoreFloat4x4(&shadowProjMatrix, XMMatrixTranspose(shadowProj));
+	shadowFrustum.SetMatrices(shadowViewMatrix, shadowProjMatrix);
 
 	XMMATRIX pShadowProj = XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, .1f, 3.0f);
 
@@ -684,18 +890,18 @@ void Game::CreateMatrices()
 // --------------------------------------------------------
 void Game::CreateBasicGeometry()
 {
-	cube = new Mesh("Assets/Models/cube.obj", device);
-	sphere = new Mesh("Assets/Models/sphere.obj", device);
-	cylinder = new Mesh("Assets/Models/cylinder.obj", device);
-	hockeyPaddle = new Mesh("Assets/Models/hockeypaddle.obj", device);
-	hockeyTable = new Mesh("Assets/Models/hockeytable.obj", device);
+	cube = new Mesh("Assets/Models/cube.obj", renderer);
+	sphere = new Mesh("Assets/Models/sphere.obj", renderer);
+	cylinder = new Mesh("Assets/Models/cylinder.obj", renderer);
+	hockeyPaddle = new Mesh("Assets/Models/hockeypaddle.obj", renderer);
+	hockeyTable = new Mesh("Assets/Models/hockeytable.obj", renderer);
 
-	TEST_ENTITY = new GameEntity(cube, TEST_MATERIAL);
+	TEST_ENTITY = entities->Props.Get(entities->Props.Create(cube, TEST_MATERIAL));
 
-	puck = new Puck(cylinder, designMaterial);
-	player1 = new Paddle(hockeyPaddle, paddleMaterial);
-	player2 = new Paddle(hockeyPaddle, paddleMaterial);
-	table = new GameEntity(cube, designMaterial);
+	puck = entities->Pucks.Get(entities->Pucks.Create(cylinder, designMaterial));
+	player1 = entities->Paddles.Get(entities->Paddles.Create(hockeyPaddle, paddleMaterial));
+	player2 = entities->Paddles.Get(entities->Paddles.Create(hockeyPaddle, paddleMaterial));
+	table = entities->Props.Get(entities->Props.Create(cube, designMaterial));
 
 	player1->SetPosition(-2.5f, -0.225f, 0.0f);
 	player2->SetPosition(2.5f, -0.225f, 0.0f);
@@ -703,15 +909,31 @@ void Game::CreateBasicGeometry()
 	table->SetPosition(0.0f, -.5f, 0.0f);
 	player1->SetScale(0.5f, 0.5f, 0.5f);
 	player2->SetScale(0.5f, 0.5f, 0.5f);
+	player1->SetBounds(-3.2f, -0.8f, -1.2f, 1.2f);
+	player2->SetBounds(0.8f, 2.8f, -1.2f, 1.2f);
 	puck->SetScale(0.5f, 0.1f, 0.5f);
 	table->SetScale(8.0f, 0.5f, 4.5f);
-	TEST_ENTITY->SetScale(.1f, .1f, .1f);
 
-	player1->UpdateWorldMatrix();
-	player2->UpdateWorldMatrix();
-	puck->UpdateWorldMatrix();
-	table->UpdateWorldMatrix();
-	TEST_ENTITY->UpdateWorldMatrix();
+	player1->AttachTransform(transforms);
+	player2->AttachTransform(transforms);
+	puck->AttachTransform(transforms);
+	table->AttachTransform(transforms);
+	TEST_ENTITY->AttachTransform(transforms);
+
+	//The light marker rides along above the puck.  It's local to the
+	//puck's (0.5, 0.1, 0.5) scale, so this puts it at y = .15 and 0.1 wide
+	TEST_ENTITY->SetParent(puck);
+	TEST_ENTITY->SetPosition(0.0f, 3.5f, 0.0f);
+	TEST_ENTITY->SetScale(0.2f, 1.0f, 0.2f);
+
+	//What the render thread draws instead, in DRAWN_ order
+	simulated[DRAWN_PLAYER1] = player1;
+	simulated[DRAWN_PLAYER2] = player2;
+	simulated[DRAWN_PUCK] = puck;
+	simulated[DRAWN_TABLE] = table;
+	simulated[DRAWN_MARKER] = TEST_ENTITY;
+	for (int i = 0; i < DRAWN_COUNT; i++)
+		drawn[i] = new GameEntity(simulated[i]->GetMesh(), simulated[i]->getMaterial());
 }
 
 
@@ -730,25 +952,61 @@ void Game::OnResize()
 // --------------------------------------------------------
 void Game::Update(float deltaTime, float totalTime)
 {
-	//CreateShadowMapDirectionalOnly();
-	CreateShadowMap();
+	GameEntity::BeginFrame();
+	transforms->BeginFrame();
+	transforms->UpdateWorldMatrices();
 
+	//Whether this Update changed anything a snapshot holds
+	bool moved = false;
+
+	scoreBool = 0;
 	if (!paused)
 	{
-		//Puck Movement and Collision
-		puck->Update(deltaTime);
-		puck->CollisionDetection(player1);
-		puck->CollisionDetection(player2);
-		//Update Point Light Direction
-		pointLight.Position = XMFLOAT3(puck->GetPosition().x, .15f, puck->GetPosition().z);
+		MatchState state;
 
-		//Paddle Movement
-		PlayerMovement(deltaTime);
+		if (onlineActive)
+		{
+			server->Update(deltaTime);
+			onlineClients[0]->Update(deltaTime, PollPaddleInput(1));
+			onlineClients[1]->Update(deltaTime, PollPaddleInput(2));
+
+			//Puck and score come from the server, and each
+			//player sees their own predicted paddle
+			MatchState p2State;
+			onlineClients[0]->GetDisplayState(state);
+			onlineClients[1]->GetDisplayState(p2State);
+			state.PaddleX[1] = p2State.PaddleX[1];
+			state.PaddleZ[1] = p2State.PaddleZ[1];
+
+			if (onlineClients[0]->HasState())
+				ApplyMatchState(state);
+			moved = true;
+		}
+		else
+		{
+			//Whole steps at a fixed rate, however long this frame took
+			int steps = localSteps->Advance(deltaTime);
+			unsigned char p1Buttons = PollPaddleInput(1);
+			unsigned char p2Buttons = PollPaddleInput(2);
+			for (int i = 0; i < steps; i++)
+			{
+				localPrevious = localCurrent;
+				localMatch->Step(MATCH_STEP_DT, p1Buttons, p2Buttons);
+				localMatch->GetState(localCurrent);
+			}
 
-		//Camera Movement during Debug Mode
-		
+			//Drawn between the last two steps, as far along as the time
+			//left over reaches, so motion is even at any frame rate
+			float alpha = localSteps->GetAlpha();
+			Match::Interpolate(localPrevious, localCurrent, alpha, state);
+			ApplyMatchState(state);
+			moved = steps > 0 || alpha != localAlpha;
+			localAlpha = alpha;
+		}
 
-		scoreBool = puck->checkScore();
+		//The point light follows its marker, which follows the puck
+		transforms->UpdateWorldMatrices();
+		pointLight.Position = TEST_ENTITY->GetWorldPosition();
 	}
 	if (particlesActive)
 	{
@@ -794,10 +1052,26 @@ void Game::Update(float deltaTime, float totalTime)
 		}
 
 		lastHit = totalTime + 1;
+		moved = true;
 
 		
 	}
 
+	if (GetAsyncKeyState('O') & 0x8000 && (totalTime > lastHit))
+	{
+		if (onlineActive)
+		{
+			StopOnline();
+		}
+		else
+		{
+			StartOnline();
+		}
+
+		lastHit = totalTime + 1;
+		moved = true;
+	}
+
 	if (GetAsyncKeyState(' ') & 0x8000 && (totalTime > lastHit))
 	{
 		if (paused)
@@ -810,6 +1084,7 @@ void Game::Update(float deltaTime, float totalTime)
 		}
 
 		lastHit = totalTime + 1;
+		moved = true;
 	}
 
 	
@@ -820,12 +1095,52 @@ void Game::Update(float deltaTime, float totalTime)
 
 	CameraMovement();
 	mainCamera->Update();
+
+	//Hand this step over to the render thread, unless it would just
+	//be the last one again
+	if (moved || DebugModeActive || emitter->IsAlive() || emitter1->IsAlive() || emitter2->IsAlive() || emitter3->IsAlive())
+		PublishSnapshot();
 	
 	// Quit if the escape key is pressed
 	if (GetAsyncKeyState(VK_ESCAPE))
 		Quit();
 }
 
+// --------------------------------------------------------
+// Copies everything Draw needs out of the simulation into
+// the next snapshot and publishes it.  Never waits: if the
+// render thread hasn't taken the last one it's replaced
+// --------------------------------------------------------
+void Game::PublishSnapshot()
+{
+	FrameSnapshot& frame = snapshots.GetWriteBuffer();
+	frame.Step = ++simSteps;
+
+	//Brings everything that moved up to date first
+	transforms->UpdateWorldMatrices();
+	for (int i = 0; i < DRAWN_COUNT; i++)
+		frame.Worlds[i] = simulated[i]->GetWorldMatrix();
+
+	frame.View = mainCamera->getViewMatrix();
+	frame.Projection = mainCamera->getProjMatrix();
+	frame.CameraPosition = mainCamera->getPositon();
+	frame.Light = dirLight;
+	frame.PLight = pointLight;
+
+	//Only the living ranges; the vectors keep their memory between steps
+	Emitter* emitters[EMITTER_COUNT] = { emitter, emitter1, emitter2, emitter3 };
+	for (int i = 0; i < EMITTER_COUNT; i++)
+		emitters[i]->Capture(frame.Particles[i]);
+
+	frame.DebugMode = DebugModeActive;
+	frame.Online = onlineActive;
+	frame.RoundTripMs = onlineActive ? onlineClients[0]->GetRoundTripMs() : 0.0f;
+	frame.WorldRebuilds = transforms->GetRebuilds() + GameEntity::GetWorldRebuilds();
+	frame.Propagated = transforms->GetPropagated();
+
+	snapshots.Publish();
+}
+
 // --------------------------------------------------------
 // Clear the screen, redraw everything, present to the user
 // --------------------------------------------------------
@@ -834,83 +1149,80 @@ void Game::Draw(float deltaTime, float totalTime)
 	// Background color (Cornflower Blue in this case) for clearing
 	const float color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };//{ 0.4f, 0.6f, 0.75f, 0.0f };
 
+	renderer->BeginFrame();
+	passes->BeginFrame();
+	ISimpleShader::BeginFrame();
+	shadowCache->BeginFrame();
+	lastSubmittedDraws = submittedDraws;
+	lastCulledDraws = culledDraws;
+	submittedDraws = 0;
+	culledDraws = 0;
+
+	//The newest step the simulation has finished, or the last one
+	//again if it hasn't finished another since
+	snapshots.Acquire();
+	const FrameSnapshot& frame = snapshots.GetReadBuffer();
+	int stepsSinceLastFrame = (int)(frame.Step - lastDrawnStep);
+	lastDrawnStep = frame.Step;
+
+	//Everything drawn is posed as the simulation left it
+	for (int i = 0; i < DRAWN_COUNT; i++)
+		drawn[i]->SetWorldMatrix(XMMatrixTranspose(XMLoadFloat4x4(&frame.Worlds[i])));
+
+	//Which shadow views need drawing; the passes only draw them
+	PrepareShadowMaps(frame);
+
+	Frustum cameraFrustum;
+	cameraFrustum.SetMatrices(frame.View, frame.Projection);
+
+	//Lights, camera position and shadow matrices, once for every shader
+	PerFrameConstants frameConstants = {};
+	frameConstants.ShadowView = shadowViewMatrix;
+	frameConstants.ShadowProjection = shadowProjMatrix;
+	frameConstants.CubeShadowProjection = pShadowProjMatrix;
+	frameConstants.CameraPosition = frame.CameraPosition; //sending cam position for specular
+	frameConstants.Light = frame.Light;
+	frameConstants.PLight = frame.PLight;
+
 	// Clear the render target and depth buffer (erases what's on the screen)
 	//  - Do this ONCE PER FRAME
 	//  - At the beginning of Draw (before drawing *anything*)
-	context->ClearRenderTargetView(backBufferRTV, color);
-	context->ClearDepthStencilView(
-		depthStencilView,
-		D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL,
-		1.0f,
-		0);
-
-	viewMatrix = mainCamera->getViewMatrix();
-	projectionMatrix = mainCamera->getProjMatrix();
-
-	
-	pixelShader->SetData(
-		"light",  //The name of the (eventual) variable in the shader
-		&dirLight, //The address of the data to copy
-		sizeof(DirectionalLight)); //The size of the data to copy
-
-	
-
-	pixelShader->SetData( //sending over the point light
-		"pLight",
-		&pointLight,
-		sizeof(PointLight));
-
-	vertexShader->SetMatrix4x4("shadowViewMat", shadowViewMatrix);
-	vertexShader->SetMatrix4x4("shadowProjMat", shadowProjMatrix);
-	vertexShader->SetMatrix4x4("CubeShadowProjMat", pShadowProjMatrix);
-
-	pixelShader->SetSamplerState("ShadowSampler", shadowSampler);
-	pixelShader->SetShaderResourceView("ShadowMap", shadowMapSRV);
-	pixelShader->SetShaderResourceView("ShadowCubeMap", pShadowMapSRV);
-
-	pixelShader->SetFloat3("cameraPosition", mainCamera->getPositon()); //sending cam position for specular
-	
-	pixelShader->SetShaderResourceView("SkyTexture", skySRV);
-
-	pixelShader->SetSamplerState("basicSampler", sampler);
-
-	pixelShader->SetShaderResourceView("srv", paddleTextureSRV);
-
-	pixelShader->SetShaderResourceView("NormalMap", TEST_TEXTURE);
-	
-	//Same as above														 //Drawing objects
-
-	player1->PrepareMaterial(viewMatrix, projectionMatrix);
-	player1->Draw(context);
-
-	player2->PrepareMaterial(viewMatrix, projectionMatrix);
-	player2->Draw(context);
-
-	//Sending Normal Map to Pixel Shader
-	pixelShader->SetShaderResourceView("NormalMap", designNormMapSRV);
+	renderer->ClearRenderTarget(backBufferRTV, color);
+	renderer->ClearDepth(depthStencilView, 1.0f, true);
 
-	pixelShader->SetShaderResourceView("srv", puckSRV);
-
-	puck->PrepareMaterial(viewMatrix, projectionMatrix);
-	puck->Draw(context);
-	
-	pixelShader->SetShaderResourceView("srv", designTextureSRV);
-	table->PrepareMaterial(viewMatrix, projectionMatrix);
-	table->Draw(context);
-
-	/**///Test entity drawing
-	if (DebugModeActive) 
+	//Every pass at once, each into a command list of its own
+	passes->Record([this, &frame, &cameraFrustum, &frameConstants](int a_pass, RenderPassContext& a_context)
 	{
-		pixelShader->SetShaderResourceView("srv", designTextureSRV);
-		TEST_ENTITY->SetPosition(pointLight.Position.x, pointLight.Position.y, pointLight.Position.z);
-		TEST_ENTITY->PrepareMaterial(viewMatrix, projectionMatrix);
-		TEST_ENTITY->Draw(context);
-	}
+		//Lists start with nothing bound, and without them (drawn in
+		//order) a pass mustn't inherit the last one's states either
+		float blendFactor[4] = { 1,1,1,1 };
+		a_context.Backend->SetRasterizerState(0);
+		a_context.Backend->SetBlendState(0, blendFactor, 0xffffffff);
+		a_context.Backend->SetDepthStencilState(0, 0);
+		a_context.Constants->SetFrame(frameConstants);
+
+		switch (a_pass)
+		{
+		case PASS_SHADOW: RecordShadowMap(a_context); break;
+		case PASS_CUBE_SHADOW: RecordCubeShadowMap(a_context); break;
+		case PASS_OPAQUE: RecordOpaque(a_context, frame, cameraFrustum); break;
+		case PASS_PARTICLES: RecordParticles(a_context, frame); break;
+		case PASS_SKY: RecordSky(a_context, frame); break;
+		}
+	});
+
+	//Shadow maps, then the scene that reads them
+	passes->Submit(PASS_SHADOW, PASS_PARTICLES);
 
 	//Store Texture in Font
 	ID3D11ShaderResourceView* fontTexture;
 	font->GetSpriteSheet(&fontTexture);
 
+	//Running the lists left nothing bound, and SpriteBatch draws to
+	//whatever target and viewport it finds
+	renderer->SetRenderTarget(backBufferRTV, depthStencilView);
+	renderer->SetViewport((float)this->width, (float)this->height);
+
 	//Draw Text
 	spriteBatch->Begin();
 	font->DrawString(
@@ -918,62 +1230,91 @@ void Game::Draw(float deltaTime, float totalTime)
 		L"Air Hockey",
 		XMFLOAT2(500, 50));
 
-	spriteBatch->End();
-
-	/**/
-	//Particle states
-	float blend[4] = { 1,1,1,1 };
-	context->OMSetBlendState(particleBlendState, blend, 0xffffffff);
-	context->OMSetDepthStencilState(particleDepthState, 0);
-	if (!DebugModeActive) {
-		emitter->Draw(context, mainCamera);
-
-		emitter1->Draw(context, mainCamera);
-
-		emitter2->Draw(context, mainCamera);
-
-		emitter3->Draw(context, mainCamera);
+	if (frame.Online)
+	{
+		std::wstring netText = L"Online  RTT " + std::to_wstring((int)frame.RoundTripMs) + L"ms";
+		font->DrawString(
+			spriteBatch,
+			netText.c_str(),
+			XMFLOAT2(20, 650));
 	}
-	
-	//draw the sky LAST, this should make it so it draws wherever there isn't
-	//already something there and sets the depth to 1.0
-	ID3D11Buffer* skyVB = cube->GetVertexBuffer();
-	ID3D11Buffer* skyIB = cube->GetIndexBuffer();
 
-	// Set the buffers
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
-	context->IASetVertexBuffers(0, 1, &skyVB, &stride, &offset);
-	context->IASetIndexBuffer(skyIB, DXGI_FORMAT_R32_UINT, 0);
-
-	// Set up the sky shaders
-	skyVS->SetMatrix4x4("view", mainCamera->getViewMatrix());
-	skyVS->SetMatrix4x4("projection", mainCamera->getProjMatrix());
-	skyVS->CopyAllBufferData();
-	skyVS->SetShader();
-	
-	//skyPS->SetShaderResourceView("SkyTexture", pShadowMapSRV); //Shadow Cube Tex for Debugging
-	skyPS->SetShaderResourceView("SkyTexture", skySRV);
-	skyPS->SetSamplerState("BasicSampler", sampler);
-	skyPS->SetShader();
-
-	// Set up the render state options
-	context->RSSetState(skyRasterState);
-	context->OMSetDepthStencilState(skyDepthState, 0);
-
-
-
-	//Draw sky
-	context->DrawIndexed(cube->GetIndexCount(), 0, 0);
-	/**/
+	if (frame.DebugMode)
+	{
+		std::wstring transformText = L"World rebuilds " + std::to_wstring(frame.WorldRebuilds) +
+			L"  propagated " + std::to_wstring(frame.Propagated);
+		font->DrawString(
+			spriteBatch,
+			transformText.c_str(),
+			XMFLOAT2(20, 620));
+
+		const RenderFrameStats& frameStats = deviceBackend->GetLastFrameStats();
+		RenderFilterStats filterStats = renderer->GetLastFilterStats();
+		for (int i = 0; i < PASS_COUNT; i++)
+		{
+			FilteringBackend* passFilter = (FilteringBackend*)passes->GetPass(i).Backend;
+			if (passFilter == renderer)
+				continue;
+			filterStats.Issued += passFilter->GetLastFilterStats().Issued;
+			filterStats.Filtered += passFilter->GetLastFilterStats().Filtered;
+		}
+		std::wstring cullText = L"Draws " + std::to_wstring(lastSubmittedDraws) + L"  culled " + std::to_wstring(lastCulledDraws) +
+			L"  states " + std::to_wstring(filterStats.Issued) + L" (" + std::to_wstring(filterStats.Filtered) + L" redundant dropped)" + L"  uploads " + std::to_wstring(frameStats.Uploads) +
+			L" (" + std::to_wstring(frameStats.BytesUploaded / 1024) + L" KB)";
+		RenderQueueStats queueStats = passes->GetLastQueueStats();
+		std::wstring queueText = L"Binds: shaders " + std::to_wstring(queueStats.ShaderBinds) + L"  textures " + std::to_wstring(queueStats.TextureBinds) +
+			L"  meshes " + std::to_wstring(queueStats.MeshBinds) + L"  skipped " + std::to_wstring(queueStats.SkippedBinds) +
+			L"  instanced " + std::to_wstring(queueStats.Instances) + L" in " + std::to_wstring(queueStats.InstancedDraws);
+		font->DrawString(
+			spriteBatch,
+			cullText.c_str(),
+			XMFLOAT2(20, 590));
+
+		font->DrawString(
+			spriteBatch,
+			queueText.c_str(),
+			XMFLOAT2(20, 560));
+
+		std::wstring shadowText = L"Shadow views drawn " + std::to_wstring(shadowCache->GetLastUpdated()) +
+			L"  cached " + std::to_wstring(shadowCache->GetLastSkipped()) + L"  copies " + std::to_wstring(frameStats.Copies) +
+			L"  cube draws " + std::to_wstring(cubeShadows->GetLastDraws()) + L" (" + std::to_wstring(cubeShadows->GetLastInstances()) + L" faces)";
+		font->DrawString(
+			spriteBatch,
+			shadowText.c_str(),
+			XMFLOAT2(20, 530));
+
+		const SimpleShaderUploadStats& uploadStats = ISimpleShader::GetLastFrameStats();
+		std::wstring uploadText = L"Constant buffers sent " + std::to_wstring(uploadStats.Uploads) +
+			L" (" + std::to_wstring(uploadStats.BytesUploaded / 1024) + L" KB, " + std::to_wstring(uploadStats.BytesChanged / 1024) + L" KB changed)" +
+			L"  unchanged " + std::to_wstring(uploadStats.Skipped);
+		font->DrawString(
+			spriteBatch,
+			uploadText.c_str(),
+			XMFLOAT2(20, 500));
+
+		TransientRingStats ringStats = passes->GetLastRingStats();
+		std::wstring ringText = L"Transient " + std::to_wstring(ringStats.Allocations) + L" uploads, " +
+			std::to_wstring(ringStats.BytesUsed / 1024) + L" of " + std::to_wstring(ringStats.Capacity / 1024) + L" KB" +
+			L"  discards " + std::to_wstring(ringStats.Discards) + L"  overflows " + std::to_wstring(ringStats.Overflows);
+		font->DrawString(
+			spriteBatch,
+			ringText.c_str(),
+			XMFLOAT2(20, 470));
+
+		std::wstring stepText = L"Sim step " + std::to_wstring(frame.Step) + L" (" + std::to_wstring(stepsSinceLastFrame) + L" since last frame)";
+		font->DrawString(
+			spriteBatch,
+			stepText.c_str(),
+			XMFLOAT2(20, 440));
+	}
 
+	spriteBatch->End();
 
-	//reset the blendstate
-	context->OMSetBlendState(0, blend, 0xffffffff);
+	//SpriteBatch sets its own shaders, buffers and states on the context
+	renderer->Invalidate();
 
-	// Reset any states we've changed for the next frame!
-	context->RSSetState(0);
-	context->OMSetDepthStencilState(0, 0);
+	//Particles and sky over the scene and the text
+	passes->Submit(PASS_PARTICLES, PASS_COUNT);
 
 	// Present the back buffer to the user
 	//  - Puts the final frame we're drawing into the window so the user can see it
@@ -981,87 +1322,96 @@ void Game::Draw(float deltaTime, float totalTime)
 	swapChain->Present(0, 0);
 }
 
-void Game::PlayerMovement(float deltaTime)
+//Copies a match's state onto the entities we draw, and
+//flags a goal if either score went up
+void Game::ApplyMatchState(const MatchState& state)
 {
-	//Movement for Player 1
-	if (DebugModeActive == false)
-	{
-		if (GetAsyncKeyState('W') & 0x8000)
-		{
-			player1->MoveAbsolute(0.0f, 0.0f, 5 * deltaTime);
+	puck->SetPosition(state.PuckX, puck->GetPosition().y, state.PuckZ);
+	player1->SetPosition(state.PaddleX[0], player1->GetPosition().y, state.PaddleZ[0]);
+	player2->SetPosition(state.PaddleX[1], player2->GetPosition().y, state.PaddleZ[1]);
+
+	if (state.Score[0] > player1Score)
+		scoreBool = 1;
+	else if (state.Score[1] > player2Score)
+		scoreBool = 2;
+}
 
-			if (player1->GetPosition().z > 1.2f)
-			{
-				player1->SetPosition(player1->GetPosition().x, player1->GetPosition().y, 1.2f);
-			}
-		}
-		if (GetAsyncKeyState('D') & 0x8000)
-		{
-			player1->MoveAbsolute(5 * deltaTime, 0.0f, 0.0f);
+//Starts a server on localhost and connects both players to it
+//through simulated latency, jitter and packet loss
+void Game::StartOnline()
+{
+	server = new GameServer();
+	if (!server->Start(NET_DEFAULT_PORT, 0))
+	{
+		std::cout << "Could not start the online server\n";
+		delete server;
+		server = 0;
+		return;
+	}
+	server->GetSimulator()->SetConditions(50, 10, 2.0f);
 
-			if (player1->GetPosition().x > -0.8f)
-			{
-				player1->SetPosition(-0.8f, player1->GetPosition().y, player1->GetPosition().z);
-			}
-		}
-		if (GetAsyncKeyState('S') & 0x8000)
-		{
-			player1->MoveAbsolute(0.0f, 0.0f, -5 * deltaTime);
+	NetAddress address = NetMakeAddress(127, 0, 0, 1, server->GetPort());
+	for (int i = 0; i < 2; i++)
+	{
+		onlineClients[i] = new GameClient();
+		onlineClients[i]->GetSimulator()->SetConditions(50, 10, 2.0f);
+		onlineClients[i]->Connect(address, 0, i);
+	}
 
-			if (player1->GetPosition().z < -1.2f)
-			{
-				player1->SetPosition(player1->GetPosition().x, player1->GetPosition().y, -1.2f);
-			}
-		}
-		if (GetAsyncKeyState('A') & 0x8000)
-		{
-			player1->MoveAbsolute(-5 * deltaTime, 0.0f, 0.0f);
+	player1Score = 0;
+	player2Score = 0;
+	onlineActive = true;
+	std::cout << "Online mode started\n";
+}
 
-			if (player1->GetPosition().x < -3.2f)
-			{
-				player1->SetPosition(-3.2f, player1->GetPosition().y, player1->GetPosition().z);
-			}
-		}
+void Game::StopOnline()
+{
+	for (int i = 0; i < 2; i++)
+	{
+		delete onlineClients[i];
+		onlineClients[i] = 0;
 	}
 
-	//Movement for Player 2
-	if (GetAsyncKeyState('L') & 0x8000)
-	{
-		player2->MoveAbsolute(5 * deltaTime, 0.0f, 0.0f);
+	delete server;
+	server = 0;
 
-		if (player2->GetPosition().x > 2.8f)
-		{
-			player2->SetPosition(2.8f, player2->GetPosition().y, player2->GetPosition().z);
-		}
-	}
-	if (GetAsyncKeyState('I') & 0x8000)
+	if (onlineActive)
 	{
-		player2->MoveAbsolute(0.0f, 0.0f, 5 * deltaTime);
+		localMatch->Reset();
+		localMatch->GetState(localCurrent);
+		localPrevious = localCurrent;
+		player1Score = 0;
+		player2Score = 0;
+		onlineActive = false;
+		std::cout << "Online mode stopped\n";
+	}
+}
 
-		if (player2->GetPosition().z > 1.2f)
-		{
-			player2->SetPosition(player2->GetPosition().x, player2->GetPosition().y, 1.2f);
-		}
+//Reads the keyboard into paddle input bits for the given player
+unsigned char Game::PollPaddleInput(int player)
+{
+	unsigned char buttons = 0;
 
-	}
-	if (GetAsyncKeyState('K') & 0x8000)
+	//Player 1 shares WASD with the debug camera
+	if (player == 1)
 	{
-		player2->MoveAbsolute(0.0f, 0.0f, -5 * deltaTime);
+		if (DebugModeActive)
+			return 0;
 
-		if (player2->GetPosition().z < -1.2f)
-		{
-			player2->SetPosition(player2->GetPosition().x, player2->GetPosition().y, -1.2f);
-		}
+		if (GetAsyncKeyState('W') & 0x8000) buttons |= PADDLE_UP;
+		if (GetAsyncKeyState('S') & 0x8000) buttons |= PADDLE_DOWN;
+		if (GetAsyncKeyState('A') & 0x8000) buttons |= PADDLE_LEFT;
+		if (GetAsyncKeyState('D') & 0x8000) buttons |= PADDLE_RIGHT;
 	}
-	if (GetAsyncKeyState('J') & 0x8000)
+	else
 	{
-		player2->MoveAbsolute(-5 * deltaTime, 0.0f, 0.0f);
-
-		if (player2->GetPosition().x < 0.8f)
-		{
-			player2->SetPosition(0.8f, player2->GetPosition().y, player2->GetPosition().z);
-		}
+		if (GetAsyncKeyState('I') & 0x8000) buttons |= PADDLE_UP;
+		if (GetAsyncKeyState('K') & 0x8000) buttons |= PADDLE_DOWN;
+		if (GetAsyncKeyState('J') & 0x8000) buttons |= PADDLE_LEFT;
+		if (GetAsyncKeyState('L') & 0x8000) buttons |= PADDLE_RIGHT;
 	}
+
+	return buttons;
 }
 
 void Game::CameraMovement()
@@ -11,6 +11,21 @@
 #include "Paddle.h"
 #include "Puck.h"
 #include "Emitter.h"
+#include "Match.h"
+#include "FixedTimestep.h"
+#include "GameServer.h"
+#include "GameClient.h"
+#include "JobPool.h"
+#include "EntityRegistry.h"
+#include "D3D11Backend.h"
+#include "FilteringBackend.h"
+#include "RenderStateCache.h"
+#include "RenderQueue.h"
+#include "ShaderConstants.h"
+#include "ShadowCache.h"
+#include "CubeShadowBatch.h"
+#include "PassRecorder.h"
+#include "TripleBuffer.h"
 #include <iostream>
 #include "SpriteBatch.h"
 #include "SpriteFont.h"
@@ -29,7 +44,7 @@ public:
 	void OnResize();
 	void Update(float deltaTime, float totalTime);
 	void Draw(float deltaTime, float totalTime);
-	void PlayerMovement(float deltaTime);
+	unsigned char PollPaddleInput(int player);
 	void CameraMovement();
 
 	// Overridden mouse input helper methods
@@ -49,8 +64,66 @@ private:
 	void LoadLights();
 	void CreateMatrices();
 	void CreateBasicGeometry();
-	void CreateShadowMap();
-	void CreateShadowMapDirectionalOnly();
+
+	//A frame's passes, each recorded into its own command list (on
+	//whichever thread gets to it) and submitted in this order
+	static const int PASS_SHADOW = 0;
+	static const int PASS_CUBE_SHADOW = 1;
+	static const int PASS_OPAQUE = 2;
+	static const int PASS_PARTICLES = 3;
+	static const int PASS_SKY = 4;
+	static const int PASS_COUNT = 5;
+
+	//What the render thread draws in place of the simulation's
+	//entities, posed from each snapshot
+	static const int DRAWN_PLAYER1 = 0;
+	static const int DRAWN_PLAYER2 = 1;
+	static const int DRAWN_PUCK = 2;
+	static const int DRAWN_TABLE = 3;
+	static const int DRAWN_MARKER = 4;	// TEST_ENTITY, the point light's marker
+	static const int DRAWN_COUNT = 5;
+	static const int EMITTER_COUNT = 4;
+
+	//Everything Draw needs from one finished Update, copied out so
+	//the render thread never reads what the simulation is changing
+	struct FrameSnapshot
+	{
+		uint64_t Step;										// Updates so far
+		XMFLOAT4X4 Worlds[DRAWN_COUNT];						// Transposed, like GameEntity's
+		XMFLOAT4X4 View;
+		XMFLOAT4X4 Projection;
+		XMFLOAT3 CameraPosition;
+		DirectionalLight Light;
+		PointLight PLight;
+		std::vector<Particle> Particles[EMITTER_COUNT];		// Living, oldest first
+		bool DebugMode;
+		bool Online;
+		float RoundTripMs;
+		unsigned int WorldRebuilds;
+		unsigned int Propagated;
+	};
+	void PublishSnapshot();
+
+	void PrepareShadowMaps(const FrameSnapshot& a_frame);
+	void RecordShadowMap(RenderPassContext& a_pass);
+	void RecordCubeShadowMap(RenderPassContext& a_pass);
+	void RecordOpaque(RenderPassContext& a_pass, const FrameSnapshot& a_frame, const Frustum& a_frustum);
+	void RecordParticles(RenderPassContext& a_pass, const FrameSnapshot& a_frame);
+	void RecordSky(RenderPassContext& a_pass, const FrameSnapshot& a_frame);
+
+	//Culled drawing; both count what they submit and what they skip,
+	//from whichever pass is recording
+	void DrawShadowCaster(RenderQueue* a_queue, GameEntity* a_entity, const Frustum& a_frustum);
+	void DrawEntity(RenderQueue* a_queue, GameEntity* a_entity, const Frustum& a_frustum, RenderPass a_pass, ID3D11ShaderResourceView* a_texture, ID3D11ShaderResourceView* a_normalMap);
+	std::atomic<int> submittedDraws;
+	std::atomic<int> culledDraws;
+	int lastSubmittedDraws;
+	int lastCulledDraws;
+
+	//Online play helpers
+	void StartOnline();
+	void StopOnline();
+	void ApplyMatchState(const MatchState& state);
 
 	//Sprites and Fonts
 	SpriteBatch* spriteBatch;
@@ -74,6 +147,26 @@ private:
 	int sqNumOfInd;
 	int diaNumOfInd;
 
+	//Everything drawn goes through here rather than straight to the context,
+	//which only sees the calls that change something
+	FilteringBackend* renderer;
+	D3D11Backend* deviceBackend;
+
+	//Owns every rasterizer, depth, blend and sampler state below
+	RenderStateCache* renderStates;
+
+	//Every pass's queue (each view's draws, sorted by the state they
+	//need), transient ring and per-frame and per-view constants
+	PassRecorder* passes;
+
+	//Update publishes a snapshot after every step and Draw takes the
+	//newest; neither waits for the other
+	TripleBuffer<FrameSnapshot> snapshots;
+	uint64_t simSteps;
+	uint64_t lastDrawnStep;
+	GameEntity* simulated[DRAWN_COUNT];
+	GameEntity* drawn[DRAWN_COUNT];
+
 	// Wrappers for DirectX shaders to provide simplified functionality
 	SimpleVertexShader* vertexShader;
 	SimplePixelShader* pixelShader;
@@ -83,6 +176,19 @@ private:
 	ID3D11ShaderResourceView* shadowMapSRV;
 	ID3D11Texture2D* shadowMapTex;
 	ID3D11DepthStencilView* shadowDepthView;
+
+	//Static casters' depth, kept between frames, and what each
+	//shadow view was last drawn from
+	ID3D11Texture2D* staticShadowTex;
+	ID3D11DepthStencilView* staticShadowDepthView;
+	ShadowCache* shadowCache;
+	bool staticShadowStale;
+	bool dynamicShadowStale;
+	unsigned int cubeStaleFaces;
+	unsigned int cubeCasterFaces[3];	// player1, player2, puck
+	static const int SHADOW_VIEW_STATIC = 0;
+	static const int SHADOW_VIEW_DIRECTIONAL = 1;
+	static const int SHADOW_VIEW_CUBE = 2;	// First of six faces
 	ID3D11SamplerState* shadowSampler;
 	ID3D11RasterizerState* shadowRasterizer;
 
@@ -90,6 +196,7 @@ private:
 	ID3D11ShaderResourceView* pShadowMapSRV;
 	ID3D11Texture2D* pShadowCubeTex; 
 	ID3D11DepthStencilView* pShadowCubeDepthView[6]; //array of depth buffer textures
+	ID3D11DepthStencilView* pShadowCubeArrayDepthView; //all six faces
 
 	//View matticies for the cube map
 	XMMATRIX pShadowView1;
@@ -101,7 +208,17 @@ private:
 
 	SimpleVertexShader* shadowVS;
 
+	//Same as vertexShader and shadowVS, with the world matrix per instance
+	SimpleVertexShader* instancedVS;
+	SimpleVertexShader* shadowInstancedVS;
+
+	//Cube faces by instance, routed to their face by the geometry shader
+	SimpleVertexShader* cubeShadowVS;
+	SimpleGeometryShader* cubeShadowGS;
+	CubeShadowBatch* cubeShadows;
+
 	XMFLOAT4X4 shadowViewMatrix, shadowProjMatrix;
+	Frustum shadowFrustum;
 
 	XMFLOAT4X4* pShadowViewMatrix;
 	XMFLOAT4X4 pShadowProjMatrix;
@@ -121,6 +238,9 @@ private:
 	//Entities
 	GameEntity* entity;
 	GameEntity* entity2;
+
+	//Owns every entity below; the pointers stay valid until destroyed there
+	EntityRegistry* entities;
 	
 	Paddle* player1;
 	Paddle* player2;
@@ -129,6 +249,28 @@ private:
 
 	GameEntity* table;
 
+	//World matrices of everything drawn, built in one batch per frame
+	TransformSystem* transforms;
+
+	//Worker threads for big batches (transform levels), and the
+	//render thread's own for recording passes
+	JobPool* jobs;
+	JobPool* renderJobs;
+
+	//Gameplay for local (same keyboard) play, stepped at MATCH_STEP_RATE
+	//and drawn between its last two steps
+	Match* localMatch;
+	FixedTimestep* localSteps;
+	MatchState localPrevious;
+	MatchState localCurrent;
+	float localAlpha;
+
+	//Online play: an in-process authoritative server on localhost
+	//and one client per player, both going through simulated latency
+	bool onlineActive;
+	GameServer* server;
+	GameClient* onlineClients[2];
+
 	//Particle stuff
 	ID3D11ShaderResourceView* particleTexture;
 	SimpleVertexShader* particleVS;
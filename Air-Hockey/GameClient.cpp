@@ -0,0 +1,212 @@
+#include "GameClient.h"
+#include "Match.h"
+#include <cstddef>
+#include <cstring>
+
+// How often to retry the handshake until the server answers
+static const float CONNECT_RETRY_SECONDS = 0.25f;
+
+GameClient::GameClient() : predicted(0, 0)
+{
+	matchID = 0;
+	slot = 0;
+	connected = false;
+	accumulator = 0.0f;
+	connectTimer = 0.0f;
+	sequence = 0;
+	lastAckedSequence = 0;
+	hasState = false;
+	roundTripMs = 0.0f;
+	memset(&state, 0, sizeof(state));
+	memset(pending, 0, sizeof(pending));
+}
+
+GameClient::~GameClient()
+{
+	Disconnect();
+}
+
+bool GameClient::Connect(const NetAddress& a_server, uint16_t a_matchID, int a_slot)
+{
+	if (!socket.Open(0))
+		return false;
+
+	server = a_server;
+	matchID = a_matchID;
+	slot = a_slot;
+	connected = false;
+	hasState = false;
+	memset(&state, 0, sizeof(state));
+	history.Clear();
+	sequence = 0;
+	lastAckedSequence = 0;
+
+	Match::ConfigurePaddle(&predicted, slot);
+
+	SendConnect();
+	connectTimer = CONNECT_RETRY_SECONDS;
+	return true;
+}
+
+void GameClient::Disconnect()
+{
+	if (connected)
+	{
+		ConnectPacket bye = {};
+		bye.Header.Type = NET_DISCONNECT;
+		bye.Header.Slot = (uint8_t)slot;
+		bye.Header.MatchID = matchID;
+
+		//Straight out, the simulator won't be flushed again
+		socket.Send(server, &bye, sizeof(bye));
+	}
+
+	connected = false;
+	socket.Close();
+}
+
+void GameClient::SendConnect()
+{
+	ConnectPacket hello = {};
+	hello.Header.Type = NET_CONNECT;
+	hello.Header.Slot = (uint8_t)slot;
+	hello.Header.MatchID = matchID;
+	simulator.Send(&socket, server, &hello, sizeof(hello));
+}
+
+void GameClient::Update(float dt, unsigned char a_buttons)
+{
+	if (!socket.IsOpen())
+		return;
+
+	ReceivePackets();
+
+	if (!connected)
+	{
+		connectTimer -= dt;
+		if (connectTimer <= 0.0f)
+		{
+			SendConnect();
+			connectTimer = CONNECT_RETRY_SECONDS;
+		}
+	}
+	else
+	{
+		//Sample input at the server's tick rate so each
+		//input is exactly one server tick of movement
+		accumulator += dt;
+		while (accumulator >= NET_TICK_DT)
+		{
+			sequence++;
+			NetInputCommand& input = pending[sequence % PENDING_INPUTS];
+			input.Sequence = sequence;
+			input.Buttons = a_buttons;
+
+			//Predict: move our paddle now instead of waiting a round trip
+			predicted.ApplyInput(a_buttons, NET_TICK_DT);
+
+			SendInputs();
+			accumulator -= NET_TICK_DT;
+		}
+	}
+
+	simulator.Flush(&socket);
+}
+
+void GameClient::SendInputs()
+{
+	InputPacket packet;
+	packet.Header.Type = NET_INPUT;
+	packet.Header.Slot = (uint8_t)slot;
+	packet.Header.MatchID = matchID;
+	packet.ClientTimeMs = NetTimeMs();
+	packet.AckTick = state.Tick;
+
+	//Resend the newest unacknowledged inputs, oldest first
+	uint32_t unacked = sequence - lastAckedSequence;
+	uint32_t count = unacked < (uint32_t)NET_INPUT_REDUNDANCY ? unacked : (uint32_t)NET_INPUT_REDUNDANCY;
+	packet.Count = (uint8_t)count;
+	for (uint32_t i = 0; i < count; i++)
+		packet.Inputs[i] = pending[(sequence - count + 1 + i) % PENDING_INPUTS];
+
+	int size = (int)(offsetof(InputPacket, Inputs) + count * sizeof(NetInputCommand));
+	simulator.Send(&socket, server, &packet, size);
+}
+
+void GameClient::ReceivePackets()
+{
+	NetAddress from;
+	int size;
+	while ((size = socket.Receive(from, packetBuffer, NET_MAX_PACKET_SIZE)) >= (int)sizeof(NetHeader))
+	{
+		if (from != server)
+			continue;
+
+		const NetHeader* header = (const NetHeader*)packetBuffer;
+		if (header->MatchID != matchID)
+			continue;
+
+		if (header->Type == NET_ACCEPT)
+		{
+			//The server may have given us the other side
+			if (!connected || header->Slot != slot)
+			{
+				slot = header->Slot;
+				Match::ConfigurePaddle(&predicted, slot);
+			}
+			connected = true;
+		}
+		else if (header->Type == NET_SNAPSHOT && size > (int)sizeof(SnapshotPacket))
+		{
+			HandleSnapshot(packetBuffer, size);
+		}
+	}
+}
+
+void GameClient::HandleSnapshot(const unsigned char* a_data, int a_size)
+{
+	QuantizedState decoded;
+	int header = sizeof(SnapshotPacket);
+	if (!SnapshotCodec::ReadSnapshot(history, state.Tick, a_data + header, a_size - header, decoded))
+		return;
+
+	//Late, reordered snapshots are older than what we have
+	if (hasState && (int32_t)(decoded.Tick - state.Tick) <= 0)
+		return;
+
+	//Kept so the server can encode against it once we ack it
+	history.Store(decoded);
+	SnapshotCodec::Dequantize(decoded, state);
+	hasState = true;
+
+	Reconcile(*(const SnapshotPacket*)a_data);
+}
+
+void GameClient::Reconcile(const SnapshotPacket& a_snapshot)
+{
+	connected = true;
+
+	float sample = (float)(NetTimeMs() - a_snapshot.EchoTimeMs);
+	roundTripMs = roundTripMs == 0.0f ? sample : roundTripMs * 0.9f + sample * 0.1f;
+
+	if ((int32_t)(a_snapshot.LastInput - lastAckedSequence) > 0)
+		lastAckedSequence = a_snapshot.LastInput;
+
+	//Start from where the server says our paddle is, then
+	//replay every input it hasn't simulated yet
+	predicted.SetPosition(state.PaddleX[slot], predicted.GetPosition().y, state.PaddleZ[slot]);
+
+	uint32_t unacked = sequence - lastAckedSequence;
+	if (unacked > (uint32_t)PENDING_INPUTS)
+		unacked = PENDING_INPUTS;
+
+	for (uint32_t s = sequence - unacked + 1; s != sequence + 1; s++)
+		predicted.ApplyInput(pending[s % PENDING_INPUTS].Buttons, NET_TICK_DT);
+}
+
+void GameClient::GetDisplayState(MatchState& a_state)
+{
+	a_state = state;
+	a_state.PaddleX[slot] = predicted.GetPosition().x;
+	a_state.PaddleZ[slot] = predicted.GetPosition().z;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "Paddle.h"
+#include "NetSocket.h"
+#include "NetProtocol.h"
+#include "LatencySimulator.h"
+#include "SnapshotCodec.h"
+
+// --------------------------------------------------------
+// Online client for one player.  Sends timestamped inputs
+// at the server's tick rate, predicts its own paddle right
+// away and reconciles it with every server snapshot.
+// --------------------------------------------------------
+class GameClient
+{
+public:
+	GameClient();
+	~GameClient();
+
+	bool Connect(const NetAddress& a_server, uint16_t a_matchID, int a_slot);
+	void Disconnect();
+
+	// Call every frame with the player's current input
+	void Update(float dt, unsigned char a_buttons);
+
+	bool IsConnected() { return connected; }
+	bool HasState() { return hasState; }
+	int GetSlot() { return slot; }
+	float GetRoundTripMs() { return roundTripMs; }
+	LatencySimulator* GetSimulator() { return &simulator; }
+
+	// Newest server state, with this player's paddle replaced by the prediction
+	void GetDisplayState(MatchState& a_state);
+
+private:
+	static const int PENDING_INPUTS = 64;
+
+	UdpSocket socket;
+	LatencySimulator simulator;
+	NetAddress server;
+	uint16_t matchID;
+	int slot;
+	bool connected;
+	float accumulator;
+	float connectTimer;
+
+	// Prediction
+	Paddle predicted;
+	uint32_t sequence;
+	uint32_t lastAckedSequence;
+	NetInputCommand pending[PENDING_INPUTS];
+
+	// Newest authoritative state, and recent ones to decode deltas against
+	MatchState state;
+	bool hasState;
+	SnapshotHistory history;
+	float roundTripMs;
+
+	unsigned char packetBuffer[NET_MAX_PACKET_SIZE];
+
+	void ReceivePackets();
+	void SendConnect();
+	void SendInputs();
+	void HandleSnapshot(const unsigned char* a_data, int a_size);
+	void Reconcile(const SnapshotPacket& a_snapshot);
+};
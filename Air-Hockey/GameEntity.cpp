@@ -1,5 +1,8 @@
 #include "GameEntity.h"
+#include "Mesh.h"
 
+unsigned int GameEntity::frameRebuilds = 0;
+unsigned int GameEntity::lastFrameRebuilds = 0;
 
 GameEntity::GameEntity()
 {
@@ -7,15 +10,12 @@ GameEntity::GameEntity()
 	entityRot = XMFLOAT3();
 	entityScale = XMFLOAT3();
 
-	XMMATRIX trans = XMMatrixTranslation(entityPos.x, entityPos.y, entityPos.z);
-	XMMATRIX rot = XMMatrixRotationRollPitchYawFromVector(XMLoadFloat3(&entityRot));
-	XMMATRIX scale = XMMatrixScaling(entityScale.x, entityScale.y, entityScale.z);
-
-	XMMATRIX world = scale * rot * trans;
-
-	XMStoreFloat4x4(&worldMatrix, XMMatrixTranspose(world));
-
+	entityMesh = 0;
+	material = 0;
 
+	worldDirty = true;
+	transforms = 0;
+	transform = INVALID_TRANSFORM;
 }
 
 GameEntity::GameEntity(Mesh* a_mesh, Material* a_mat)
@@ -29,21 +29,9 @@ GameEntity::GameEntity(Mesh* a_mesh, Material* a_mat)
 	entityRot = XMFLOAT3(0,0,0);
 	entityScale = XMFLOAT3(1,1,1);
 
-	XMMATRIX trans = XMMatrixTranslation(entityPos.x, entityPos.y, entityPos.z);
-	XMMATRIX rot = XMMatrixRotationRollPitchYawFromVector(XMLoadFloat3(&entityRot));
-	XMMATRIX scale = XMMatrixScaling(entityScale.x, entityScale.y, entityScale.z);
-
-	XMMATRIX world = scale * rot * trans;
-
-	XMStoreFloat4x4(&worldMatrix, XMMatrixTranspose(world));
-	
-	
-}
-
-void GameEntity::Release()
-{
-	delete entityMesh;
-	delete material;
+	worldDirty = true;
+	transforms = 0;
+	transform = INVALID_TRANSFORM;
 }
 
 Material* GameEntity::getMaterial()
@@ -53,6 +41,10 @@ Material* GameEntity::getMaterial()
 
 XMFLOAT4X4 GameEntity::GetWorldMatrix()
 {
+	if (transforms)
+		return transforms->GetWorldMatrix(transform);
+
+	UpdateWorldMatrix();
 	return worldMatrix;
 }
 
@@ -74,45 +66,35 @@ XMFLOAT3 GameEntity::GetScale()
 void GameEntity::SetWorldMatrix(XMMATRIX a_matrix)
 {
 	XMStoreFloat4x4(&worldMatrix, XMMatrixTranspose(a_matrix));
+	worldDirty = false;
 }
 
+//Setting the same value again (e.g. every frame from the network) doesn't dirty the matrix
 void GameEntity::SetPosition(float x, float y, float z)
 {
-	entityPos = XMFLOAT3(x, y, z);
+	if (entityPos.x == x && entityPos.y == y && entityPos.z == z)
+		return;
 
-	XMMATRIX trans = XMMatrixTranslation(x, y, z);
-	XMMATRIX rot = XMMatrixRotationRollPitchYawFromVector(XMLoadFloat3(&entityRot));
-	XMMATRIX scale = XMMatrixScaling(entityScale.x, entityScale.y, entityScale.z);
-
-	XMMATRIX world = scale * rot * trans;
-
-	XMStoreFloat4x4(&worldMatrix, XMMatrixTranspose(world));
+	entityPos = XMFLOAT3(x, y, z);
+	TransformChanged();
 }
 
 void GameEntity::SetRotation(float x, float y, float z)
 {
-	entityRot = XMFLOAT3(x, y, z);
+	if (entityRot.x == x && entityRot.y == y && entityRot.z == z)
+		return;
 
-	XMMATRIX trans = XMMatrixTranslation(entityPos.x, entityPos.y, entityPos.z);
-	XMMATRIX rot = XMMatrixRotationRollPitchYawFromVector(XMLoadFloat3(&entityRot));
-	XMMATRIX scale = XMMatrixScaling(entityScale.x, entityScale.y, entityScale.z);
-
-	XMMATRIX world = scale * rot * trans;
-
-	XMStoreFloat4x4(&worldMatrix, XMMatrixTranspose(world));
+	entityRot = XMFLOAT3(x, y, z);
+	TransformChanged();
 }
 
 void GameEntity::SetScale(float x, float y, float z)
 {
-	entityScale = XMFLOAT3(x, y, z);
+	if (entityScale.x == x && entityScale.y == y && entityScale.z == z)
+		return;
 
-	XMMATRIX trans = XMMatrixTranslation(entityPos.x, entityPos.y, entityPos.z);
-	XMMATRIX rot = XMMatrixRotationRollPitchYawFromVector(XMLoadFloat3(&entityRot));
-	XMMATRIX scale = XMMatrixScaling(x, y, z);
-
-	XMMATRIX world = scale * rot * trans;
-
-	XMStoreFloat4x4(&worldMatrix, XMMatrixTranspose(world));
+	entityScale = XMFLOAT3(x, y, z);
+	TransformChanged();
 }
 
 void GameEntity::MoveAbsolute(float x, float y, float z)
@@ -120,6 +102,7 @@ void GameEntity::MoveAbsolute(float x, float y, float z)
 	entityPos.x += x;
 	entityPos.y += y;
 	entityPos.z += z;
+	TransformChanged();
 }
 
 void GameEntity::MoveRelative(float x, float y, float z)
@@ -131,30 +114,116 @@ void GameEntity::MoveRelative(float x, float y, float z)
 	XMStoreFloat3(
 		&entityPos,
 		XMLoadFloat3(&entityPos) + direction);
+	TransformChanged();
 }
 
-void GameEntity::MoveForward(float dist)
+void GameEntity::TransformChanged()
 {
+	worldDirty = true;
 
+	if (transforms)
+	{
+		transforms->SetPosition(transform, entityPos.x, entityPos.y, entityPos.z);
+		transforms->SetRotation(transform, entityRot.x, entityRot.y, entityRot.z);
+		transforms->SetScale(transform, entityScale.x, entityScale.y, entityScale.z);
+	}
 }
 
-void GameEntity::Draw(ID3D11DeviceContext* a_context)
+void GameEntity::AttachTransform(TransformSystem* a_system)
 {
-	//Update World Matrix
-	UpdateWorldMatrix();
+	DetachTransform();
 
-	// Set buffers in the input assembler
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
+	transforms = a_system;
+	transform = transforms->Create();
+	TransformChanged();
+}
 
-	ID3D11Buffer* vBuffer = entityMesh->GetVertexBuffer();
-	ID3D11Buffer* iBuffer = entityMesh->GetIndexBuffer();
+void GameEntity::DetachTransform()
+{
+	if (!transforms)
+		return;
 
-	a_context->IASetVertexBuffers(0, 1, &vBuffer, &stride, &offset);
-	a_context->IASetIndexBuffer(iBuffer, DXGI_FORMAT_R32_UINT, 0);
+	transforms->Destroy(transform);
+	transforms = 0;
+	transform = INVALID_TRANSFORM;
+	worldDirty = true;
+}
+
+bool GameEntity::SetParent(GameEntity* a_parent)
+{
+	if (!transforms)
+		return false;
+
+	if (!a_parent)
+		return transforms->SetParent(transform, INVALID_TRANSFORM);
+
+	if (a_parent->transforms != transforms)
+		return false;
+
+	return transforms->SetParent(transform, a_parent->transform);
+}
+
+XMFLOAT3 GameEntity::GetWorldPosition()
+{
+	if (transforms)
+		return transforms->GetWorldPosition(transform);
+
+	//Stored transposed, so the translation is the last column; this
+	//way entities placed with SetWorldMatrix() know where they are too
+	XMFLOAT4X4 world = GetWorldMatrix();
+	return XMFLOAT3(world._14, world._24, world._34);
+}
+
+void GameEntity::GetWorldBounds(XMFLOAT3& a_center, XMFLOAT3& a_extents, float& a_radius)
+{
+	//Stored transposed for the shaders
+	XMFLOAT4X4 worldT = GetWorldMatrix();
+	XMMATRIX world = XMMatrixTranspose(XMLoadFloat4x4(&worldT));
+
+	XMFLOAT3 center = entityMesh->GetBoundsCenter();
+	XMFLOAT3 extents = entityMesh->GetBoundsExtents();
+	XMStoreFloat3(&a_center, XMVector3Transform(XMLoadFloat3(&center), world));
+
+	//Box around the rotated box: each world axis gathers every local axis' reach
+	XMVECTOR reach = XMVectorScale(XMVectorAbs(world.r[0]), extents.x);
+	reach = XMVectorAdd(reach, XMVectorScale(XMVectorAbs(world.r[1]), extents.y));
+	reach = XMVectorAdd(reach, XMVectorScale(XMVectorAbs(world.r[2]), extents.z));
+	XMStoreFloat3(&a_extents, reach);
+
+	//Sphere grows with the largest scale
+	float scaleSq = XMVectorGetX(XMVector3LengthSq(world.r[0]));
+	scaleSq = fmaxf(scaleSq, XMVectorGetX(XMVector3LengthSq(world.r[1])));
+	scaleSq = fmaxf(scaleSq, XMVectorGetX(XMVector3LengthSq(world.r[2])));
+	a_radius = entityMesh->GetBoundsRadius() * sqrtf(scaleSq);
+}
+
+bool GameEntity::IsVisible(const Frustum& a_frustum)
+{
+	if (!entityMesh)
+		return true;
+
+	XMFLOAT3 center;
+	XMFLOAT3 extents;
+	float radius;
+	GetWorldBounds(center, extents, radius);
+
+	//The sphere is cheaper and throws most things out; the box is tighter
+	return a_frustum.IntersectsSphere(center, radius) && a_frustum.IntersectsBox(center, extents);
+}
+
+void GameEntity::MoveForward(float dist)
+{
+
+}
+
+void GameEntity::Draw(RenderBackend* a_backend)
+{
+	// Set buffers in the input assembler
+	a_backend->SetVertexBuffer(entityMesh->GetVertexBuffer(), sizeof(Vertex), 0);
+	a_backend->SetIndexBuffer(entityMesh->GetIndexBuffer());
 
 	// Finally do the actual drawing
-	a_context->DrawIndexed(
+	a_backend->DrawIndexed(
 		entityMesh->GetIndexCount(),     // The number of indices to use (we could draw a subset if we wanted)
 		0,     // Offset to the first index we want to use
 		0);    // Offset to add to each index when looking up vertices
@@ -162,6 +231,9 @@ void GameEntity::Draw(ID3D11DeviceContext* a_context)
 
 void GameEntity::UpdateWorldMatrix()
 {
+	if (!worldDirty)
+		return;
+
 	XMMATRIX trans = XMMatrixTranslation(entityPos.x, entityPos.y, entityPos.z);
 	XMMATRIX rot = XMMatrixRotationRollPitchYawFromVector(XMLoadFloat3(&entityRot));
 	XMMATRIX scale = XMMatrixScaling(entityScale.x, entityScale.y, entityScale.z);
@@ -169,31 +241,14 @@ void GameEntity::UpdateWorldMatrix()
 	XMMATRIX world = scale * rot * trans;
 
 	XMStoreFloat4x4(&worldMatrix, XMMatrixTranspose(world));
+
+	worldDirty = false;
+	frameRebuilds++;
 }
 
-void GameEntity::PrepareMaterial(XMFLOAT4X4 a_viewMat, XMFLOAT4X4 a_projMat)
-{
-	
-	SimpleVertexShader* vShader = material->getVertexShader();
-	SimplePixelShader* pShader = material->getPixelShader();
-	// Send data to shader variables
-	//  - Do this ONCE PER OBJECT you're drawing
-	//  - This is actually a complex process of copying data to a local buffer
-	//    and then copying that entire buffer to the GPU.  
-	//  - The "SimpleShader" class handles all of that for you.
-	vShader->SetMatrix4x4("world", worldMatrix);
-	vShader->SetMatrix4x4("view", a_viewMat);
-	vShader->SetMatrix4x4("projection", a_projMat);
-
-	// Once you've set all of the data you care to change for
-	// the next draw call, you need to actually send it to the GPU
-	//  - If you skip this, the "SetMatrix" calls above won't make it to the GPU!
-	vShader->CopyAllBufferData();
-	pShader->CopyAllBufferData();
-	// Set the vertex and pixel shaders to use for the next Draw() command
-	//  - These don't technically need to be set every frame...YET
-	//  - Once you start applying different shaders to different objects,
-	//    you'll need to swap the current shaders before each draw
-	vShader->SetShader();
-	pShader->SetShader();
+//Call once at the start of each frame
+void GameEntity::BeginFrame()
+{
+	lastFrameRebuilds = frameRebuilds;
+	frameRebuilds = 0;
 }
@@ -1,19 +1,21 @@
 #pragma once
-#include <d3d11.h>
 #include <DirectXMath.h>
-#include "Mesh.h"
-#include "SimpleShader.h"
-#include "Material.h"
+#include "TransformSystem.h"
+#include "Frustum.h"
 
 using namespace DirectX;
 
+// Only held by pointer here, so the simulation (Match, Puck,
+// Paddle) builds without the mesh, shader and D3D headers
+class Mesh;
+class Material;
+class RenderBackend;
+
 class GameEntity
 {  
 public:
 	GameEntity();
 	GameEntity(Mesh* a_mesh, Material* a_mat);
-	
-	void Release();
 
 	/* Gets and Sets */
 	XMFLOAT4X4 GetWorldMatrix();
@@ -21,6 +23,7 @@ public:
 	XMFLOAT3 GetRotation();
 	XMFLOAT3 GetScale();
 	Material* getMaterial();
+	Mesh* GetMesh() { return entityMesh; }
 	void SetWorldMatrix(XMMATRIX a_matrix);
 	void SetPosition(float x, float y, float z);
 	void SetRotation(float x, float y, float z);
@@ -32,13 +35,32 @@ public:
 	void MoveForward(float dist);
 
 	/*Drawing Methods*/
-	void Draw(ID3D11DeviceContext* a_context);
+	void Draw(RenderBackend* a_backend);
+
+	/*The mesh's bounds moved into the world with this entity*/
+	void GetWorldBounds(XMFLOAT3& a_center, XMFLOAT3& a_extents, float& a_radius);
+
+	/*False if the entity is certainly outside (entities without a mesh never are)*/
+	bool IsVisible(const Frustum& a_frustum);
 
-	/*Update WorldMatrix*/
+	/*Update WorldMatrix (only rebuilds if something moved)*/
 	void UpdateWorldMatrix();
 
-	/*Materials*/
-	void PrepareMaterial(XMFLOAT4X4 a_viewMat, XMFLOAT4X4 a_projMat);
+	/*Shared transforms: the entity's matrix is then built by the
+	  system in batches with everything else attached to it*/
+	void AttachTransform(TransformSystem* a_system);
+	void DetachTransform();
+
+	/*Makes this entity's transform local to a_parent (0 to unparent).
+	  Both must be attached to the same system*/
+	bool SetParent(GameEntity* a_parent);
+
+	/*Where the entity ends up once its parents are applied*/
+	XMFLOAT3 GetWorldPosition();
+
+	/*Transform counters*/
+	static void BeginFrame();
+	static unsigned int GetWorldRebuilds() { return lastFrameRebuilds; }
 
 protected:
 	//WorldMatrix
@@ -47,10 +69,25 @@ protected:
 	XMFLOAT3 entityRot;
 	XMFLOAT3 entityScale;
 
+	//Set whenever pos/rot/scale change; the matrix is rebuilt when next asked for
+	bool worldDirty;
+
+	//Call after changing entityPos/Rot/Scale directly
+	void TransformChanged();
+
+	//Where the world matrix lives when attached
+	TransformSystem* transforms;
+	TransformHandle transform;
+
 	//Mesh
 	Mesh* entityMesh;
 
 	//SimpleShaders
 	Material* material;
+
+private:
+	//Rebuilds this frame so far, and in the last full frame
+	static unsigned int frameRebuilds;
+	static unsigned int lastFrameRebuilds;
 };
 
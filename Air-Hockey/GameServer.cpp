@@ -0,0 +1,89 @@
+#include "GameServer.h"
+
+// Caps on work per Update() so a flood of packets or a long
+// hitch can't stall the server
+static const int MAX_PACKETS_PER_UPDATE = 256;
+static const int RECEIVE_BATCH_SIZE = 32;
+static const int MAX_TICKS_PER_UPDATE = 8;
+
+GameServer::GameServer()
+{
+	match = 0;
+	accumulator = 0.0f;
+	packets = new PacketBatch(RECEIVE_BATCH_SIZE, NET_MAX_PACKET_SIZE);
+}
+
+GameServer::~GameServer()
+{
+	Stop();
+	delete packets;
+}
+
+bool GameServer::Start(uint16_t a_port, uint16_t a_matchID)
+{
+	Stop();
+
+	if (!socket.Open(a_port))
+		return false;
+
+	match = new ServerMatch(a_matchID);
+	accumulator = 0.0f;
+	return true;
+}
+
+void GameServer::Stop()
+{
+	socket.Close();
+
+	delete match;
+	match = 0;
+}
+
+void GameServer::ReceivePackets()
+{
+	for (int received = 0; received < MAX_PACKETS_PER_UPDATE;)
+	{
+		int count = socket.ReceiveBatch(*packets);
+		if (count == 0)
+			break;
+
+		for (int i = 0; i < count; i++)
+		{
+			int size = packets->GetSize(i);
+			if (size < (int)sizeof(NetHeader))
+				continue;
+
+			const NetHeader* header = (const NetHeader*)packets->GetData(i);
+			if (header->MatchID == match->GetID())
+				match->HandlePacket(packets->GetAddress(i), packets->GetData(i), size, &socket, &simulator);
+		}
+		received += count;
+	}
+}
+
+void GameServer::Update(float dt)
+{
+	if (!match)
+		return;
+
+	ReceivePackets();
+
+	accumulator += dt;
+
+	uint32_t now = NetTimeMs();
+
+	int ticks = 0;
+	while (accumulator >= NET_TICK_DT && ticks < MAX_TICKS_PER_UPDATE)
+	{
+		match->Tick(now);
+		match->SendSnapshots(&socket, &simulator);
+		accumulator -= NET_TICK_DT;
+		ticks++;
+	}
+
+	//Too far behind to catch up, drop the extra time
+	if (ticks == MAX_TICKS_PER_UPDATE)
+		accumulator = 0.0f;
+
+	simulator.Flush(&socket);
+}
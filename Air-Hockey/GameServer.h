@@ -0,0 +1,33 @@
+#pragma once
+#include "ServerMatch.h"
+
+// --------------------------------------------------------
+// Authoritative server for a single match.  Owns the socket
+// and ticks the match at NET_TICK_RATE no matter how often
+// Update() is called.
+// --------------------------------------------------------
+class GameServer
+{
+public:
+	GameServer();
+	~GameServer();
+
+	bool Start(uint16_t a_port, uint16_t a_matchID);
+	void Stop();
+
+	void Update(float dt);
+
+	uint16_t GetPort() { return socket.GetPort(); }
+	ServerMatch* GetMatch() { return match; }
+	LatencySimulator* GetSimulator() { return &simulator; }
+
+private:
+	UdpSocket socket;
+	LatencySimulator simulator;
+	ServerMatch* match;
+	float accumulator;
+
+	PacketBatch* packets;
+
+	void ReceivePackets();
+};
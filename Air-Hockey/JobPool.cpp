@@ -0,0 +1,112 @@
+#include "JobPool.h"
+
+JobPool::JobPool(int a_threads)
+{
+	quitting = false;
+	jobCount = 0;
+	chunkSize = 1;
+	chunkCount = 0;
+	generation = 0;
+	activeWorkers = 0;
+	nextChunk = 0;
+	chunksDone = 0;
+
+	if (a_threads <= 0)
+		a_threads = (int)std::thread::hardware_concurrency() - 1;
+
+	for (int i = 0; i < a_threads; i++)
+		workers.push_back(std::thread(&JobPool::WorkerLoop, this));
+}
+
+JobPool::~JobPool()
+{
+	{
+		std::lock_guard<std::mutex> hold(lock);
+		quitting = true;
+	}
+	wake.notify_all();
+
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+void JobPool::ParallelFor(int a_count, int a_chunkSize, const std::function<void(int, int)>& a_job)
+{
+	if (a_count <= 0)
+		return;
+
+	//Not worth waking anyone for
+	if (workers.empty() || a_count <= a_chunkSize)
+	{
+		a_job(0, a_count);
+		return;
+	}
+
+	std::unique_lock<std::mutex> hold(lock);
+
+	//Workers that woke late for the last job must leave it first
+	idle.wait(hold, [this] { return activeWorkers == 0; });
+
+	job = a_job;
+	jobCount = a_count;
+	chunkSize = a_chunkSize;
+	chunkCount = (a_count + a_chunkSize - 1) / a_chunkSize;
+	nextChunk = 0;
+	chunksDone = 0;
+	generation++;
+
+	hold.unlock();
+	wake.notify_all();
+
+	RunChunks();
+
+	hold.lock();
+	idle.wait(hold, [this] { return chunksDone == chunkCount; });
+}
+
+void JobPool::RunChunks()
+{
+	for (;;)
+	{
+		int chunk = nextChunk.fetch_add(1);
+		if (chunk >= chunkCount)
+			return;
+
+		int first = chunk * chunkSize;
+		int last = first + chunkSize < jobCount ? first + chunkSize : jobCount;
+		job(first, last);
+
+		//Taking the lock first means the caller can't miss the wakeup
+		if (chunksDone.fetch_add(1) + 1 == chunkCount)
+		{
+			{
+				std::lock_guard<std::mutex> hold(lock);
+			}
+			idle.notify_all();
+		}
+	}
+}
+
+void JobPool::WorkerLoop()
+{
+	uint64_t seen = 0;
+
+	for (;;)
+	{
+		std::unique_lock<std::mutex> hold(lock);
+		wake.wait(hold, [this, seen] { return quitting || generation != seen; });
+		if (quitting)
+			return;
+
+		seen = generation;
+		activeWorkers++;
+		hold.unlock();
+
+		RunChunks();
+
+		hold.lock();
+		activeWorkers--;
+		hold.unlock();
+		idle.notify_all();
+	}
+}
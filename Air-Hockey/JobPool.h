@@ -0,0 +1,48 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------
+// A few worker threads that split loops into chunks.  The
+// calling thread works too, and ParallelFor() only returns
+// once every chunk is done, so callers see plain blocking
+// loops that happen to run on several cores.
+// --------------------------------------------------------
+class JobPool
+{
+public:
+	// 0 threads = one per core besides the caller
+	JobPool(int a_threads = 0);
+	~JobPool();
+
+	// Calls a_job(first, last) over [0, a_count) in chunks of a_chunkSize
+	void ParallelFor(int a_count, int a_chunkSize, const std::function<void(int, int)>& a_job);
+
+	// Workers plus the calling thread
+	int GetThreadCount() { return (int)workers.size() + 1; }
+
+private:
+	std::vector<std::thread> workers;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable idle;
+	bool quitting;
+
+	//The job being run; only changed while no worker is inside it
+	std::function<void(int, int)> job;
+	int jobCount;
+	int chunkSize;
+	int chunkCount;
+	uint64_t generation;
+	int activeWorkers;
+	std::atomic<int> nextChunk;
+	std::atomic<int> chunksDone;
+
+	void WorkerLoop();
+	void RunChunks();
+};
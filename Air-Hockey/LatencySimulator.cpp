@@ -0,0 +1,94 @@
+#include "LatencySimulator.h"
+#include <cstring>
+
+LatencySimulator::LatencySimulator()
+{
+	delayed = new DelayedPacket[MAX_DELAYED];
+	delayedCount = 0;
+	latencyMs = 0;
+	jitterMs = 0;
+	lossPercent = 0.0f;
+	droppedCount = 0;
+	randomState = 0x2545F491;
+}
+
+LatencySimulator::~LatencySimulator()
+{
+	delete[] delayed;
+}
+
+void LatencySimulator::SetConditions(int a_latencyMs, int a_jitterMs, float a_lossPercent)
+{
+	latencyMs = a_latencyMs;
+	jitterMs = a_jitterMs;
+	lossPercent = a_lossPercent;
+}
+
+//Xorshift, so every simulator has its own repeatable sequence
+unsigned int LatencySimulator::NextRandom()
+{
+	randomState ^= randomState << 13;
+	randomState ^= randomState >> 17;
+	randomState ^= randomState << 5;
+	return randomState;
+}
+
+void LatencySimulator::Send(UdpSocket* a_socket, const NetAddress& a_to, const void* a_data, int a_size)
+{
+	if (IsPassthrough())
+	{
+		a_socket->Queue(a_to, a_data, a_size);
+		return;
+	}
+
+	//Lost on the way
+	if ((NextRandom() % 10000) < (unsigned int)(lossPercent * 100.0f))
+	{
+		droppedCount++;
+		return;
+	}
+
+	//A full queue behaves like a full router buffer
+	if (delayedCount == MAX_DELAYED || a_size > NET_MAX_PACKET_SIZE)
+	{
+		droppedCount++;
+		return;
+	}
+
+	int delay = latencyMs;
+	if (jitterMs > 0)
+		delay += (int)(NextRandom() % (unsigned int)(2 * jitterMs + 1)) - jitterMs;
+	if (delay < 0)
+		delay = 0;
+
+	DelayedPacket& packet = delayed[delayedCount++];
+	packet.To = a_to;
+	packet.DeliverAtMs = NetTimeMs() + delay;
+	packet.Size = a_size;
+	memcpy(packet.Data, a_data, a_size);
+}
+
+void LatencySimulator::Flush(UdpSocket* a_socket)
+{
+	uint32_t now = NetTimeMs();
+
+	for (int i = 0; i < delayedCount;)
+	{
+		DelayedPacket& packet = delayed[i];
+		if ((int32_t)(now - packet.DeliverAtMs) >= 0)
+		{
+			a_socket->Queue(packet.To, packet.Data, packet.Size);
+
+			//Swap the last one in; jitter reorders packets anyway
+			if (i != delayedCount - 1)
+				packet = delayed[delayedCount - 1];
+			delayedCount--;
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	a_socket->Flush();
+}
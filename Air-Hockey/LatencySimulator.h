@@ -0,0 +1,51 @@
+#pragma once
+#include "NetSocket.h"
+#include "NetProtocol.h"
+
+// --------------------------------------------------------
+// Sits between the game and a UdpSocket and holds outgoing
+// packets back to fake latency, jitter and packet loss.
+// With everything at zero, packets wait only for the next
+// Flush(), which sends them as one batch.
+// --------------------------------------------------------
+class LatencySimulator
+{
+public:
+	LatencySimulator();
+	~LatencySimulator();
+
+	void SetConditions(int a_latencyMs, int a_jitterMs, float a_lossPercent);
+	bool IsPassthrough() { return latencyMs == 0 && jitterMs == 0 && lossPercent <= 0.0f; }
+
+	// Queues (or drops) a packet; it goes out on a later Flush()
+	void Send(UdpSocket* a_socket, const NetAddress& a_to, const void* a_data, int a_size);
+
+	// Sends every queued packet whose delivery time has come, and
+	// everything queued on the socket, in one batch
+	void Flush(UdpSocket* a_socket);
+
+	int GetDroppedCount() { return droppedCount; }
+
+private:
+	struct DelayedPacket
+	{
+		NetAddress To;
+		uint32_t DeliverAtMs;
+		int Size;
+		unsigned char Data[NET_MAX_PACKET_SIZE];
+	};
+
+	static const int MAX_DELAYED = 256;
+
+	//Preallocated so the simulator never allocates per packet
+	DelayedPacket* delayed;
+	int delayedCount;
+
+	int latencyMs;
+	int jitterMs;
+	float lossPercent;
+	int droppedCount;
+	unsigned int randomState;
+
+	unsigned int NextRandom();
+};
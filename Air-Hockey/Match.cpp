@@ -0,0 +1,97 @@
+#include "Match.h"
+
+
+Match::Match() : puck(0, 0), paddle1(0, 0), paddle2(0, 0)
+{
+	Reset();
+}
+
+Match::~Match()
+{
+}
+
+void Match::Reset()
+{
+	ConfigurePaddle(&paddle1, 0);
+	ConfigurePaddle(&paddle2, 1);
+
+	puck.SetScale(0.5f, 0.1f, 0.5f);
+	puck.SetPosition(0.0f, -.2f, 0.0f);
+	puck.setDirection(1.0f, 0.0f, 1.0f);
+
+	score[0] = 0;
+	score[1] = 0;
+	tick = 0;
+}
+
+void Match::ConfigurePaddle(Paddle* a_paddle, int a_slot)
+{
+	a_paddle->SetScale(0.5f, 0.5f, 0.5f);
+
+	if (a_slot == 0)
+	{
+		a_paddle->SetPosition(-2.5f, -0.225f, 0.0f);
+		a_paddle->SetBounds(-3.2f, -0.8f, -1.2f, 1.2f);
+	}
+	else
+	{
+		a_paddle->SetPosition(2.5f, -0.225f, 0.0f);
+		a_paddle->SetBounds(0.8f, 2.8f, -1.2f, 1.2f);
+	}
+}
+
+int Match::Step(float dt, unsigned char a_p1Buttons, unsigned char a_p2Buttons)
+{
+	tick++;
+
+	//Puck Movement and Collision
+	puck.Update(dt);
+	puck.CollisionDetection(&paddle1);
+	puck.CollisionDetection(&paddle2);
+
+	//Paddle Movement
+	paddle1.ApplyInput(a_p1Buttons, dt);
+	paddle2.ApplyInput(a_p2Buttons, dt);
+
+	int scorer = puck.checkScore();
+	if (scorer == 1 || scorer == 2)
+		score[scorer - 1]++;
+
+	return scorer;
+}
+
+void Match::GetState(MatchState& a_state)
+{
+	a_state.Tick = tick;
+	a_state.PuckX = puck.GetPosition().x;
+	a_state.PuckZ = puck.GetPosition().z;
+	a_state.PuckDirX = puck.getDirecton().x;
+	a_state.PuckDirZ = puck.getDirecton().z;
+
+	for (int i = 0; i < NET_PLAYERS_PER_MATCH; i++)
+	{
+		Paddle* paddle = GetPaddle(i);
+		a_state.PaddleX[i] = paddle->GetPosition().x;
+		a_state.PaddleZ[i] = paddle->GetPosition().z;
+		a_state.Score[i] = (uint8_t)score[i];
+	}
+}
+
+void Match::Interpolate(const MatchState& a_from, const MatchState& a_to, float a_alpha, MatchState& a_state)
+{
+	a_state = a_to;
+
+	for (int i = 0; i < NET_PLAYERS_PER_MATCH; i++)
+	{
+		if (a_from.Score[i] != a_to.Score[i])
+			return;
+	}
+
+	a_state.PuckX = a_from.PuckX + (a_to.PuckX - a_from.PuckX) * a_alpha;
+	a_state.PuckZ = a_from.PuckZ + (a_to.PuckZ - a_from.PuckZ) * a_alpha;
+	for (int i = 0; i < NET_PLAYERS_PER_MATCH; i++)
+	{
+		a_state.PaddleX[i] = a_from.PaddleX[i] + (a_to.PaddleX[i] - a_from.PaddleX[i]) * a_alpha;
+		a_state.PaddleZ[i] = a_from.PaddleZ[i] + (a_to.PaddleZ[i] - a_from.PaddleZ[i]) * a_alpha;
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "Puck.h"
+#include "Paddle.h"
+#include "NetProtocol.h"
+
+// Local play steps the match at this rate, whatever the frame rate
+// (the online server ticks at NET_TICK_RATE), and at most a tenth
+// of a second's worth of steps in one frame
+const int MATCH_STEP_RATE = 240;
+const float MATCH_STEP_DT = 1.0f / MATCH_STEP_RATE;
+const int MATCH_MAX_STEPS = MATCH_STEP_RATE / 10;
+
+// --------------------------------------------------------
+// The gameplay of one air hockey match with no rendering:
+// the puck, both paddles and the score.  Used for local
+// play, by the online server and for client prediction.
+// --------------------------------------------------------
+class Match
+{
+public:
+	Match();
+	~Match();
+
+	// Puts the paddles and puck back at the start and clears the score
+	void Reset();
+
+	// Advances the match by dt.  Returns 1 or 2 if that player scored.
+	int Step(float dt, unsigned char a_p1Buttons, unsigned char a_p2Buttons);
+
+	void GetState(MatchState& a_state);
+
+	// a_alpha of the way from a_from to a_to, for drawing between two
+	// steps.  Just a_to if someone scored in between (the puck was reset)
+	static void Interpolate(const MatchState& a_from, const MatchState& a_to, float a_alpha, MatchState& a_state);
+
+	Puck* GetPuck() { return &puck; }
+	Paddle* GetPaddle(int a_slot) { return a_slot == 0 ? &paddle1 : &paddle2; }
+	int GetScore(int a_slot) { return score[a_slot]; }
+	uint32_t GetTick() { return tick; }
+
+	// Gives a paddle the size, start position and half of the rink for a slot
+	static void ConfigurePaddle(Paddle* a_paddle, int a_slot);
+
+private:
+	Puck puck;
+	Paddle paddle1;
+	Paddle paddle2;
+	int score[NET_PLAYERS_PER_MATCH];
+	uint32_t tick;
+};
@@ -1,14 +1,16 @@
 #include "Mesh.h"
 
+#ifndef _WIN32
+#define sscanf_s sscanf
+#endif
 
-
-Mesh::Mesh(Vertex * a_vertices, int a_numOfVert, UINT * a_indices, int a_numOfInd, ID3D11Device * a_device)
+Mesh::Mesh(char * meshData, RenderBackend * a_backend)
 {
-	BufferCreation(a_vertices, a_numOfVert, a_indices, a_numOfInd, a_device);
-}
+	owner = a_backend;
+	vertexBuffer = 0;
+	indexBuffer = 0;
+	numOfIndices = 0;
 
-Mesh::Mesh(char * meshData, ID3D11Device * a_device)
-{
 	// File input object
 	std::ifstream obj(meshData);
 
@@ -21,7 +23,7 @@ Mesh::Mesh(char * meshData, ID3D11Device * a_device)
 	std::vector<XMFLOAT3> normals;       // Normals from the file
 	std::vector<XMFLOAT2> uvs;           // UVs from the file
 	std::vector<Vertex> verts;           // Verts we're assembling
-	std::vector<UINT> indices;           // Indices of these verts
+	std::vector<unsigned int> indices;           // Indices of these verts
 	unsigned int vertCounter = 0;        // Count of vertices/indices
 	char chars[100];                     // String for line reading
 
@@ -178,18 +180,34 @@ Mesh::Mesh(char * meshData, ID3D11Device * a_device)
 	//    an index buffer in this case?  Sure!  Though, if your mesh class assumes you have
 	//    one, you'll need to write some extra code to handle cases when you don't.
 
-	BufferCreation(&verts[0], vertCounter, &indices[0], vertCounter, a_device);
+	BufferCreation(&verts[0], vertCounter, &indices[0], vertCounter);
+}
+
+Mesh::Mesh(Vertex * a_vertices, int a_numOfVert, unsigned int * a_indices, int a_numOfInd, RenderBackend * a_backend)
+{
+	owner = a_backend;
+	BufferCreation(a_vertices, a_numOfVert, a_indices, a_numOfInd);
 }
 
 Mesh::Mesh()
 {
+	vertexBuffer = 0;
+	indexBuffer = 0;
+	numOfIndices = 0;
+	owner = 0;
+	boundsCenter = XMFLOAT3(0, 0, 0);
+	boundsExtents = XMFLOAT3(0, 0, 0);
+	boundsRadius = 0;
 }
 
 
 Mesh::~Mesh()
 {
-	vertexBuffer->Release();
-	indexBuffer->Release();
+	if (!owner)
+		return;
+
+	owner->ReleaseBuffer(vertexBuffer);
+	owner->ReleaseBuffer(indexBuffer);
 }
 
 ID3D11Buffer * Mesh::GetVertexBuffer()
@@ -207,57 +225,57 @@ int Mesh::GetIndexCount()
 	return numOfIndices;
 }
 
-void Mesh::BufferCreation(Vertex * a_vertices, int a_numOfVert, UINT * a_indices, int a_numOfInd, ID3D11Device * a_device)
+void Mesh::BufferCreation(Vertex * a_vertices, int a_numOfVert, unsigned int * a_indices, int a_numOfInd)
 {
 	// Make sure we have tangents for normal mapping
 	CalculateTangents(a_vertices, a_numOfVert, a_indices, a_numOfInd);
 
+	// Positions are gone once they're in the buffer, so measure them now
+	CalculateBounds(a_vertices, a_numOfVert);
+
 	numOfIndices = a_numOfInd;
 
-	// Create the VERTEX BUFFER description -----------------------------------
-	// - The description is created on the stack because we only need
-	//    it to create the buffer.  The description is then useless.
-	D3D11_BUFFER_DESC vbd;
-	vbd.Usage = D3D11_USAGE_IMMUTABLE;
-	vbd.ByteWidth = sizeof(Vertex) * a_numOfVert;       // 3 = number of vertices in the buffer
-	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER; // Tells DirectX this is a vertex buffer
-	vbd.CPUAccessFlags = 0;
-	vbd.MiscFlags = 0;
-	vbd.StructureByteStride = 0;
-
-	// Create the proper struct to hold the initial vertex data
-	// - This is how we put the initial data into the buffer
-	D3D11_SUBRESOURCE_DATA initialVertexData;
-	initialVertexData.pSysMem = a_vertices;
-
-	// Actually create the buffer with the initial data
-	// - Once we do this, we'll NEVER CHANGE THE BUFFER AGAIN
-	a_device->CreateBuffer(&vbd, &initialVertexData, &vertexBuffer);
-
-
-
-	// Create the INDEX BUFFER description ------------------------------------
-	// - The description is created on the stack because we only need
-	//    it to create the buffer.  The description is then useless.
-	D3D11_BUFFER_DESC ibd;
-	ibd.Usage = D3D11_USAGE_IMMUTABLE;
-	ibd.ByteWidth = sizeof(int) * a_numOfInd;         // 3 = number of indices in the buffer
-	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER; // Tells DirectX this is an index buffer
-	ibd.CPUAccessFlags = 0;
-	ibd.MiscFlags = 0;
-	ibd.StructureByteStride = 0;
-
-	// Create the proper struct to hold the initial index data
-	// - This is how we put the initial data into the buffer
-	D3D11_SUBRESOURCE_DATA initialIndexData;
-	initialIndexData.pSysMem = a_indices;
-
-	// Actually create the buffer with the initial data
-	// - Once we do this, we'll NEVER CHANGE THE BUFFER AGAIN
-	a_device->CreateBuffer(&ibd, &initialIndexData, &indexBuffer);
+	// Neither buffer ever changes again, so the backend makes them immutable
+	vertexBuffer = owner->CreateBuffer(RENDER_BUFFER_VERTEX, sizeof(Vertex) * a_numOfVert, a_vertices, false);
+	indexBuffer = owner->CreateBuffer(RENDER_BUFFER_INDEX, sizeof(unsigned int) * a_numOfInd, a_indices, false);
+}
+
+void Mesh::CalculateBounds(Vertex * a_vertices, int a_numOfVert)
+{
+	if (a_numOfVert <= 0)
+	{
+		boundsCenter = XMFLOAT3(0, 0, 0);
+		boundsExtents = XMFLOAT3(0, 0, 0);
+		boundsRadius = 0;
+		return;
+	}
+
+	XMVECTOR minimum = XMLoadFloat3(&a_vertices[0].Position);
+	XMVECTOR maximum = minimum;
+	for (int i = 1; i < a_numOfVert; i++)
+	{
+		XMVECTOR position = XMLoadFloat3(&a_vertices[i].Position);
+		minimum = XMVectorMin(minimum, position);
+		maximum = XMVectorMax(maximum, position);
+	}
+
+	XMVECTOR center = XMVectorScale(XMVectorAdd(minimum, maximum), 0.5f);
+	XMStoreFloat3(&boundsCenter, center);
+	XMStoreFloat3(&boundsExtents, XMVectorScale(XMVectorSubtract(maximum, minimum), 0.5f));
+
+	// Tighter than the box's corner for round meshes like the puck
+	float radiusSq = 0;
+	for (int i = 0; i < a_numOfVert; i++)
+	{
+		XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&a_vertices[i].Position), center);
+		float distanceSq = XMVectorGetX(XMVector3LengthSq(offset));
+		if (distanceSq > radiusSq)
+			radiusSq = distanceSq;
+	}
+	boundsRadius = sqrtf(radiusSq);
 }
 
-void Mesh::CalculateTangents(Vertex * a_vertices, int a_numOfVert, UINT * a_indices, int a_numOfInd)
+void Mesh::CalculateTangents(Vertex * a_vertices, int a_numOfVert, unsigned int * a_indices, int a_numOfInd)
 {
 	// Reset tangents
 	for (int i = 0; i < a_numOfVert; i++)
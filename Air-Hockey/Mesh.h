@@ -1,15 +1,17 @@
 #pragma once
-#include <d3d11.h>
 #include "Vertex.h"
+#include "RenderBackend.h"
 #include <fstream>
 #include <vector>
 using namespace DirectX;
 
+// Buffers are made (and released) through a RenderBackend,
+// so meshes build without the D3D headers
 class Mesh
 {
 public:
-	Mesh(Vertex* a_vertices, int a_numOfVert, UINT* a_indices, int a_numOfInd, ID3D11Device* a_device);
-	Mesh(char* meshData, ID3D11Device * a_device);
+	Mesh(char* meshData, RenderBackend* a_backend);
+	Mesh(Vertex* a_vertices, int a_numOfVert, unsigned int* a_indices, int a_numOfInd, RenderBackend* a_backend);
 	Mesh();
 	
 	~Mesh();
@@ -17,13 +19,28 @@ public:
 	ID3D11Buffer* GetVertexBuffer();
 	ID3D11Buffer* GetIndexBuffer();
 	int GetIndexCount();
-	void BufferCreation(Vertex * a_vertices, int a_numOfVert, UINT * a_indices, int a_numOfInd, ID3D11Device * a_device);
-	void CalculateTangents(Vertex* a_vertices, int a_numOfVert, UINT* a_indices, int a_numOfInd);
+	void BufferCreation(Vertex * a_vertices, int a_numOfVert, unsigned int * a_indices, int a_numOfInd);
+	void CalculateTangents(Vertex* a_vertices, int a_numOfVert, unsigned int* a_indices, int a_numOfInd);
+
+	/*Bounds in model space, found when the buffers are made*/
+	XMFLOAT3 GetBoundsCenter() { return boundsCenter; }
+	XMFLOAT3 GetBoundsExtents() { return boundsExtents; }
+	float GetBoundsRadius() { return boundsRadius; }
 
 private:
 	ID3D11Buffer* vertexBuffer;
 	ID3D11Buffer* indexBuffer;
 
 	int numOfIndices;
+
+	//Made the buffers; they go back to it
+	RenderBackend* owner;
+
+	//Box (center and half size) and a sphere around the same center
+	XMFLOAT3 boundsCenter;
+	XMFLOAT3 boundsExtents;
+	float boundsRadius;
+
+	void CalculateBounds(Vertex* a_vertices, int a_numOfVert);
 };
 
@@ -0,0 +1,140 @@
+#pragma once
+#include <cstdint>
+
+// --------------------------------------------------------
+// Wire format for online play.  Packet headers are plain
+// structs sent as-is, so both ends must share endianness
+// (x86/x64).  Game state is bit-packed by SnapshotCodec.
+// --------------------------------------------------------
+
+// Fixed simulation and network rate of the authoritative server
+const int NET_TICK_RATE = 120;
+const float NET_TICK_DT = 1.0f / NET_TICK_RATE;
+
+const uint16_t NET_DEFAULT_PORT = 27015;
+const int NET_MAX_PACKET_SIZE = 1200;
+
+// Every input packet re-sends this many of the newest unacknowledged
+// inputs, so a single lost packet never loses an input
+const int NET_INPUT_REDUNDANCY = 8;
+
+// Per-client limits that keep server bandwidth and CPU bounded
+const int NET_MAX_INPUTS_PER_TICK = 2;		// Inputs applied per client per tick (catch-up rate)
+const int NET_INPUT_QUEUE_SIZE = 32;		// Inputs buffered per client before dropping
+const int NET_SNAPSHOT_BYTES_PER_SEC = 16 * 1024;
+
+const int NET_PLAYERS_PER_MATCH = 2;
+
+// Spectating.  Every NET_KEYFRAME_INTERVAL ticks becomes a keyframe, and
+// the relay keeps the newest NET_SPECTATOR_BASELINES of them to encode
+// deltas against.  Subscriptions are kept alive by re-sending NET_SPECTATE
+const int NET_KEYFRAME_INTERVAL = 32;
+const int NET_SPECTATOR_BASELINES = 4;
+const uint32_t NET_SPECTATE_KEEPALIVE_MS = 1000;
+const uint32_t NET_SPECTATE_TIMEOUT_MS = 5000;
+const int NET_MAX_MATCH_RELAYS = 4;		// Relays one match will stream to
+
+// The dedicated server splits matches across shards, each on its own
+// port.  A match always lives on the shard picked by its id
+inline int NetShardForMatch(uint16_t matchID, int shardCount)
+{
+	return matchID % shardCount;
+}
+
+inline uint16_t NetShardPort(uint16_t basePort, uint16_t matchID, int shardCount)
+{
+	return (uint16_t)(basePort + NetShardForMatch(matchID, shardCount));
+}
+
+enum NetPacketType
+{
+	NET_CONNECT = 1,
+	NET_ACCEPT,
+	NET_INPUT,
+	NET_SNAPSHOT,
+	NET_DISCONNECT,
+	NET_SPECTATE,			// Spectator -> relay, relay -> server: subscribe and keep alive
+	NET_MATCH_STATE,		// Server -> relay: full state every tick
+	NET_SPECTATOR_STATE		// Relay -> spectators: state delta-encoded against a keyframe
+};
+
+#pragma pack(push, 1)
+
+struct NetHeader
+{
+	uint8_t Type;
+	uint8_t Slot;		// Player slot in the match (0 or 1)
+	uint16_t MatchID;
+};
+
+// One tick of paddle input from a client
+struct NetInputCommand
+{
+	uint32_t Sequence;
+	uint8_t Buttons;	// PaddleInput bits
+};
+
+struct ConnectPacket
+{
+	NetHeader Header;	// Slot is the requested slot
+};
+
+struct InputPacket
+{
+	NetHeader Header;
+	uint32_t ClientTimeMs;	// Echoed back in snapshots for round trip time
+	uint32_t AckTick;		// Newest snapshot tick the client has received
+	uint8_t Count;
+	NetInputCommand Inputs[NET_INPUT_REDUNDANCY];	// Oldest first
+};
+
+// Everything needed to show a match
+struct MatchState
+{
+	uint32_t Tick;
+	float PuckX;
+	float PuckZ;
+	float PuckDirX;
+	float PuckDirZ;
+	float PaddleX[NET_PLAYERS_PER_MATCH];
+	float PaddleZ[NET_PLAYERS_PER_MATCH];
+	uint8_t Score[NET_PLAYERS_PER_MATCH];
+};
+
+// Followed by a SnapshotCodec snapshot, delta-encoded against the
+// client's AckTick when the server still has it
+struct SnapshotPacket
+{
+	NetHeader Header;
+	uint32_t LastInput;		// Newest input sequence the server has applied for this client
+	uint32_t EchoTimeMs;	// ClientTimeMs of the input packet with the newest ack
+};
+
+struct SpectatePacket
+{
+	NetHeader Header;
+	uint32_t AckKeyframe;	// Newest keyframe tick the spectator holds, 0 for none
+};
+
+struct MatchStatePacket
+{
+	NetHeader Header;
+	MatchState State;
+};
+
+enum SpectatorStateFlags
+{
+	SPECTATOR_STATE_FULL = 1,		// No baseline, every field is present
+	SPECTATOR_STATE_KEYFRAME = 2	// Keep this state as a baseline and ack it
+};
+
+// Followed by the state's SnapshotCodec fields
+struct SpectatorStatePacket
+{
+	NetHeader Header;
+	uint32_t Tick;
+	uint32_t BaselineTick;
+	uint8_t Flags;
+};
+
+#pragma pack(pop)
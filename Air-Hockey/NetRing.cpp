@@ -0,0 +1,351 @@
+#include "NetRing.h"
+
+#if defined(__linux__) && defined(AIRHOCKEY_IO_URING)
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <cstring>
+
+//user_data tags: receive slots are their index, sends and cancels are marked
+static const uint64_t SEND_TAG = 1ull << 32;
+static const uint64_t CANCEL_TAG = 1ull << 33;
+
+struct NetRing::Slot
+{
+	msghdr Message;
+	iovec Vector;
+	sockaddr_in Address;
+	int Result;
+	unsigned char Data[NET_SOCKET_MAX_PACKET];
+};
+
+//No liburing dependency; the three syscalls are all we need
+static int RingSetup(unsigned a_entries, io_uring_params* a_params)
+{
+	return (int)syscall(__NR_io_uring_setup, a_entries, a_params);
+}
+
+static int RingEnter(int a_ring, unsigned a_submit, unsigned a_wait, unsigned a_flags)
+{
+	return (int)syscall(__NR_io_uring_enter, a_ring, a_submit, a_wait, a_flags, 0, 0);
+}
+
+NetRing::NetRing()
+{
+	socketHandle = -1;
+	ringHandle = -1;
+	submitRing = MAP_FAILED;
+	completeRing = MAP_FAILED;
+	entries = MAP_FAILED;
+	submitRingSize = completeRingSize = entriesSize = 0;
+	toSubmit = 0;
+
+	receiveSlots = 0;
+	sendSlots = 0;
+	ready = 0;
+	freeSends = 0;
+	receiveDepth = sendDepth = 0;
+	receivesPosted = readyHead = readyCount = freeSendCount = 0;
+}
+
+NetRing* NetRing::Create(intptr_t a_socket, int a_receiveDepth, int a_sendDepth)
+{
+	NetRing* ring = new NetRing();
+	if (!ring->Init((int)a_socket, a_receiveDepth, a_sendDepth))
+	{
+		delete ring;
+		return 0;
+	}
+	return ring;
+}
+
+bool NetRing::Init(int a_socket, int a_receiveDepth, int a_sendDepth)
+{
+	socketHandle = a_socket;
+
+	//Every slot can be in flight at once, plus one cancel per receive
+	//on shutdown, so the submission queue can never fill
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	ringHandle = RingSetup(a_receiveDepth * 2 + a_sendDepth, &params);
+	if (ringHandle < 0)
+		return false;
+
+	submitRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	completeRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (singleMap && completeRingSize > submitRingSize)
+		submitRingSize = completeRingSize;
+
+	submitRing = mmap(0, submitRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringHandle, IORING_OFF_SQ_RING);
+	if (submitRing == MAP_FAILED)
+		return false;
+
+	if (singleMap)
+	{
+		completeRing = submitRing;
+		completeRingSize = 0;
+	}
+	else
+	{
+		completeRing = mmap(0, completeRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringHandle, IORING_OFF_CQ_RING);
+		if (completeRing == MAP_FAILED)
+			return false;
+	}
+
+	entriesSize = params.sq_entries * sizeof(io_uring_sqe);
+	entries = mmap(0, entriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringHandle, IORING_OFF_SQES);
+	if (entries == MAP_FAILED)
+		return false;
+
+	char* sq = (char*)submitRing;
+	submitHead = (unsigned*)(sq + params.sq_off.head);
+	submitTail = (unsigned*)(sq + params.sq_off.tail);
+	submitMask = (unsigned*)(sq + params.sq_off.ring_mask);
+	submitArray = (unsigned*)(sq + params.sq_off.array);
+
+	char* cq = (char*)completeRing;
+	completeHead = (unsigned*)(cq + params.cq_off.head);
+	completeTail = (unsigned*)(cq + params.cq_off.tail);
+	completeMask = (unsigned*)(cq + params.cq_off.ring_mask);
+	completions = cq + params.cq_off.cqes;
+
+	receiveDepth = a_receiveDepth;
+	receiveSlots = new Slot[receiveDepth];
+	ready = new int[receiveDepth];
+
+	sendDepth = a_sendDepth;
+	sendSlots = new Slot[sendDepth];
+	freeSends = new int[sendDepth];
+	for (int i = 0; i < sendDepth; i++)
+		freeSends[freeSendCount++] = i;
+
+	NetIoStats unused;
+	for (int i = 0; i < receiveDepth; i++)
+		ArmReceive(i);
+	Submit(unused);
+
+	return true;
+}
+
+NetRing::~NetRing()
+{
+	//The kernel still points at our slots; cancel the receives and wait
+	//for everything outstanding before the memory goes away
+	if (ringHandle >= 0 && receiveSlots)
+	{
+		NetIoStats unused;
+		for (int i = 0; i < receiveDepth; i++)
+		{
+			io_uring_sqe* entry = (io_uring_sqe*)NextEntry();
+			entry->opcode = IORING_OP_ASYNC_CANCEL;
+			entry->addr = (uint64_t)i;
+			entry->user_data = CANCEL_TAG;
+		}
+		Submit(unused);
+
+		receiveDepth = 0;	//Stop Harvest() from queueing them as ready
+		while (receivesPosted > 0 || freeSendCount < sendDepth)
+		{
+			if (RingEnter(ringHandle, 0, 1, IORING_ENTER_GETEVENTS) < 0)
+				break;
+			Harvest();
+		}
+	}
+
+	if (entries != MAP_FAILED)
+		munmap(entries, entriesSize);
+	if (completeRing != MAP_FAILED && completeRing != submitRing)
+		munmap(completeRing, completeRingSize);
+	if (submitRing != MAP_FAILED)
+		munmap(submitRing, submitRingSize);
+	if (ringHandle >= 0)
+		close(ringHandle);
+
+	delete[] receiveSlots;
+	delete[] ready;
+	delete[] sendSlots;
+	delete[] freeSends;
+}
+
+//Claims the next submission entry.  Published to the kernel right away,
+//but it only looks at it on the next Submit()
+void* NetRing::NextEntry()
+{
+	unsigned tail = *submitTail;
+	unsigned index = tail & *submitMask;
+
+	io_uring_sqe* entry = (io_uring_sqe*)entries + index;
+	memset(entry, 0, sizeof(io_uring_sqe));
+	submitArray[index] = index;
+
+	__atomic_store_n(submitTail, tail + 1, __ATOMIC_RELEASE);
+	toSubmit++;
+	return entry;
+}
+
+void NetRing::ArmReceive(int a_slot)
+{
+	Slot& slot = receiveSlots[a_slot];
+	slot.Vector.iov_base = slot.Data;
+	slot.Vector.iov_len = sizeof(slot.Data);
+	memset(&slot.Message, 0, sizeof(slot.Message));
+	slot.Message.msg_name = &slot.Address;
+	slot.Message.msg_namelen = sizeof(slot.Address);
+	slot.Message.msg_iov = &slot.Vector;
+	slot.Message.msg_iovlen = 1;
+
+	io_uring_sqe* entry = (io_uring_sqe*)NextEntry();
+	entry->opcode = IORING_OP_RECVMSG;
+	entry->fd = socketHandle;
+	entry->addr = (uint64_t)&slot.Message;
+	entry->len = 1;
+	entry->user_data = (uint64_t)a_slot;
+	receivesPosted++;
+}
+
+void NetRing::Submit(NetIoStats& a_stats)
+{
+	if (toSubmit == 0)
+		return;
+
+	a_stats.Syscalls++;
+	int result = RingEnter(ringHandle, toSubmit, 0, 0);
+	if (result > 0)
+		toSubmit -= result;
+}
+
+void NetRing::Harvest()
+{
+	unsigned head = *completeHead;
+	unsigned tail = __atomic_load_n(completeTail, __ATOMIC_ACQUIRE);
+
+	for (; head != tail; head++)
+	{
+		io_uring_cqe* completion = (io_uring_cqe*)completions + (head & *completeMask);
+		uint64_t tag = completion->user_data;
+
+		if (tag & CANCEL_TAG)
+			continue;
+
+		if (tag & SEND_TAG)
+		{
+			freeSends[freeSendCount++] = (int)(tag & 0xFFFFFFFF);
+			continue;
+		}
+
+		receivesPosted--;
+		if (receiveDepth == 0)
+			continue;
+
+		receiveSlots[tag].Result = completion->res;
+		ready[(readyHead + readyCount) % receiveDepth] = (int)tag;
+		readyCount++;
+	}
+
+	__atomic_store_n(completeHead, head, __ATOMIC_RELEASE);
+}
+
+bool NetRing::HasPending()
+{
+	return readyCount > 0 || *completeHead != __atomic_load_n(completeTail, __ATOMIC_ACQUIRE);
+}
+
+int NetRing::Receive(PacketBatch& a_batch, NetIoStats& a_stats)
+{
+	Harvest();
+
+	while (readyCount > 0 && !a_batch.IsFull())
+	{
+		int index = ready[readyHead];
+		readyHead = (readyHead + 1) % receiveDepth;
+		readyCount--;
+
+		Slot& slot = receiveSlots[index];
+		if (slot.Result > 0)
+		{
+			NetAddress from;
+			from.IP = ntohl(slot.Address.sin_addr.s_addr);
+			from.Port = ntohs(slot.Address.sin_port);
+			a_batch.Add(from, slot.Data, slot.Result);
+
+			a_stats.PacketsIn++;
+			a_stats.BytesIn += slot.Result;
+		}
+
+		ArmReceive(index);
+	}
+
+	Submit(a_stats);
+	return a_batch.GetCount();
+}
+
+int NetRing::Send(PacketBatch& a_batch, NetIoStats& a_stats)
+{
+	for (int i = 0; i < a_batch.GetCount(); i++)
+	{
+		//Every send slot is in flight; push what we have and wait for one
+		if (freeSendCount == 0)
+		{
+			a_stats.Syscalls++;
+			int result = RingEnter(ringHandle, toSubmit, 1, IORING_ENTER_GETEVENTS);
+			if (result < 0)
+				return i;
+			toSubmit -= result;
+			Harvest();
+		}
+
+		int index = freeSends[--freeSendCount];
+		Slot& slot = sendSlots[index];
+
+		int size = a_batch.GetSize(i);
+		const NetAddress& to = a_batch.GetAddress(i);
+		memcpy(slot.Data, a_batch.GetData(i), size);
+
+		memset(&slot.Address, 0, sizeof(slot.Address));
+		slot.Address.sin_family = AF_INET;
+		slot.Address.sin_addr.s_addr = htonl(to.IP);
+		slot.Address.sin_port = htons(to.Port);
+
+		slot.Vector.iov_base = slot.Data;
+		slot.Vector.iov_len = size;
+		memset(&slot.Message, 0, sizeof(slot.Message));
+		slot.Message.msg_name = &slot.Address;
+		slot.Message.msg_namelen = sizeof(slot.Address);
+		slot.Message.msg_iov = &slot.Vector;
+		slot.Message.msg_iovlen = 1;
+
+		io_uring_sqe* entry = (io_uring_sqe*)NextEntry();
+		entry->opcode = IORING_OP_SENDMSG;
+		entry->fd = socketHandle;
+		entry->addr = (uint64_t)&slot.Message;
+		entry->len = 1;
+		entry->user_data = SEND_TAG | (uint64_t)index;
+
+		a_stats.PacketsOut++;
+		a_stats.BytesOut += size;
+	}
+
+	Submit(a_stats);
+
+	//Recycle finished sends now so the next batch rarely has to wait
+	Harvest();
+	return a_batch.GetCount();
+}
+
+#else
+
+// Not available on this platform or build; sockets use batched calls
+NetRing::NetRing() {}
+NetRing::~NetRing() {}
+NetRing* NetRing::Create(intptr_t /*a_socket*/, int /*a_receiveDepth*/, int /*a_sendDepth*/) { return 0; }
+int NetRing::Receive(PacketBatch& /*a_batch*/, NetIoStats& /*a_stats*/) { return 0; }
+int NetRing::Send(PacketBatch& /*a_batch*/, NetIoStats& /*a_stats*/) { return 0; }
+bool NetRing::HasPending() { return false; }
+
+#endif
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "NetSocket.h"
+
+// --------------------------------------------------------
+// io_uring backend for a UdpSocket in NET_IO_RING mode.
+// Keeps a pool of receives posted at all times and copies
+// outgoing batches into send slots, so a whole batch costs
+// one io_uring_enter.  Only built on Linux when
+// AIRHOCKEY_IO_URING is defined; elsewhere Create() returns
+// null and the socket falls back to batched calls.
+// --------------------------------------------------------
+class NetRing
+{
+public:
+	static NetRing* Create(intptr_t a_socket, int a_receiveDepth, int a_sendDepth);
+	~NetRing();
+
+	// Moves finished receives into the batch and re-posts them
+	int Receive(PacketBatch& a_batch, NetIoStats& a_stats);
+
+	// Queues the batch's packets as sends and submits them
+	int Send(PacketBatch& a_batch, NetIoStats& a_stats);
+
+	// True if completions are waiting that Receive() hasn't handed out
+	bool HasPending();
+
+	// Becomes readable when completions arrive
+	intptr_t GetHandle() { return ringHandle; }
+
+private:
+	struct Slot;
+
+	NetRing();
+	bool Init(int a_socket, int a_receiveDepth, int a_sendDepth);
+	void* NextEntry();
+	void ArmReceive(int a_slot);
+	void Submit(NetIoStats& a_stats);
+	void Harvest();
+
+	int socketHandle;
+	int ringHandle;
+
+	//Shared with the kernel
+	void* submitRing;
+	size_t submitRingSize;
+	void* completeRing;
+	size_t completeRingSize;
+	void* entries;
+	size_t entriesSize;
+	unsigned* submitHead;
+	unsigned* submitTail;
+	unsigned* submitMask;
+	unsigned* submitArray;
+	unsigned* completeHead;
+	unsigned* completeTail;
+	unsigned* completeMask;
+	void* completions;
+	unsigned toSubmit;
+
+	//Receives stay posted; finished ones wait in a FIFO for Receive()
+	Slot* receiveSlots;
+	int receiveDepth;
+	int receivesPosted;
+	int* ready;
+	int readyHead;
+	int readyCount;
+
+	Slot* sendSlots;
+	int sendDepth;
+	int* freeSends;
+	int freeSendCount;
+};
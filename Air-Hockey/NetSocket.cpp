@@ -0,0 +1,435 @@
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef int socklen_t;
+typedef SOCKET NativeSocket;
+#define NET_DONTWAIT 0
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+typedef int NativeSocket;
+#define NET_DONTWAIT MSG_DONTWAIT
+#endif
+
+#include <chrono>
+#include <cstring>
+#include "NetSocket.h"
+#include "NetRing.h"
+
+// Packets Queue() holds before flushing on its own
+static const int SEND_QUEUE_SIZE = 64;
+
+// io_uring receives kept posted, and sends allowed in flight
+static const int RING_RECEIVE_DEPTH = 64;
+static const int RING_SEND_DEPTH = 128;
+
+NetAddress NetMakeAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d, uint16_t port)
+{
+	NetAddress address;
+	address.IP = ((uint32_t)a << 24) | ((uint32_t)b << 16) | ((uint32_t)c << 8) | (uint32_t)d;
+	address.Port = port;
+	return address;
+}
+
+uint32_t NetTimeMs()
+{
+	using namespace std::chrono;
+	return (uint32_t)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t NetTimeUs()
+{
+	using namespace std::chrono;
+	return (uint64_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+const char* NetIoModeName(NetIoMode mode)
+{
+	switch (mode)
+	{
+	case NET_IO_SINGLE: return "single";
+	case NET_IO_BATCHED: return "batched";
+	case NET_IO_RING: return "ring";
+	}
+	return "unknown";
+}
+
+#ifdef __linux__
+//Headers for recvmmsg/sendmmsg, one per slot, pointing at the slot's data
+struct BatchHeaders
+{
+	mmsghdr* Messages;
+	iovec* Vectors;
+	sockaddr_in* Addresses;
+};
+#endif
+
+PacketBatch::PacketBatch(int a_capacity, int a_packetSize)
+{
+	capacity = a_capacity;
+	packetSize = a_packetSize;
+	count = 0;
+
+	data = new unsigned char[capacity * packetSize];
+	sizes = new int[capacity];
+	addresses = new NetAddress[capacity];
+	native = 0;
+
+#ifdef __linux__
+	BatchHeaders* headers = new BatchHeaders();
+	headers->Messages = new mmsghdr[capacity];
+	headers->Vectors = new iovec[capacity];
+	headers->Addresses = new sockaddr_in[capacity];
+	memset(headers->Messages, 0, capacity * sizeof(mmsghdr));
+
+	for (int i = 0; i < capacity; i++)
+	{
+		headers->Vectors[i].iov_base = GetData(i);
+		headers->Vectors[i].iov_len = packetSize;
+		headers->Messages[i].msg_hdr.msg_iov = &headers->Vectors[i];
+		headers->Messages[i].msg_hdr.msg_iovlen = 1;
+		headers->Messages[i].msg_hdr.msg_name = &headers->Addresses[i];
+	}
+	native = headers;
+#endif
+}
+
+PacketBatch::~PacketBatch()
+{
+#ifdef __linux__
+	BatchHeaders* headers = (BatchHeaders*)native;
+	delete[] headers->Messages;
+	delete[] headers->Vectors;
+	delete[] headers->Addresses;
+	delete headers;
+#endif
+
+	delete[] data;
+	delete[] sizes;
+	delete[] addresses;
+}
+
+bool PacketBatch::Add(const NetAddress& a_address, const void* a_data, int a_size)
+{
+	if (count == capacity || a_size > packetSize)
+		return false;
+
+	memcpy(GetData(count), a_data, a_size);
+	sizes[count] = a_size;
+	addresses[count] = a_address;
+	count++;
+	return true;
+}
+
+UdpSocket::UdpSocket()
+{
+	handle = -1;
+	port = 0;
+	ioMode = NET_IO_BATCHED;
+	sendQueue = 0;
+	ring = 0;
+	ResetStats();
+}
+
+UdpSocket::~UdpSocket()
+{
+	Close();
+	delete sendQueue;
+}
+
+bool UdpSocket::InitNetworking()
+{
+#ifdef _WIN32
+	WSADATA wsaData;
+	return WSAStartup(MAKEWORD(2, 2), &wsaData) == 0;
+#else
+	return true;
+#endif
+}
+
+void UdpSocket::ShutdownNetworking()
+{
+#ifdef _WIN32
+	WSACleanup();
+#endif
+}
+
+void UdpSocket::ResetStats()
+{
+	memset(&stats, 0, sizeof(stats));
+}
+
+bool UdpSocket::Open(uint16_t a_port, NetIoMode a_mode)
+{
+	Close();
+
+	intptr_t s = (intptr_t)socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+#ifdef _WIN32
+	if ((SOCKET)s == INVALID_SOCKET)
+		return false;
+#else
+	if (s < 0)
+		return false;
+#endif
+
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(a_port);
+
+	if (bind((NativeSocket)s, (const sockaddr*)&address, sizeof(address)) != 0)
+	{
+#ifdef _WIN32
+		closesocket((SOCKET)s);
+#else
+		close((NativeSocket)s);
+#endif
+		return false;
+	}
+
+	//Never block the game loop waiting on the network.  On Linux every
+	//call passes MSG_DONTWAIT instead, because io_uring won't wait on a
+	//socket marked non-blocking
+#ifdef _WIN32
+	u_long nonBlocking = 1;
+	ioctlsocket((SOCKET)s, FIONBIO, &nonBlocking);
+#elif !defined(__linux__)
+	fcntl((NativeSocket)s, F_SETFL, fcntl((NativeSocket)s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+	//Find out which port we got if we asked for any
+	socklen_t length = sizeof(address);
+	getsockname((NativeSocket)s, (sockaddr*)&address, &length);
+
+	handle = s;
+	port = ntohs(address.sin_port);
+
+	ioMode = a_mode;
+	if (ioMode == NET_IO_RING)
+	{
+		ring = NetRing::Create(handle, RING_RECEIVE_DEPTH, RING_SEND_DEPTH);
+		if (!ring)
+			ioMode = NET_IO_BATCHED;
+	}
+
+	return true;
+}
+
+void UdpSocket::Close()
+{
+	if (handle == -1)
+		return;
+
+	//In-flight ring operations point at the socket, so they go first
+	delete ring;
+	ring = 0;
+
+	if (sendQueue)
+		sendQueue->Clear();
+
+#ifdef _WIN32
+	closesocket((SOCKET)handle);
+#else
+	close((NativeSocket)handle);
+#endif
+	handle = -1;
+	port = 0;
+}
+
+int UdpSocket::Send(const NetAddress& to, const void* data, int size)
+{
+	if (handle == -1)
+		return -1;
+
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(to.IP);
+	address.sin_port = htons(to.Port);
+
+	stats.Syscalls++;
+	int sent = (int)sendto((NativeSocket)handle, (const char*)data, size, NET_DONTWAIT, (const sockaddr*)&address, sizeof(address));
+	if (sent < 0)
+		return -1;
+
+	stats.PacketsOut++;
+	stats.BytesOut += sent;
+	return sent;
+}
+
+int UdpSocket::Receive(NetAddress& from, void* buffer, int bufferSize)
+{
+	if (handle == -1)
+		return -1;
+
+	sockaddr_in address = {};
+	socklen_t length = sizeof(address);
+
+	stats.Syscalls++;
+	int received = (int)recvfrom((NativeSocket)handle, (char*)buffer, bufferSize, NET_DONTWAIT, (sockaddr*)&address, &length);
+	if (received < 0)
+		return -1;
+
+	from.IP = ntohl(address.sin_addr.s_addr);
+	from.Port = ntohs(address.sin_port);
+
+	stats.PacketsIn++;
+	stats.BytesIn += received;
+	return received;
+}
+
+void UdpSocket::Queue(const NetAddress& to, const void* data, int size)
+{
+	if (!sendQueue)
+		sendQueue = new PacketBatch(SEND_QUEUE_SIZE);
+
+	if (sendQueue->IsFull())
+		Flush();
+
+	sendQueue->Add(to, data, size);
+}
+
+int UdpSocket::Flush()
+{
+	if (!sendQueue || sendQueue->GetCount() == 0)
+		return 0;
+
+	int sent = SendBatch(*sendQueue);
+	sendQueue->Clear();
+	return sent;
+}
+
+int UdpSocket::SendBatch(PacketBatch& batch)
+{
+	if (handle == -1)
+		return 0;
+
+	if (ring)
+		return ring->Send(batch, stats);
+
+#ifdef __linux__
+	if (ioMode == NET_IO_BATCHED)
+	{
+		BatchHeaders* headers = (BatchHeaders*)batch.native;
+		for (int i = 0; i < batch.count; i++)
+		{
+			sockaddr_in& address = headers->Addresses[i];
+			memset(&address, 0, sizeof(address));
+			address.sin_family = AF_INET;
+			address.sin_addr.s_addr = htonl(batch.addresses[i].IP);
+			address.sin_port = htons(batch.addresses[i].Port);
+
+			headers->Messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+			headers->Vectors[i].iov_len = batch.sizes[i];
+		}
+
+		//The kernel may take fewer than asked; keep going until it stops
+		int sent = 0;
+		while (sent < batch.count)
+		{
+			stats.Syscalls++;
+			int result = sendmmsg((int)handle, headers->Messages + sent, batch.count - sent, MSG_DONTWAIT);
+			if (result <= 0)
+				break;
+
+			for (int i = sent; i < sent + result; i++)
+				stats.BytesOut += batch.sizes[i];
+			stats.PacketsOut += result;
+			sent += result;
+		}
+		return sent;
+	}
+#endif
+
+	int sent = 0;
+	for (int i = 0; i < batch.count; i++)
+	{
+		if (Send(batch.addresses[i], batch.GetData(i), batch.sizes[i]) >= 0)
+			sent++;
+	}
+	return sent;
+}
+
+int UdpSocket::ReceiveBatch(PacketBatch& batch)
+{
+	batch.Clear();
+	if (handle == -1)
+		return 0;
+
+	if (ring)
+		return ring->Receive(batch, stats);
+
+#ifdef __linux__
+	if (ioMode == NET_IO_BATCHED)
+	{
+		BatchHeaders* headers = (BatchHeaders*)batch.native;
+		for (int i = 0; i < batch.capacity; i++)
+		{
+			headers->Messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+			headers->Vectors[i].iov_len = batch.packetSize;
+		}
+
+		stats.Syscalls++;
+		int received = recvmmsg((int)handle, headers->Messages, batch.capacity, MSG_DONTWAIT, 0);
+		if (received <= 0)
+			return 0;
+
+		for (int i = 0; i < received; i++)
+		{
+			batch.sizes[i] = (int)headers->Messages[i].msg_len;
+			batch.addresses[i].IP = ntohl(headers->Addresses[i].sin_addr.s_addr);
+			batch.addresses[i].Port = ntohs(headers->Addresses[i].sin_port);
+			stats.BytesIn += batch.sizes[i];
+		}
+		stats.PacketsIn += received;
+		batch.count = received;
+		return received;
+	}
+#endif
+
+	NetAddress from;
+	while (!batch.IsFull())
+	{
+		int size = Receive(from, batch.GetData(batch.count), batch.packetSize);
+		if (size < 0)
+			break;
+
+		batch.sizes[batch.count] = size;
+		batch.addresses[batch.count] = from;
+		batch.count++;
+	}
+	return batch.count;
+}
+
+intptr_t UdpSocket::GetPollHandle()
+{
+	return ring ? ring->GetHandle() : handle;
+}
+
+bool UdpSocket::Wait(int timeoutUs)
+{
+	if (handle == -1)
+		return false;
+
+	//The ring may already hold packets the socket no longer shows
+	if (ring && ring->HasPending())
+		return true;
+
+	NativeSocket waitOn = (NativeSocket)GetPollHandle();
+
+	fd_set readable;
+	FD_ZERO(&readable);
+	FD_SET(waitOn, &readable);
+
+	timeval timeout;
+	timeout.tv_sec = timeoutUs / 1000000;
+	timeout.tv_usec = timeoutUs % 1000000;
+
+	//The first argument is ignored by Winsock
+	stats.Syscalls++;
+	return select((int)waitOn + 1, &readable, 0, 0, &timeout) > 0;
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include <cstdint>
+
+// --------------------------------------------------------
+// An IPv4 address and port, both in host byte order
+// --------------------------------------------------------
+struct NetAddress
+{
+	uint32_t IP;
+	uint16_t Port;
+
+	bool operator==(const NetAddress& other) const { return IP == other.IP && Port == other.Port; }
+	bool operator!=(const NetAddress& other) const { return !(*this == other); }
+};
+
+// Builds an address from four octets, e.g. NetMakeAddress(127, 0, 0, 1, port)
+NetAddress NetMakeAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d, uint16_t port);
+
+// Milliseconds on a monotonic clock, used for packet timestamps
+uint32_t NetTimeMs();
+
+// Microseconds on the same clock, for scheduling and profiling
+uint64_t NetTimeUs();
+
+// Largest datagram a socket will queue or batch (one Ethernet MTU)
+const int NET_SOCKET_MAX_PACKET = 1500;
+
+// How a socket moves batches of packets
+enum NetIoMode
+{
+	NET_IO_SINGLE,		// One sendto/recvfrom per packet
+	NET_IO_BATCHED,		// sendmmsg/recvmmsg on Linux, one call per packet elsewhere
+	NET_IO_RING			// io_uring on Linux builds with AIRHOCKEY_IO_URING
+};
+
+const char* NetIoModeName(NetIoMode mode);
+
+// Per-socket counters, to see how well batching is doing
+struct NetIoStats
+{
+	uint64_t Syscalls;		// Every socket call, waits included
+	uint64_t PacketsIn;
+	uint64_t PacketsOut;
+	uint64_t BytesIn;
+	uint64_t BytesOut;
+};
+
+// --------------------------------------------------------
+// A fixed number of packet slots in one allocation, filled
+// by UdpSocket::ReceiveBatch() or by Add() before a
+// SendBatch().  Also holds the scratch the batch syscalls
+// need, so moving a batch never allocates.
+// --------------------------------------------------------
+class PacketBatch
+{
+public:
+	PacketBatch(int a_capacity, int a_packetSize = NET_SOCKET_MAX_PACKET);
+	~PacketBatch();
+
+	void Clear() { count = 0; }
+
+	// Copies a packet in; false if the batch is full or it's too big
+	bool Add(const NetAddress& a_address, const void* a_data, int a_size);
+
+	int GetCount() { return count; }
+	int GetCapacity() { return capacity; }
+	bool IsFull() { return count == capacity; }
+
+	unsigned char* GetData(int a_index) { return data + a_index * packetSize; }
+	int GetSize(int a_index) { return sizes[a_index]; }
+	const NetAddress& GetAddress(int a_index) { return addresses[a_index]; }
+
+private:
+	friend class UdpSocket;
+
+	unsigned char* data;
+	int* sizes;
+	NetAddress* addresses;
+	int count;
+	int capacity;
+	int packetSize;
+
+	//Platform message headers for the batch calls, built once
+	void* native;
+};
+
+class NetRing;
+
+// --------------------------------------------------------
+// Thin non-blocking UDP socket wrapper.  Winsock and BSD
+// sockets are hidden in the .cpp so this header doesn't
+// drag <winsock2.h> in ahead of <Windows.h>.
+// --------------------------------------------------------
+class UdpSocket
+{
+public:
+	UdpSocket();
+	~UdpSocket();
+
+	// Must be called once per process before opening sockets
+	static bool InitNetworking();
+	static void ShutdownNetworking();
+
+	// Binds to the given port on all interfaces (0 = any free port).
+	// Modes the platform lacks fall back to the next simpler one
+	bool Open(uint16_t port, NetIoMode mode = NET_IO_BATCHED);
+	void Close();
+	bool IsOpen() { return handle != -1; }
+	uint16_t GetPort() { return port; }
+	NetIoMode GetIoMode() { return ioMode; }
+
+	// Returns the number of bytes sent/received, or -1 if
+	// nothing was sent/nothing is waiting
+	int Send(const NetAddress& to, const void* data, int size);
+	int Receive(NetAddress& from, void* buffer, int bufferSize);
+
+	// Holds a packet for the next Flush(), flushing early if the
+	// queue fills.  Lets a whole tick's sends go out together
+	void Queue(const NetAddress& to, const void* data, int size);
+	int Flush();
+
+	// Sends every packet in the batch; returns how many went out
+	int SendBatch(PacketBatch& batch);
+
+	// Replaces the batch's contents with waiting packets; returns the count
+	int ReceiveBatch(PacketBatch& batch);
+
+	// Blocks until a packet is waiting or the timeout runs out.
+	// Returns true if there is something to Receive()
+	bool Wait(int timeoutUs);
+
+	// What to poll for readability: the socket, or the ring in ring mode
+	intptr_t GetPollHandle();
+	intptr_t GetHandle() { return handle; }
+
+	const NetIoStats& GetStats() { return stats; }
+	void ResetStats();
+
+private:
+	intptr_t handle;
+	uint16_t port;
+	NetIoMode ioMode;
+	NetIoStats stats;
+
+	PacketBatch* sendQueue;
+	NetRing* ring;
+};
@@ -4,6 +4,8 @@
 Paddle::Paddle(Mesh* mesh, Material* mat) : GameEntity(mesh, mat)
 {
 	radius = 1;
+	speed = 5.0f;
+	SetBounds(-3.2f, 3.2f, -1.2f, 1.2f);
 }
 
 Paddle::~Paddle()
@@ -14,3 +16,48 @@ int Paddle::getRadius()
 {
 	return radius;
 }
+
+void Paddle::SetBounds(float a_minX, float a_maxX, float a_minZ, float a_maxZ)
+{
+	minX = a_minX;
+	maxX = a_maxX;
+	minZ = a_minZ;
+	maxZ = a_maxZ;
+}
+
+//Moves the paddle for one step of input and keeps it on its side of the rink
+void Paddle::ApplyInput(unsigned char a_buttons, float dt)
+{
+	if (a_buttons & PADDLE_UP)
+	{
+		MoveAbsolute(0.0f, 0.0f, speed * dt);
+
+		if (entityPos.z > maxZ)
+			entityPos.z = maxZ;
+	}
+	if (a_buttons & PADDLE_RIGHT)
+	{
+		MoveAbsolute(speed * dt, 0.0f, 0.0f);
+
+		if (entityPos.x > maxX)
+			entityPos.x = maxX;
+	}
+	if (a_buttons & PADDLE_DOWN)
+	{
+		MoveAbsolute(0.0f, 0.0f, -speed * dt);
+
+		if (entityPos.z < minZ)
+			entityPos.z = minZ;
+	}
+	if (a_buttons & PADDLE_LEFT)
+	{
+		MoveAbsolute(-speed * dt, 0.0f, 0.0f);
+
+		if (entityPos.x < minX)
+			entityPos.x = minX;
+	}
+
+	//The clamps above write the position directly
+	if (a_buttons)
+		TransformChanged();
+}
@@ -1,6 +1,15 @@
 #pragma once
 #include "GameEntity.h"
 
+// Bit flags for a paddle's movement input, shared by local
+// play, the online client's prediction and the server
+enum PaddleInput
+{
+	PADDLE_UP = 1,
+	PADDLE_DOWN = 2,
+	PADDLE_LEFT = 4,
+	PADDLE_RIGHT = 8
+};
 
 class Paddle :
 	public GameEntity
@@ -10,10 +19,18 @@ public:
 	~Paddle();
 
 	int getRadius();
-	
+
+	/*Movement*/
+	void SetBounds(float a_minX, float a_maxX, float a_minZ, float a_maxZ);
+	void ApplyInput(unsigned char a_buttons, float dt);
 
 private:
 	int radius;
+	float speed;
 
-
+	//Area of the rink this paddle is allowed to move in
+	float minX;
+	float maxX;
+	float minZ;
+	float maxZ;
 };
\ No newline at end of file
@@ -0,0 +1,168 @@
+#include "PassRecorder.h"
+#include <cstring>
+
+PassRecorder::PassRecorder(RenderBackend* a_immediate, JobPool* a_jobs, int a_passes, unsigned int a_ringBytes)
+{
+	immediate = a_immediate;
+	jobs = a_jobs;
+	parallel = true;
+
+	//Any pass without a deferred backend means none get one
+	std::vector<RenderBackend*> backends;
+	for (int i = 0; i < a_passes; i++)
+	{
+		RenderBackend* backend = immediate->CreateDeferred();
+		if (!backend)
+			break;
+		backends.push_back(backend);
+	}
+	deferred = (int)backends.size() == a_passes;
+	if (!deferred)
+	{
+		for (size_t i = 0; i < backends.size(); i++)
+			delete backends[i];
+		backends.assign(a_passes, immediate);
+	}
+
+	passes.resize(a_passes);
+	for (int i = 0; i < a_passes; i++)
+	{
+		RenderPassContext& pass = passes[i];
+		pass.Backend = backends[i];
+		pass.Ring = new TransientRing(pass.Backend, a_ringBytes);
+		pass.Constants = new ShaderConstants(pass.Backend);
+		pass.Queue = new RenderQueue();
+		pass.Queue->SetShaderConstants(pass.Constants);
+		pass.Queue->SetTransientRing(pass.Ring);
+	}
+
+	lists.assign(a_passes, 0);
+	uploads.resize(a_passes);
+	memset(&uploads[0], 0, uploads.size() * sizeof(SimpleShaderUploadStats));
+}
+
+PassRecorder::~PassRecorder()
+{
+	DropLists();
+
+	//Buffers first, while the backends they came through still exist
+	for (size_t i = 0; i < passes.size(); i++)
+	{
+		delete passes[i].Queue;
+		delete passes[i].Constants;
+		delete passes[i].Ring;
+		if (deferred)
+			delete passes[i].Backend;
+	}
+}
+
+void PassRecorder::DropLists()
+{
+	for (size_t i = 0; i < lists.size(); i++)
+	{
+		delete lists[i];
+		lists[i] = 0;
+	}
+}
+
+void PassRecorder::BeginFrame()
+{
+	//Recorded but never submitted last frame
+	DropLists();
+
+	for (size_t i = 0; i < passes.size(); i++)
+	{
+		if (deferred)
+			passes[i].Backend->BeginFrame();
+		passes[i].Queue->BeginFrame();
+		passes[i].Ring->BeginFrame();
+	}
+}
+
+void PassRecorder::RecordPass(int a_pass, const std::function<void(int, RenderPassContext&)>& a_record)
+{
+	ISimpleShader::SetThreadStats(&uploads[a_pass]);
+	a_record(a_pass, passes[a_pass]);
+	ISimpleShader::SetThreadStats(0);
+
+	lists[a_pass] = passes[a_pass].Backend->FinishCommandList();
+}
+
+void PassRecorder::Record(const std::function<void(int, RenderPassContext&)>& a_record)
+{
+	if (!deferred)
+	{
+		for (size_t i = 0; i < passes.size(); i++)
+			a_record((int)i, passes[i]);
+		return;
+	}
+
+	DropLists();
+
+	//One pass per chunk; they're few and uneven, so let threads grab them
+	if (parallel && jobs)
+	{
+		jobs->ParallelFor((int)passes.size(), 1, [this, &a_record](int a_first, int a_last)
+		{
+			for (int i = a_first; i < a_last; i++)
+				RecordPass(i, a_record);
+		});
+	}
+	else
+	{
+		for (size_t i = 0; i < passes.size(); i++)
+			RecordPass((int)i, a_record);
+	}
+
+	for (size_t i = 0; i < uploads.size(); i++)
+	{
+		ISimpleShader::AddFrameStats(uploads[i]);
+		memset(&uploads[i], 0, sizeof(uploads[i]));
+	}
+}
+
+void PassRecorder::Submit(int a_first, int a_last)
+{
+	for (int i = a_first; i < a_last; i++)
+	{
+		if (!lists[i])
+			continue;
+
+		immediate->ExecuteCommandList(lists[i]);
+		lists[i] = 0;
+	}
+}
+
+RenderQueueStats PassRecorder::GetLastQueueStats()
+{
+	RenderQueueStats total;
+	memset(&total, 0, sizeof(total));
+	for (size_t i = 0; i < passes.size(); i++)
+	{
+		const RenderQueueStats& stats = passes[i].Queue->GetLastFrameStats();
+		total.Submitted += stats.Submitted;
+		total.ShaderBinds += stats.ShaderBinds;
+		total.TextureBinds += stats.TextureBinds;
+		total.MeshBinds += stats.MeshBinds;
+		total.SkippedBinds += stats.SkippedBinds;
+		total.InstancedDraws += stats.InstancedDraws;
+		total.Instances += stats.Instances;
+	}
+	return total;
+}
+
+TransientRingStats PassRecorder::GetLastRingStats()
+{
+	TransientRingStats total;
+	memset(&total, 0, sizeof(total));
+	for (size_t i = 0; i < passes.size(); i++)
+	{
+		const TransientRingStats& stats = passes[i].Ring->GetLastFrameStats();
+		total.Allocations += stats.Allocations;
+		total.BytesUsed += stats.BytesUsed;
+		total.Discards += stats.Discards;
+		total.Overflows += stats.Overflows;
+		total.Capacity += stats.Capacity;
+	}
+	return total;
+}
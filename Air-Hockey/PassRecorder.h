@@ -0,0 +1,82 @@
+#pragma once
+#include <functional>
+#include <vector>
+#include "RenderBackend.h"
+#include "RenderQueue.h"
+#include "TransientRing.h"
+#include "ShaderConstants.h"
+#include "SimpleShader.h"
+#include "JobPool.h"
+
+// Everything one pass records with.  None of it is shared
+// with another pass, so passes can be recorded at once
+struct RenderPassContext
+{
+	RenderBackend* Backend;			// Deferred, unless the immediate backend can't make one
+	RenderQueue* Queue;				// Draws through Constants and Ring already
+	TransientRing* Ring;
+	ShaderConstants* Constants;
+};
+
+// --------------------------------------------------------
+// Records a frame's passes (shadow views, opaque, particles,
+// sky...) on the job pool's threads, each into a command
+// list of its own, then runs the lists on the immediate
+// backend in pass order, so the GPU sees exactly what one
+// thread drawing them in order would have sent.
+//
+// A list starts with nothing bound, so each pass sets its
+// own render target, viewport and states.  Shaders drawn by
+// a pass are pointed at its backend (RenderQueue does that
+// by itself); a shader mustn't be drawn by two passes, and
+// passes mustn't use the job pool themselves.
+//
+// If the immediate backend can't make deferred backends the
+// passes just draw on it, one after another, inside Record().
+// --------------------------------------------------------
+class PassRecorder
+{
+public:
+	// a_ringBytes is each pass's transient ring, which grows if needed.
+	// Creates ShaderConstants, so make this before loading any shaders
+	PassRecorder(RenderBackend* a_immediate, JobPool* a_jobs, int a_passes, unsigned int a_ringBytes);
+	~PassRecorder();
+
+	int GetPassCount() { return (int)passes.size(); }
+	RenderPassContext& GetPass(int a_pass) { return passes[a_pass]; }
+	bool IsDeferred() { return deferred; }
+
+	// Starts every pass's frame: backend, queue and ring counters
+	void BeginFrame();
+
+	// Calls a_record(pass, context) once for every pass, spread over
+	// the job pool (or in order on this thread, if not parallel), and
+	// returns once they're all recorded
+	void Record(const std::function<void(int, RenderPassContext&)>& a_record);
+
+	// Runs passes a_first to a_last - 1 on the immediate backend, in order
+	void Submit(int a_first, int a_last);
+
+	// Off records on this thread only, into the same lists
+	void SetParallel(bool a_parallel) { parallel = a_parallel; }
+
+	// Summed over every pass, last frame
+	RenderQueueStats GetLastQueueStats();
+	TransientRingStats GetLastRingStats();
+
+private:
+	RenderBackend* immediate;
+	JobPool* jobs;
+	bool deferred;
+	bool parallel;
+
+	std::vector<RenderPassContext> passes;
+
+	//Each pass's finished list, until it's submitted, and the
+	//constant buffer uploads it counted while recording
+	std::vector<RenderCommandList*> lists;
+	std::vector<SimpleShaderUploadStats> uploads;
+
+	void RecordPass(int a_pass, const std::function<void(int, RenderPassContext&)>& a_record);
+	void DropLists();
+};
@@ -19,35 +19,9 @@ struct VertexToPixel
 	float4 CubeShadowMapPosition	:	POSITION2;
 };
 
-struct DirectionalLight
-{
-	float4 AmbientColor;
-	float4 DiffuseColor;
-	float3 Direction;
-};
-
-struct PointLight
-{
-	float4 AmbientColor;
-	float4 DiffuseColor;
-	float3 Position;
-};
-
-// Constant Buffer
-// - Allows us to define a buffer of individual variables 
-//    which will (eventually) hold data from our C++ code
-// - All non-pipeline variables that get their values from 
-//    our C++ code must be defined inside a Constant Buffer
-// - The name of the cbuffer itself is unimportant
-cbuffer ExternalData : register(b0)
-{
-	DirectionalLight light;
-	PointLight pLight;
-
-	float3 cameraPosition; //cam position for specular
-};
-
-
+// Lights and the camera position come from ShaderConstants.hlsli;
+// nothing here changes per object
+#include "ShaderConstants.hlsli"
 
 Texture2D srv		:	register(t0);
 Texture2D ShadowMap	:	register(t1);
@@ -48,7 +48,8 @@ void Puck::CollisionDetection(Paddle* a_paddle)
 
 	Vect2 = Vect1 - 2 * WallN * (WallN DOT Vect1)
 	*/
-	XMVECTOR paddlePos = XMLoadFloat3(&a_paddle->GetPosition());
+	XMFLOAT3 paddlePosition = a_paddle->GetPosition();
+	XMVECTOR paddlePos = XMLoadFloat3(&paddlePosition);
 	XMVECTOR puckPos = XMLoadFloat3(&entityPos);
 	//distance between positions
 	XMVECTOR diff = XMVectorSubtract(puckPos, paddlePos);
@@ -126,7 +127,7 @@ void Puck::Update(float dt)
 	XMStoreFloat3(&velocity, puckVel);
 	XMStoreFloat3(&direction, puckDir);
 	entityPos.y = -.19;
-	std::cout << direction.x << ", " << direction.y << ", " << direction.z << std::endl;
+	TransformChanged();
 }
 
 int Puck::checkScore()
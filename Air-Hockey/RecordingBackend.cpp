@@ -0,0 +1,280 @@
+#include "RecordingBackend.h"
+#include <cstring>
+
+RecordingBackend::RecordingBackend(bool a_record)
+{
+	record = a_record;
+	owner = 0;
+	nextBuffer = 1;
+	liveBuffers = 0;
+	liveStates = 0;
+}
+
+// One list's commands, kept until it runs
+class RecordingCommandList : public RenderCommandList
+{
+public:
+	std::vector<RenderCommand> Commands;
+};
+
+void RecordingBackend::Record(RenderCommandType a_type, uint64_t a_object, uint32_t a_count, uint32_t a_start, int32_t a_base, uint8_t a_stage, uint16_t a_slot, uint64_t a_object2)
+{
+	if (!record)
+		return;
+
+	RenderCommand command;
+	command.Type = (uint8_t)a_type;
+	command.Stage = a_stage;
+	command.Slot = a_slot;
+	command.Count = a_count;
+	command.Start = a_start;
+	command.Base = a_base;
+	command.Object = a_object;
+	command.Object2 = a_object2;
+	commands.push_back(command);
+}
+
+void RecordingBackend::BeginFrame()
+{
+	RenderBackend::BeginFrame();
+	commands.clear();
+}
+
+uint64_t RecordingBackend::HashCommands()
+{
+	//Field by field, so struct padding never leaks in
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < commands.size(); i++)
+	{
+		const RenderCommand& c = commands[i];
+		uint64_t fields[6] = { c.Type | ((uint64_t)c.Stage << 8) | ((uint64_t)c.Slot << 16), c.Count, c.Start, (uint64_t)(uint32_t)c.Base, c.Object, c.Object2 };
+		const unsigned char* bytes = (const unsigned char*)fields;
+		for (size_t b = 0; b < sizeof(fields); b++)
+		{
+			hash ^= bytes[b];
+			hash *= 1099511628211ULL;
+		}
+	}
+	return hash;
+}
+
+ID3D11Buffer* RecordingBackend::CreateBuffer(RenderBufferType /*a_type*/, unsigned int /*a_bytes*/, const void* /*a_initialData*/, bool /*a_dynamic*/)
+{
+	//Never dereferenced, only compared; keep them aligned like real pointers
+	Live(false)++;
+	return (ID3D11Buffer*)(uintptr_t)NextId();
+}
+
+void RecordingBackend::ReleaseBuffer(ID3D11Buffer* a_buffer)
+{
+	if (a_buffer)
+		Live(false)--;
+}
+
+//Ids from the same counter as buffers, so nothing ever compares equal by accident
+ID3D11RasterizerState* RecordingBackend::CreateRasterizerState(const D3D11_RASTERIZER_DESC& /*a_desc*/)
+{
+	Live(true)++;
+	return (ID3D11RasterizerState*)(uintptr_t)NextId();
+}
+
+ID3D11DepthStencilState* RecordingBackend::CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& /*a_desc*/)
+{
+	Live(true)++;
+	return (ID3D11DepthStencilState*)(uintptr_t)NextId();
+}
+
+ID3D11BlendState* RecordingBackend::CreateBlendState(const D3D11_BLEND_DESC& /*a_desc*/)
+{
+	Live(true)++;
+	return (ID3D11BlendState*)(uintptr_t)NextId();
+}
+
+ID3D11SamplerState* RecordingBackend::CreateSamplerState(const D3D11_SAMPLER_DESC& /*a_desc*/)
+{
+	Live(true)++;
+	return (ID3D11SamplerState*)(uintptr_t)NextId();
+}
+
+void RecordingBackend::ReleaseState(ID3D11DeviceChild* a_state)
+{
+	if (a_state)
+		Live(true)--;
+}
+
+void RecordingBackend::UpdateBuffer(ID3D11Buffer* a_buffer, const void* /*a_data*/, unsigned int a_bytes)
+{
+	Record(RENDER_COMMAND_UPDATE_BUFFER, (uintptr_t)a_buffer, a_bytes);
+	frame.Uploads++;
+	frame.BytesUploaded += a_bytes;
+}
+
+void RecordingBackend::WriteBuffer(ID3D11Buffer* a_buffer, const void* /*a_data*/, unsigned int a_bytes)
+{
+	Record(RENDER_COMMAND_WRITE_BUFFER, (uintptr_t)a_buffer, a_bytes);
+	frame.Uploads++;
+	frame.BytesUploaded += a_bytes;
+}
+
+void RecordingBackend::WriteBufferRange(ID3D11Buffer* a_buffer, unsigned int a_offset, const void* /*a_data*/, unsigned int a_bytes, bool a_discard)
+{
+	Record(RENDER_COMMAND_WRITE_BUFFER_RANGE, (uintptr_t)a_buffer, a_bytes, a_offset, a_discard ? 1 : 0);
+	frame.Uploads++;
+	frame.BytesUploaded += a_bytes;
+}
+
+void RecordingBackend::SetVertexBuffer(ID3D11Buffer* a_buffer, unsigned int a_stride, unsigned int a_offset)
+{
+	Record(RENDER_COMMAND_SET_VERTEX_BUFFER, (uintptr_t)a_buffer, a_stride, a_offset);
+	frame.StateChanges++;
+}
+
+void RecordingBackend::SetIndexBuffer(ID3D11Buffer* a_buffer)
+{
+	Record(RENDER_COMMAND_SET_INDEX_BUFFER, (uintptr_t)a_buffer);
+	frame.StateChanges++;
+}
+
+void RecordingBackend::SetInstanceBuffer(ID3D11Buffer* a_buffer, unsigned int a_stride, unsigned int a_offset)
+{
+	Record(RENDER_COMMAND_SET_INSTANCE_BUFFER, (uintptr_t)a_buffer, a_stride, a_offset);
+	frame.StateChanges++;
+}
+
+void RecordingBackend::SetInputLayout(ID3D11InputLayout* a_layout)
+{
+	Record(RENDER_COMMAND_SET_INPUT_LAYOUT, (uintptr_t)a_layout);
+	frame.StateChanges++;
+}
+
+void RecordingBackend::SetShader(RenderStage a_stage, ID3D11DeviceChild* a_shader)
+{
+	Record(RENDER_COMMAND_SET_SHADER, (uintptr_t)a_shader, 0, 0, 0, (uint8_t)a_stage);
+	frame.StateChanges++;
+}
+
+void RecordingBackend::SetConstantBuffer(RenderStage a_stage, unsigned int a_slot, ID3D11Buffer* a_buffer)
+{
+	Record(RENDER_COMMAND_SET_CONSTANT_BUFFER, (uintptr_t)a_buffer, 0, 0, 0, (uint8_t)a_stage, (uint16_t)a_slot);
+	frame.StateChanges++;
+}
+
+void RecordingBackend::SetShaderResource(RenderStage a_stage, unsigned int a_slot, ID3D11ShaderResourceView* a_srv)
+{
+	Record(RENDER_COMMAND_SET_SHADER_RESOURCE, (uintptr_t)a_srv, 0, 0, 0, (uint8_t)a_stage, (uint16_t)a_slot);
+	frame.StateChanges++;
+}
+
+void RecordingBackend::SetSampler(RenderStage a_stage, unsigned int a_slot, ID3D11SamplerState* a_sampler)
+{
+	Record(RENDER_COMMAND_SET_SAMPLER, (uintptr_t)a_sampler, 0, 0, 0, (uint8_t)a_stage, (uint16_t)a_slot);
+	frame.StateChanges++;
+}
+
+void RecordingBackend::SetUnorderedAccess(unsigned int a_slot, ID3D11UnorderedAccessView* a_uav, unsigned int a_initialCount)
+{
+	Record(RENDER_COMMAND_SET_UNORDERED_ACCESS, (uintptr_t)a_uav, a_initialCount, 0, 0, RENDER_STAGE_COMPUTE, (uint16_t)a_slot);
+	frame.StateChanges++;
+}
+
+void RecordingBackend::SetRasterizerState(ID3D11RasterizerState* a_state)
+{
+	Record(RENDER_COMMAND_SET_RASTERIZER_STATE, (uintptr_t)a_state);
+	frame.StateChanges++;
+}
+
+void RecordingBackend::SetBlendState(ID3D11BlendState* a_state, const float /*a_factor*/[4], unsigned int a_sampleMask)
+{
+	Record(RENDER_COMMAND_SET_BLEND_STATE, (uintptr_t)a_state, a_sampleMask);
+	frame.StateChanges++;
+}
+
+void RecordingBackend::SetDepthStencilState(ID3D11DepthStencilState* a_state, unsigned int a_stencilRef)
+{
+	Record(RENDER_COMMAND_SET_DEPTH_STENCIL_STATE, (uintptr_t)a_state, 0, 0, (int32_t)a_stencilRef);
+	frame.StateChanges++;
+}
+
+void RecordingBackend::SetRenderTarget(ID3D11RenderTargetView* a_target, ID3D11DepthStencilView* a_depth)
+{
+	Record(RENDER_COMMAND_SET_RENDER_TARGET, (uintptr_t)a_target, 0, 0, 0, 0, 0, (uintptr_t)a_depth);
+	frame.StateChanges++;
+}
+
+void RecordingBackend::SetViewport(float a_width, float a_height)
+{
+	Record(RENDER_COMMAND_SET_VIEWPORT, 0, (uint32_t)a_width, (uint32_t)a_height);
+	frame.StateChanges++;
+}
+
+void RecordingBackend::ClearRenderTarget(ID3D11RenderTargetView* a_target, const float /*a_color*/[4])
+{
+	Record(RENDER_COMMAND_CLEAR_RENDER_TARGET, (uintptr_t)a_target);
+	frame.Clears++;
+}
+
+void RecordingBackend::ClearDepth(ID3D11DepthStencilView* a_depth, float /*a_value*/, bool a_stencil)
+{
+	Record(RENDER_COMMAND_CLEAR_DEPTH, (uintptr_t)a_depth, a_stencil ? 1 : 0);
+	frame.Clears++;
+}
+
+void RecordingBackend::CopyResource(ID3D11Resource* a_dest, ID3D11Resource* a_source)
+{
+	Record(RENDER_COMMAND_COPY_RESOURCE, (uintptr_t)a_dest, 0, 0, 0, 0, 0, (uintptr_t)a_source);
+	frame.Copies++;
+}
+
+void RecordingBackend::DrawIndexed(unsigned int a_indexCount, unsigned int a_startIndex, int a_baseVertex)
+{
+	Record(RENDER_COMMAND_DRAW_INDEXED, 0, a_indexCount, a_startIndex, a_baseVertex);
+	frame.Draws++;
+	frame.Indices += a_indexCount;
+}
+
+void RecordingBackend::DrawIndexedInstanced(unsigned int a_indexCount, unsigned int a_instanceCount, unsigned int a_startIndex, int a_baseVertex, unsigned int a_startInstance)
+{
+	Record(RENDER_COMMAND_DRAW_INDEXED_INSTANCED, a_instanceCount, a_indexCount, a_startIndex, a_baseVertex, 0, 0, a_startInstance);
+	frame.Draws++;
+	frame.Indices += a_indexCount * a_instanceCount;
+	frame.Instances += a_instanceCount;
+}
+
+void RecordingBackend::Draw(unsigned int a_vertexCount, unsigned int a_startVertex)
+{
+	Record(RENDER_COMMAND_DRAW, 0, a_vertexCount, a_startVertex);
+	frame.Draws++;
+	frame.Indices += a_vertexCount;
+}
+
+void RecordingBackend::Dispatch(unsigned int a_groupsX, unsigned int a_groupsY, unsigned int a_groupsZ)
+{
+	Record(RENDER_COMMAND_DISPATCH, 0, a_groupsX, a_groupsY, (int32_t)a_groupsZ);
+	frame.Draws++;
+}
+
+RenderBackend* RecordingBackend::CreateDeferred()
+{
+	RecordingBackend* deferred = new RecordingBackend(record);
+	deferred->owner = this;
+	return deferred;
+}
+
+RenderCommandList* RecordingBackend::FinishCommandList()
+{
+	//Copied out, so the next list reuses this one's memory
+	RecordingCommandList* list = new RecordingCommandList();
+	list->Commands = commands;
+	commands.clear();
+	TakeFrameStats(list);
+	return list;
+}
+
+void RecordingBackend::ExecuteCommandList(RenderCommandList* a_list)
+{
+	RecordingCommandList* list = (RecordingCommandList*)a_list;
+	if (record)
+		commands.insert(commands.end(), list->Commands.begin(), list->Commands.end());
+	AddFrameStats(list->Stats);
+	delete list;
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include "RenderBackend.h"
+
+enum RenderCommandType
+{
+	RENDER_COMMAND_UPDATE_BUFFER,
+	RENDER_COMMAND_WRITE_BUFFER,
+	RENDER_COMMAND_SET_VERTEX_BUFFER,
+	RENDER_COMMAND_SET_INDEX_BUFFER,
+	RENDER_COMMAND_SET_INSTANCE_BUFFER,
+	RENDER_COMMAND_SET_INPUT_LAYOUT,
+	RENDER_COMMAND_SET_SHADER,
+	RENDER_COMMAND_SET_CONSTANT_BUFFER,
+	RENDER_COMMAND_SET_SHADER_RESOURCE,
+	RENDER_COMMAND_SET_SAMPLER,
+	RENDER_COMMAND_SET_UNORDERED_ACCESS,
+	RENDER_COMMAND_SET_RASTERIZER_STATE,
+	RENDER_COMMAND_SET_BLEND_STATE,
+	RENDER_COMMAND_SET_DEPTH_STENCIL_STATE,
+	RENDER_COMMAND_SET_RENDER_TARGET,
+	RENDER_COMMAND_SET_VIEWPORT,
+	RENDER_COMMAND_CLEAR_RENDER_TARGET,
+	RENDER_COMMAND_CLEAR_DEPTH,
+	RENDER_COMMAND_COPY_RESOURCE,
+	RENDER_COMMAND_DRAW_INDEXED,
+	RENDER_COMMAND_DRAW_INDEXED_INSTANCED,
+	RENDER_COMMAND_DRAW,
+	RENDER_COMMAND_DISPATCH,
+	RENDER_COMMAND_WRITE_BUFFER_RANGE
+};
+
+// One backend call.  Objects are kept as their pointer values,
+// which is all the recording needs to tell them apart
+struct RenderCommand
+{
+	uint8_t Type;
+	uint8_t Stage;
+	uint16_t Slot;
+	uint32_t Count;		// Bytes, indices, stride, width...
+	uint32_t Start;		// Start index, offset, height...
+	int32_t Base;		// Base vertex, stencil ref...
+	uint64_t Object;
+	uint64_t Object2;
+};
+
+// --------------------------------------------------------
+// RenderBackend with no GPU behind it.  Counts every frame
+// exactly like D3D11Backend and, unless created as a null
+// backend, also keeps the frame's calls as a command list
+// that can be inspected or hashed to catch regressions.
+//
+// Buffers and states it creates are just unique ids; nothing
+// is ever uploaded anywhere.
+//
+// Its deferred backends keep each list's commands in memory
+// and take ids from this one, so ids stay unique across
+// threads.  Running a list appends its commands here.
+// --------------------------------------------------------
+class RecordingBackend : public RenderBackend
+{
+public:
+	// a_record false = null backend: count only, keep nothing
+	RecordingBackend(bool a_record = true);
+
+	ID3D11Buffer* CreateBuffer(RenderBufferType a_type, unsigned int a_bytes, const void* a_initialData, bool a_dynamic);
+	void ReleaseBuffer(ID3D11Buffer* a_buffer);
+	void UpdateBuffer(ID3D11Buffer* a_buffer, const void* a_data, unsigned int a_bytes);
+	void WriteBuffer(ID3D11Buffer* a_buffer, const void* a_data, unsigned int a_bytes);
+	void WriteBufferRange(ID3D11Buffer* a_buffer, unsigned int a_offset, const void* a_data, unsigned int a_bytes, bool a_discard);
+
+	ID3D11RasterizerState* CreateRasterizerState(const D3D11_RASTERIZER_DESC& a_desc);
+	ID3D11DepthStencilState* CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& a_desc);
+	ID3D11BlendState* CreateBlendState(const D3D11_BLEND_DESC& a_desc);
+	ID3D11SamplerState* CreateSamplerState(const D3D11_SAMPLER_DESC& a_desc);
+	void ReleaseState(ID3D11DeviceChild* a_state);
+
+	void SetVertexBuffer(ID3D11Buffer* a_buffer, unsigned int a_stride, unsigned int a_offset);
+	void SetIndexBuffer(ID3D11Buffer* a_buffer);
+	void SetInstanceBuffer(ID3D11Buffer* a_buffer, unsigned int a_stride, unsigned int a_offset);
+	void SetInputLayout(ID3D11InputLayout* a_layout);
+
+	void SetShader(RenderStage a_stage, ID3D11DeviceChild* a_shader);
+	void SetConstantBuffer(RenderStage a_stage, unsigned int a_slot, ID3D11Buffer* a_buffer);
+	void SetShaderResource(RenderStage a_stage, unsigned int a_slot, ID3D11ShaderResourceView* a_srv);
+	void SetSampler(RenderStage a_stage, unsigned int a_slot, ID3D11SamplerState* a_sampler);
+	void SetUnorderedAccess(unsigned int a_slot, ID3D11UnorderedAccessView* a_uav, unsigned int a_initialCount);
+
+	void SetRasterizerState(ID3D11RasterizerState* a_state);
+	void SetBlendState(ID3D11BlendState* a_state, const float a_factor[4], unsigned int a_sampleMask);
+	void SetDepthStencilState(ID3D11DepthStencilState* a_state, unsigned int a_stencilRef);
+	void SetRenderTarget(ID3D11RenderTargetView* a_target, ID3D11DepthStencilView* a_depth);
+	void SetViewport(float a_width, float a_height);
+
+	void ClearRenderTarget(ID3D11RenderTargetView* a_target, const float a_color[4]);
+	void ClearDepth(ID3D11DepthStencilView* a_depth, float a_value, bool a_stencil);
+	void CopyResource(ID3D11Resource* a_dest, ID3D11Resource* a_source);
+
+	void DrawIndexed(unsigned int a_indexCount, unsigned int a_startIndex, int a_baseVertex);
+	void DrawIndexedInstanced(unsigned int a_indexCount, unsigned int a_instanceCount, unsigned int a_startIndex, int a_baseVertex, unsigned int a_startInstance);
+	void Draw(unsigned int a_vertexCount, unsigned int a_startVertex);
+	void Dispatch(unsigned int a_groupsX, unsigned int a_groupsY, unsigned int a_groupsZ);
+
+	RenderBackend* CreateDeferred();
+	RenderCommandList* FinishCommandList();
+	void ExecuteCommandList(RenderCommandList* a_list);
+
+	// Drops the last frame's commands (their memory is reused)
+	void BeginFrame();
+
+	const std::vector<RenderCommand>& GetCommands() { return commands; }
+
+	// FNV-1a over this frame's commands; equal frames hash equal
+	uint64_t HashCommands();
+
+	int GetLiveBuffers() { return liveBuffers; }
+	int GetLiveStates() { return liveStates; }
+
+private:
+	bool record;
+	std::vector<RenderCommand> commands;
+
+	//Deferred backends count on the one that made them (0 here)
+	RecordingBackend* owner;
+	std::atomic<uint64_t> nextBuffer;
+	std::atomic<int> liveBuffers;
+	std::atomic<int> liveStates;
+
+	uint64_t NextId() { return owner ? owner->NextId() : nextBuffer++ << 4; }
+	std::atomic<int>& Live(bool a_state) { return owner ? owner->Live(a_state) : (a_state ? liveStates : liveBuffers); }
+
+	void Record(RenderCommandType a_type, uint64_t a_object, uint32_t a_count = 0, uint32_t a_start = 0, int32_t a_base = 0, uint8_t a_stage = 0, uint16_t a_slot = 0, uint64_t a_object2 = 0);
+};
@@ -0,0 +1,32 @@
+#include "RenderBackend.h"
+#include <cstring>
+
+RenderBackend::RenderBackend()
+{
+	memset(&frame, 0, sizeof(frame));
+	memset(&lastFrame, 0, sizeof(lastFrame));
+}
+
+void RenderBackend::BeginFrame()
+{
+	lastFrame = frame;
+	memset(&frame, 0, sizeof(frame));
+}
+
+void RenderBackend::TakeFrameStats(RenderCommandList* a_list)
+{
+	a_list->Stats = frame;
+	memset(&frame, 0, sizeof(frame));
+}
+
+void RenderBackend::AddFrameStats(const RenderFrameStats& a_stats)
+{
+	frame.Draws += a_stats.Draws;
+	frame.Indices += a_stats.Indices;
+	frame.Instances += a_stats.Instances;
+	frame.StateChanges += a_stats.StateChanges;
+	frame.Uploads += a_stats.Uploads;
+	frame.BytesUploaded += a_stats.BytesUploaded;
+	frame.Clears += a_stats.Clears;
+	frame.Copies += a_stats.Copies;
+}
@@ -0,0 +1,161 @@
+#pragma once
+#include <cstdint>
+
+// D3D objects only pass through here by pointer, so this header
+// (and the recording backend) build without the D3D headers
+struct ID3D11Buffer;
+struct ID3D11Resource;
+struct ID3D11InputLayout;
+struct ID3D11DeviceChild;
+struct ID3D11ShaderResourceView;
+struct ID3D11UnorderedAccessView;
+struct ID3D11SamplerState;
+struct ID3D11RasterizerState;
+struct ID3D11BlendState;
+struct ID3D11DepthStencilState;
+struct ID3D11RenderTargetView;
+struct ID3D11DepthStencilView;
+struct D3D11_RASTERIZER_DESC;
+struct D3D11_DEPTH_STENCIL_DESC;
+struct D3D11_BLEND_DESC;
+struct D3D11_SAMPLER_DESC;
+
+enum RenderStage
+{
+	RENDER_STAGE_VERTEX,
+	RENDER_STAGE_HULL,
+	RENDER_STAGE_DOMAIN,
+	RENDER_STAGE_GEOMETRY,
+	RENDER_STAGE_PIXEL,
+	RENDER_STAGE_COMPUTE,
+	RENDER_STAGE_COUNT
+};
+
+enum RenderBufferType
+{
+	RENDER_BUFFER_VERTEX,
+	RENDER_BUFFER_INDEX,
+	RENDER_BUFFER_CONSTANT
+};
+
+// What one frame asked of the backend
+struct RenderFrameStats
+{
+	uint32_t Draws;				// DrawIndexed, DrawIndexedInstanced, Draw and Dispatch calls
+	uint32_t Indices;			// Indices and vertices drawn, every instance counted
+	uint32_t Instances;			// Instances drawn by instanced draws
+	uint32_t StateChanges;		// Every Set* call: shaders, buffers, resources, fixed-function state
+	uint32_t Uploads;			// Buffer updates
+	uint64_t BytesUploaded;
+	uint32_t Clears;
+	uint32_t Copies;			// Whole resources copied on the GPU
+};
+
+// --------------------------------------------------------
+// Calls recorded on a deferred backend, waiting to be run
+// on the backend it came from.  Each backend keeps its own
+// kind of list behind this; Stats is what recording it
+// counted, added to that backend's frame when it runs.
+// --------------------------------------------------------
+class RenderCommandList
+{
+public:
+	virtual ~RenderCommandList() {}
+
+	RenderFrameStats Stats;
+};
+
+// --------------------------------------------------------
+// Everything the renderer does to the GPU once resources
+// exist: uploads, binds, fixed-function state and draws.
+// D3D11Backend sends it to a device context; the recording
+// backend keeps a command list and counts it instead, so
+// render code can run and be measured without a GPU.
+//
+// Both count the same things per frame, between calls to
+// BeginFrame().
+//
+// A deferred backend (CreateDeferred()) records instead of
+// drawing, so passes can be recorded on other threads and
+// run later, in order, from the one that made it.
+// --------------------------------------------------------
+class RenderBackend
+{
+public:
+	RenderBackend();
+	virtual ~RenderBackend() {}
+
+	// Buffers.  Dynamic buffers are rewritten whole with WriteBuffer(),
+	// the rest with UpdateBuffer()
+	virtual ID3D11Buffer* CreateBuffer(RenderBufferType a_type, unsigned int a_bytes, const void* a_initialData, bool a_dynamic) = 0;
+	virtual void ReleaseBuffer(ID3D11Buffer* a_buffer) = 0;
+	virtual void UpdateBuffer(ID3D11Buffer* a_buffer, const void* a_data, unsigned int a_bytes) = 0;
+	virtual void WriteBuffer(ID3D11Buffer* a_buffer, const void* a_data, unsigned int a_bytes) = 0;
+	// Writes part of a dynamic buffer.  Unless a_discard, the rest must be
+	// left alone, since the GPU may still be reading it (NO_OVERWRITE)
+	virtual void WriteBufferRange(ID3D11Buffer* a_buffer, unsigned int a_offset, const void* a_data, unsigned int a_bytes, bool a_discard) = 0;
+
+	// Fixed-function and sampler state objects.  Each call makes a new
+	// one; RenderStateCache shares one per distinct description
+	virtual ID3D11RasterizerState* CreateRasterizerState(const D3D11_RASTERIZER_DESC& a_desc) = 0;
+	virtual ID3D11DepthStencilState* CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& a_desc) = 0;
+	virtual ID3D11BlendState* CreateBlendState(const D3D11_BLEND_DESC& a_desc) = 0;
+	virtual ID3D11SamplerState* CreateSamplerState(const D3D11_SAMPLER_DESC& a_desc) = 0;
+	virtual void ReleaseState(ID3D11DeviceChild* a_state) = 0;
+
+	// Input assembler (indices are always 32 bit, triangle lists)
+	virtual void SetVertexBuffer(ID3D11Buffer* a_buffer, unsigned int a_stride, unsigned int a_offset) = 0;
+	virtual void SetIndexBuffer(ID3D11Buffer* a_buffer) = 0;
+	// Per-instance data goes in input slot 1, where SimpleVertexShader
+	// puts semantics ending in _PER_INSTANCE
+	virtual void SetInstanceBuffer(ID3D11Buffer* a_buffer, unsigned int a_stride, unsigned int a_offset) = 0;
+	virtual void SetInputLayout(ID3D11InputLayout* a_layout) = 0;
+
+	// Shaders and what they read; a_shader must match the stage (0 unbinds)
+	virtual void SetShader(RenderStage a_stage, ID3D11DeviceChild* a_shader) = 0;
+	virtual void SetConstantBuffer(RenderStage a_stage, unsigned int a_slot, ID3D11Buffer* a_buffer) = 0;
+	virtual void SetShaderResource(RenderStage a_stage, unsigned int a_slot, ID3D11ShaderResourceView* a_srv) = 0;
+	virtual void SetSampler(RenderStage a_stage, unsigned int a_slot, ID3D11SamplerState* a_sampler) = 0;
+	virtual void SetUnorderedAccess(unsigned int a_slot, ID3D11UnorderedAccessView* a_uav, unsigned int a_initialCount) = 0;
+
+	// Fixed-function state (0 = the D3D default)
+	virtual void SetRasterizerState(ID3D11RasterizerState* a_state) = 0;
+	virtual void SetBlendState(ID3D11BlendState* a_state, const float a_factor[4], unsigned int a_sampleMask) = 0;
+	virtual void SetDepthStencilState(ID3D11DepthStencilState* a_state, unsigned int a_stencilRef) = 0;
+	virtual void SetRenderTarget(ID3D11RenderTargetView* a_target, ID3D11DepthStencilView* a_depth) = 0;
+	virtual void SetViewport(float a_width, float a_height) = 0;
+
+	virtual void ClearRenderTarget(ID3D11RenderTargetView* a_target, const float a_color[4]) = 0;
+	virtual void ClearDepth(ID3D11DepthStencilView* a_depth, float a_value, bool a_stencil) = 0;
+
+	// GPU side; both must be the same size and format
+	virtual void CopyResource(ID3D11Resource* a_dest, ID3D11Resource* a_source) = 0;
+
+	virtual void DrawIndexed(unsigned int a_indexCount, unsigned int a_startIndex, int a_baseVertex) = 0;
+	virtual void DrawIndexedInstanced(unsigned int a_indexCount, unsigned int a_instanceCount, unsigned int a_startIndex, int a_baseVertex, unsigned int a_startInstance) = 0;
+	virtual void Draw(unsigned int a_vertexCount, unsigned int a_startVertex) = 0;
+	virtual void Dispatch(unsigned int a_groupsX, unsigned int a_groupsY, unsigned int a_groupsZ) = 0;
+
+	// A backend recording into command lists for this one, or 0 if it
+	// can't.  Use it from one thread at a time; what it creates belongs
+	// to this backend.  Every list it records starts with nothing bound
+	virtual RenderBackend* CreateDeferred() = 0;
+	// On a deferred backend: everything recorded since the last call
+	virtual RenderCommandList* FinishCommandList() = 0;
+	// Runs a_list here and deletes it.  Leaves nothing bound afterwards
+	virtual void ExecuteCommandList(RenderCommandList* a_list) = 0;
+
+	// Call once at the start of each frame
+	virtual void BeginFrame();
+	const RenderFrameStats& GetFrameStats() { return frame; }
+	const RenderFrameStats& GetLastFrameStats() { return lastFrame; }
+
+protected:
+	RenderFrameStats frame;
+	RenderFrameStats lastFrame;
+
+	// Moves the counts so far into a_list, for a list being finished
+	void TakeFrameStats(RenderCommandList* a_list);
+	// Counts a list being run as part of this frame
+	void AddFrameStats(const RenderFrameStats& a_stats);
+};
@@ -0,0 +1,408 @@
+#include "RenderQueue.h"
+#include "Mesh.h"
+#include <cstring>
+
+//Hashed at compile time, so binding by name never builds a string
+static constexpr SimpleShaderName SHADER_WORLD("world");
+static constexpr SimpleShaderName SHADER_VIEW("view");
+static constexpr SimpleShaderName SHADER_PROJECTION("projection");
+static constexpr SimpleShaderName SHADER_TEXTURE("srv");
+static constexpr SimpleShaderName SHADER_NORMAL_MAP("NormalMap");
+
+RenderQueue::RenderQueue()
+{
+	sorted = false;
+	hasCamera = false;
+	constants = 0;
+	instanceBuffer = 0;
+	instanceOwner = 0;
+	instanceCapacity = 0;
+	ring = 0;
+	memset(&frame, 0, sizeof(frame));
+	memset(&lastFrame, 0, sizeof(lastFrame));
+}
+
+RenderQueue::~RenderQueue()
+{
+	if (instanceBuffer)
+		instanceOwner->ReleaseBuffer(instanceBuffer);
+}
+
+void RenderQueue::SetInstancedShader(SimpleVertexShader* a_vs, SimpleVertexShader* a_instanced)
+{
+	for (size_t i = 0; i < instancedShaders.size(); i += 2)
+	{
+		if (instancedShaders[i] == a_vs)
+		{
+			instancedShaders[i + 1] = a_instanced;
+			return;
+		}
+	}
+
+	instancedShaders.push_back(a_vs);
+	instancedShaders.push_back(a_instanced);
+}
+
+SimpleVertexShader* RenderQueue::FindInstanced(SimpleVertexShader* a_vs)
+{
+	for (size_t i = 0; i < instancedShaders.size(); i += 2)
+	{
+		if (instancedShaders[i] == a_vs)
+			return instancedShaders[i + 1];
+	}
+	return 0;
+}
+
+void RenderQueue::BeginFrame()
+{
+	lastFrame = frame;
+	memset(&frame, 0, sizeof(frame));
+}
+
+void RenderQueue::Begin()
+{
+	//Keeps the memory; a frame's worth of draws is allocated once
+	items.clear();
+	sorted = false;
+}
+
+void RenderQueue::SetCamera(const XMFLOAT4X4& a_view, const XMFLOAT4X4& a_proj)
+{
+	view = a_view;
+	projection = a_proj;
+	hasCamera = true;
+}
+
+//A handful of each per scene, so a scan beats hashing
+uint64_t RenderQueue::Intern(std::vector<const void*>& a_seen, const void* a_first, const void* a_second, int a_bits)
+{
+	size_t count = a_seen.size() / 2;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (a_seen[i * 2] == a_first && a_seen[i * 2 + 1] == a_second)
+			return i < ((uint64_t)1 << a_bits) ? i : ((uint64_t)1 << a_bits) - 1;
+	}
+
+	a_seen.push_back(a_first);
+	a_seen.push_back(a_second);
+	return count < ((uint64_t)1 << a_bits) ? count : ((uint64_t)1 << a_bits) - 1;
+}
+
+uint64_t RenderQueue::DepthBits(GameEntity* a_entity)
+{
+	if (!hasCamera)
+		return 0;
+
+	//The view matrix is stored transposed, so view z is its third row
+	XMFLOAT3 position = a_entity->GetWorldPosition();
+	float depth = view._31 * position.x + view._32 * position.y + view._33 * position.z + view._34;
+	if (!(depth > 0.0f))
+		depth = 0.0f;
+
+	//Positive floats order the same as their bits; the top 16 keep
+	//the exponent and 7 bits of mantissa, plenty for front to back
+	uint32_t bits;
+	memcpy(&bits, &depth, sizeof(bits));
+	return bits >> (32 - DEPTH_BITS);
+}
+
+void RenderQueue::Submit(RenderPass a_pass, GameEntity* a_entity, SimpleVertexShader* a_vs, SimplePixelShader* a_ps,
+	ID3D11ShaderResourceView* a_texture, ID3D11ShaderResourceView* a_normalMap)
+{
+	//Nothing to draw
+	if (!a_entity->GetMesh())
+		return;
+
+	Item item;
+	item.Entity = a_entity;
+	item.EntityMesh = a_entity->GetMesh();
+	item.VS = a_vs;
+	item.PS = a_ps;
+	item.Texture = a_texture;
+	item.NormalMap = a_normalMap;
+
+	uint64_t key = (uint64_t)a_pass;
+	key = (key << SHADER_BITS) | Intern(shaderPairs, a_vs, a_ps, SHADER_BITS);
+	key = (key << MATERIAL_BITS) | Intern(materials, a_entity->getMaterial(), 0, MATERIAL_BITS);
+	key = (key << TEXTURE_BITS) | Intern(texturePairs, a_texture, a_normalMap, TEXTURE_BITS);
+	key = (key << MESH_BITS) | Intern(meshes, item.EntityMesh, 0, MESH_BITS);
+	key = (key << DEPTH_BITS) | DepthBits(a_entity);
+	item.Key = key;
+
+	items.push_back(item);
+	sorted = false;
+	frame.Submitted++;
+}
+
+void RenderQueue::Sort()
+{
+	if (sorted)
+		return;
+
+	uint32_t count = (uint32_t)items.size();
+	order.resize(count);
+	scratch.resize(count);
+	keys.resize(count);
+	keyScratch.resize(count);
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		order[i] = i;
+		keys[i] = items[i].Key;
+	}
+
+	//Least significant byte first; each pass is stable, so earlier
+	//bytes stay in order within equal later ones
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		uint32_t buckets[256] = {};
+		for (uint32_t i = 0; i < count; i++)
+			buckets[(keys[i] >> shift) & 0xFF]++;
+
+		//Every key has the same byte here (most do, most of the time)
+		if (count == 0 || buckets[(keys[0] >> shift) & 0xFF] == count)
+			continue;
+
+		uint32_t offset = 0;
+		for (int b = 0; b < 256; b++)
+		{
+			uint32_t size = buckets[b];
+			buckets[b] = offset;
+			offset += size;
+		}
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			uint32_t position = buckets[(keys[i] >> shift) & 0xFF]++;
+			keyScratch[position] = keys[i];
+			scratch[position] = order[i];
+		}
+
+		keys.swap(keyScratch);
+		order.swap(scratch);
+	}
+
+	sorted = true;
+}
+
+//Everything but the world matrix
+bool RenderQueue::SameState(const Item& a_first, const Item& a_second)
+{
+	return a_first.VS == a_second.VS &&
+		a_first.PS == a_second.PS &&
+		a_first.Texture == a_second.Texture &&
+		a_first.NormalMap == a_second.NormalMap &&
+		a_first.EntityMesh == a_second.EntityMesh;
+}
+
+void RenderQueue::BuildBatches()
+{
+	batches.clear();
+	instanceData.clear();
+
+	//Single draws of the current shader pair, held back until its
+	//instanced batches are out, so the two vertex shaders don't take
+	//turns being bound
+	singles.clear();
+
+	uint32_t count = (uint32_t)order.size();
+	for (uint32_t start = 0; start < count;)
+	{
+		const Item& first = items[order[start]];
+		if (start > 0)
+		{
+			const Item& previous = items[order[start - 1]];
+			if (first.VS != previous.VS || first.PS != previous.PS)
+				FlushSingles();
+		}
+
+		//Sorting put everything with the same state next to each other
+		uint32_t end = start + 1;
+		while (end < count && SameState(first, items[order[end]]))
+			end++;
+
+		Batch batch;
+		batch.Start = start;
+		batch.Count = end - start;
+		batch.Instance = -1;
+
+		if (batch.Count >= (uint32_t)MIN_INSTANCES && FindInstanced(first.VS))
+		{
+			batch.Instance = (int)instanceData.size();
+			for (uint32_t i = start; i < end; i++)
+				instanceData.push_back(items[order[i]].Entity->GetWorldMatrix());
+			batches.push_back(batch);
+		}
+		else
+		{
+			//Drawn one at a time, but still only bound once
+			batch.Count = 1;
+			for (uint32_t i = start; i < end; i++)
+			{
+				batch.Start = i;
+				singles.push_back(batch);
+			}
+		}
+
+		start = end;
+	}
+
+	FlushSingles();
+}
+
+void RenderQueue::FlushSingles()
+{
+	batches.insert(batches.end(), singles.begin(), singles.end());
+	singles.clear();
+}
+
+void RenderQueue::UploadInstances(RenderBackend* a_backend)
+{
+	uint32_t needed = (uint32_t)instanceData.size();
+
+	if (ring)
+	{
+		TransientAllocation allocation = ring->Upload(&instanceData[0], needed * sizeof(XMFLOAT4X4));
+		a_backend->SetInstanceBuffer(allocation.Buffer, sizeof(XMFLOAT4X4), allocation.Offset);
+		return;
+	}
+
+	//Grows to fit the biggest view yet and stays there
+	if (needed > instanceCapacity || a_backend != instanceOwner)
+	{
+		if (instanceBuffer)
+			instanceOwner->ReleaseBuffer(instanceBuffer);
+
+		uint32_t capacity = instanceCapacity > 0 ? instanceCapacity : 256;
+		while (capacity < needed)
+			capacity *= 2;
+
+		instanceBuffer = a_backend->CreateBuffer(RENDER_BUFFER_VERTEX, capacity * sizeof(XMFLOAT4X4), 0, true);
+		instanceOwner = a_backend;
+		instanceCapacity = capacity;
+	}
+
+	a_backend->WriteBuffer(instanceBuffer, &instanceData[0], needed * sizeof(XMFLOAT4X4));
+	a_backend->SetInstanceBuffer(instanceBuffer, sizeof(XMFLOAT4X4), 0);
+}
+
+void RenderQueue::Execute(RenderBackend* a_backend)
+{
+	Sort();
+	BuildBatches();
+
+	//Every instanced batch of the view in one upload
+	if (!instanceData.empty())
+		UploadInstances(a_backend);
+
+	//The view's camera, once for every shader
+	if (hasCamera && constants)
+		constants->SetPass(view, projection);
+
+	//What the previous draw left bound
+	SimpleVertexShader* vs = 0;
+	SimplePixelShader* ps = 0;
+	ID3D11ShaderResourceView* texture = 0;
+	ID3D11ShaderResourceView* normalMap = 0;
+	Mesh* mesh = 0;
+	bool first = true;
+	bool vsUploaded = false;
+	const SimpleShaderVariable* worldVariable = 0;
+
+	for (size_t b = 0; b < batches.size(); b++)
+	{
+		const Batch& batch = batches[b];
+		const Item& item = items[order[batch.Start]];
+		SimpleVertexShader* batchVS = batch.Instance >= 0 ? FindInstanced(item.VS) : item.VS;
+
+		if (first || batchVS != vs)
+		{
+			vs = batchVS;
+			if (hasCamera && !constants)
+			{
+				vs->SetMatrix4x4(SHADER_VIEW, view);
+				vs->SetMatrix4x4(SHADER_PROJECTION, projection);
+			}
+			vs->SetTarget(a_backend);
+			vs->SetShader();
+			worldVariable = vs->GetVariableInfo(SHADER_WORLD);
+			vsUploaded = false;
+			frame.ShaderBinds++;
+		}
+		else
+		{
+			frame.SkippedBinds++;
+		}
+
+		//A different pixel shader may put its textures in other slots
+		if (first || item.PS != ps)
+		{
+			ps = item.PS;
+			if (ps)
+			{
+				//Its data is per view, not per object, so once is enough
+				ps->SetTarget(a_backend);
+				ps->CopyAllBufferData();
+				ps->SetShader();
+			}
+			else
+			{
+				a_backend->SetShader(RENDER_STAGE_PIXEL, 0);
+			}
+			texture = 0;
+			normalMap = 0;
+			frame.ShaderBinds++;
+		}
+		else
+		{
+			frame.SkippedBinds++;
+		}
+
+		if (ps && (item.Texture != texture || item.NormalMap != normalMap))
+		{
+			if (item.Texture != texture)
+				ps->SetShaderResourceView(SHADER_TEXTURE, item.Texture);
+			if (item.NormalMap != normalMap)
+				ps->SetShaderResourceView(SHADER_NORMAL_MAP, item.NormalMap);
+			texture = item.Texture;
+			normalMap = item.NormalMap;
+			frame.TextureBinds++;
+		}
+		else if (ps)
+		{
+			frame.SkippedBinds++;
+		}
+
+		if (first || item.EntityMesh != mesh)
+		{
+			mesh = item.EntityMesh;
+			a_backend->SetVertexBuffer(mesh->GetVertexBuffer(), sizeof(Vertex), 0);
+			a_backend->SetIndexBuffer(mesh->GetIndexBuffer());
+			frame.MeshBinds++;
+		}
+		else
+		{
+			frame.SkippedBinds++;
+		}
+
+		if (batch.Instance >= 0)
+		{
+			//World matrices are already in the instance buffer
+			if (!vsUploaded)
+				vs->CopyAllBufferData();
+			vsUploaded = true;
+
+			a_backend->DrawIndexedInstanced(mesh->GetIndexCount(), batch.Count, 0, 0, (unsigned int)batch.Instance);
+			frame.InstancedDraws++;
+			frame.Instances += batch.Count;
+		}
+		else
+		{
+			//The only thing every draw needs of its own
+			vs->SetMatrix4x4(worldVariable, item.Entity->GetWorldMatrix());
+			vs->CopyAllBufferData();
+			a_backend->DrawIndexed(mesh->GetIndexCount(), 0, 0);
+		}
+		first = false;
+	}
+}
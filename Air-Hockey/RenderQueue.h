@@ -0,0 +1,177 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+#include "RenderBackend.h"
+#include "SimpleShader.h"
+#include "GameEntity.h"
+#include "ShaderConstants.h"
+#include "TransientRing.h"
+
+using namespace DirectX;
+
+// Coarsest sort field; passes always draw in this order
+enum RenderPass
+{
+	RENDER_PASS_SHADOW,
+	RENDER_PASS_OPAQUE,
+	RENDER_PASS_DEBUG,
+	RENDER_PASS_COUNT
+};
+
+// What a frame's walk bound, against what binding everything
+// for every draw would have cost
+struct RenderQueueStats
+{
+	uint32_t Submitted;
+	uint32_t ShaderBinds;
+	uint32_t TextureBinds;
+	uint32_t MeshBinds;
+	uint32_t SkippedBinds;
+	uint32_t InstancedDraws;	// Batches drawn with one instanced draw
+	uint32_t Instances;			// Entities drawn by those
+};
+
+// --------------------------------------------------------
+// Collects a view's draws, sorts them so draws sharing
+// state end up next to each other, then draws them binding
+// only what changed since the previous draw.
+//
+// Each submission gets a 64 bit key, most significant first:
+//
+//   pass 4 | shaders 8 | material 8 | textures 12 | mesh 16 | depth 16
+//
+// Shaders, materials, texture pairs and meshes are numbered
+// the first time they're seen and keep that number, so the
+// order is stable from frame to frame.  Depth is view space,
+// front to back.  Keys are radix sorted, a byte at a time.
+//
+// Binds are skipped by comparing the objects themselves, so
+// running out of numbers only costs sort quality.
+//
+// Runs of draws that need exactly the same state become one
+// instanced draw when their vertex shader has an instanced
+// version (see SetInstancedShader()).  Their world matrices
+// go in one dynamic instance buffer, written once per view,
+// or in the frame's TransientRing if it has one.
+// --------------------------------------------------------
+class RenderQueue
+{
+public:
+	RenderQueue();
+	~RenderQueue();
+
+	// a_instanced reads the world matrix (as GetWorldMatrix() returns
+	// it) from WORLD_PER_INSTANCE0..3 instead of its constant buffer,
+	// and is drawn in place of a_vs for runs of MIN_INSTANCES or more
+	void SetInstancedShader(SimpleVertexShader* a_vs, SimpleVertexShader* a_instanced);
+
+	// Clears last view's submissions
+	void Begin();
+
+	// View and projection as the shaders get them (transposed); written
+	// once per view to the shared constants if there are any, or else set
+	// on every vertex shader bound.  Also used for the depth part of the key
+	void SetCamera(const XMFLOAT4X4& a_view, const XMFLOAT4X4& a_proj);
+
+	// Where SetCamera()'s matrices go; 0 (the default) sets them per shader
+	void SetShaderConstants(ShaderConstants* a_constants) { constants = a_constants; }
+
+	// Where instance matrices go; 0 (the default) keeps a buffer of the
+	// queue's own.  a_ring must write through the backend drawn with
+	void SetTransientRing(TransientRing* a_ring) { ring = a_ring; }
+
+	// a_ps may be 0 (depth only); entities without a mesh are ignored.
+	// The textures go to the pixel shader's "srv" and "NormalMap"
+	void Submit(RenderPass a_pass, GameEntity* a_entity, SimpleVertexShader* a_vs, SimplePixelShader* a_ps,
+		ID3D11ShaderResourceView* a_texture, ID3D11ShaderResourceView* a_normalMap);
+
+	// Sorts and draws everything submitted since Begin(), shaders
+	// included, through a_backend
+	void Execute(RenderBackend* a_backend);
+
+	// Sorts without drawing; Execute() does this itself
+	void Sort();
+
+	int GetCount() { return (int)items.size(); }
+	uint64_t GetSortedKey(int a_index) { return items[order[a_index]].Key; }
+
+	// Counters since the last call to BeginFrame()
+	void BeginFrame();
+	const RenderQueueStats& GetFrameStats() { return frame; }
+	const RenderQueueStats& GetLastFrameStats() { return lastFrame; }
+
+	static const int PASS_BITS = 4;
+	static const int SHADER_BITS = 8;
+	static const int MATERIAL_BITS = 8;
+	static const int TEXTURE_BITS = 12;
+	static const int MESH_BITS = 16;
+	static const int DEPTH_BITS = 16;
+
+	static const int MIN_INSTANCES = 2;
+
+private:
+	struct Item
+	{
+		uint64_t Key;
+		GameEntity* Entity;
+		Mesh* EntityMesh;
+		SimpleVertexShader* VS;
+		SimplePixelShader* PS;
+		ID3D11ShaderResourceView* Texture;
+		ID3D11ShaderResourceView* NormalMap;
+	};
+
+	std::vector<Item> items;
+
+	//Indices into items, in draw order once sorted, and the sort's scratch
+	std::vector<uint32_t> order;
+	std::vector<uint32_t> scratch;
+	std::vector<uint64_t> keys;
+	std::vector<uint64_t> keyScratch;
+	bool sorted;
+
+	//A run of sorted items drawn together; Instance is -1 unless instanced
+	struct Batch
+	{
+		uint32_t Start;
+		uint32_t Count;
+		int Instance;
+	};
+
+	std::vector<Batch> batches;
+	std::vector<Batch> singles;
+
+	//Plain and instanced vertex shaders, in pairs
+	std::vector<SimpleVertexShader*> instancedShaders;
+
+	//World matrices for every instanced batch of the view, and where they go
+	std::vector<XMFLOAT4X4> instanceData;
+	ID3D11Buffer* instanceBuffer;
+	RenderBackend* instanceOwner;
+	uint32_t instanceCapacity;
+	TransientRing* ring;
+
+	XMFLOAT4X4 view;
+	XMFLOAT4X4 projection;
+	bool hasCamera;
+	ShaderConstants* constants;
+
+	//Objects seen so far, numbered by position
+	std::vector<const void*> shaderPairs;
+	std::vector<const void*> materials;
+	std::vector<const void*> texturePairs;
+	std::vector<const void*> meshes;
+
+	RenderQueueStats frame;
+	RenderQueueStats lastFrame;
+
+	// Number for a (pair of) object(s), clamped to what a_bits can hold
+	static uint64_t Intern(std::vector<const void*>& a_seen, const void* a_first, const void* a_second, int a_bits);
+	uint64_t DepthBits(GameEntity* a_entity);
+	SimpleVertexShader* FindInstanced(SimpleVertexShader* a_vs);
+	static bool SameState(const Item& a_first, const Item& a_second);
+	void BuildBatches();
+	void FlushSingles();
+	void UploadInstances(RenderBackend* a_backend);
+};
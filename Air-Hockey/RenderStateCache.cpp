@@ -0,0 +1,182 @@
+#include "RenderStateCache.h"
+#include <cstring>
+
+//FNV-1a over a normalized description; padding is already zero
+static uint32_t HashBytes(const void* a_data, size_t a_size)
+{
+	const unsigned char* bytes = (const unsigned char*)a_data;
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < a_size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+// --------------------------------------------------------
+// Copies field by field into a zeroed description, so two
+// that D3D treats the same compare equal byte for byte
+// --------------------------------------------------------
+static D3D11_RASTERIZER_DESC Normalize(const D3D11_RASTERIZER_DESC& a_desc)
+{
+	D3D11_RASTERIZER_DESC key;
+	memset(&key, 0, sizeof(key));
+	key.FillMode = a_desc.FillMode;
+	key.CullMode = a_desc.CullMode;
+	key.FrontCounterClockwise = a_desc.FrontCounterClockwise;
+	key.DepthBias = a_desc.DepthBias;
+	key.DepthBiasClamp = a_desc.DepthBiasClamp;
+	key.SlopeScaledDepthBias = a_desc.SlopeScaledDepthBias;
+	key.DepthClipEnable = a_desc.DepthClipEnable;
+	key.ScissorEnable = a_desc.ScissorEnable;
+	key.MultisampleEnable = a_desc.MultisampleEnable;
+	key.AntialiasedLineEnable = a_desc.AntialiasedLineEnable;
+	return key;
+}
+
+static D3D11_DEPTH_STENCIL_DESC Normalize(const D3D11_DEPTH_STENCIL_DESC& a_desc)
+{
+	D3D11_DEPTH_STENCIL_DESC key;
+	memset(&key, 0, sizeof(key));
+	key.DepthEnable = a_desc.DepthEnable;
+	key.DepthWriteMask = a_desc.DepthWriteMask;
+	key.DepthFunc = a_desc.DepthFunc;
+	key.StencilEnable = a_desc.StencilEnable;
+	key.StencilReadMask = a_desc.StencilReadMask;
+	key.StencilWriteMask = a_desc.StencilWriteMask;
+	key.FrontFace = a_desc.FrontFace;
+	key.BackFace = a_desc.BackFace;
+	return key;
+}
+
+static D3D11_BLEND_DESC Normalize(const D3D11_BLEND_DESC& a_desc)
+{
+	D3D11_BLEND_DESC key;
+	memset(&key, 0, sizeof(key));
+	key.AlphaToCoverageEnable = a_desc.AlphaToCoverageEnable;
+	key.IndependentBlendEnable = a_desc.IndependentBlendEnable;
+
+	//Without independent blending only the first target's settings are used
+	int targets = a_desc.IndependentBlendEnable ? 8 : 1;
+	for (int i = 0; i < targets; i++)
+	{
+		const D3D11_RENDER_TARGET_BLEND_DESC& target = a_desc.RenderTarget[i];
+		key.RenderTarget[i].BlendEnable = target.BlendEnable;
+		key.RenderTarget[i].SrcBlend = target.SrcBlend;
+		key.RenderTarget[i].DestBlend = target.DestBlend;
+		key.RenderTarget[i].BlendOp = target.BlendOp;
+		key.RenderTarget[i].SrcBlendAlpha = target.SrcBlendAlpha;
+		key.RenderTarget[i].DestBlendAlpha = target.DestBlendAlpha;
+		key.RenderTarget[i].BlendOpAlpha = target.BlendOpAlpha;
+		key.RenderTarget[i].RenderTargetWriteMask = target.RenderTargetWriteMask;
+	}
+	return key;
+}
+
+static D3D11_SAMPLER_DESC Normalize(const D3D11_SAMPLER_DESC& a_desc)
+{
+	D3D11_SAMPLER_DESC key;
+	memset(&key, 0, sizeof(key));
+	key.Filter = a_desc.Filter;
+	key.AddressU = a_desc.AddressU;
+	key.AddressV = a_desc.AddressV;
+	key.AddressW = a_desc.AddressW;
+	key.MipLODBias = a_desc.MipLODBias;
+	key.MaxAnisotropy = a_desc.MaxAnisotropy;
+	key.ComparisonFunc = a_desc.ComparisonFunc;
+	memcpy(key.BorderColor, a_desc.BorderColor, sizeof(key.BorderColor));
+	key.MinLOD = a_desc.MinLOD;
+	key.MaxLOD = a_desc.MaxLOD;
+	return key;
+}
+
+RenderStateCache::RenderStateCache(RenderBackend* a_backend)
+{
+	backend = a_backend;
+	requests = 0;
+	created = 0;
+}
+
+RenderStateCache::~RenderStateCache()
+{
+	for (size_t i = 0; i < rasterizerStates.size(); i++)
+		backend->ReleaseState(rasterizerStates[i].Object);
+	for (size_t i = 0; i < depthStencilStates.size(); i++)
+		backend->ReleaseState(depthStencilStates[i].Object);
+	for (size_t i = 0; i < blendStates.size(); i++)
+		backend->ReleaseState(blendStates[i].Object);
+	for (size_t i = 0; i < samplerStates.size(); i++)
+		backend->ReleaseState(samplerStates[i].Object);
+}
+
+template<typename Desc, typename State>
+State* RenderStateCache::Find(std::vector<Entry<Desc, State>>& a_entries, const Desc& a_key, uint32_t a_hash)
+{
+	for (size_t i = 0; i < a_entries.size(); i++)
+	{
+		if (a_entries[i].Hash == a_hash && memcmp(&a_entries[i].Key, &a_key, sizeof(Desc)) == 0)
+			return a_entries[i].Object;
+	}
+	return 0;
+}
+
+ID3D11RasterizerState* RenderStateCache::GetRasterizerState(const D3D11_RASTERIZER_DESC& a_desc)
+{
+	requests++;
+	D3D11_RASTERIZER_DESC key = Normalize(a_desc);
+	uint32_t hash = HashBytes(&key, sizeof(key));
+	ID3D11RasterizerState* state = Find(rasterizerStates, key, hash);
+	if (state)
+		return state;
+
+	Entry<D3D11_RASTERIZER_DESC, ID3D11RasterizerState> entry = { hash, key, backend->CreateRasterizerState(key) };
+	rasterizerStates.push_back(entry);
+	created++;
+	return entry.Object;
+}
+
+ID3D11DepthStencilState* RenderStateCache::GetDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& a_desc)
+{
+	requests++;
+	D3D11_DEPTH_STENCIL_DESC key = Normalize(a_desc);
+	uint32_t hash = HashBytes(&key, sizeof(key));
+	ID3D11DepthStencilState* state = Find(depthStencilStates, key, hash);
+	if (state)
+		return state;
+
+	Entry<D3D11_DEPTH_STENCIL_DESC, ID3D11DepthStencilState> entry = { hash, key, backend->CreateDepthStencilState(key) };
+	depthStencilStates.push_back(entry);
+	created++;
+	return entry.Object;
+}
+
+ID3D11BlendState* RenderStateCache::GetBlendState(const D3D11_BLEND_DESC& a_desc)
+{
+	requests++;
+	D3D11_BLEND_DESC key = Normalize(a_desc);
+	uint32_t hash = HashBytes(&key, sizeof(key));
+	ID3D11BlendState* state = Find(blendStates, key, hash);
+	if (state)
+		return state;
+
+	Entry<D3D11_BLEND_DESC, ID3D11BlendState> entry = { hash, key, backend->CreateBlendState(key) };
+	blendStates.push_back(entry);
+	created++;
+	return entry.Object;
+}
+
+ID3D11SamplerState* RenderStateCache::GetSamplerState(const D3D11_SAMPLER_DESC& a_desc)
+{
+	requests++;
+	D3D11_SAMPLER_DESC key = Normalize(a_desc);
+	uint32_t hash = HashBytes(&key, sizeof(key));
+	ID3D11SamplerState* state = Find(samplerStates, key, hash);
+	if (state)
+		return state;
+
+	Entry<D3D11_SAMPLER_DESC, ID3D11SamplerState> entry = { hash, key, backend->CreateSamplerState(key) };
+	samplerStates.push_back(entry);
+	created++;
+	return entry.Object;
+}
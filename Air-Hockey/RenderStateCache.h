@@ -0,0 +1,59 @@
+#pragma once
+#include <d3d11.h>
+#include <cstdint>
+#include <vector>
+#include "RenderBackend.h"
+
+// --------------------------------------------------------
+// One state object per distinct description.  Ask for a
+// rasterizer, depth-stencil, blend or sampler state by its
+// D3D11_*_DESC; the first request creates it through the
+// backend, later identical ones get the same object back.
+//
+// Descriptions are compared by value, with the parts D3D
+// ignores (struct padding, render targets 1-7 without
+// independent blending) cleared first, so descriptions that
+// only differ there share a state too.
+//
+// The cache owns every state it returns: don't Release()
+// them, they live until the cache is deleted.
+// --------------------------------------------------------
+class RenderStateCache
+{
+public:
+	RenderStateCache(RenderBackend* a_backend);
+	~RenderStateCache();
+
+	ID3D11RasterizerState* GetRasterizerState(const D3D11_RASTERIZER_DESC& a_desc);
+	ID3D11DepthStencilState* GetDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& a_desc);
+	ID3D11BlendState* GetBlendState(const D3D11_BLEND_DESC& a_desc);
+	ID3D11SamplerState* GetSamplerState(const D3D11_SAMPLER_DESC& a_desc);
+
+	// Requests so far, and how many of them created a state
+	uint32_t GetRequests() { return requests; }
+	uint32_t GetCreated() { return created; }
+
+private:
+	RenderBackend* backend;
+
+	//A handful of each per game, so a scan over hashes beats a map
+	template<typename Desc, typename State>
+	struct Entry
+	{
+		uint32_t Hash;
+		Desc Key;
+		State* Object;
+	};
+
+	std::vector<Entry<D3D11_RASTERIZER_DESC, ID3D11RasterizerState>> rasterizerStates;
+	std::vector<Entry<D3D11_DEPTH_STENCIL_DESC, ID3D11DepthStencilState>> depthStencilStates;
+	std::vector<Entry<D3D11_BLEND_DESC, ID3D11BlendState>> blendStates;
+	std::vector<Entry<D3D11_SAMPLER_DESC, ID3D11SamplerState>> samplerStates;
+
+	uint32_t requests;
+	uint32_t created;
+
+	// The entry for a_key (already normalized), or 0
+	template<typename Desc, typename State>
+	static State* Find(std::vector<Entry<Desc, State>>& a_entries, const Desc& a_key, uint32_t a_hash);
+};
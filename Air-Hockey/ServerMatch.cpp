@@ -0,0 +1,298 @@
+#include "ServerMatch.h"
+#include <cstddef>
+#include <cstring>
+
+// Clients we haven't heard from in this long lose their slot
+static const uint32_t CLIENT_TIMEOUT_MS = 5000;
+
+// Queued inputs beyond this are a backlog the server catches up on
+static const int INPUT_JITTER_BUFFER = 2;
+
+ServerMatch::ServerMatch()
+{
+	Reset(0);
+}
+
+ServerMatch::ServerMatch(uint16_t a_id)
+{
+	Reset(a_id);
+}
+
+ServerMatch::~ServerMatch()
+{
+}
+
+void ServerMatch::Reset(uint16_t a_id)
+{
+	id = a_id;
+	match.Reset();
+	history.Clear();
+	memset(&latest, 0, sizeof(latest));
+
+	for (int i = 0; i < NET_PLAYERS_PER_MATCH; i++)
+		ResetClient(i);
+
+	memset(relays, 0, sizeof(relays));
+}
+
+void ServerMatch::ResetClient(int a_slot)
+{
+	MatchClient& client = clients[a_slot];
+	memset(&client, 0, sizeof(MatchClient));
+	client.SendBudget = NET_SNAPSHOT_BYTES_PER_SEC * NET_TICK_DT;
+}
+
+int ServerMatch::GetClientCount()
+{
+	int count = 0;
+	for (int i = 0; i < NET_PLAYERS_PER_MATCH; i++)
+	{
+		if (clients[i].Connected)
+			count++;
+	}
+	return count;
+}
+
+void ServerMatch::HandlePacket(const NetAddress& a_from, const unsigned char* a_data, int a_size, UdpSocket* a_socket, LatencySimulator* a_sender)
+{
+	if (a_size < (int)sizeof(NetHeader))
+		return;
+
+	const NetHeader* header = (const NetHeader*)a_data;
+	switch (header->Type)
+	{
+	case NET_CONNECT:
+		if (a_size >= (int)sizeof(ConnectPacket))
+			HandleConnect(a_from, *(const ConnectPacket*)a_data, a_socket, a_sender);
+		break;
+
+	case NET_INPUT:
+		if (a_size >= (int)offsetof(InputPacket, Inputs))
+			HandleInput(a_from, *(const InputPacket*)a_data, a_size);
+		break;
+
+	case NET_SPECTATE:
+		HandleSpectate(a_from, NetTimeMs());
+		break;
+
+	case NET_DISCONNECT:
+		if (header->Slot < NET_PLAYERS_PER_MATCH && clients[header->Slot].Address == a_from)
+			ResetClient(header->Slot);
+		break;
+	}
+}
+
+void ServerMatch::HandleConnect(const NetAddress& a_from, const ConnectPacket& a_packet, UdpSocket* a_socket, LatencySimulator* a_sender)
+{
+	//Reconnects (a lost accept) get their old slot back
+	int slot = -1;
+	for (int i = 0; i < NET_PLAYERS_PER_MATCH; i++)
+	{
+		if (clients[i].Connected && clients[i].Address == a_from)
+			slot = i;
+	}
+
+	//Otherwise the slot they asked for, or whichever is free
+	if (slot == -1)
+	{
+		int wanted = a_packet.Header.Slot;
+		if (wanted < NET_PLAYERS_PER_MATCH && !clients[wanted].Connected)
+			slot = wanted;
+
+		for (int i = 0; i < NET_PLAYERS_PER_MATCH && slot == -1; i++)
+		{
+			if (!clients[i].Connected)
+				slot = i;
+		}
+
+		//Match is full
+		if (slot == -1)
+			return;
+
+		ResetClient(slot);
+		clients[slot].Connected = true;
+		clients[slot].Address = a_from;
+	}
+
+	clients[slot].LastHeardMs = NetTimeMs();
+
+	ConnectPacket accept = {};
+	accept.Header.Type = NET_ACCEPT;
+	accept.Header.Slot = (uint8_t)slot;
+	accept.Header.MatchID = id;
+	a_sender->Send(a_socket, a_from, &accept, sizeof(accept));
+}
+
+void ServerMatch::HandleInput(const NetAddress& a_from, const InputPacket& a_packet, int a_size)
+{
+	int slot = a_packet.Header.Slot;
+	if (slot >= NET_PLAYERS_PER_MATCH || !clients[slot].Connected || clients[slot].Address != a_from)
+		return;
+
+	int count = a_packet.Count;
+	if (count > NET_INPUT_REDUNDANCY || a_size < (int)(offsetof(InputPacket, Inputs) + count * sizeof(NetInputCommand)))
+		return;
+
+	MatchClient& client = clients[slot];
+	client.LastHeardMs = NetTimeMs();
+
+	//Packets can arrive out of order, only keep the newest timing info.
+	//Until the first ack every packet counts, or the echo would be zero
+	if (client.AckTick == 0 || (int32_t)(a_packet.AckTick - client.AckTick) > 0)
+	{
+		client.AckTick = a_packet.AckTick;
+		client.EchoTimeMs = a_packet.ClientTimeMs;
+	}
+
+	//Redundant copies of inputs we already have are skipped by sequence
+	for (int i = 0; i < count; i++)
+	{
+		const NetInputCommand& input = a_packet.Inputs[i];
+		if ((int32_t)(input.Sequence - client.LastQueuedSequence) <= 0)
+			continue;
+
+		//A client far ahead of the server loses its oldest input
+		if (client.QueueCount == NET_INPUT_QUEUE_SIZE)
+		{
+			client.QueueHead = (client.QueueHead + 1) % NET_INPUT_QUEUE_SIZE;
+			client.QueueCount--;
+		}
+
+		int tail = (client.QueueHead + client.QueueCount) % NET_INPUT_QUEUE_SIZE;
+		client.Queue[tail] = input;
+		client.QueueCount++;
+		client.LastQueuedSequence = input.Sequence;
+	}
+}
+
+void ServerMatch::HandleSpectate(const NetAddress& a_from, uint32_t a_nowMs)
+{
+	//Refresh an existing subscription, or take a free one
+	int free = -1;
+	for (int i = 0; i < NET_MAX_MATCH_RELAYS; i++)
+	{
+		if (relays[i].Subscribed && relays[i].Address == a_from)
+		{
+			relays[i].LastHeardMs = a_nowMs;
+			return;
+		}
+
+		if (!relays[i].Subscribed && free == -1)
+			free = i;
+	}
+
+	if (free == -1)
+		return;
+
+	relays[free].Subscribed = true;
+	relays[free].Address = a_from;
+	relays[free].LastHeardMs = a_nowMs;
+}
+
+bool ServerMatch::PopInput(int a_slot, unsigned char& a_buttons)
+{
+	MatchClient& client = clients[a_slot];
+	if (client.QueueCount == 0)
+		return false;
+
+	const NetInputCommand& input = client.Queue[client.QueueHead];
+	a_buttons = input.Buttons;
+	client.LastAppliedSequence = input.Sequence;
+
+	client.QueueHead = (client.QueueHead + 1) % NET_INPUT_QUEUE_SIZE;
+	client.QueueCount--;
+	return true;
+}
+
+void ServerMatch::Tick(uint32_t a_nowMs)
+{
+	//One input per client drives this tick; a missing input means no movement
+	unsigned char buttons[NET_PLAYERS_PER_MATCH] = {};
+	for (int i = 0; i < NET_PLAYERS_PER_MATCH; i++)
+	{
+		if (clients[i].Connected && (int32_t)(a_nowMs - clients[i].LastHeardMs) > (int32_t)CLIENT_TIMEOUT_MS)
+			ResetClient(i);
+
+		if (clients[i].Connected)
+			PopInput(i, buttons[i]);
+	}
+
+	for (int i = 0; i < NET_MAX_MATCH_RELAYS; i++)
+	{
+		if (relays[i].Subscribed && (int32_t)(a_nowMs - relays[i].LastHeardMs) > (int32_t)NET_SPECTATE_TIMEOUT_MS)
+			relays[i].Subscribed = false;
+	}
+
+	match.Step(NET_TICK_DT, buttons[0], buttons[1]);
+
+	//Clients that got ahead catch up on their own paddle only,
+	//a bounded number of inputs per tick
+	for (int i = 0; i < NET_PLAYERS_PER_MATCH; i++)
+	{
+		for (int extra = 1; extra < NET_MAX_INPUTS_PER_TICK; extra++)
+		{
+			unsigned char catchUp;
+			if (clients[i].QueueCount <= INPUT_JITTER_BUFFER || !PopInput(i, catchUp))
+				break;
+
+			match.GetPaddle(i)->ApplyInput(catchUp, NET_TICK_DT);
+		}
+	}
+}
+
+void ServerMatch::SendSnapshots(UdpSocket* a_socket, LatencySimulator* a_sender)
+{
+	MatchState state;
+	match.GetState(state);
+	SnapshotCodec::Quantize(state, latest);
+	history.Store(latest);
+
+	unsigned char packet[sizeof(SnapshotPacket) + SnapshotCodec::MAX_SIZE];
+	SnapshotPacket* snapshot = (SnapshotPacket*)packet;
+	snapshot->Header.Type = NET_SNAPSHOT;
+	snapshot->Header.MatchID = id;
+
+	const float budgetPerTick = NET_SNAPSHOT_BYTES_PER_SEC * NET_TICK_DT;
+	const float largest = (float)sizeof(packet);
+
+	for (int i = 0; i < NET_PLAYERS_PER_MATCH; i++)
+	{
+		MatchClient& client = clients[i];
+		if (!client.Connected)
+			continue;
+
+		//Refill, but never bank more than a couple of packets
+		client.SendBudget += budgetPerTick;
+		if (client.SendBudget > 2.0f * largest + budgetPerTick)
+			client.SendBudget = 2.0f * largest + budgetPerTick;
+
+		if (client.SendBudget < largest)
+			continue;
+
+		snapshot->Header.Slot = (uint8_t)i;
+		snapshot->LastInput = client.LastAppliedSequence;
+		snapshot->EchoTimeMs = client.EchoTimeMs;
+
+		//Each client gets a delta against the newest state it told us it has
+		int size = SnapshotCodec::WriteSnapshot(history, client.AckTick, latest, packet + sizeof(SnapshotPacket), SnapshotCodec::MAX_SIZE);
+		if (size < 0)
+			continue;
+
+		size += sizeof(SnapshotPacket);
+		a_sender->Send(a_socket, client.Address, packet, size);
+		client.SendBudget -= size;
+	}
+
+	//Relays get every tick in full; they do the per-spectator work
+	MatchStatePacket relayState;
+	relayState.Header.Type = NET_MATCH_STATE;
+	relayState.Header.Slot = 0;
+	relayState.Header.MatchID = id;
+	relayState.State = state;
+
+	for (int i = 0; i < NET_MAX_MATCH_RELAYS; i++)
+	{
+		if (relays[i].Subscribed)
+			a_sender->Send(a_socket, relays[i].Address, &relayState, sizeof(relayState));
+	}
+}
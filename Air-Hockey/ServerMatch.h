@@ -0,0 +1,82 @@
+#pragma once
+#include "Match.h"
+#include "NetSocket.h"
+#include "LatencySimulator.h"
+#include "SnapshotCodec.h"
+
+// --------------------------------------------------------
+// What the server knows about one connected player
+// --------------------------------------------------------
+struct MatchClient
+{
+	bool Connected;
+	NetAddress Address;
+	uint32_t LastHeardMs;
+
+	// Inputs received but not yet simulated, oldest first
+	NetInputCommand Queue[NET_INPUT_QUEUE_SIZE];
+	int QueueHead;
+	int QueueCount;
+	uint32_t LastQueuedSequence;
+	uint32_t LastAppliedSequence;
+
+	uint32_t EchoTimeMs;
+	uint32_t AckTick;
+
+	// Token bucket that caps snapshot bandwidth
+	float SendBudget;
+};
+
+// A spectator relay subscribed to a match's full state
+struct MatchRelay
+{
+	bool Subscribed;
+	NetAddress Address;
+	uint32_t LastHeardMs;
+};
+
+// --------------------------------------------------------
+// One authoritative match on the server: the gameplay plus
+// the two clients playing it
+// --------------------------------------------------------
+class ServerMatch
+{
+public:
+	ServerMatch();
+	ServerMatch(uint16_t a_id);
+	~ServerMatch();
+
+	// Starts a fresh match under the given id so pooled matches can be reused
+	void Reset(uint16_t a_id);
+
+	uint16_t GetID() { return id; }
+	Match* GetMatch() { return &match; }
+	int GetClientCount();
+
+	// Handles one packet addressed to this match
+	void HandlePacket(const NetAddress& a_from, const unsigned char* a_data, int a_size, UdpSocket* a_socket, LatencySimulator* a_sender);
+
+	// Simulates one fixed tick using each client's queued input.
+	// a_nowMs is passed in so a batch of matches shares one clock read
+	void Tick(uint32_t a_nowMs);
+
+	// Sends the current state to every client with bandwidth left,
+	// and to every subscribed relay
+	void SendSnapshots(UdpSocket* a_socket, LatencySimulator* a_sender);
+
+private:
+	uint16_t id;
+	Match match;
+	MatchClient clients[NET_PLAYERS_PER_MATCH];
+
+	//Recent states, for encoding against whatever clients have acked
+	SnapshotHistory history;
+	QuantizedState latest;
+	MatchRelay relays[NET_MAX_MATCH_RELAYS];
+
+	void HandleConnect(const NetAddress& a_from, const ConnectPacket& a_packet, UdpSocket* a_socket, LatencySimulator* a_sender);
+	void HandleInput(const NetAddress& a_from, const InputPacket& a_packet, int a_size);
+	void HandleSpectate(const NetAddress& a_from, uint32_t a_nowMs);
+	bool PopInput(int a_slot, unsigned char& a_buttons);
+	void ResetClient(int a_slot);
+};
@@ -0,0 +1,37 @@
+#include "ShaderConstants.h"
+#include "SimpleShader.h"
+
+ShaderConstants::ShaderConstants(RenderBackend* a_backend)
+{
+	backend = a_backend;
+
+	//Rewritten whole at most a few times a frame
+	perPass = backend->CreateBuffer(RENDER_BUFFER_CONSTANT, sizeof(PerPassConstants), 0, true);
+	perFrame = backend->CreateBuffer(RENDER_BUFFER_CONSTANT, sizeof(PerFrameConstants), 0, true);
+
+	ISimpleShader::ShareConstantBuffer("PerPass");
+	ISimpleShader::ShareConstantBuffer("PerFrame");
+}
+
+ShaderConstants::~ShaderConstants()
+{
+	backend->ReleaseBuffer(perPass);
+	backend->ReleaseBuffer(perFrame);
+}
+
+void ShaderConstants::SetFrame(const PerFrameConstants& a_frame)
+{
+	backend->WriteBuffer(perFrame, &a_frame, sizeof(a_frame));
+	backend->SetConstantBuffer(RENDER_STAGE_VERTEX, PER_FRAME_SLOT, perFrame);
+	backend->SetConstantBuffer(RENDER_STAGE_PIXEL, PER_FRAME_SLOT, perFrame);
+}
+
+void ShaderConstants::SetPass(const XMFLOAT4X4& a_view, const XMFLOAT4X4& a_proj)
+{
+	PerPassConstants pass;
+	pass.View = a_view;
+	pass.Projection = a_proj;
+
+	backend->WriteBuffer(perPass, &pass, sizeof(pass));
+	backend->SetConstantBuffer(RENDER_STAGE_VERTEX, PER_PASS_SLOT, perPass);
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <DirectXMath.h>
+#include "RenderBackend.h"
+#include "Light.h"
+
+using namespace DirectX;
+
+// Matches cbuffer PerPass in ShaderConstants.hlsli
+struct PerPassConstants
+{
+	XMFLOAT4X4 View;
+	XMFLOAT4X4 Projection;
+};
+
+// Matches cbuffer PerFrame in ShaderConstants.hlsli.  HLSL
+// starts every struct on a new 16 bytes, hence the padding
+struct PerFrameConstants
+{
+	XMFLOAT4X4 ShadowView;
+	XMFLOAT4X4 ShadowProjection;
+	XMFLOAT4X4 CubeShadowProjection;
+	XMFLOAT3 CameraPosition;
+	float Padding0;
+	DirectionalLight Light;
+	float Padding1;
+	PointLight PLight;
+	float Padding2;
+};
+
+static_assert(sizeof(PerPassConstants) == 128, "PerPassConstants must match ShaderConstants.hlsli");
+static_assert(sizeof(PerFrameConstants) == 304, "PerFrameConstants must match ShaderConstants.hlsli");
+
+// --------------------------------------------------------
+// The constant buffers every scene shader shares: one for
+// the frame (lights, camera position, shadow matrices) and
+// one for the view being drawn (view and projection).
+//
+// Each is written once when it changes and bound to the
+// same slot for all shaders; SimpleShader is told to leave
+// those cbuffers alone, so a shader's own buffer only holds
+// what changes per object.
+// --------------------------------------------------------
+class ShaderConstants
+{
+public:
+	static const unsigned int PER_PASS_SLOT = 1;
+	static const unsigned int PER_FRAME_SLOT = 2;
+
+	// Registers the shared cbuffer names with SimpleShader, so
+	// create this before loading any shaders
+	ShaderConstants(RenderBackend* a_backend);
+	~ShaderConstants();
+
+	// Writes and binds (vertex and pixel stages)
+	void SetFrame(const PerFrameConstants& a_frame);
+
+	// Writes and binds (vertex stage); as the shaders get them (transposed)
+	void SetPass(const XMFLOAT4X4& a_view, const XMFLOAT4X4& a_proj);
+
+private:
+	RenderBackend* backend;
+	ID3D11Buffer* perPass;
+	ID3D11Buffer* perFrame;
+};
@@ -0,0 +1,38 @@
+// Constants shared by every scene shader, bound once to fixed
+// slots by ShaderConstants (C++) rather than through each
+// shader's own buffers.  Layouts must match ShaderConstants.h.
+//
+// Each shader keeps only what changes per object in its own
+// buffer at b0.
+
+struct DirectionalLight
+{
+	float4 AmbientColor;
+	float4 DiffuseColor;
+	float3 Direction;
+};
+
+struct PointLight
+{
+	float4 AmbientColor;
+	float4 DiffuseColor;
+	float3 Position;
+};
+
+// Changes once per view: the main camera, or a shadow map's light
+cbuffer PerPass : register(b1)
+{
+	matrix view;
+	matrix projection;
+};
+
+// Changes once per frame
+cbuffer PerFrame : register(b2)
+{
+	matrix shadowViewMat;
+	matrix shadowProjMat;
+	matrix CubeShadowProjMat;
+	float3 cameraPosition; //cam position for specular
+	DirectionalLight light;
+	PointLight pLight;
+};
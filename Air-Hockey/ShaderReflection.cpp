@@ -0,0 +1,571 @@
+#include "ShaderReflection.h"
+#include <cstring>
+#include <fstream>
+
+//Bumped whenever the cache layout changes, so old caches are ignored
+static const uint32_t CACHE_VERSION = 1;
+static const uint32_t CACHE_MAGIC = 0x4C464552; // "REFL"
+
+//The container: "DXBC", a 16 byte checksum, 1, total size, chunk count, chunk offsets
+static const size_t DXBC_HEADER_SIZE = 32;
+static const size_t DXBC_CHECKSUM_OFFSET = 4;
+static const size_t DXBC_CHECKSUM_SIZE = 16;
+
+//Shader program opcodes that matter here
+static const uint32_t OPCODE_CUSTOMDATA = 0x35;
+static const uint32_t OPCODE_DCL_THREAD_GROUP = 0x9B;
+
+static uint32_t FourCC(const char* a_code)
+{
+	return (uint32_t)(uint8_t)a_code[0] | ((uint32_t)(uint8_t)a_code[1] << 8) |
+		((uint32_t)(uint8_t)a_code[2] << 16) | ((uint32_t)(uint8_t)a_code[3] << 24);
+}
+
+// --------------------------------------------------------
+// Bounds-checked little endian reads out of one chunk.  Any
+// read past the end sets Failed and returns 0, so parsing
+// runs to the end and is checked once
+// --------------------------------------------------------
+struct ChunkReader
+{
+	const uint8_t* Data;
+	size_t Size;
+	bool Failed;
+
+	ChunkReader(const uint8_t* a_data, size_t a_size) : Data(a_data), Size(a_size), Failed(false) {}
+
+	uint32_t U32(size_t a_offset)
+	{
+		if (a_offset + 4 > Size || a_offset + 4 < a_offset)
+		{
+			Failed = true;
+			return 0;
+		}
+		return (uint32_t)Data[a_offset] | ((uint32_t)Data[a_offset + 1] << 8) |
+			((uint32_t)Data[a_offset + 2] << 16) | ((uint32_t)Data[a_offset + 3] << 24);
+	}
+
+	uint8_t U8(size_t a_offset)
+	{
+		if (a_offset >= Size)
+		{
+			Failed = true;
+			return 0;
+		}
+		return Data[a_offset];
+	}
+
+	// Names are stored as offsets to null-terminated strings
+	std::string String(size_t a_offset)
+	{
+		size_t end = a_offset;
+		while (end < Size && Data[end] != 0)
+			end++;
+		if (end >= Size)
+		{
+			Failed = true;
+			return std::string();
+		}
+		return std::string((const char*)Data + a_offset, end - a_offset);
+	}
+};
+
+ShaderReflection::ShaderReflection()
+{
+	Clear();
+}
+
+void ShaderReflection::Clear()
+{
+	ProgramType = 0;
+	ThreadGroupSize[0] = ThreadGroupSize[1] = ThreadGroupSize[2] = 0;
+	ConstantBuffers.clear();
+	Resources.clear();
+	Inputs.clear();
+	Outputs.clear();
+}
+
+// --------------------------------------------------------
+// RDEF: a header, then the bound resources and constant
+// buffers, each a fixed-size record with offsets to names
+// --------------------------------------------------------
+static bool ParseResourceDefinitions(ChunkReader& a_chunk, ShaderReflection& a_out)
+{
+	uint32_t bufferCount = a_chunk.U32(0);
+	uint32_t bufferOffset = a_chunk.U32(4);
+	uint32_t bindingCount = a_chunk.U32(8);
+	uint32_t bindingOffset = a_chunk.U32(12);
+	uint32_t version = a_chunk.U32(16);
+	uint8_t major = (uint8_t)((version >> 8) & 0xFF);
+	a_out.ProgramType = version >> 16;
+
+	//Shader model 5 variables carry texture and sampler ranges too
+	const size_t variableSize = major >= 5 ? 40 : 24;
+	const size_t bindingSize = 32;
+	const size_t bufferSize = 24;
+
+	for (uint32_t i = 0; i < bindingCount && !a_chunk.Failed; i++)
+	{
+		size_t at = bindingOffset + i * bindingSize;
+
+		ReflectedResource resource;
+		resource.Name = a_chunk.String(a_chunk.U32(at));
+		resource.Type = a_chunk.U32(at + 4);
+		resource.BindPoint = a_chunk.U32(at + 20);
+		resource.BindCount = a_chunk.U32(at + 24);
+		a_out.Resources.push_back(resource);
+	}
+
+	for (uint32_t b = 0; b < bufferCount && !a_chunk.Failed; b++)
+	{
+		size_t at = bufferOffset + b * bufferSize;
+
+		ReflectedConstantBuffer buffer;
+		buffer.Name = a_chunk.String(a_chunk.U32(at));
+		uint32_t variableCount = a_chunk.U32(at + 4);
+		uint32_t variableOffset = a_chunk.U32(at + 8);
+		buffer.Size = a_chunk.U32(at + 12);
+
+		//Its register is on the binding of the same name
+		buffer.BindPoint = 0;
+		for (size_t r = 0; r < a_out.Resources.size(); r++)
+		{
+			if (a_out.Resources[r].Name == buffer.Name)
+			{
+				buffer.BindPoint = a_out.Resources[r].BindPoint;
+				break;
+			}
+		}
+
+		for (uint32_t v = 0; v < variableCount && !a_chunk.Failed; v++)
+		{
+			size_t varAt = variableOffset + v * variableSize;
+
+			ReflectedVariable variable;
+			variable.Name = a_chunk.String(a_chunk.U32(varAt));
+			variable.Offset = a_chunk.U32(varAt + 4);
+			variable.Size = a_chunk.U32(varAt + 8);
+			buffer.Variables.push_back(variable);
+		}
+
+		a_out.ConstantBuffers.push_back(buffer);
+	}
+
+	return !a_chunk.Failed;
+}
+
+// --------------------------------------------------------
+// ISGN/OSGN: a count, then 24 byte elements.  OSG5 puts the
+// stream first (28 bytes); ISG1/OSG1 add it and a trailing
+// min precision (32 bytes)
+// --------------------------------------------------------
+static bool ParseSignature(ChunkReader& a_chunk, uint32_t a_fourCC, std::vector<ReflectedParameter>& a_out)
+{
+	bool hasStream = a_fourCC != FourCC("ISGN") && a_fourCC != FourCC("OSGN");
+	size_t elementSize = 24;
+	if (a_fourCC == FourCC("OSG5"))
+		elementSize = 28;
+	else if (hasStream)
+		elementSize = 32;
+
+	uint32_t count = a_chunk.U32(0);
+	for (uint32_t i = 0; i < count && !a_chunk.Failed; i++)
+	{
+		size_t at = 8 + i * elementSize;
+
+		ReflectedParameter parameter;
+		parameter.Stream = 0;
+		if (hasStream)
+		{
+			parameter.Stream = a_chunk.U32(at);
+			at += 4;
+		}
+		parameter.SemanticName = a_chunk.String(a_chunk.U32(at));
+		parameter.SemanticIndex = a_chunk.U32(at + 4);
+		parameter.SystemValue = a_chunk.U32(at + 8);
+		parameter.ComponentType = a_chunk.U32(at + 12);
+		parameter.Register = a_chunk.U32(at + 16);
+		parameter.Mask = a_chunk.U8(at + 20);
+		parameter.ReadWriteMask = a_chunk.U8(at + 21);
+		a_out.push_back(parameter);
+	}
+
+	return !a_chunk.Failed;
+}
+
+// --------------------------------------------------------
+// SHEX/SHDR: the program itself.  Only walked as far as the
+// compute group size declaration
+// --------------------------------------------------------
+static bool ParseThreadGroup(ChunkReader& a_chunk, ShaderReflection& a_out)
+{
+	uint32_t length = a_chunk.U32(4);
+	size_t end = (size_t)length * 4;
+	if (end > a_chunk.Size)
+		end = a_chunk.Size;
+
+	for (size_t at = 8; at < end && !a_chunk.Failed;)
+	{
+		uint32_t token = a_chunk.U32(at);
+		uint32_t opcode = token & 0x7FF;
+		uint32_t tokens = opcode == OPCODE_CUSTOMDATA ? a_chunk.U32(at + 4) : (token >> 24) & 0x7F;
+
+		if (opcode == OPCODE_DCL_THREAD_GROUP)
+		{
+			a_out.ThreadGroupSize[0] = a_chunk.U32(at + 4);
+			a_out.ThreadGroupSize[1] = a_chunk.U32(at + 8);
+			a_out.ThreadGroupSize[2] = a_chunk.U32(at + 12);
+			break;
+		}
+
+		//Declarations come first; an instruction means there are no more
+		if (tokens == 0)
+			break;
+		at += (size_t)tokens * 4;
+	}
+
+	return !a_chunk.Failed;
+}
+
+bool ShaderReflection::Parse(const void* a_bytes, size_t a_size)
+{
+	Clear();
+
+	ChunkReader container((const uint8_t*)a_bytes, a_size);
+	if (container.U32(0) != FourCC("DXBC") || a_size < DXBC_HEADER_SIZE)
+		return false;
+
+	bool hasDefinitions = false;
+	uint32_t chunkCount = container.U32(28);
+	for (uint32_t c = 0; c < chunkCount && !container.Failed; c++)
+	{
+		uint32_t offset = container.U32(DXBC_HEADER_SIZE + c * 4);
+		uint32_t fourCC = container.U32(offset);
+		uint32_t size = container.U32(offset + 4);
+		if (container.Failed || (size_t)offset + 8 + size > a_size)
+			return false;
+
+		ChunkReader chunk((const uint8_t*)a_bytes + offset + 8, size);
+		bool ok = true;
+		if (fourCC == FourCC("RDEF"))
+		{
+			ok = ParseResourceDefinitions(chunk, *this);
+			hasDefinitions = true;
+		}
+		else if (fourCC == FourCC("ISGN") || fourCC == FourCC("ISG1"))
+			ok = ParseSignature(chunk, fourCC, Inputs);
+		else if (fourCC == FourCC("OSGN") || fourCC == FourCC("OSG5") || fourCC == FourCC("OSG1"))
+			ok = ParseSignature(chunk, fourCC, Outputs);
+		else if (fourCC == FourCC("SHEX") || fourCC == FourCC("SHDR"))
+			ok = ParseThreadGroup(chunk, *this);
+
+		if (!ok)
+			return false;
+	}
+
+	//Stripped of reflection (/Qstrip_reflect); nothing to go on
+	return hasDefinitions && !container.Failed;
+}
+
+// --------------------------------------------------------
+// Cache file: magic, version, the shader's checksum, then
+// every list as a count followed by its records.  Strings
+// are a 16 bit length and their bytes
+// --------------------------------------------------------
+static void Put32(std::vector<uint8_t>& a_out, uint32_t a_value)
+{
+	for (int i = 0; i < 4; i++)
+		a_out.push_back((uint8_t)(a_value >> (i * 8)));
+}
+
+static void PutString(std::vector<uint8_t>& a_out, const std::string& a_value)
+{
+	uint16_t length = (uint16_t)a_value.size();
+	a_out.push_back((uint8_t)length);
+	a_out.push_back((uint8_t)(length >> 8));
+	a_out.insert(a_out.end(), a_value.begin(), a_value.begin() + length);
+}
+
+static void PutParameters(std::vector<uint8_t>& a_out, const std::vector<ReflectedParameter>& a_parameters)
+{
+	Put32(a_out, (uint32_t)a_parameters.size());
+	for (size_t i = 0; i < a_parameters.size(); i++)
+	{
+		const ReflectedParameter& parameter = a_parameters[i];
+		PutString(a_out, parameter.SemanticName);
+		Put32(a_out, parameter.SemanticIndex);
+		Put32(a_out, parameter.Register);
+		Put32(a_out, parameter.SystemValue);
+		Put32(a_out, parameter.ComponentType);
+		Put32(a_out, parameter.Mask | ((uint32_t)parameter.ReadWriteMask << 8));
+		Put32(a_out, parameter.Stream);
+	}
+}
+
+void ShaderReflection::Serialize(const void* a_shader, std::vector<uint8_t>& a_out) const
+{
+	a_out.clear();
+	Put32(a_out, CACHE_MAGIC);
+	Put32(a_out, CACHE_VERSION);
+	const uint8_t* checksum = (const uint8_t*)a_shader + DXBC_CHECKSUM_OFFSET;
+	a_out.insert(a_out.end(), checksum, checksum + DXBC_CHECKSUM_SIZE);
+
+	Put32(a_out, ProgramType);
+	for (int i = 0; i < 3; i++)
+		Put32(a_out, ThreadGroupSize[i]);
+
+	Put32(a_out, (uint32_t)ConstantBuffers.size());
+	for (size_t b = 0; b < ConstantBuffers.size(); b++)
+	{
+		const ReflectedConstantBuffer& buffer = ConstantBuffers[b];
+		PutString(a_out, buffer.Name);
+		Put32(a_out, buffer.Size);
+		Put32(a_out, buffer.BindPoint);
+		Put32(a_out, (uint32_t)buffer.Variables.size());
+		for (size_t v = 0; v < buffer.Variables.size(); v++)
+		{
+			PutString(a_out, buffer.Variables[v].Name);
+			Put32(a_out, buffer.Variables[v].Offset);
+			Put32(a_out, buffer.Variables[v].Size);
+		}
+	}
+
+	Put32(a_out, (uint32_t)Resources.size());
+	for (size_t r = 0; r < Resources.size(); r++)
+	{
+		PutString(a_out, Resources[r].Name);
+		Put32(a_out, Resources[r].Type);
+		Put32(a_out, Resources[r].BindPoint);
+		Put32(a_out, Resources[r].BindCount);
+	}
+
+	PutParameters(a_out, Inputs);
+	PutParameters(a_out, Outputs);
+}
+
+// Sequential reads for Deserialize(), failing like ChunkReader
+struct CacheReader
+{
+	ChunkReader Bytes;
+	size_t At;
+
+	CacheReader(const void* a_data, size_t a_size) : Bytes((const uint8_t*)a_data, a_size), At(0) {}
+
+	uint32_t U32()
+	{
+		uint32_t value = Bytes.U32(At);
+		At += 4;
+		return value;
+	}
+
+	std::string String()
+	{
+		uint16_t length = (uint16_t)(Bytes.U8(At) | (Bytes.U8(At + 1) << 8));
+		At += 2;
+		if (At + length > Bytes.Size)
+		{
+			Bytes.Failed = true;
+			return std::string();
+		}
+		std::string value((const char*)Bytes.Data + At, length);
+		At += length;
+		return value;
+	}
+
+	// A count read from the file; capped by what's left so a corrupt
+	// one can't ask for a huge allocation
+	uint32_t Count()
+	{
+		uint32_t count = U32();
+		if (count > Bytes.Size - (At < Bytes.Size ? At : Bytes.Size))
+		{
+			Bytes.Failed = true;
+			return 0;
+		}
+		return count;
+	}
+
+	void Parameters(std::vector<ReflectedParameter>& a_out)
+	{
+		uint32_t count = Count();
+		for (uint32_t i = 0; i < count && !Bytes.Failed; i++)
+		{
+			ReflectedParameter parameter;
+			parameter.SemanticName = String();
+			parameter.SemanticIndex = U32();
+			parameter.Register = U32();
+			parameter.SystemValue = U32();
+			parameter.ComponentType = U32();
+			uint32_t masks = U32();
+			parameter.Mask = (uint8_t)masks;
+			parameter.ReadWriteMask = (uint8_t)(masks >> 8);
+			parameter.Stream = U32();
+			a_out.push_back(parameter);
+		}
+	}
+};
+
+bool ShaderReflection::Deserialize(const void* a_shader, const void* a_bytes, size_t a_size)
+{
+	Clear();
+
+	CacheReader in(a_bytes, a_size);
+	if (in.U32() != CACHE_MAGIC || in.U32() != CACHE_VERSION)
+		return false;
+	if (a_size < in.At + DXBC_CHECKSUM_SIZE ||
+		memcmp((const uint8_t*)a_bytes + in.At, (const uint8_t*)a_shader + DXBC_CHECKSUM_OFFSET, DXBC_CHECKSUM_SIZE) != 0)
+		return false;
+	in.At += DXBC_CHECKSUM_SIZE;
+
+	ProgramType = in.U32();
+	for (int i = 0; i < 3; i++)
+		ThreadGroupSize[i] = in.U32();
+
+	uint32_t bufferCount = in.Count();
+	for (uint32_t b = 0; b < bufferCount && !in.Bytes.Failed; b++)
+	{
+		ReflectedConstantBuffer buffer;
+		buffer.Name = in.String();
+		buffer.Size = in.U32();
+		buffer.BindPoint = in.U32();
+		uint32_t variableCount = in.Count();
+		for (uint32_t v = 0; v < variableCount && !in.Bytes.Failed; v++)
+		{
+			ReflectedVariable variable;
+			variable.Name = in.String();
+			variable.Offset = in.U32();
+			variable.Size = in.U32();
+			buffer.Variables.push_back(variable);
+		}
+		ConstantBuffers.push_back(buffer);
+	}
+
+	uint32_t resourceCount = in.Count();
+	for (uint32_t r = 0; r < resourceCount && !in.Bytes.Failed; r++)
+	{
+		ReflectedResource resource;
+		resource.Name = in.String();
+		resource.Type = in.U32();
+		resource.BindPoint = in.U32();
+		resource.BindCount = in.U32();
+		Resources.push_back(resource);
+	}
+
+	in.Parameters(Inputs);
+	in.Parameters(Outputs);
+
+	if (in.Bytes.Failed || in.At != a_size)
+	{
+		Clear();
+		return false;
+	}
+	return true;
+}
+
+//Paths are ASCII where this runs outside Windows
+static std::string NarrowPath(const std::wstring& a_path)
+{
+	std::string narrow;
+	for (size_t i = 0; i < a_path.size(); i++)
+		narrow.push_back((char)a_path[i]);
+	return narrow;
+}
+
+bool ShaderReflection::Load(const void* a_shader, size_t a_size, const std::wstring& a_cachePath, bool* a_fromCache)
+{
+	if (a_fromCache)
+		*a_fromCache = false;
+	if (a_size < DXBC_HEADER_SIZE)
+		return false;
+
+#ifdef _WIN32
+	std::ifstream cacheIn(a_cachePath.c_str(), std::ios::binary);
+#else
+	std::ifstream cacheIn(NarrowPath(a_cachePath).c_str(), std::ios::binary);
+#endif
+	if (cacheIn)
+	{
+		std::vector<char> cached((std::istreambuf_iterator<char>(cacheIn)), std::istreambuf_iterator<char>());
+		if (!cached.empty() && Deserialize(a_shader, &cached[0], cached.size()))
+		{
+			if (a_fromCache)
+				*a_fromCache = true;
+			return true;
+		}
+	}
+	cacheIn.close();
+
+	if (!Parse(a_shader, a_size))
+		return false;
+
+	//Missing or stale; a read-only folder just means parsing every time
+	std::vector<uint8_t> bytes;
+	Serialize(a_shader, bytes);
+#ifdef _WIN32
+	std::ofstream cacheOut(a_cachePath.c_str(), std::ios::binary | std::ios::trunc);
+#else
+	std::ofstream cacheOut(NarrowPath(a_cachePath).c_str(), std::ios::binary | std::ios::trunc);
+#endif
+	if (cacheOut)
+		cacheOut.write((const char*)&bytes[0], bytes.size());
+
+	return true;
+}
+
+std::wstring ShaderReflection::CachePathFor(const std::wstring& a_shaderPath)
+{
+	std::wstring extension = L".cso";
+	if (a_shaderPath.size() >= extension.size() &&
+		a_shaderPath.compare(a_shaderPath.size() - extension.size(), extension.size(), extension) == 0)
+		return a_shaderPath.substr(0, a_shaderPath.size() - extension.size()) + L".refl";
+	return a_shaderPath + L".refl";
+}
+
+static bool SameParameters(const std::vector<ReflectedParameter>& a_first, const std::vector<ReflectedParameter>& a_second)
+{
+	if (a_first.size() != a_second.size())
+		return false;
+	for (size_t i = 0; i < a_first.size(); i++)
+	{
+		const ReflectedParameter& x = a_first[i];
+		const ReflectedParameter& y = a_second[i];
+		if (x.SemanticName != y.SemanticName || x.SemanticIndex != y.SemanticIndex || x.Register != y.Register ||
+			x.SystemValue != y.SystemValue || x.ComponentType != y.ComponentType || x.Mask != y.Mask ||
+			x.ReadWriteMask != y.ReadWriteMask || x.Stream != y.Stream)
+			return false;
+	}
+	return true;
+}
+
+bool ShaderReflection::operator==(const ShaderReflection& a_other) const
+{
+	if (ProgramType != a_other.ProgramType ||
+		memcmp(ThreadGroupSize, a_other.ThreadGroupSize, sizeof(ThreadGroupSize)) != 0 ||
+		ConstantBuffers.size() != a_other.ConstantBuffers.size() ||
+		Resources.size() != a_other.Resources.size())
+		return false;
+
+	for (size_t b = 0; b < ConstantBuffers.size(); b++)
+	{
+		const ReflectedConstantBuffer& x = ConstantBuffers[b];
+		const ReflectedConstantBuffer& y = a_other.ConstantBuffers[b];
+		if (x.Name != y.Name || x.Size != y.Size || x.BindPoint != y.BindPoint || x.Variables.size() != y.Variables.size())
+			return false;
+		for (size_t v = 0; v < x.Variables.size(); v++)
+		{
+			if (x.Variables[v].Name != y.Variables[v].Name || x.Variables[v].Offset != y.Variables[v].Offset ||
+				x.Variables[v].Size != y.Variables[v].Size)
+				return false;
+		}
+	}
+
+	for (size_t r = 0; r < Resources.size(); r++)
+	{
+		const ReflectedResource& x = Resources[r];
+		const ReflectedResource& y = a_other.Resources[r];
+		if (x.Name != y.Name || x.Type != y.Type || x.BindPoint != y.BindPoint || x.BindCount != y.BindCount)
+			return false;
+	}
+
+	return SameParameters(Inputs, a_other.Inputs) && SameParameters(Outputs, a_other.Outputs);
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Numbers are the D3D ones (D3D_SHADER_INPUT_TYPE,
+// D3D_REGISTER_COMPONENT_TYPE, ...) so they cast straight
+// across, but this header builds without the D3D headers
+
+struct ReflectedVariable
+{
+	std::string Name;
+	uint32_t Offset;
+	uint32_t Size;
+};
+
+struct ReflectedConstantBuffer
+{
+	std::string Name;
+	uint32_t Size;
+	uint32_t BindPoint;
+	std::vector<ReflectedVariable> Variables;
+};
+
+// Textures, samplers, UAVs and buffers
+struct ReflectedResource
+{
+	std::string Name;
+	uint32_t Type;				// D3D_SHADER_INPUT_TYPE
+	uint32_t BindPoint;
+	uint32_t BindCount;
+};
+
+// One element of the input or output signature
+struct ReflectedParameter
+{
+	std::string SemanticName;
+	uint32_t SemanticIndex;
+	uint32_t Register;
+	uint32_t SystemValue;		// D3D_NAME
+	uint32_t ComponentType;		// D3D_REGISTER_COMPONENT_TYPE
+	uint8_t Mask;
+	uint8_t ReadWriteMask;
+	uint32_t Stream;
+};
+
+// --------------------------------------------------------
+// What SimpleShader needs to know about a compiled shader,
+// read straight out of the .cso's DXBC container:
+//
+//   RDEF          constant buffers, their variables, and
+//                 bound resources
+//   ISGN/OSGN     input and output signatures (also the
+//                 OSG5/ISG1/OSG1 variants)
+//   SHEX/SHDR     only for a compute shader's group size
+//
+// Parsing is plain byte reading, so it works anywhere; a
+// parsed shader is cached next to its .cso, keyed by the
+// container's checksum, so a shader that hasn't changed is
+// never parsed twice.
+// --------------------------------------------------------
+struct ShaderReflection
+{
+	uint32_t ProgramType;			// 0xFFFE vertex, 0xFFFF pixel, 0x4753 geometry, ...
+	uint32_t ThreadGroupSize[3];	// Compute shaders only
+	std::vector<ReflectedConstantBuffer> ConstantBuffers;
+	std::vector<ReflectedResource> Resources;
+	std::vector<ReflectedParameter> Inputs;
+	std::vector<ReflectedParameter> Outputs;
+
+	ShaderReflection();
+	void Clear();
+
+	// False if a_bytes isn't a DXBC shader with reflection data
+	bool Parse(const void* a_bytes, size_t a_size);
+
+	// The cache file's contents, and back.  Deserialize() fails if
+	// a_bytes came from a different shader (or cache version)
+	void Serialize(const void* a_shader, std::vector<uint8_t>& a_out) const;
+	bool Deserialize(const void* a_shader, const void* a_bytes, size_t a_size);
+
+	// Reads the cache at a_cachePath if it matches a_shader, or parses
+	// a_shader and writes the cache (failing to write is fine).  Sets
+	// a_fromCache to which one happened
+	bool Load(const void* a_shader, size_t a_size, const std::wstring& a_cachePath, bool* a_fromCache = 0);
+
+	bool operator==(const ShaderReflection& a_other) const;
+
+	// ".cso" swapped for ".refl"
+	static std::wstring CachePathFor(const std::wstring& a_shaderPath);
+};
@@ -0,0 +1,70 @@
+#include "ShadowCache.h"
+
+ShadowSignature::ShadowSignature()
+{
+	hash = 14695981039346656037ULL;
+}
+
+//FNV-1a
+void ShadowSignature::Add(const void* a_data, size_t a_bytes)
+{
+	const unsigned char* bytes = (const unsigned char*)a_data;
+	for (size_t i = 0; i < a_bytes; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+}
+
+void ShadowSignature::AddCaster(GameEntity* a_caster)
+{
+	Add((uint64_t)(uintptr_t)a_caster);
+
+	XMFLOAT4X4 world = a_caster->GetWorldMatrix();
+	Add(&world, sizeof(world));
+}
+
+ShadowCache::ShadowCache(int a_views)
+{
+	viewCount = a_views;
+	signatures = new uint64_t[viewCount];
+	drawn = new bool[viewCount];
+	for (int i = 0; i < viewCount; i++)
+	{
+		signatures[i] = 0;
+		drawn[i] = false;
+	}
+
+	updated = 0;
+	skipped = 0;
+	lastUpdated = 0;
+	lastSkipped = 0;
+}
+
+ShadowCache::~ShadowCache()
+{
+	delete[] signatures;
+	delete[] drawn;
+}
+
+bool ShadowCache::NeedsUpdate(int a_view, uint64_t a_signature)
+{
+	if (drawn[a_view] && signatures[a_view] == a_signature)
+	{
+		skipped++;
+		return false;
+	}
+
+	signatures[a_view] = a_signature;
+	drawn[a_view] = true;
+	updated++;
+	return true;
+}
+
+void ShadowCache::BeginFrame()
+{
+	lastUpdated = updated;
+	lastSkipped = skipped;
+	updated = 0;
+	skipped = 0;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include "GameEntity.h"
+
+// --------------------------------------------------------
+// Everything a shadow view's depth depends on, folded into
+// one number.  Two frames that add the same things in the
+// same order get the same signature.
+// --------------------------------------------------------
+class ShadowSignature
+{
+public:
+	ShadowSignature();
+
+	void Add(const void* a_data, size_t a_bytes);
+	void Add(uint64_t a_value) { Add(&a_value, sizeof(a_value)); }
+
+	// Which entity, and where it is
+	void AddCaster(GameEntity* a_caster);
+
+	uint64_t Get() { return hash; }
+
+private:
+	uint64_t hash;
+};
+
+// --------------------------------------------------------
+// Remembers what each shadow view was last drawn from, so a
+// view is only drawn again once that changes.  Views are
+// just numbers the caller picks, 0 to a_views - 1.
+// --------------------------------------------------------
+class ShadowCache
+{
+public:
+	ShadowCache(int a_views);
+	~ShadowCache();
+
+	// True if a_view has never been drawn, or was drawn from
+	// something else.  Assumes the caller now draws it
+	bool NeedsUpdate(int a_view, uint64_t a_signature);
+
+	// Counters, per frame
+	void BeginFrame();
+	int GetLastUpdated() { return lastUpdated; }
+	int GetLastSkipped() { return lastSkipped; }
+
+private:
+	int viewCount;
+	uint64_t* signatures;
+	bool* drawn;
+
+	int updated;
+	int skipped;
+	int lastUpdated;
+	int lastSkipped;
+};
@@ -5,13 +5,14 @@
 // - All non-pipeline variables that get their values from 
 //    our C++ code must be defined inside a Constant Buffer
 // - The name of the cbuffer itself is unimportant
+// - The light's view and projection come from ShaderConstants.hlsli
 cbuffer externalData : register(b0)
 {
 	matrix world;
-	matrix view;
-	matrix projection;
 };
 
+#include "ShaderConstants.hlsli"
+
 // Struct representing a single vertex worth of data
 // - This should match the vertex definition in our C++ code
 // - By "match", I mean the size, order and number of members
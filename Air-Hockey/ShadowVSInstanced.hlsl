@@ -0,0 +1,75 @@
+
+// Constant Buffer
+// - Allows us to define a buffer of individual variables 
+//    which will (eventually) hold data from our C++ code
+// - All non-pipeline variables that get their values from 
+//    our C++ code must be defined inside a Constant Buffer
+// - The name of the cbuffer itself is unimportant
+// - Same as ShadowVS.hlsl, except the world matrix comes
+//    from the instance buffer, one per instance
+#include "ShaderConstants.hlsli"
+
+// Struct representing a single vertex worth of data
+// - This should match the vertex definition in our C++ code
+// - By "match", I mean the size, order and number of members
+// - The name of the struct itself is unimportant, but should be descriptive
+// - Each variable must have a semantic, which defines its usage
+struct VertexShaderInput
+{ 
+	// Data type
+	//  |
+	//  |   Name          Semantic
+	//  |    |                |
+	//  v    v                v
+	float3 position		: POSITION;     // XYZ position
+	float3 normal		: NORMAL;       // Normal
+	float2 uv           : TEXCOORD;     // UV
+
+	// The world matrix, as GetWorldMatrix() gives it (transposed), a row
+	// at a time.  "_PER_INSTANCE" puts these in input slot 1
+	float4 world0		: WORLD_PER_INSTANCE0;
+	float4 world1		: WORLD_PER_INSTANCE1;
+	float4 world2		: WORLD_PER_INSTANCE2;
+	float4 world3		: WORLD_PER_INSTANCE3;
+};
+
+// Struct representing the data we're sending down the pipeline
+// - Should match our pixel shader's input (hence the name: Vertex to Pixel)
+// - At a minimum, we need a piece of data defined tagged as SV_POSITION
+// - The name of the struct itself is unimportant, but should be descriptive
+// - Each variable must have a semantic, which defines its usage
+struct VertexToPixel
+{
+	// Data type
+	//  |
+	//  |   Name          Semantic
+	//  |    |                |
+	//  v    v                v
+	float4 position		: SV_POSITION;	// XYZW position (System Value Position)
+	float3 normal		: NORMAL;       // Normal
+	float2 uv           : TEXCOORD;     // UV
+	float3 worldPos		: POSITION;
+};
+
+// --------------------------------------------------------
+// The entry point (main method) for our vertex shader
+// 
+// - Input is exactly one vertex worth of data (defined by a struct)
+// - Output is a single struct of data to pass down the pipeline
+// - Named "main" because that's the default the shader compiler looks for
+// --------------------------------------------------------
+VertexToPixel main( VertexShaderInput input )
+{
+
+	VertexToPixel output;
+
+	// Undo the transpose the C++ side does for constant buffers
+	matrix world = transpose(matrix(input.world0, input.world1, input.world2, input.world3));
+
+	matrix worldViewProj = mul(mul(world, view), projection);
+
+	output.position = mul(float4(input.position, 1.0f), worldViewProj);
+
+
+	return output;
+}
\ No newline at end of file
@@ -1,22 +1,29 @@
 #include "SimpleShader.h"
 
+SimpleShaderUploadStats ISimpleShader::frameUploads = {};
+SimpleShaderUploadStats ISimpleShader::lastFrameUploads = {};
+thread_local SimpleShaderUploadStats* ISimpleShader::threadUploads = 0;
+std::vector<std::string> ISimpleShader::sharedBuffers;
+
 ///////////////////////////////////////////////////////////////////////////////
 // ------ BASE SIMPLE SHADER --------------------------------------------------
 ///////////////////////////////////////////////////////////////////////////////
 
 // --------------------------------------------------------
-// Constructor accepts DirectX device & context
+// Constructor accepts DirectX device & render backend
 // --------------------------------------------------------
-ISimpleShader::ISimpleShader(ID3D11Device* device, ID3D11DeviceContext* context)
+ISimpleShader::ISimpleShader(ID3D11Device* device, RenderBackend* backend)
 {
 	// Save the device
 	this->device = device;
-	this->deviceContext = context;
+	this->backend = backend;
+	this->target = backend;
 
 	// Set up fields
 	constantBufferCount = 0;
 	constantBuffers = 0;
 	shaderBlob = 0;
+	shaderValid = false;
 }
 
 // --------------------------------------------------------
@@ -25,8 +32,10 @@ ISimpleShader::ISimpleShader(ID3D11Device* device, ID3D11DeviceContext* context)
 ISimpleShader::~ISimpleShader()
 {
 	// Derived class destructors will call this class's CleanUp method
+#ifdef _WIN32
 	if(shaderBlob)
 		shaderBlob->Release();
+#endif
 }
 
 // --------------------------------------------------------
@@ -38,7 +47,7 @@ void ISimpleShader::CleanUp()
 	// Handle constant buffers and local data buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		constantBuffers[i].ConstantBuffer->Release();
+		backend->ReleaseBuffer(constantBuffers[i].ConstantBuffer);
 		delete[] constantBuffers[i].LocalDataBuffer;
 	}
 
@@ -59,6 +68,9 @@ void ISimpleShader::CleanUp()
 	cbTable.clear();
 	samplerTable.clear();
 	textureTable.clear();
+	varHashes.clear();
+	textureHashes.clear();
+	samplerHashes.clear();
 }
 
 // --------------------------------------------------------
@@ -70,7 +82,8 @@ void ISimpleShader::CleanUp()
 // 
 // Returns true if shader is loaded properly, false otherwise
 // --------------------------------------------------------
-bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
+#ifdef _WIN32
+bool ISimpleShader::LoadShaderFile(const wchar_t* shaderFile)
 {
 	// Load the shader to a blob and ensure it worked
 	HRESULT hr = D3DReadFileToBlob(shaderFile, &shaderBlob);
@@ -79,6 +92,14 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		return false;
 	}
 
+	// Get information about this shader and its variables, buffers,
+	// etc.  Read from the cache next to the file when it's current,
+	// so only a shader that changed is parsed
+	if (!reflection.Load(shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize(), ShaderReflection::CachePathFor(shaderFile)))
+	{
+		return false;
+	}
+
 	// Create the shader - Calls an overloaded version of this abstract
 	// method in the appropriate child class
 	shaderValid = CreateShader(shaderBlob);
@@ -87,33 +108,19 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		return false;
 	}
 
-	// Set up shader reflection to get information about
-	// this shader and its variables,  buffers, etc.
-	ID3D11ShaderReflection* refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)&refl);
-	
-	// Get the description of the shader
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-
 	// Create resource arrays
-	constantBufferCount = shaderDesc.ConstantBuffers;
-	constantBuffers = new SimpleConstantBuffer[constantBufferCount];
+	// Shared buffers are skipped, so there may be fewer than this
+	constantBufferCount = 0;
+	constantBuffers = new SimpleConstantBuffer[reflection.ConstantBuffers.size()];
 	
 	// Handle bound resources (like shaders and samplers)
-	unsigned int resourceCount = shaderDesc.BoundResources;
-	for (unsigned int r = 0; r < resourceCount; r++)
+	for (size_t r = 0; r < reflection.Resources.size(); r++)
 	{
 		// Get this resource's description
-		D3D11_SHADER_INPUT_BIND_DESC resourceDesc;
-		refl->GetResourceBindingDesc(r, &resourceDesc);
+		const ReflectedResource& resourceDesc = reflection.Resources[r];
 
 		// Check the type
-		switch (resourceDesc.Type)
+		switch ((D3D_SHADER_INPUT_TYPE)resourceDesc.Type)
 		{
 		case D3D_SIT_TEXTURE: // A texture resource
 		{
@@ -123,6 +130,7 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 			srv->Index = (unsigned int)shaderResourceViews.size();	// Raw index
 
 			textureTable.insert(std::pair<std::string, SimpleSRV*>(resourceDesc.Name, srv));
+			textureHashes.push_back(std::make_pair(SimpleShaderName(resourceDesc.Name.c_str()).Hash, (const SimpleSRV*)srv));
 			shaderResourceViews.push_back(srv);
 		}
 			break;
@@ -135,6 +143,7 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 			samp->Index = (unsigned int)samplerStates.size();	// Raw index
 
 			samplerTable.insert(std::pair<std::string, SimpleSampler*>(resourceDesc.Name, samp));
+			samplerHashes.push_back(std::make_pair(SimpleShaderName(resourceDesc.Name.c_str()).Hash, (const SimpleSampler*)samp));
 			samplerStates.push_back(samp);
 		}
 			break;
@@ -142,71 +151,65 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 	}
 
 	// Loop through all constant buffers
-	for (unsigned int b = 0; b < constantBufferCount; b++)
+	for (size_t r = 0; r < reflection.ConstantBuffers.size(); r++)
 	{
-		// Get this buffer
-		ID3D11ShaderReflectionConstantBuffer* cb =
-			refl->GetConstantBufferByIndex(b);
-		
 		// Get the description of this buffer
-		D3D11_SHADER_BUFFER_DESC bufferDesc;
-		cb->GetDesc(&bufferDesc);
-		
-		// Get the description of the resource binding, so
-		// we know exactly how it's bound in the shader
-		D3D11_SHADER_INPUT_BIND_DESC bindDesc;
-		refl->GetResourceBindingDescByName(bufferDesc.Name, &bindDesc);
+		const ReflectedConstantBuffer& bufferDesc = reflection.ConstantBuffers[r];
+
+		// Someone else fills and binds it
+		if (IsSharedConstantBuffer(bufferDesc.Name))
+			continue;
+		unsigned int b = constantBufferCount++;
 		
 		// Set up the buffer and put its pointer in the table
-		constantBuffers[b].BindIndex = bindDesc.BindPoint;
+		constantBuffers[b].BindIndex = bufferDesc.BindPoint;
 		constantBuffers[b].Name = bufferDesc.Name;
 		cbTable.insert(std::pair<std::string, SimpleConstantBuffer*>(bufferDesc.Name, &constantBuffers[b]));
 
-		// Create this constant buffer
-		D3D11_BUFFER_DESC newBuffDesc;
-		newBuffDesc.Usage = D3D11_USAGE_DEFAULT;
-		newBuffDesc.ByteWidth = bufferDesc.Size;
-		newBuffDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-		newBuffDesc.CPUAccessFlags = 0;
-		newBuffDesc.MiscFlags = 0;
-		newBuffDesc.StructureByteStride = 0;
-		device->CreateBuffer(&newBuffDesc, 0, &constantBuffers[b].ConstantBuffer);
-
-		// Set up the data buffer for this constant buffer
+		// Create this constant buffer.  It starts out updated with
+		// UpdateSubresource, and is made dynamic if it changes often
+		constantBuffers[b].ConstantBuffer = backend->CreateBuffer(RENDER_BUFFER_CONSTANT, bufferDesc.Size, 0, false);
+		constantBuffers[b].Dynamic = false;
+		constantBuffers[b].MakeDynamic = false;
+		constantBuffers[b].ChangedUploads = 0;
+
+		// Set up the data buffer for this constant buffer; all of
+		// it is dirty until it's been sent once
 		constantBuffers[b].Size = bufferDesc.Size;
 		constantBuffers[b].LocalDataBuffer = new unsigned char[bufferDesc.Size];
 		ZeroMemory(constantBuffers[b].LocalDataBuffer, bufferDesc.Size);
+		constantBuffers[b].DirtyStart = 0;
+		constantBuffers[b].DirtyEnd = bufferDesc.Size;
 
 		// Loop through all variables in this buffer
-		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
+		for (size_t v = 0; v < bufferDesc.Variables.size(); v++)
 		{
-			// Get this variable
-			ID3D11ShaderReflectionVariable* var =
-				cb->GetVariableByIndex(v);
-			
-			// Get the description of the variable and its type
-			D3D11_SHADER_VARIABLE_DESC varDesc;
-			var->GetDesc(&varDesc);
+			// Get the description of this variable
+			const ReflectedVariable& varDesc = bufferDesc.Variables[v];
 
 			// Create the variable struct
 			SimpleShaderVariable varStruct;
 			varStruct.ConstantBufferIndex = b;
-			varStruct.ByteOffset = varDesc.StartOffset;
+			varStruct.ByteOffset = varDesc.Offset;
 			varStruct.Size = varDesc.Size;
 			
 			// Get a string version
-			std::string varName(varDesc.Name);
-
-			// Add this variable to the table and the constant buffer
-			varTable.insert(std::pair<std::string, SimpleShaderVariable>(varName, varStruct));
+			const std::string& varName = varDesc.Name;
+
+			// Add this variable to the table and the constant buffer.
+			// Map entries never move, so the hash list can point at them
+			std::pair<std::unordered_map<std::string, SimpleShaderVariable>::iterator, bool> added =
+				varTable.insert(std::pair<std::string, SimpleShaderVariable>(varName, varStruct));
+			if (added.second)
+				varHashes.push_back(std::make_pair(SimpleShaderName(varDesc.Name.c_str()).Hash, (const SimpleShaderVariable*)&added.first->second));
 			constantBuffers[b].Variables.push_back(varStruct);
 		}
 	}
 
 	// All set
-	refl->Release();
 	return true;
 }
+#endif
 
 // --------------------------------------------------------
 // Helper for looking up a variable by name and also
@@ -261,11 +264,130 @@ void ISimpleShader::SetShader()
 	// Ensure the shader is valid
 	if (!shaderValid) return;
 
+	// Buffers that keep changing switch to dynamic here, where
+	// they're about to be bound anyway (the old buffer may still
+	// be bound now, and this shader may not be)
+	for (unsigned int i = 0; i < constantBufferCount; i++)
+	{
+		SimpleConstantBuffer* cb = &constantBuffers[i];
+		if (!cb->MakeDynamic)
+			continue;
+
+		target->ReleaseBuffer(cb->ConstantBuffer);
+		cb->ConstantBuffer = target->CreateBuffer(RENDER_BUFFER_CONSTANT, cb->Size, cb->LocalDataBuffer, true);
+		cb->Dynamic = true;
+		cb->MakeDynamic = false;
+		cb->DirtyStart = cb->Size;
+		cb->DirtyEnd = 0;
+	}
+
 	// Set the shader and any relevant constant buffers, which
 	// is an overloaded method in a subclass
 	SetShaderAndCBs();
 }
 
+// --------------------------------------------------------
+// Sends one constant buffer to the GPU if anything in it
+// changed since it was last sent.  D3D11 constant buffers
+// are always written whole; the dirty range only decides
+// whether to write at all
+// --------------------------------------------------------
+void ISimpleShader::UploadBuffer(SimpleConstantBuffer* cb)
+{
+	SimpleShaderUploadStats& uploads = threadUploads ? *threadUploads : frameUploads;
+	if (cb->DirtyStart >= cb->DirtyEnd)
+	{
+		cb->ChangedUploads = 0;
+		uploads.Skipped++;
+		return;
+	}
+
+	if (cb->Dynamic)
+		target->WriteBuffer(cb->ConstantBuffer, cb->LocalDataBuffer, cb->Size);
+	else
+		target->UpdateBuffer(cb->ConstantBuffer, cb->LocalDataBuffer, cb->Size);
+
+	uploads.Uploads++;
+	uploads.BytesUploaded += cb->Size;
+	uploads.BytesChanged += cb->DirtyEnd - cb->DirtyStart;
+
+	//Changes nearly every time it's sent: per-object data
+	if (!cb->Dynamic && ++cb->ChangedUploads >= DYNAMIC_AFTER)
+		cb->MakeDynamic = true;
+
+	cb->DirtyStart = cb->Size;
+	cb->DirtyEnd = 0;
+}
+
+// --------------------------------------------------------
+// Marks a constant buffer name as shared: shaders loaded
+// after this leave it alone (no buffer, no variables, no
+// binding), so whatever the caller binds to its register
+// stays bound across every shader
+// --------------------------------------------------------
+void ISimpleShader::ShareConstantBuffer(std::string name)
+{
+	if (!IsSharedConstantBuffer(name))
+		sharedBuffers.push_back(name);
+}
+
+bool ISimpleShader::IsSharedConstantBuffer(const std::string& name)
+{
+	for (size_t i = 0; i < sharedBuffers.size(); i++)
+	{
+		if (sharedBuffers[i] == name)
+			return true;
+	}
+	return false;
+}
+
+// --------------------------------------------------------
+// Resets the upload counters; call once per frame
+// --------------------------------------------------------
+void ISimpleShader::BeginFrame()
+{
+	lastFrameUploads = frameUploads;
+	memset(&frameUploads, 0, sizeof(frameUploads));
+}
+
+// --------------------------------------------------------
+// Counts this thread's uploads somewhere else, so passes
+// recorded at once don't all write the frame's counters
+// --------------------------------------------------------
+void ISimpleShader::SetThreadStats(SimpleShaderUploadStats* stats)
+{
+	threadUploads = stats;
+}
+
+void ISimpleShader::AddFrameStats(const SimpleShaderUploadStats& stats)
+{
+	frameUploads.Uploads += stats.Uploads;
+	frameUploads.Skipped += stats.Skipped;
+	frameUploads.BytesUploaded += stats.BytesUploaded;
+	frameUploads.BytesChanged += stats.BytesChanged;
+}
+
+// --------------------------------------------------------
+// Copies data into a constant buffer's local copy, widening
+// its dirty range only if the bytes are actually different
+// --------------------------------------------------------
+void ISimpleShader::WriteVariable(const SimpleShaderVariable* var, const void* data, unsigned int size)
+{
+	SimpleConstantBuffer* cb = &constantBuffers[var->ConstantBufferIndex];
+	unsigned char* dest = cb->LocalDataBuffer + var->ByteOffset;
+
+	//Same value as last time (lights, cameras, anything set every
+	//frame that didn't move) leaves the buffer clean
+	if (memcmp(dest, data, size) == 0)
+		return;
+
+	memcpy(dest, data, size);
+	if (var->ByteOffset < cb->DirtyStart)
+		cb->DirtyStart = var->ByteOffset;
+	if (var->ByteOffset + size > cb->DirtyEnd)
+		cb->DirtyEnd = var->ByteOffset + size;
+}
+
 // --------------------------------------------------------
 // Copies the relevant data to the all of this 
 // shader's constant buffers.  To just copy one
@@ -276,13 +398,10 @@ void ISimpleShader::CopyAllBufferData()
 	// Ensure the shader is valid
 	if (!shaderValid) return;
 
-	// Loop through the constant buffers and copy all data
+	// Loop through the constant buffers and copy any that changed
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		// Copy the entire local data buffer
-		deviceContext->UpdateSubresource(
-			constantBuffers[i].ConstantBuffer, 0, 0,
-			constantBuffers[i].LocalDataBuffer, 0, 0);
+		UploadBuffer(&constantBuffers[i]);
 	}
 }
 
@@ -310,10 +429,8 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 	SimpleConstantBuffer* cb = &this->constantBuffers[index];
 	if (!cb) return;
 
-	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer, 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	// Copy the data (if it changed) and get out
+	UploadBuffer(cb);
 }
 
 // --------------------------------------------------------
@@ -332,10 +449,8 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 	SimpleConstantBuffer* cb = this->FindConstantBuffer(bufferName);
 	if (!cb) return;
 
-	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer, 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	// Copy the data (if it changed) and get out
+	UploadBuffer(cb);
 }
 
 
@@ -357,10 +472,7 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 		return false;
 
 	// Set the data in the local data buffer
-	memcpy(
-		constantBuffers[var->ConstantBufferIndex].LocalDataBuffer + var->ByteOffset,
-		data,
-		size);
+	WriteVariable(var, data, size);
 
 	// Success
 	return true;
@@ -446,6 +558,49 @@ bool ISimpleShader::SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 dat
 	return this->SetData(name, &data, sizeof(float) * 16);
 }
 
+// --------------------------------------------------------
+// Sets data by handle - no lookup at all
+//
+// var - The variable, from GetVariableInfo()
+// data - The data to set in the buffer
+// size - The size of the data (this must match the variable's size)
+//
+// Returns false if var is null or the sizes don't match
+// --------------------------------------------------------
+bool ISimpleShader::SetData(const SimpleShaderVariable* var, const void* data, unsigned int size)
+{
+	if (var == 0 || var->Size != size)
+		return false;
+
+	WriteVariable(var, data, size);
+	return true;
+}
+
+bool ISimpleShader::SetInt(const SimpleShaderVariable* var, int data)
+{
+	return this->SetData(var, &data, sizeof(int));
+}
+
+bool ISimpleShader::SetFloat(const SimpleShaderVariable* var, float data)
+{
+	return this->SetData(var, &data, sizeof(float));
+}
+
+bool ISimpleShader::SetFloat3(const SimpleShaderVariable* var, const DirectX::XMFLOAT3& data)
+{
+	return this->SetData(var, &data, sizeof(float) * 3);
+}
+
+bool ISimpleShader::SetFloat4(const SimpleShaderVariable* var, const DirectX::XMFLOAT4& data)
+{
+	return this->SetData(var, &data, sizeof(float) * 4);
+}
+
+bool ISimpleShader::SetMatrix4x4(const SimpleShaderVariable* var, const DirectX::XMFLOAT4X4& data)
+{
+	return this->SetData(var, &data, sizeof(float) * 16);
+}
+
 // --------------------------------------------------------
 // Gets info about a shader variable, if it exists
 // --------------------------------------------------------
@@ -454,6 +609,19 @@ const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string name)
 	return FindVariable(name, -1);
 }
 
+// --------------------------------------------------------
+// Gets info about a shader variable by hashed name (or null)
+// --------------------------------------------------------
+const SimpleShaderVariable* ISimpleShader::GetVariableInfo(SimpleShaderName name)
+{
+	for (size_t i = 0; i < varHashes.size(); i++)
+	{
+		if (varHashes[i].first == name.Hash)
+			return varHashes[i].second;
+	}
+	return 0;
+}
+
 // --------------------------------------------------------
 // Gets info about an SRV in the shader (or null)
 //
@@ -474,6 +642,19 @@ const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(std::string name)
 }
 
 
+// --------------------------------------------------------
+// Gets info about an SRV in the shader by hashed name (or null)
+// --------------------------------------------------------
+const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(SimpleShaderName name)
+{
+	for (size_t i = 0; i < textureHashes.size(); i++)
+	{
+		if (textureHashes[i].first == name.Hash)
+			return textureHashes[i].second;
+	}
+	return 0;
+}
+
 // --------------------------------------------------------
 // Gets info about an SRV in the shader (or null)
 //
@@ -508,6 +689,19 @@ const SimpleSampler* ISimpleShader::GetSamplerInfo(std::string name)
 	return result->second;
 }
 
+// --------------------------------------------------------
+// Gets info about a sampler in the shader by hashed name (or null)
+// --------------------------------------------------------
+const SimpleSampler* ISimpleShader::GetSamplerInfo(SimpleShaderName name)
+{
+	for (size_t i = 0; i < samplerHashes.size(); i++)
+	{
+		if (samplerHashes[i].first == name.Hash)
+			return samplerHashes[i].second;
+	}
+	return 0;
+}
+
 // --------------------------------------------------------
 // Gets info about a sampler in the shader (or null)
 // 
@@ -577,8 +771,8 @@ const SimpleConstantBuffer * ISimpleShader::GetBufferInfo(unsigned int index)
 // --------------------------------------------------------
 // Constructor just calls the base
 // --------------------------------------------------------
-SimpleVertexShader::SimpleVertexShader(ID3D11Device* device, ID3D11DeviceContext* context)
-	: ISimpleShader(device, context) 
+SimpleVertexShader::SimpleVertexShader(ID3D11Device* device, RenderBackend* backend)
+	: ISimpleShader(device, backend) 
 { 
 	// Ensure we set to zero to successfully trigger
 	// the Input Layout creation during LoadShader()
@@ -593,8 +787,8 @@ SimpleVertexShader::SimpleVertexShader(ID3D11Device* device, ID3D11DeviceContext
 // Passing in a valid input layout will stop LoadShader()
 // from creating an input layout from shader reflection
 // --------------------------------------------------------
-SimpleVertexShader::SimpleVertexShader(ID3D11Device * device, ID3D11DeviceContext * context, ID3D11InputLayout * inputLayout, bool perInstanceCompatible)
-	: ISimpleShader(device, context)
+SimpleVertexShader::SimpleVertexShader(ID3D11Device * device, RenderBackend * backend, ID3D11InputLayout * inputLayout, bool perInstanceCompatible)
+	: ISimpleShader(device, backend)
 {
 	// Save the custom input layout
 	this->inputLayout = inputLayout;
@@ -618,8 +812,10 @@ SimpleVertexShader::~SimpleVertexShader()
 void SimpleVertexShader::CleanUp()
 {
 	ISimpleShader::CleanUp();
+#ifdef _WIN32
 	if (shader) { shader->Release(); shader = 0; }
 	if (inputLayout) { inputLayout->Release(); inputLayout = 0; }
+#endif
 }
 
 // --------------------------------------------------------
@@ -629,6 +825,7 @@ void SimpleVertexShader::CleanUp()
 //
 // Returns true if shader is created correctly, false otherwise
 // --------------------------------------------------------
+#ifdef _WIN32
 bool SimpleVertexShader::CreateShader(ID3DBlob* shaderBlob)
 {
 	// Clean up first, in the event this method is
@@ -656,24 +853,12 @@ bool SimpleVertexShader::CreateShader(ID3DBlob* shaderBlob)
 	// matches what the vertex shader expects.  Code adapted from:
 	// https://takinginitiative.wordpress.com/2011/12/11/directx-1011-basic-shader-reflection-automatic-input-layout-creation/
 
-	// Reflect shader info
-	ID3D11ShaderReflection* refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)&refl);
-	
-	// Get shader info
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-
-	// Read input layout description from shader info
+	// Read input layout description from shader info (LoadShaderFile()
+	// has already reflected it)
 	std::vector<D3D11_INPUT_ELEMENT_DESC> inputLayoutDesc;
-	for (unsigned int i = 0; i< shaderDesc.InputParameters; i++)
+	for (size_t i = 0; i < reflection.Inputs.size(); i++)
 	{
-		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
-		refl->GetInputParameterDesc(i, &paramDesc);
+		const ReflectedParameter& paramDesc = reflection.Inputs[i];
 
 		// Check the semantic name for "_PER_INSTANCE"
 		std::string perInstanceStr = "_PER_INSTANCE";
@@ -685,7 +870,7 @@ bool SimpleVertexShader::CreateShader(ID3DBlob* shaderBlob)
 
 		// Fill out input element desc
 		D3D11_INPUT_ELEMENT_DESC elementDesc;
-		elementDesc.SemanticName = paramDesc.SemanticName;
+		elementDesc.SemanticName = paramDesc.SemanticName.c_str();
 		elementDesc.SemanticIndex = paramDesc.SemanticIndex;
 		elementDesc.InputSlot = 0;
 		elementDesc.AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
@@ -740,10 +925,10 @@ bool SimpleVertexShader::CreateShader(ID3DBlob* shaderBlob)
 		shaderBlob->GetBufferSize(),
 		&inputLayout);
 
-	// All done, clean up
-	refl->Release();
+	// All done
 	return true;
 }
+#endif
 
 // --------------------------------------------------------
 // Sets the vertex shader, input layout and constant buffers
@@ -755,16 +940,13 @@ void SimpleVertexShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 
 	// Set the shader and input layout
-	deviceContext->IASetInputLayout(inputLayout);
-	deviceContext->VSSetShader(shader, 0, 0);
+	target->SetInputLayout(inputLayout);
+	target->SetShader(RENDER_STAGE_VERTEX, (ID3D11DeviceChild*)shader);
 
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		deviceContext->VSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			&constantBuffers[i].ConstantBuffer);
+		target->SetConstantBuffer(RENDER_STAGE_VERTEX, constantBuffers[i].BindIndex, constantBuffers[i].ConstantBuffer);
 	}
 }
 
@@ -778,13 +960,24 @@ void SimpleVertexShader::SetShaderAndCBs()
 // --------------------------------------------------------
 bool SimpleVertexShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
 {
-	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
+	return SetShaderResourceView(GetShaderResourceViewInfo(name), srv);
+}
+
+// --------------------------------------------------------
+// Sets a shader resource view in the vertex shader stage
+//
+// srvInfo - The texture, from GetShaderResourceViewInfo()
+// srv - The shader resource view of the texture in GPU memory
+//
+// Returns false if srvInfo is null
+// --------------------------------------------------------
+bool SimpleVertexShader::SetShaderResourceView(const SimpleSRV* srvInfo, ID3D11ShaderResourceView* srv)
+{
 	if (srvInfo == 0)
 		return false;
 
 	// Set the shader resource view
-	deviceContext->VSSetShaderResources(srvInfo->BindIndex, 1, &srv);
+	target->SetShaderResource(RENDER_STAGE_VERTEX, srvInfo->BindIndex, srv);
 
 	// Success
 	return true;
@@ -800,13 +993,24 @@ bool SimpleVertexShader::SetShaderResourceView(std::string name, ID3D11ShaderRes
 // --------------------------------------------------------
 bool SimpleVertexShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
 {
-	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
+	return SetSamplerState(GetSamplerInfo(name), samplerState);
+}
+
+// --------------------------------------------------------
+// Sets a sampler state in the vertex shader stage
+//
+// sampInfo - The sampler, from GetSamplerInfo()
+// samplerState - The sampler state in GPU memory
+//
+// Returns false if sampInfo is null
+// --------------------------------------------------------
+bool SimpleVertexShader::SetSamplerState(const SimpleSampler* sampInfo, ID3D11SamplerState* samplerState)
+{
 	if (sampInfo == 0)
 		return false;
 
-	// Set the shader resource view
-	deviceContext->VSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	// Set the sampler state
+	target->SetSampler(RENDER_STAGE_VERTEX, sampInfo->BindIndex, samplerState);
 
 	// Success
 	return true;
@@ -820,8 +1024,8 @@ bool SimpleVertexShader::SetSamplerState(std::string name, ID3D11SamplerState* s
 // --------------------------------------------------------
 // Constructor just calls the base
 // --------------------------------------------------------
-SimplePixelShader::SimplePixelShader(ID3D11Device* device, ID3D11DeviceContext* context)
-	: ISimpleShader(device, context) 
+SimplePixelShader::SimplePixelShader(ID3D11Device* device, RenderBackend* backend)
+	: ISimpleShader(device, backend) 
 { 
 	this->shader = 0;
 }
@@ -840,7 +1044,9 @@ SimplePixelShader::~SimplePixelShader()
 void SimplePixelShader::CleanUp()
 {
 	ISimpleShader::CleanUp();
+#ifdef _WIN32
 	if (shader) { shader->Release(); shader = 0; }
+#endif
 }
 
 // --------------------------------------------------------
@@ -850,6 +1056,7 @@ void SimplePixelShader::CleanUp()
 //
 // Returns true if shader is created correctly, false otherwise
 // --------------------------------------------------------
+#ifdef _WIN32
 bool SimplePixelShader::CreateShader(ID3DBlob* shaderBlob)
 {
 	// Clean up first, in the event this method is
@@ -866,6 +1073,7 @@ bool SimplePixelShader::CreateShader(ID3DBlob* shaderBlob)
 	// Check the result
 	return (result == S_OK);
 }
+#endif
 
 // --------------------------------------------------------
 // Sets the pixel shader and constant buffers for
@@ -877,15 +1085,12 @@ void SimplePixelShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 	
 	// Set the shader
-	deviceContext->PSSetShader(shader, 0, 0);
+	target->SetShader(RENDER_STAGE_PIXEL, (ID3D11DeviceChild*)shader);
 
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		deviceContext->PSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			&constantBuffers[i].ConstantBuffer);
+		target->SetConstantBuffer(RENDER_STAGE_PIXEL, constantBuffers[i].BindIndex, constantBuffers[i].ConstantBuffer);
 	}
 }
 
@@ -899,13 +1104,24 @@ void SimplePixelShader::SetShaderAndCBs()
 // --------------------------------------------------------
 bool SimplePixelShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
 {
-	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
+	return SetShaderResourceView(GetShaderResourceViewInfo(name), srv);
+}
+
+// --------------------------------------------------------
+// Sets a shader resource view in the pixel shader stage
+//
+// srvInfo - The texture, from GetShaderResourceViewInfo()
+// srv - The shader resource view of the texture in GPU memory
+//
+// Returns false if srvInfo is null
+// --------------------------------------------------------
+bool SimplePixelShader::SetShaderResourceView(const SimpleSRV* srvInfo, ID3D11ShaderResourceView* srv)
+{
 	if (srvInfo == 0)
 		return false;
 
 	// Set the shader resource view
-	deviceContext->PSSetShaderResources(srvInfo->BindIndex, 1, &srv);
+	target->SetShaderResource(RENDER_STAGE_PIXEL, srvInfo->BindIndex, srv);
 
 	// Success
 	return true;
@@ -921,13 +1137,24 @@ bool SimplePixelShader::SetShaderResourceView(std::string name, ID3D11ShaderReso
 // --------------------------------------------------------
 bool SimplePixelShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
 {
-	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
+	return SetSamplerState(GetSamplerInfo(name), samplerState);
+}
+
+// --------------------------------------------------------
+// Sets a sampler state in the pixel shader stage
+//
+// sampInfo - The sampler, from GetSamplerInfo()
+// samplerState - The sampler state in GPU memory
+//
+// Returns false if sampInfo is null
+// --------------------------------------------------------
+bool SimplePixelShader::SetSamplerState(const SimpleSampler* sampInfo, ID3D11SamplerState* samplerState)
+{
 	if (sampInfo == 0)
 		return false;
 
-	// Set the shader resource view
-	deviceContext->PSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	// Set the sampler state
+	target->SetSampler(RENDER_STAGE_PIXEL, sampInfo->BindIndex, samplerState);
 
 	// Success
 	return true;
@@ -943,8 +1170,8 @@ bool SimplePixelShader::SetSamplerState(std::string name, ID3D11SamplerState* sa
 // --------------------------------------------------------
 // Constructor just calls the base
 // --------------------------------------------------------
-SimpleDomainShader::SimpleDomainShader(ID3D11Device* device, ID3D11DeviceContext* context)
-	: ISimpleShader(device, context) 
+SimpleDomainShader::SimpleDomainShader(ID3D11Device* device, RenderBackend* backend)
+	: ISimpleShader(device, backend) 
 { 
 	this->shader = 0;
 }
@@ -963,7 +1190,9 @@ SimpleDomainShader::~SimpleDomainShader()
 void SimpleDomainShader::CleanUp()
 {
 	ISimpleShader::CleanUp();
+#ifdef _WIN32
 	if (shader) { shader->Release(); shader = 0; }
+#endif
 }
 
 // --------------------------------------------------------
@@ -973,6 +1202,7 @@ void SimpleDomainShader::CleanUp()
 //
 // Returns true if shader is created correctly, false otherwise
 // --------------------------------------------------------
+#ifdef _WIN32
 bool SimpleDomainShader::CreateShader(ID3DBlob* shaderBlob)
 {
 	// Clean up first, in the event this method is
@@ -989,6 +1219,7 @@ bool SimpleDomainShader::CreateShader(ID3DBlob* shaderBlob)
 	// Check the result
 	return (result == S_OK);
 }
+#endif
 
 // --------------------------------------------------------
 // Sets the domain shader and constant buffers for
@@ -1000,15 +1231,12 @@ void SimpleDomainShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 
 	// Set the shader
-	deviceContext->DSSetShader(shader, 0, 0);
+	target->SetShader(RENDER_STAGE_DOMAIN, (ID3D11DeviceChild*)shader);
 
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		deviceContext->DSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			&constantBuffers[i].ConstantBuffer);
+		target->SetConstantBuffer(RENDER_STAGE_DOMAIN, constantBuffers[i].BindIndex, constantBuffers[i].ConstantBuffer);
 	}
 }
 
@@ -1022,13 +1250,24 @@ void SimpleDomainShader::SetShaderAndCBs()
 // --------------------------------------------------------
 bool SimpleDomainShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
 {
-	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
+	return SetShaderResourceView(GetShaderResourceViewInfo(name), srv);
+}
+
+// --------------------------------------------------------
+// Sets a shader resource view in the domain shader stage
+//
+// srvInfo - The texture, from GetShaderResourceViewInfo()
+// srv - The shader resource view of the texture in GPU memory
+//
+// Returns false if srvInfo is null
+// --------------------------------------------------------
+bool SimpleDomainShader::SetShaderResourceView(const SimpleSRV* srvInfo, ID3D11ShaderResourceView* srv)
+{
 	if (srvInfo == 0)
 		return false;
 
 	// Set the shader resource view
-	deviceContext->DSSetShaderResources(srvInfo->BindIndex, 1, &srv);
+	target->SetShaderResource(RENDER_STAGE_DOMAIN, srvInfo->BindIndex, srv);
 
 	// Success
 	return true;
@@ -1044,13 +1283,24 @@ bool SimpleDomainShader::SetShaderResourceView(std::string name, ID3D11ShaderRes
 // --------------------------------------------------------
 bool SimpleDomainShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
 {
-	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
+	return SetSamplerState(GetSamplerInfo(name), samplerState);
+}
+
+// --------------------------------------------------------
+// Sets a sampler state in the domain shader stage
+//
+// sampInfo - The sampler, from GetSamplerInfo()
+// samplerState - The sampler state in GPU memory
+//
+// Returns false if sampInfo is null
+// --------------------------------------------------------
+bool SimpleDomainShader::SetSamplerState(const SimpleSampler* sampInfo, ID3D11SamplerState* samplerState)
+{
 	if (sampInfo == 0)
 		return false;
 
-	// Set the shader resource view
-	deviceContext->DSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	// Set the sampler state
+	target->SetSampler(RENDER_STAGE_DOMAIN, sampInfo->BindIndex, samplerState);
 
 	// Success
 	return true;
@@ -1065,8 +1315,8 @@ bool SimpleDomainShader::SetSamplerState(std::string name, ID3D11SamplerState* s
 // --------------------------------------------------------
 // Constructor just calls the base
 // --------------------------------------------------------
-SimpleHullShader::SimpleHullShader(ID3D11Device* device, ID3D11DeviceContext* context)
-	: ISimpleShader(device, context) 
+SimpleHullShader::SimpleHullShader(ID3D11Device* device, RenderBackend* backend)
+	: ISimpleShader(device, backend) 
 { 
 	this->shader = 0;
 }
@@ -1085,7 +1335,9 @@ SimpleHullShader::~SimpleHullShader()
 void SimpleHullShader::CleanUp()
 {
 	ISimpleShader::CleanUp();
+#ifdef _WIN32
 	if (shader) { shader->Release(); shader = 0; }
+#endif
 }
 
 // --------------------------------------------------------
@@ -1095,6 +1347,7 @@ void SimpleHullShader::CleanUp()
 //
 // Returns true if shader is created correctly, false otherwise
 // --------------------------------------------------------
+#ifdef _WIN32
 bool SimpleHullShader::CreateShader(ID3DBlob* shaderBlob)
 {
 	// Clean up first, in the event this method is
@@ -1111,6 +1364,7 @@ bool SimpleHullShader::CreateShader(ID3DBlob* shaderBlob)
 	// Check the result
 	return (result == S_OK);
 }
+#endif
 
 // --------------------------------------------------------
 // Sets the hull shader and constant buffers for
@@ -1122,15 +1376,12 @@ void SimpleHullShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 
 	// Set the shader
-	deviceContext->HSSetShader(shader, 0, 0);
+	target->SetShader(RENDER_STAGE_HULL, (ID3D11DeviceChild*)shader);
 
 	// Set the constant buffers?
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		deviceContext->HSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			&constantBuffers[i].ConstantBuffer);
+		target->SetConstantBuffer(RENDER_STAGE_HULL, constantBuffers[i].BindIndex, constantBuffers[i].ConstantBuffer);
 	}
 }
 
@@ -1144,13 +1395,24 @@ void SimpleHullShader::SetShaderAndCBs()
 // --------------------------------------------------------
 bool SimpleHullShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
 {
-	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
+	return SetShaderResourceView(GetShaderResourceViewInfo(name), srv);
+}
+
+// --------------------------------------------------------
+// Sets a shader resource view in the hull shader stage
+//
+// srvInfo - The texture, from GetShaderResourceViewInfo()
+// srv - The shader resource view of the texture in GPU memory
+//
+// Returns false if srvInfo is null
+// --------------------------------------------------------
+bool SimpleHullShader::SetShaderResourceView(const SimpleSRV* srvInfo, ID3D11ShaderResourceView* srv)
+{
 	if (srvInfo == 0)
 		return false;
 
 	// Set the shader resource view
-	deviceContext->HSSetShaderResources(srvInfo->BindIndex, 1, &srv);
+	target->SetShaderResource(RENDER_STAGE_HULL, srvInfo->BindIndex, srv);
 
 	// Success
 	return true;
@@ -1166,13 +1428,24 @@ bool SimpleHullShader::SetShaderResourceView(std::string name, ID3D11ShaderResou
 // --------------------------------------------------------
 bool SimpleHullShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
 {
-	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
+	return SetSamplerState(GetSamplerInfo(name), samplerState);
+}
+
+// --------------------------------------------------------
+// Sets a sampler state in the hull shader stage
+//
+// sampInfo - The sampler, from GetSamplerInfo()
+// samplerState - The sampler state in GPU memory
+//
+// Returns false if sampInfo is null
+// --------------------------------------------------------
+bool SimpleHullShader::SetSamplerState(const SimpleSampler* sampInfo, ID3D11SamplerState* samplerState)
+{
 	if (sampInfo == 0)
 		return false;
 
-	// Set the shader resource view
-	deviceContext->HSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	// Set the sampler state
+	target->SetSampler(RENDER_STAGE_HULL, sampInfo->BindIndex, samplerState);
 
 	// Success
 	return true;
@@ -1188,8 +1461,8 @@ bool SimpleHullShader::SetSamplerState(std::string name, ID3D11SamplerState* sam
 // --------------------------------------------------------
 // Constructor calls the base and sets up potential stream-out options
 // --------------------------------------------------------
-SimpleGeometryShader::SimpleGeometryShader(ID3D11Device* device, ID3D11DeviceContext* context, bool useStreamOut, bool allowStreamOutRasterization)
-	: ISimpleShader(device, context) 
+SimpleGeometryShader::SimpleGeometryShader(ID3D11Device* device, RenderBackend* backend, bool useStreamOut, bool allowStreamOutRasterization)
+	: ISimpleShader(device, backend) 
 { 
 	this->shader = 0;
 	this->useStreamOut = useStreamOut;
@@ -1210,7 +1483,9 @@ SimpleGeometryShader::~SimpleGeometryShader()
 void SimpleGeometryShader::CleanUp()
 {
 	ISimpleShader::CleanUp();
+#ifdef _WIN32
 	if (shader) { shader->Release(); shader = 0; }
+#endif
 }
 
 // --------------------------------------------------------
@@ -1220,6 +1495,7 @@ void SimpleGeometryShader::CleanUp()
 //
 // Returns true if shader is created correctly, false otherwise
 // --------------------------------------------------------
+#ifdef _WIN32
 bool SimpleGeometryShader::CreateShader(ID3DBlob* shaderBlob)
 {
 	// Clean up first, in the event this method is
@@ -1240,6 +1516,7 @@ bool SimpleGeometryShader::CreateShader(ID3DBlob* shaderBlob)
 	// Check the result
 	return (result == S_OK);
 }
+#endif
 
 // --------------------------------------------------------
 // Creates the DirectX Geometry shader and sets it up for
@@ -1249,38 +1526,27 @@ bool SimpleGeometryShader::CreateShader(ID3DBlob* shaderBlob)
 //
 // Returns true if shader is created correctly, false otherwise
 // --------------------------------------------------------
+#ifdef _WIN32
 bool SimpleGeometryShader::CreateShaderWithStreamOut(ID3DBlob* shaderBlob)
 {
 	// Clean up first, in the event this method is
 	// called more than once on the same object
 	this->CleanUp();
 
-	// Reflect shader info
-	ID3D11ShaderReflection* refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)&refl);
-
-	// Get shader info
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-
-	// Set up the output signature
+	// Set up the output signature (LoadShaderFile() has already
+	// reflected it)
 	streamOutVertexSize = 0;
 	std::vector<D3D11_SO_DECLARATION_ENTRY> soDecl;
-	for (unsigned int i = 0; i < shaderDesc.OutputParameters; i++)
+	for (size_t i = 0; i < reflection.Outputs.size(); i++)
 	{
 		// Get the info about this entry
-		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
-		refl->GetOutputParameterDesc(i, &paramDesc);
+		const ReflectedParameter& paramDesc = reflection.Outputs[i];
 		
 		// Create the SO Declaration
 		D3D11_SO_DECLARATION_ENTRY entry;
 		entry.SemanticIndex  = paramDesc.SemanticIndex;
-		entry.SemanticName   = paramDesc.SemanticName;
-		entry.Stream         = paramDesc.Stream;
+		entry.SemanticName   = paramDesc.SemanticName.c_str();
+		entry.Stream         = (BYTE)paramDesc.Stream;
 		entry.StartComponent = 0; // Assume starting at 0
 		entry.OutputSlot     = 0; // Assume the first output slot
 
@@ -1311,6 +1577,7 @@ bool SimpleGeometryShader::CreateShaderWithStreamOut(ID3DBlob* shaderBlob)
 	
 	return (result == S_OK);
 }
+#endif
 
 // --------------------------------------------------------
 // Creates a vertex buffer that is compatible with the stream output
@@ -1326,6 +1593,7 @@ bool SimpleGeometryShader::CreateShaderWithStreamOut(ID3DBlob* shaderBlob)
 // Returns true if buffer is created successfully AND stream output
 // was used to create the shader.  False otherwise.
 // --------------------------------------------------------
+#ifdef _WIN32
 bool SimpleGeometryShader::CreateCompatibleStreamOutBuffer(ID3D11Buffer** buffer, int vertexCount)
 {
 	// Was stream output actually used?
@@ -1345,16 +1613,19 @@ bool SimpleGeometryShader::CreateCompatibleStreamOutBuffer(ID3D11Buffer** buffer
 	HRESULT result = device->CreateBuffer(&desc, 0, buffer);
 	return (result == S_OK);
 }
+#endif
 
 // --------------------------------------------------------
 // Helper method to unbind all stream out buffers from the SO stage
 // --------------------------------------------------------
+#ifdef _WIN32
 void SimpleGeometryShader::UnbindStreamOutStage(ID3D11DeviceContext* deviceContext)
 {
 	unsigned int offset = 0;
 	ID3D11Buffer* unset[1] = { 0 };
 	deviceContext->SOSetTargets(1, unset, &offset);
 }
+#endif
 
 // --------------------------------------------------------
 // Sets the geometry shader and constant buffers for
@@ -1366,15 +1637,12 @@ void SimpleGeometryShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 
 	// Set the shader
-	deviceContext->GSSetShader(shader, 0, 0);
+	target->SetShader(RENDER_STAGE_GEOMETRY, (ID3D11DeviceChild*)shader);
 
 	// Set the constant buffers?
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		deviceContext->GSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			&constantBuffers[i].ConstantBuffer);
+		target->SetConstantBuffer(RENDER_STAGE_GEOMETRY, constantBuffers[i].BindIndex, constantBuffers[i].ConstantBuffer);
 	}
 }
 
@@ -1388,13 +1656,24 @@ void SimpleGeometryShader::SetShaderAndCBs()
 // --------------------------------------------------------
 bool SimpleGeometryShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
 {
-	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
+	return SetShaderResourceView(GetShaderResourceViewInfo(name), srv);
+}
+
+// --------------------------------------------------------
+// Sets a shader resource view in the Geometry shader stage
+//
+// srvInfo - The texture, from GetShaderResourceViewInfo()
+// srv - The shader resource view of the texture in GPU memory
+//
+// Returns false if srvInfo is null
+// --------------------------------------------------------
+bool SimpleGeometryShader::SetShaderResourceView(const SimpleSRV* srvInfo, ID3D11ShaderResourceView* srv)
+{
 	if (srvInfo == 0)
 		return false;
 
 	// Set the shader resource view
-	deviceContext->GSSetShaderResources(srvInfo->BindIndex, 1, &srv);
+	target->SetShaderResource(RENDER_STAGE_GEOMETRY, srvInfo->BindIndex, srv);
 
 	// Success
 	return true;
@@ -1410,13 +1689,24 @@ bool SimpleGeometryShader::SetShaderResourceView(std::string name, ID3D11ShaderR
 // --------------------------------------------------------
 bool SimpleGeometryShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
 {
-	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
+	return SetSamplerState(GetSamplerInfo(name), samplerState);
+}
+
+// --------------------------------------------------------
+// Sets a sampler state in the Geometry shader stage
+//
+// sampInfo - The sampler, from GetSamplerInfo()
+// samplerState - The sampler state in GPU memory
+//
+// Returns false if sampInfo is null
+// --------------------------------------------------------
+bool SimpleGeometryShader::SetSamplerState(const SimpleSampler* sampInfo, ID3D11SamplerState* samplerState)
+{
 	if (sampInfo == 0)
 		return false;
 
-	// Set the shader resource view
-	deviceContext->GSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	// Set the sampler state
+	target->SetSampler(RENDER_STAGE_GEOMETRY, sampInfo->BindIndex, samplerState);
 
 	// Success
 	return true;
@@ -1448,8 +1738,8 @@ unsigned int SimpleGeometryShader::CalcComponentCount(unsigned int mask)
 // --------------------------------------------------------
 // Constructor just calls the base
 // --------------------------------------------------------
-SimpleComputeShader::SimpleComputeShader(ID3D11Device* device, ID3D11DeviceContext* context)
-	: ISimpleShader(device, context) 
+SimpleComputeShader::SimpleComputeShader(ID3D11Device* device, RenderBackend* backend)
+	: ISimpleShader(device, backend) 
 { 
 	this->shader = 0;
 }
@@ -1468,7 +1758,9 @@ SimpleComputeShader::~SimpleComputeShader()
 void SimpleComputeShader::CleanUp()
 {
 	ISimpleShader::CleanUp();
+#ifdef _WIN32
 	if (shader) { shader->Release(); shader = 0; }
+#endif
 
 	uavTable.clear();
 }
@@ -1480,6 +1772,7 @@ void SimpleComputeShader::CleanUp()
 //
 // Returns true if shader is created correctly, false otherwise
 // --------------------------------------------------------
+#ifdef _WIN32
 bool SimpleComputeShader::CreateShader(ID3DBlob* shaderBlob)
 {
 	// Clean up first, in the event this method is
@@ -1497,34 +1790,20 @@ bool SimpleComputeShader::CreateShader(ID3DBlob* shaderBlob)
 	if (result != S_OK)
 		return false;
 
-	// Set up shader reflection to get information about UAV's
-	ID3D11ShaderReflection* refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)&refl);
-
-	// Get the description of the shader
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-	
-	// Grab the thread info
-	threadsTotal = refl->GetThreadGroupSize(
-		&threadsX,
-		&threadsY,
-		&threadsZ);
+	// Grab the thread info (LoadShaderFile() has already reflected it)
+	threadsX = reflection.ThreadGroupSize[0];
+	threadsY = reflection.ThreadGroupSize[1];
+	threadsZ = reflection.ThreadGroupSize[2];
+	threadsTotal = threadsX * threadsY * threadsZ;
 
 	// Loop and get all UAV resources
-	unsigned int resourceCount = shaderDesc.BoundResources;
-	for (unsigned int r = 0; r < resourceCount; r++)
+	for (size_t r = 0; r < reflection.Resources.size(); r++)
 	{
 		// Get this resource's description
-		D3D11_SHADER_INPUT_BIND_DESC resourceDesc;
-		refl->GetResourceBindingDesc(r, &resourceDesc);
+		const ReflectedResource& resourceDesc = reflection.Resources[r];
 
 		// Check the type, looking for any kind of UAV
-		switch (resourceDesc.Type)
+		switch ((D3D_SHADER_INPUT_TYPE)resourceDesc.Type)
 		{
 		case D3D_SIT_UAV_APPEND_STRUCTURED:
 		case D3D_SIT_UAV_CONSUME_STRUCTURED:
@@ -1537,9 +1816,9 @@ bool SimpleComputeShader::CreateShader(ID3DBlob* shaderBlob)
 	}
 
 	// All set
-	refl->Release();
 	return true;
 }
+#endif
 
 // --------------------------------------------------------
 // Sets the Compute shader and constant buffers for
@@ -1551,15 +1830,12 @@ void SimpleComputeShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 
 	// Set the shader
-	deviceContext->CSSetShader(shader, 0, 0);
+	target->SetShader(RENDER_STAGE_COMPUTE, (ID3D11DeviceChild*)shader);
 
 	// Set the constant buffers?
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		deviceContext->CSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			&constantBuffers[i].ConstantBuffer);
+		target->SetConstantBuffer(RENDER_STAGE_COMPUTE, constantBuffers[i].BindIndex, constantBuffers[i].ConstantBuffer);
 	}
 }
 
@@ -1572,7 +1848,7 @@ void SimpleComputeShader::SetShaderAndCBs()
 // a shader with (8,2,2) threads per group will launch a 
 // total of 160 threads: ((5 * 8) * (1 * 2) * (1 * 2))
 //
-// This is identical to using the device context's 
+// This is identical to using the render backend's 
 // Dispatch() method yourself.  
 //
 // Note: This will dispatch the currently active shader, 
@@ -1585,7 +1861,7 @@ void SimpleComputeShader::SetShaderAndCBs()
 // --------------------------------------------------------
 void SimpleComputeShader::DispatchByGroups(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ)
 {
-	deviceContext->Dispatch(groupsX, groupsY, groupsZ);
+	target->Dispatch(groupsX, groupsY, groupsZ);
 }
 
 // --------------------------------------------------------
@@ -1610,10 +1886,13 @@ void SimpleComputeShader::DispatchByGroups(unsigned int groupsX, unsigned int gr
 // --------------------------------------------------------
 void SimpleComputeShader::DispatchByThreads(unsigned int threadsX, unsigned int threadsY, unsigned int threadsZ)
 {
-	deviceContext->Dispatch(
-		max((unsigned int)ceil((float)threadsX / this->threadsX), 1),
-		max((unsigned int)ceil((float)threadsY / this->threadsY), 1),
-		max((unsigned int)ceil((float)threadsZ / this->threadsZ), 1));
+	unsigned int groupsX = (unsigned int)ceil((float)threadsX / this->threadsX);
+	unsigned int groupsY = (unsigned int)ceil((float)threadsY / this->threadsY);
+	unsigned int groupsZ = (unsigned int)ceil((float)threadsZ / this->threadsZ);
+	target->Dispatch(
+		groupsX > 1 ? groupsX : 1,
+		groupsY > 1 ? groupsY : 1,
+		groupsZ > 1 ? groupsZ : 1);
 }
 
 // --------------------------------------------------------
@@ -1626,13 +1905,24 @@ void SimpleComputeShader::DispatchByThreads(unsigned int threadsX, unsigned int
 // --------------------------------------------------------
 bool SimpleComputeShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
 {
-	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
+	return SetShaderResourceView(GetShaderResourceViewInfo(name), srv);
+}
+
+// --------------------------------------------------------
+// Sets a shader resource view in the Compute shader stage
+//
+// srvInfo - The texture, from GetShaderResourceViewInfo()
+// srv - The shader resource view of the texture in GPU memory
+//
+// Returns false if srvInfo is null
+// --------------------------------------------------------
+bool SimpleComputeShader::SetShaderResourceView(const SimpleSRV* srvInfo, ID3D11ShaderResourceView* srv)
+{
 	if (srvInfo == 0)
 		return false;
 
 	// Set the shader resource view
-	deviceContext->CSSetShaderResources(srvInfo->BindIndex, 1, &srv);
+	target->SetShaderResource(RENDER_STAGE_COMPUTE, srvInfo->BindIndex, srv);
 
 	// Success
 	return true;
@@ -1648,13 +1938,24 @@ bool SimpleComputeShader::SetShaderResourceView(std::string name, ID3D11ShaderRe
 // --------------------------------------------------------
 bool SimpleComputeShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
 {
-	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
+	return SetSamplerState(GetSamplerInfo(name), samplerState);
+}
+
+// --------------------------------------------------------
+// Sets a sampler state in the Compute shader stage
+//
+// sampInfo - The sampler, from GetSamplerInfo()
+// samplerState - The sampler state in GPU memory
+//
+// Returns false if sampInfo is null
+// --------------------------------------------------------
+bool SimpleComputeShader::SetSamplerState(const SimpleSampler* sampInfo, ID3D11SamplerState* samplerState)
+{
 	if (sampInfo == 0)
 		return false;
 
-	// Set the shader resource view
-	deviceContext->CSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	// Set the sampler state
+	target->SetSampler(RENDER_STAGE_COMPUTE, sampInfo->BindIndex, samplerState);
 
 	// Success
 	return true;
@@ -1677,7 +1978,7 @@ bool SimpleComputeShader::SetUnorderedAccessView(std::string name, ID3D11Unorder
 		return false;
 
 	// Set the shader resource view
-	deviceContext->CSSetUnorderedAccessViews(bindIndex, 1, &uav, &appendConsumeOffset);
+	target->SetUnorderedAccess(bindIndex, uav, appendConsumeOffset);
 
 	// Success
 	return true;
@@ -1698,4 +1999,25 @@ int SimpleComputeShader::GetUnorderedAccessViewIndex(std::string name)
 
 	// Success
 	return result->second;
-}
\ No newline at end of file
+}
+
+
+#ifndef _WIN32
+
+///////////////////////////////////////////////////////////////////////////////
+// ------ WITHOUT D3D ---------------------------------------------------------
+///////////////////////////////////////////////////////////////////////////////
+
+// No device to make shaders with (see SimpleShader.h)
+bool ISimpleShader::LoadShaderFile(const wchar_t* /*shaderFile*/) { return false; }
+bool SimpleVertexShader::CreateShader(ID3DBlob* /*shaderBlob*/) { return false; }
+bool SimplePixelShader::CreateShader(ID3DBlob* /*shaderBlob*/) { return false; }
+bool SimpleDomainShader::CreateShader(ID3DBlob* /*shaderBlob*/) { return false; }
+bool SimpleHullShader::CreateShader(ID3DBlob* /*shaderBlob*/) { return false; }
+bool SimpleGeometryShader::CreateShader(ID3DBlob* /*shaderBlob*/) { return false; }
+bool SimpleGeometryShader::CreateShaderWithStreamOut(ID3DBlob* /*shaderBlob*/) { return false; }
+bool SimpleGeometryShader::CreateCompatibleStreamOutBuffer(ID3D11Buffer** /*buffer*/, int /*vertexCount*/) { return false; }
+void SimpleGeometryShader::UnbindStreamOutStage(ID3D11DeviceContext* /*deviceContext*/) {}
+bool SimpleComputeShader::CreateShader(ID3DBlob* /*shaderBlob*/) { return false; }
+
+#endif
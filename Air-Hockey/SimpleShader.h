@@ -1,18 +1,64 @@
 #pragma once
+#ifdef _WIN32
 #pragma comment(lib, "dxguid.lib")
 #pragma comment(lib, "d3dcompiler.lib")
 
 #include <d3d11.h>
 #include <d3dcompiler.h>
+#endif
 #include <DirectXMath.h>
 
+#include "RenderBackend.h"
+#include "ShaderReflection.h"
+
 #include <unordered_map>
 #include <vector>
 #include <string>
+#include <utility>
+#include <cstdint>
+
+#ifndef _WIN32
+// Without the D3D headers there's no device, so shaders are never
+// loaded or created and every D3D pointer below stays 0.  Unloaded
+// shaders still bind (nothing) through a backend, which is all the
+// server's render benchmarks need of them
+struct ID3D10Blob;
+typedef ID3D10Blob ID3DBlob;
+struct ID3D11Device;
+struct ID3D11DeviceContext;
+struct ID3D11VertexShader;
+struct ID3D11PixelShader;
+struct ID3D11DomainShader;
+struct ID3D11HullShader;
+struct ID3D11GeometryShader;
+struct ID3D11ComputeShader;
+#endif
+
+// --------------------------------------------------------
+// A variable, texture or sampler name, hashed (FNV-1a) so
+// lookups by it never build a string.  Declared constexpr,
+// the hash is worked out at compile time:
+//
+//   static constexpr SimpleShaderName WORLD("world");
+//   vs->SetMatrix4x4(WORLD, world);
+// --------------------------------------------------------
+struct SimpleShaderName
+{
+	uint32_t Hash;
+
+	constexpr explicit SimpleShaderName(const char* name) : Hash(HashString(name, 2166136261u)) {}
+
+	static constexpr uint32_t HashString(const char* name, uint32_t hash)
+	{
+		return *name ? HashString(name + 1, (hash ^ (uint32_t)(unsigned char)*name) * 16777619u) : hash;
+	}
+};
 
 // --------------------------------------------------------
 // Used by simple shaders to store information about
-// specific variables in constant buffers
+// specific variables in constant buffers.  A pointer to one
+// (from GetVariableInfo()) is also a handle the setters take
+// directly, skipping the lookup altogether
 // --------------------------------------------------------
 struct SimpleShaderVariable
 {
@@ -34,6 +80,27 @@ struct SimpleConstantBuffer
 	ID3D11Buffer* ConstantBuffer;
 	unsigned char* LocalDataBuffer;
 	std::vector<SimpleShaderVariable> Variables;
+
+	// Bytes changed since the last upload (none when DirtyStart >= DirtyEnd)
+	unsigned int DirtyStart;
+	unsigned int DirtyEnd;
+
+	// Uploads in a row that had changes; enough of them and the
+	// buffer is made dynamic, written with Map(WRITE_DISCARD)
+	unsigned int ChangedUploads;
+	bool Dynamic;
+	bool MakeDynamic;		// Done the next time the shader is set
+};
+
+// --------------------------------------------------------
+// Constant buffer traffic from every shader, per frame
+// --------------------------------------------------------
+struct SimpleShaderUploadStats
+{
+	uint32_t Uploads;			// Buffers sent to the GPU
+	uint32_t Skipped;			// Copies asked for with nothing changed
+	uint64_t BytesUploaded;		// Whole buffers, as D3D11 needs them sent
+	uint64_t BytesChanged;		// The dirty ranges within those
 };
 
 // --------------------------------------------------------
@@ -60,22 +127,48 @@ struct SimpleSampler
 class ISimpleShader
 {
 public:
-	ISimpleShader(ID3D11Device* device, ID3D11DeviceContext* context);
+	ISimpleShader(ID3D11Device* device, RenderBackend* backend);
 	virtual ~ISimpleShader();
 
 	// Initialization method (since we can't invoke derived class
 	// overrides in the base class constructor)
-	bool LoadShaderFile(LPCWSTR shaderFile);
+	bool LoadShaderFile(const wchar_t* shaderFile);
 
 	// Simple helpers
 	bool IsShaderValid() { return shaderValid; }
 
-	// Activating the shader and copying data
+	// Activating the shader and copying data.  Copies only send
+	// buffers that changed since they were last sent
 	void SetShader();
 	void CopyAllBufferData();
 	void CopyBufferData(unsigned int index);
 	void CopyBufferData(std::string bufferName);
 
+	// Uploads from every shader since the last call
+	static void BeginFrame();
+	static const SimpleShaderUploadStats& GetFrameStats() { return frameUploads; }
+	static const SimpleShaderUploadStats& GetLastFrameStats() { return lastFrameUploads; }
+
+	// Counts the calling thread's uploads into stats instead (0 to
+	// stop), for passes recorded on other threads; add them to the
+	// frame's with AddFrameStats() once those threads are done
+	static void SetThreadStats(SimpleShaderUploadStats* stats);
+	static void AddFrameStats(const SimpleShaderUploadStats& stats);
+
+	// Where binds, uploads and draws go from now on (0 = the backend
+	// the shader was made with).  A pass recorded on its own backend
+	// points the shaders it draws at it; a shader must not be drawn
+	// by two passes being recorded at the same time
+	void SetTarget(RenderBackend* target) { this->target = target ? target : backend; }
+
+	// Changed uploads in a row before a buffer is made dynamic
+	static const unsigned int DYNAMIC_AFTER = 8;
+
+	// Constant buffers (by cbuffer name) filled and bound by the
+	// caller for every shader at once; call before loading shaders
+	static void ShareConstantBuffer(std::string name);
+	static bool IsSharedConstantBuffer(const std::string& name);
+
 	// Sets arbitrary shader data
 	bool SetData(std::string name, const void* data, unsigned int size);
 
@@ -90,18 +183,39 @@ public:
 	bool SetMatrix4x4(std::string name, const float data[16]);
 	bool SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data);
 
+	// Same, by handle (no lookup) or by hashed name (no string).
+	// A null handle is ignored and returns false
+	bool SetData(const SimpleShaderVariable* var, const void* data, unsigned int size);
+	bool SetInt(const SimpleShaderVariable* var, int data);
+	bool SetFloat(const SimpleShaderVariable* var, float data);
+	bool SetFloat3(const SimpleShaderVariable* var, const DirectX::XMFLOAT3& data);
+	bool SetFloat4(const SimpleShaderVariable* var, const DirectX::XMFLOAT4& data);
+	bool SetMatrix4x4(const SimpleShaderVariable* var, const DirectX::XMFLOAT4X4& data);
+
+	bool SetData(SimpleShaderName name, const void* data, unsigned int size) { return SetData(GetVariableInfo(name), data, size); }
+	bool SetFloat3(SimpleShaderName name, const DirectX::XMFLOAT3& data) { return SetFloat3(GetVariableInfo(name), data); }
+	bool SetFloat4(SimpleShaderName name, const DirectX::XMFLOAT4& data) { return SetFloat4(GetVariableInfo(name), data); }
+	bool SetMatrix4x4(SimpleShaderName name, const DirectX::XMFLOAT4X4& data) { return SetMatrix4x4(GetVariableInfo(name), data); }
+
 	// Setting shader resources
 	virtual bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv) = 0;
 	virtual bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState) = 0;
+	virtual bool SetShaderResourceView(const SimpleSRV* srvInfo, ID3D11ShaderResourceView* srv) = 0;
+	virtual bool SetSamplerState(const SimpleSampler* sampInfo, ID3D11SamplerState* samplerState) = 0;
+	bool SetShaderResourceView(SimpleShaderName name, ID3D11ShaderResourceView* srv) { return SetShaderResourceView(GetShaderResourceViewInfo(name), srv); }
+	bool SetSamplerState(SimpleShaderName name, ID3D11SamplerState* samplerState) { return SetSamplerState(GetSamplerInfo(name), samplerState); }
 
 	// Getting data about variables and resources
 	const SimpleShaderVariable* GetVariableInfo(std::string name);
+	const SimpleShaderVariable* GetVariableInfo(SimpleShaderName name);
 	
 	const SimpleSRV* GetShaderResourceViewInfo(std::string name);
+	const SimpleSRV* GetShaderResourceViewInfo(SimpleShaderName name);
 	const SimpleSRV* GetShaderResourceViewInfo(unsigned int index);
 	size_t GetShaderResourceViewCount() { return textureTable.size(); }
 	
 	const SimpleSampler* GetSamplerInfo(std::string name);
+	const SimpleSampler* GetSamplerInfo(SimpleShaderName name);
 	const SimpleSampler* GetSamplerInfo(unsigned int index);
 	size_t GetSamplerCount() { return samplerTable.size(); }
 
@@ -113,13 +227,19 @@ public:
 	
 	// Misc getters
 	ID3DBlob* GetShaderBlob() { return shaderBlob; }
+	const ShaderReflection& GetReflection() { return reflection; }
 
 protected:
 	
 	bool shaderValid;
 	ID3DBlob* shaderBlob;
 	ID3D11Device* device;
-	ID3D11DeviceContext* deviceContext;
+	RenderBackend* backend;
+	RenderBackend* target;
+
+	// Everything LoadShaderFile() learned about the shader; kept for
+	// the stages' CreateShader(), which run after it's filled in
+	ShaderReflection reflection;
 
 	// Resource counts
 	unsigned int constantBufferCount;
@@ -133,6 +253,12 @@ protected:
 	std::unordered_map<std::string, SimpleSRV*> textureTable;
 	std::unordered_map<std::string, SimpleSampler*> samplerTable;
 
+	// The same, keyed by SimpleShaderName hash.  A shader has a
+	// handful of each, so a scan beats any map
+	std::vector<std::pair<uint32_t, const SimpleShaderVariable*>> varHashes;
+	std::vector<std::pair<uint32_t, const SimpleSRV*>> textureHashes;
+	std::vector<std::pair<uint32_t, const SimpleSampler*>> samplerHashes;
+
 	// Pure virtual functions for dealing with shader types
 	virtual bool CreateShader(ID3DBlob* shaderBlob) = 0;
 	virtual void SetShaderAndCBs() = 0;
@@ -142,6 +268,15 @@ protected:
 	// Helpers for finding data by name
 	SimpleShaderVariable* FindVariable(std::string name, int size);
 	SimpleConstantBuffer* FindConstantBuffer(std::string name);
+
+	// Copies into the local buffer, marking what actually changed
+	void WriteVariable(const SimpleShaderVariable* var, const void* data, unsigned int size);
+	void UploadBuffer(SimpleConstantBuffer* cb);
+
+	static SimpleShaderUploadStats frameUploads;
+	static SimpleShaderUploadStats lastFrameUploads;
+	static thread_local SimpleShaderUploadStats* threadUploads;
+	static std::vector<std::string> sharedBuffers;
 };
 
 // --------------------------------------------------------
@@ -150,15 +285,19 @@ protected:
 class SimpleVertexShader : public ISimpleShader
 {
 public:
-	SimpleVertexShader(ID3D11Device* device, ID3D11DeviceContext* context);
-	SimpleVertexShader(ID3D11Device* device, ID3D11DeviceContext* context, ID3D11InputLayout* inputLayout, bool perInstanceCompatible);
+	SimpleVertexShader(ID3D11Device* device, RenderBackend* backend);
+	SimpleVertexShader(ID3D11Device* device, RenderBackend* backend, ID3D11InputLayout* inputLayout, bool perInstanceCompatible);
 	~SimpleVertexShader();
 	ID3D11VertexShader* GetDirectXShader() { return shader; }
 	ID3D11InputLayout* GetInputLayout() { return inputLayout; }
 	bool GetPerInstanceCompatible() { return perInstanceCompatible; }
 
+	using ISimpleShader::SetShaderResourceView;
+	using ISimpleShader::SetSamplerState;
 	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
 	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+	bool SetShaderResourceView(const SimpleSRV* srvInfo, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(const SimpleSampler* sampInfo, ID3D11SamplerState* samplerState);
 
 protected:
 	bool perInstanceCompatible;
@@ -176,12 +315,16 @@ protected:
 class SimplePixelShader : public ISimpleShader
 {
 public:
-	SimplePixelShader(ID3D11Device* device, ID3D11DeviceContext* context);
+	SimplePixelShader(ID3D11Device* device, RenderBackend* backend);
 	~SimplePixelShader();
 	ID3D11PixelShader* GetDirectXShader() { return shader; }
 
+	using ISimpleShader::SetShaderResourceView;
+	using ISimpleShader::SetSamplerState;
 	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
 	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+	bool SetShaderResourceView(const SimpleSRV* srvInfo, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(const SimpleSampler* sampInfo, ID3D11SamplerState* samplerState);
 
 protected:
 	ID3D11PixelShader* shader;
@@ -196,12 +339,16 @@ protected:
 class SimpleDomainShader : public ISimpleShader
 {
 public:
-	SimpleDomainShader(ID3D11Device* device, ID3D11DeviceContext* context);
+	SimpleDomainShader(ID3D11Device* device, RenderBackend* backend);
 	~SimpleDomainShader();
 	ID3D11DomainShader* GetDirectXShader() { return shader; }
 
+	using ISimpleShader::SetShaderResourceView;
+	using ISimpleShader::SetSamplerState;
 	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
 	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+	bool SetShaderResourceView(const SimpleSRV* srvInfo, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(const SimpleSampler* sampInfo, ID3D11SamplerState* samplerState);
 
 protected:
 	ID3D11DomainShader* shader;
@@ -216,12 +363,16 @@ protected:
 class SimpleHullShader : public ISimpleShader
 {
 public:
-	SimpleHullShader(ID3D11Device* device, ID3D11DeviceContext* context);
+	SimpleHullShader(ID3D11Device* device, RenderBackend* backend);
 	~SimpleHullShader();
 	ID3D11HullShader* GetDirectXShader() { return shader; }
 
+	using ISimpleShader::SetShaderResourceView;
+	using ISimpleShader::SetSamplerState;
 	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
 	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+	bool SetShaderResourceView(const SimpleSRV* srvInfo, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(const SimpleSampler* sampInfo, ID3D11SamplerState* samplerState);
 
 protected:
 	ID3D11HullShader* shader;
@@ -236,12 +387,16 @@ protected:
 class SimpleGeometryShader : public ISimpleShader
 {
 public:
-	SimpleGeometryShader(ID3D11Device* device, ID3D11DeviceContext* context, bool useStreamOut = 0, bool allowStreamOutRasterization = 0);
+	SimpleGeometryShader(ID3D11Device* device, RenderBackend* backend, bool useStreamOut = 0, bool allowStreamOutRasterization = 0);
 	~SimpleGeometryShader();
 	ID3D11GeometryShader* GetDirectXShader() { return shader; }
 
+	using ISimpleShader::SetShaderResourceView;
+	using ISimpleShader::SetSamplerState;
 	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
 	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+	bool SetShaderResourceView(const SimpleSRV* srvInfo, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(const SimpleSampler* sampInfo, ID3D11SamplerState* samplerState);
 
 	bool CreateCompatibleStreamOutBuffer(ID3D11Buffer** buffer, int vertexCount);
 
@@ -272,15 +427,19 @@ protected:
 class SimpleComputeShader : public ISimpleShader
 {
 public:
-	SimpleComputeShader(ID3D11Device* device, ID3D11DeviceContext* context);
+	SimpleComputeShader(ID3D11Device* device, RenderBackend* backend);
 	~SimpleComputeShader();
 	ID3D11ComputeShader* GetDirectXShader() { return shader; }
 
 	void DispatchByGroups(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ);
 	void DispatchByThreads(unsigned int threadsX, unsigned int threadsY, unsigned int threadsZ);
 
+	using ISimpleShader::SetShaderResourceView;
+	using ISimpleShader::SetSamplerState;
 	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
 	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+	bool SetShaderResourceView(const SimpleSRV* srvInfo, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(const SimpleSampler* sampInfo, ID3D11SamplerState* samplerState);
 	bool SetUnorderedAccessView(std::string name, ID3D11UnorderedAccessView* uav, unsigned int appendConsumeOffset = -1);
 
 	int GetUnorderedAccessViewIndex(std::string name);
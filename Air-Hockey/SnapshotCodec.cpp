@@ -0,0 +1,210 @@
+#include "SnapshotCodec.h"
+#include <cmath>
+#include <cstddef>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Positions are stored in 1/512ths of a unit: the rink is about 8 x 4,
+// so the puck fits in 13 bits and paddles in 12
+static const float POS_SCALE = 512.0f;
+
+// Puck direction is a unit vector, stored per component in 1/1024ths
+static const float DIR_SCALE = 1024.0f;
+
+// How far the puck moves per tick per unit of quantized direction, in
+// position steps as 16.16 fixed point.  Must match Puck's speed of 3.
+// Integer maths keeps the prediction identical on both ends
+static const int64_t PUCK_STEP_Q16 = (int64_t)(3.0 / NET_TICK_RATE * 512.0 / 1024.0 * 65536.0 + 0.5);
+
+// Largest magnitude any field or prediction may have.  Predictions are
+// clamped to it as well (dead reckoning from an old baseline can run far
+// off the rink), so a residual is at most twice it and fits in 16 bits
+static const int32_t FIELD_LIMIT = 16383;
+
+static const int FIELD_COUNT = 10;
+static_assert(sizeof(QuantizedState) == sizeof(uint32_t) + FIELD_COUNT * sizeof(int32_t), "QuantizedState fields must be packed int32s after Tick");
+
+// Residuals use a prefix code, written low bit first:
+//   0    -> zero
+//   10   -> 4 bit zigzag value
+//   110  -> 8 bit zigzag value
+//   111  -> 16 bit zigzag value
+static const uint8_t classForLength[17] = { 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3 };
+static const uint8_t prefixCode[4] = { 0, 1, 3, 7 };
+static const uint8_t prefixBits[4] = { 1, 2, 3, 3 };
+static const uint8_t payloadBits[4] = { 0, 4, 8, 16 };
+static_assert((uint32_t)(2 * FIELD_LIMIT) << 1 < (1u << 16), "The largest residual's zigzag value must fit the 16 bit class");
+
+// Class from the low three bits of a residual, for the reader
+static const uint8_t classForPrefix[8] = { 0, 1, 0, 2, 0, 1, 0, 3 };
+
+static inline int BitLength(uint32_t a_value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	return _BitScanReverse(&index, a_value) ? (int)index + 1 : 0;
+#else
+	return a_value ? 32 - __builtin_clz(a_value) : 0;
+#endif
+}
+
+static inline void WriteResidual(BitWriter& a_writer, int32_t a_residual)
+{
+	uint32_t zigzag = ((uint32_t)a_residual << 1) ^ (uint32_t)(a_residual >> 31);
+	int cls = classForLength[BitLength(zigzag)];
+
+	a_writer.Write(prefixCode[cls] | (zigzag << prefixBits[cls]), prefixBits[cls] + payloadBits[cls]);
+}
+
+static inline int32_t ReadResidual(BitReader& a_reader)
+{
+	int cls = classForPrefix[a_reader.Peek(3)];
+	uint32_t zigzag = a_reader.Read(prefixBits[cls] + payloadBits[cls]) >> prefixBits[cls];
+
+	return (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+}
+
+static inline int32_t ClampField(int64_t a_value)
+{
+	return (int32_t)(a_value < -FIELD_LIMIT ? -FIELD_LIMIT : (a_value > FIELD_LIMIT ? FIELD_LIMIT : a_value));
+}
+
+static inline int32_t QuantizeValue(float a_value, float a_scale)
+{
+	return ClampField((int64_t)floorf(a_value * a_scale + 0.5f));
+}
+
+// Fills in what the baseline says this tick should look like
+static void Predict(const QuantizedState* a_baseline, uint32_t a_tick, int32_t* a_prediction)
+{
+	if (!a_baseline)
+	{
+		for (int i = 0; i < FIELD_COUNT; i++)
+			a_prediction[i] = 0;
+		return;
+	}
+
+	memcpy(a_prediction, &a_baseline->PuckX, FIELD_COUNT * sizeof(int32_t));
+
+	//The puck keeps going the way it was, until it hits something (or
+	//the edge of what a field can hold; Encode and Decode clamp alike)
+	int64_t ticks = (int64_t)(a_tick - a_baseline->Tick);
+	a_prediction[0] = ClampField(a_baseline->PuckX + ((a_baseline->PuckDirX * ticks * PUCK_STEP_Q16 + 0x8000) >> 16));
+	a_prediction[1] = ClampField(a_baseline->PuckZ + ((a_baseline->PuckDirZ * ticks * PUCK_STEP_Q16 + 0x8000) >> 16));
+}
+
+void SnapshotHistory::Clear()
+{
+	memset(states, 0, sizeof(states));
+}
+
+void SnapshotCodec::Quantize(const MatchState& a_state, QuantizedState& a_out)
+{
+	a_out.Tick = a_state.Tick;
+	a_out.PuckX = QuantizeValue(a_state.PuckX, POS_SCALE);
+	a_out.PuckZ = QuantizeValue(a_state.PuckZ, POS_SCALE);
+	a_out.PuckDirX = QuantizeValue(a_state.PuckDirX, DIR_SCALE);
+	a_out.PuckDirZ = QuantizeValue(a_state.PuckDirZ, DIR_SCALE);
+
+	for (int i = 0; i < NET_PLAYERS_PER_MATCH; i++)
+	{
+		a_out.PaddleX[i] = QuantizeValue(a_state.PaddleX[i], POS_SCALE);
+		a_out.PaddleZ[i] = QuantizeValue(a_state.PaddleZ[i], POS_SCALE);
+		a_out.Score[i] = a_state.Score[i];
+	}
+}
+
+void SnapshotCodec::Dequantize(const QuantizedState& a_state, MatchState& a_out)
+{
+	a_out.Tick = a_state.Tick;
+	a_out.PuckX = a_state.PuckX / POS_SCALE;
+	a_out.PuckZ = a_state.PuckZ / POS_SCALE;
+	a_out.PuckDirX = a_state.PuckDirX / DIR_SCALE;
+	a_out.PuckDirZ = a_state.PuckDirZ / DIR_SCALE;
+
+	for (int i = 0; i < NET_PLAYERS_PER_MATCH; i++)
+	{
+		a_out.PaddleX[i] = a_state.PaddleX[i] / POS_SCALE;
+		a_out.PaddleZ[i] = a_state.PaddleZ[i] / POS_SCALE;
+		a_out.Score[i] = (uint8_t)a_state.Score[i];
+	}
+}
+
+void SnapshotCodec::Encode(const QuantizedState* a_baseline, const QuantizedState& a_state, BitWriter& a_writer)
+{
+	int32_t prediction[FIELD_COUNT];
+	Predict(a_baseline, a_state.Tick, prediction);
+
+	const int32_t* fields = &a_state.PuckX;
+	for (int i = 0; i < FIELD_COUNT; i++)
+		WriteResidual(a_writer, fields[i] - prediction[i]);
+}
+
+bool SnapshotCodec::Decode(const QuantizedState* a_baseline, uint32_t a_tick, BitReader& a_reader, QuantizedState& a_out)
+{
+	int32_t prediction[FIELD_COUNT];
+	Predict(a_baseline, a_tick, prediction);
+
+	a_out.Tick = a_tick;
+	int32_t* fields = &a_out.PuckX;
+	for (int i = 0; i < FIELD_COUNT; i++)
+		fields[i] = prediction[i] + ReadResidual(a_reader);
+
+	return !a_reader.Overflowed();
+}
+
+int SnapshotCodec::WriteSnapshot(const SnapshotHistory& a_history, uint32_t a_ackTick, const QuantizedState& a_state, unsigned char* a_out, int a_capacity)
+{
+	//The baseline must be recent enough that the client still has it
+	const QuantizedState* baseline = 0;
+	uint32_t age = a_state.Tick - a_ackTick;
+	if (age > 0 && age < (uint32_t)SnapshotHistory::SIZE)
+		baseline = a_history.Find(a_ackTick);
+
+	BitWriter writer(a_out, a_capacity);
+	if (baseline)
+	{
+		writer.Write(1, 1);
+		writer.Write(a_state.Tick & 0xFFFF, 16);
+		writer.Write(age, 6);
+	}
+	else
+	{
+		writer.Write(0, 1);
+		writer.Write(a_state.Tick, 32);
+	}
+
+	Encode(baseline, a_state, writer);
+	return writer.Finish();
+}
+
+bool SnapshotCodec::ReadSnapshot(const SnapshotHistory& a_history, uint32_t a_newestTick, const unsigned char* a_data, int a_size, QuantizedState& a_out)
+{
+	BitReader reader(a_data, a_size);
+
+	uint32_t tick;
+	const QuantizedState* baseline = 0;
+
+	if (reader.Read(1))
+	{
+		if (a_newestTick == 0)
+			return false;
+
+		//The tick closest to the newest one we have with these low bits
+		uint16_t low = (uint16_t)reader.Read(16);
+		tick = a_newestTick + (int16_t)(low - (uint16_t)a_newestTick);
+
+		uint32_t age = reader.Read(6);
+		baseline = a_history.Find(tick - age);
+		if (age == 0 || !baseline)
+			return false;
+	}
+	else
+	{
+		tick = reader.Read(32);
+	}
+
+	return Decode(baseline, tick, reader, a_out);
+}
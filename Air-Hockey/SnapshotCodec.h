@@ -0,0 +1,75 @@
+#pragma once
+#include "NetProtocol.h"
+#include "BitStream.h"
+
+// --------------------------------------------------------
+// MatchState as the wire sees it: fixed-point integers on
+// a grid that covers the rink (see SnapshotCodec.cpp)
+// --------------------------------------------------------
+struct QuantizedState
+{
+	uint32_t Tick;
+	int32_t PuckX;
+	int32_t PuckZ;
+	int32_t PuckDirX;
+	int32_t PuckDirZ;
+	int32_t PaddleX[NET_PLAYERS_PER_MATCH];
+	int32_t PaddleZ[NET_PLAYERS_PER_MATCH];
+	int32_t Score[NET_PLAYERS_PER_MATCH];
+};
+
+// --------------------------------------------------------
+// The last SNAPSHOT_HISTORY states, by tick.  The server
+// keeps one per match to encode against whatever a client
+// has acked, and clients keep one to decode against.
+// --------------------------------------------------------
+class SnapshotHistory
+{
+public:
+	static const int SIZE = 64;
+
+	SnapshotHistory() { Clear(); }
+
+	void Clear();
+	void Store(const QuantizedState& a_state) { states[a_state.Tick % SIZE] = a_state; }
+
+	// Returns the state for a tick, or null if it's gone or never arrived
+	const QuantizedState* Find(uint32_t a_tick) const
+	{
+		const QuantizedState& state = states[a_tick % SIZE];
+		return (a_tick != 0 && state.Tick == a_tick) ? &state : 0;
+	}
+
+private:
+	QuantizedState states[SIZE];
+};
+
+// --------------------------------------------------------
+// Bit-packed snapshot encoding.  Every field is written as
+// a residual against a prediction from the baseline (plain
+// "unchanged" for most fields, dead reckoning for the puck)
+// with a short prefix code, so a quiet tick is a few bytes.
+// With no baseline the residual is against zero.
+// --------------------------------------------------------
+class SnapshotCodec
+{
+public:
+	// Most bytes a state can take, baseline or not
+	static const int MAX_SIZE = 32;
+
+	static void Quantize(const MatchState& a_state, QuantizedState& a_out);
+	static void Dequantize(const QuantizedState& a_state, MatchState& a_out);
+
+	// Field data only; the tick and baseline travel in the packet
+	static void Encode(const QuantizedState* a_baseline, const QuantizedState& a_state, BitWriter& a_writer);
+	static bool Decode(const QuantizedState* a_baseline, uint32_t a_tick, BitReader& a_reader, QuantizedState& a_out);
+
+	// Snapshot framing: a tick plus how far back the baseline is,
+	// then the fields.  Returns the bytes written, or -1
+	static int WriteSnapshot(const SnapshotHistory& a_history, uint32_t a_ackTick, const QuantizedState& a_state, unsigned char* a_out, int a_capacity);
+
+	// a_newestTick is the newest tick already decoded (0 for none) and is
+	// used to widen the 16 bit tick.  Returns false if the data is bad or
+	// the baseline isn't in the history
+	static bool ReadSnapshot(const SnapshotHistory& a_history, uint32_t a_newestTick, const unsigned char* a_data, int a_size, QuantizedState& a_out);
+};
@@ -0,0 +1,122 @@
+#include "SpectatorClient.h"
+#include <cstring>
+
+SpectatorClient::SpectatorClient()
+{
+	matchID = 0;
+	connected = false;
+	lastSpectateMs = 0;
+	newestKeyframe = 0;
+	hasState = false;
+	bytesReceived = 0;
+	statesReceived = 0;
+	memset(keyframes, 0, sizeof(keyframes));
+	memset(&state, 0, sizeof(state));
+}
+
+SpectatorClient::~SpectatorClient()
+{
+	Disconnect();
+}
+
+bool SpectatorClient::Connect(const NetAddress& a_relay, uint16_t a_matchID)
+{
+	Disconnect();
+
+	if (!socket.Open(0))
+		return false;
+
+	relay = a_relay;
+	matchID = a_matchID;
+	connected = true;
+	newestKeyframe = 0;
+	hasState = false;
+	memset(keyframes, 0, sizeof(keyframes));
+
+	SendSpectate();
+	return true;
+}
+
+void SpectatorClient::Disconnect()
+{
+	connected = false;
+	socket.Close();
+}
+
+void SpectatorClient::SendSpectate()
+{
+	SpectatePacket packet = {};
+	packet.Header.Type = NET_SPECTATE;
+	packet.Header.MatchID = matchID;
+	packet.AckKeyframe = newestKeyframe;
+	socket.Send(relay, &packet, sizeof(packet));
+
+	lastSpectateMs = NetTimeMs();
+}
+
+void SpectatorClient::Update()
+{
+	if (!connected)
+		return;
+
+	NetAddress from;
+	int size;
+	while ((size = socket.Receive(from, packetBuffer, NET_MAX_PACKET_SIZE)) >= 0)
+	{
+		if (from != relay || size < (int)sizeof(SpectatorStatePacket))
+			continue;
+
+		const NetHeader* header = (const NetHeader*)packetBuffer;
+		if (header->Type == NET_SPECTATOR_STATE && header->MatchID == matchID)
+		{
+			bytesReceived += size;
+			HandleState(packetBuffer, size);
+		}
+	}
+
+	if (NetTimeMs() - lastSpectateMs >= NET_SPECTATE_KEEPALIVE_MS)
+		SendSpectate();
+}
+
+void SpectatorClient::HandleState(const unsigned char* a_data, int a_size)
+{
+	const SpectatorStatePacket* packet = (const SpectatorStatePacket*)a_data;
+	bool keyframe = (packet->Flags & SPECTATOR_STATE_KEYFRAME) != 0;
+
+	//Late packets only matter if they carry a keyframe we can use later
+	if (hasState && (int32_t)(packet->Tick - state.Tick) <= 0 && !keyframe)
+		return;
+
+	const QuantizedState* baseline = 0;
+	if (!(packet->Flags & SPECTATOR_STATE_FULL))
+	{
+		const QuantizedState& slot = keyframes[(packet->BaselineTick / NET_KEYFRAME_INTERVAL) % NET_SPECTATOR_BASELINES];
+		if (slot.Tick != packet->BaselineTick)
+			return;
+		baseline = &slot;
+	}
+
+	QuantizedState decoded;
+	int header = sizeof(SpectatorStatePacket);
+	BitReader reader(a_data + header, a_size - header);
+	if (!SnapshotCodec::Decode(baseline, packet->Tick, reader, decoded))
+		return;
+
+	statesReceived++;
+
+	if (keyframe)
+	{
+		keyframes[(decoded.Tick / NET_KEYFRAME_INTERVAL) % NET_SPECTATOR_BASELINES] = decoded;
+		if ((int32_t)(decoded.Tick - newestKeyframe) > 0)
+		{
+			newestKeyframe = decoded.Tick;
+			SendSpectate();
+		}
+	}
+
+	if (!hasState || (int32_t)(decoded.Tick - state.Tick) > 0)
+	{
+		SnapshotCodec::Dequantize(decoded, state);
+		hasState = true;
+	}
+}
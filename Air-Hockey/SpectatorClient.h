@@ -0,0 +1,50 @@
+#pragma once
+#include "NetSocket.h"
+#include "NetProtocol.h"
+#include "SnapshotCodec.h"
+
+// --------------------------------------------------------
+// Watches a match through a spectator relay.  Holds the
+// newest keyframes the relay encodes deltas against and
+// acks each one so the relay can move to it.
+// --------------------------------------------------------
+class SpectatorClient
+{
+public:
+	SpectatorClient();
+	~SpectatorClient();
+
+	bool Connect(const NetAddress& a_relay, uint16_t a_matchID);
+	void Disconnect();
+
+	// Reads everything waiting and keeps the subscription alive
+	void Update();
+
+	bool HasState() { return hasState; }
+	void GetState(MatchState& a_state) { a_state = state; }
+
+	uint64_t GetBytesReceived() { return bytesReceived; }
+	uint32_t GetStatesReceived() { return statesReceived; }
+
+private:
+	UdpSocket socket;
+	NetAddress relay;
+	uint16_t matchID;
+	bool connected;
+	uint32_t lastSpectateMs;
+
+	//Keyframe for tick t lives in slot (t / NET_KEYFRAME_INTERVAL) % NET_SPECTATOR_BASELINES
+	QuantizedState keyframes[NET_SPECTATOR_BASELINES];
+	uint32_t newestKeyframe;
+
+	MatchState state;
+	bool hasState;
+
+	uint64_t bytesReceived;
+	uint32_t statesReceived;
+
+	unsigned char packetBuffer[NET_MAX_PACKET_SIZE];
+
+	void SendSpectate();
+	void HandleState(const unsigned char* a_data, int a_size);
+};
@@ -0,0 +1,519 @@
+#include "TransformSystem.h"
+#include "JobPool.h"
+#include <cstring>
+
+// Levels and batches smaller than this stay on the calling thread
+static const int PARALLEL_MIN = 2048;
+static const int GROUPS_PER_JOB = 128;
+static const int SLOTS_PER_JOB = 512;
+
+//Copies an array into a new, bigger one
+template<typename T>
+static T* Resize(T* a_old, int a_oldSize, int a_newSize)
+{
+	T* resized = new T[a_newSize];
+	memset(resized, 0, sizeof(T) * a_newSize);
+	if (a_old)
+		memcpy(resized, a_old, sizeof(T) * a_oldSize);
+	delete[] a_old;
+	return resized;
+}
+
+//Reorders the first a_count entries so new[i] = old[a_order[i]]
+template<typename T>
+static void Permute(T*& a_array, const int* a_order, int a_count, int a_capacity)
+{
+	T* sorted = new T[a_capacity];
+	memset(sorted, 0, sizeof(T) * a_capacity);
+	for (int i = 0; i < a_count; i++)
+		sorted[i] = a_array[a_order[i]];
+	delete[] a_array;
+	a_array = sorted;
+}
+
+TransformSystem::TransformSystem(int a_capacity)
+{
+	count = 0;
+	capacity = 0;
+
+	posX = posY = posZ = 0;
+	rotX = rotY = rotZ = 0;
+	scaleX = scaleY = scaleZ = 0;
+	dirty = 0;
+	changed = 0;
+	locals = 0;
+	worlds = 0;
+	parents = 0;
+	parentSlots = 0;
+
+	slots = 0;
+	handles = 0;
+	freeHandles = 0;
+	freeCount = 0;
+	nextHandle = 0;
+
+	levelCount = 0;
+	levelStarts[0] = 0;
+	orderDirty = false;
+
+	jobs = 0;
+	anyDirty = false;
+	frameRebuilds = 0;
+	framePropagated = 0;
+	lastFrameRebuilds = 0;
+	lastFramePropagated = 0;
+
+	//Groups of four are always read whole
+	int rounded = (a_capacity + 3) & ~3;
+	Grow(rounded < 4 ? 4 : rounded);
+}
+
+TransformSystem::~TransformSystem()
+{
+	delete[] posX;
+	delete[] posY;
+	delete[] posZ;
+	delete[] rotX;
+	delete[] rotY;
+	delete[] rotZ;
+	delete[] scaleX;
+	delete[] scaleY;
+	delete[] scaleZ;
+	delete[] dirty;
+	delete[] changed;
+	delete[] locals;
+	delete[] worlds;
+	delete[] parents;
+	delete[] parentSlots;
+	delete[] slots;
+	delete[] handles;
+	delete[] freeHandles;
+}
+
+void TransformSystem::Grow(int a_capacity)
+{
+	int oldCapacity = capacity;
+	capacity = a_capacity;
+
+	posX = Resize(posX, oldCapacity, capacity);
+	posY = Resize(posY, oldCapacity, capacity);
+	posZ = Resize(posZ, oldCapacity, capacity);
+	rotX = Resize(rotX, oldCapacity, capacity);
+	rotY = Resize(rotY, oldCapacity, capacity);
+	rotZ = Resize(rotZ, oldCapacity, capacity);
+	scaleX = Resize(scaleX, oldCapacity, capacity);
+	scaleY = Resize(scaleY, oldCapacity, capacity);
+	scaleZ = Resize(scaleZ, oldCapacity, capacity);
+	dirty = Resize(dirty, oldCapacity, capacity);
+	changed = Resize(changed, oldCapacity, capacity);
+	locals = Resize(locals, oldCapacity, capacity);
+	worlds = Resize(worlds, oldCapacity, capacity);
+	parents = Resize(parents, oldCapacity, capacity);
+	parentSlots = Resize(parentSlots, oldCapacity, capacity);
+	slots = Resize(slots, oldCapacity, capacity);
+	handles = Resize(handles, oldCapacity, capacity);
+	freeHandles = Resize(freeHandles, oldCapacity, capacity);
+}
+
+TransformHandle TransformSystem::Create()
+{
+	if (count == capacity)
+		Grow(capacity * 2);
+
+	//There are never more handles than slots, so both fit
+	TransformHandle handle = freeCount > 0 ? freeHandles[--freeCount] : nextHandle++;
+
+	int slot = count++;
+	slots[handle] = slot;
+	handles[slot] = handle;
+
+	posX[slot] = posY[slot] = posZ[slot] = 0.0f;
+	rotX[slot] = rotY[slot] = rotZ[slot] = 0.0f;
+	scaleX[slot] = scaleY[slot] = scaleZ[slot] = 1.0f;
+	parents[slot] = INVALID_TRANSFORM;
+	parentSlots[slot] = -1;
+	changed[slot] = false;
+	MarkDirty(slot);
+
+	//New roots go on the end, past any children
+	orderDirty = true;
+
+	return handle;
+}
+
+void TransformSystem::MoveSlot(int a_from, int a_to)
+{
+	posX[a_to] = posX[a_from];
+	posY[a_to] = posY[a_from];
+	posZ[a_to] = posZ[a_from];
+	rotX[a_to] = rotX[a_from];
+	rotY[a_to] = rotY[a_from];
+	rotZ[a_to] = rotZ[a_from];
+	scaleX[a_to] = scaleX[a_from];
+	scaleY[a_to] = scaleY[a_from];
+	scaleZ[a_to] = scaleZ[a_from];
+	dirty[a_to] = dirty[a_from];
+	locals[a_to] = locals[a_from];
+	worlds[a_to] = worlds[a_from];
+	parents[a_to] = parents[a_from];
+
+	handles[a_to] = handles[a_from];
+	slots[handles[a_to]] = a_to;
+}
+
+void TransformSystem::Destroy(TransformHandle a_handle)
+{
+	if (!IsValid(a_handle))
+		return;
+
+	//Orphans keep their local transform, which is now their world one
+	for (int i = 0; i < count; i++)
+	{
+		if (parents[i] == a_handle)
+		{
+			parents[i] = INVALID_TRANSFORM;
+			MarkDirty(i);
+		}
+	}
+
+	//Move the last transform into the hole to keep the arrays packed
+	int slot = slots[a_handle];
+	int last = count - 1;
+	if (slot != last)
+		MoveSlot(last, slot);
+
+	//Padding past the end is still built, so keep it harmless
+	posX[last] = posY[last] = posZ[last] = 0.0f;
+	rotX[last] = rotY[last] = rotZ[last] = 0.0f;
+	scaleX[last] = scaleY[last] = scaleZ[last] = 0.0f;
+	dirty[last] = false;
+
+	slots[a_handle] = -1;
+	freeHandles[freeCount++] = a_handle;
+	count--;
+	orderDirty = true;
+}
+
+bool TransformSystem::IsValid(TransformHandle a_handle)
+{
+	return a_handle < nextHandle && slots[a_handle] != -1;
+}
+
+void TransformSystem::MarkDirty(int a_slot)
+{
+	dirty[a_slot] = true;
+	anyDirty = true;
+}
+
+void TransformSystem::SetPosition(TransformHandle a_handle, float x, float y, float z)
+{
+	int slot = slots[a_handle];
+	if (posX[slot] == x && posY[slot] == y && posZ[slot] == z)
+		return;
+
+	posX[slot] = x;
+	posY[slot] = y;
+	posZ[slot] = z;
+	MarkDirty(slot);
+}
+
+void TransformSystem::SetRotation(TransformHandle a_handle, float x, float y, float z)
+{
+	int slot = slots[a_handle];
+	if (rotX[slot] == x && rotY[slot] == y && rotZ[slot] == z)
+		return;
+
+	rotX[slot] = x;
+	rotY[slot] = y;
+	rotZ[slot] = z;
+	MarkDirty(slot);
+}
+
+void TransformSystem::SetScale(TransformHandle a_handle, float x, float y, float z)
+{
+	int slot = slots[a_handle];
+	if (scaleX[slot] == x && scaleY[slot] == y && scaleZ[slot] == z)
+		return;
+
+	scaleX[slot] = x;
+	scaleY[slot] = y;
+	scaleZ[slot] = z;
+	MarkDirty(slot);
+}
+
+XMFLOAT3 TransformSystem::GetPosition(TransformHandle a_handle)
+{
+	int slot = slots[a_handle];
+	return XMFLOAT3(posX[slot], posY[slot], posZ[slot]);
+}
+
+XMFLOAT3 TransformSystem::GetRotation(TransformHandle a_handle)
+{
+	int slot = slots[a_handle];
+	return XMFLOAT3(rotX[slot], rotY[slot], rotZ[slot]);
+}
+
+XMFLOAT3 TransformSystem::GetScale(TransformHandle a_handle)
+{
+	int slot = slots[a_handle];
+	return XMFLOAT3(scaleX[slot], scaleY[slot], scaleZ[slot]);
+}
+
+int TransformSystem::GetDepthOf(int a_slot)
+{
+	int depth = 0;
+	for (TransformHandle up = parents[a_slot]; up != INVALID_TRANSFORM; up = parents[slots[up]])
+		depth++;
+	return depth;
+}
+
+bool TransformSystem::SetParent(TransformHandle a_child, TransformHandle a_parent)
+{
+	if (!IsValid(a_child))
+		return false;
+
+	if (a_parent != INVALID_TRANSFORM)
+	{
+		if (!IsValid(a_parent) || GetDepthOf(slots[a_parent]) + 1 >= MAX_DEPTH)
+			return false;
+
+		for (TransformHandle up = a_parent; up != INVALID_TRANSFORM; up = parents[slots[up]])
+		{
+			if (up == a_child)
+				return false;
+		}
+	}
+
+	int slot = slots[a_child];
+	parents[slot] = a_parent;
+	MarkDirty(slot);
+	orderDirty = true;
+	return true;
+}
+
+TransformHandle TransformSystem::GetParent(TransformHandle a_handle)
+{
+	return parents[slots[a_handle]];
+}
+
+// Counting sort by depth, so each level is one contiguous run
+// and every parent is finished before its children start
+void TransformSystem::SortByDepth()
+{
+	int* depths = new int[count];
+	int levelSizes[MAX_DEPTH] = {};
+
+	for (int i = 0; i < count; i++)
+	{
+		depths[i] = GetDepthOf(i);
+
+		//Too deep to fit (a long chain built below an existing one) becomes a root
+		if (depths[i] >= MAX_DEPTH)
+		{
+			parents[i] = INVALID_TRANSFORM;
+			depths[i] = 0;
+			MarkDirty(i);
+		}
+		levelSizes[depths[i]]++;
+	}
+
+	levelCount = 0;
+	levelStarts[0] = 0;
+	for (int d = 0; d < MAX_DEPTH && levelSizes[d] > 0; d++)
+	{
+		levelStarts[d + 1] = levelStarts[d] + levelSizes[d];
+		levelCount = d + 1;
+	}
+
+	int next[MAX_DEPTH];
+	for (int d = 0; d < levelCount; d++)
+		next[d] = levelStarts[d];
+
+	//Stable, so the order within a level survives re-sorts
+	int* order = new int[count];
+	for (int i = 0; i < count; i++)
+		order[next[depths[i]]++] = i;
+
+	Permute(posX, order, count, capacity);
+	Permute(posY, order, count, capacity);
+	Permute(posZ, order, count, capacity);
+	Permute(rotX, order, count, capacity);
+	Permute(rotY, order, count, capacity);
+	Permute(rotZ, order, count, capacity);
+	Permute(scaleX, order, count, capacity);
+	Permute(scaleY, order, count, capacity);
+	Permute(scaleZ, order, count, capacity);
+	Permute(dirty, order, count, capacity);
+	Permute(locals, order, count, capacity);
+	Permute(worlds, order, count, capacity);
+	Permute(parents, order, count, capacity);
+	Permute(handles, order, count, capacity);
+
+	for (int i = 0; i < count; i++)
+		slots[handles[i]] = i;
+	for (int i = 0; i < count; i++)
+		parentSlots[i] = parents[i] == INVALID_TRANSFORM ? -1 : slots[parents[i]];
+
+	delete[] depths;
+	delete[] order;
+	orderDirty = false;
+}
+
+void TransformSystem::UpdateWorldMatrices()
+{
+	if (!anyDirty)
+		return;
+
+	if (orderDirty)
+		SortByDepth();
+
+	//Local matrices first: everything that changed, four at a time
+	int groups = (count + 3) / 4;
+	if (jobs && count >= PARALLEL_MIN)
+		jobs->ParallelFor(groups, GROUPS_PER_JOB, [this](int a_first, int a_last) { BuildLocals(a_first, a_last); });
+	else
+		BuildLocals(0, groups);
+
+	//Then down the hierarchy a level at a time; a level only reads the one above
+	for (int d = 0; d < levelCount; d++)
+	{
+		int first = levelStarts[d];
+		int size = levelStarts[d + 1] - first;
+
+		if (jobs && size >= PARALLEL_MIN)
+			jobs->ParallelFor(size, SLOTS_PER_JOB, [this, first](int a_first, int a_last) { PropagateRange(first + a_first, first + a_last); });
+		else
+			PropagateRange(first, first + size);
+	}
+
+	memset(changed, 0, sizeof(bool) * count);
+	anyDirty = false;
+}
+
+void TransformSystem::BuildLocals(int a_firstGroup, int a_lastGroup)
+{
+	//Groups with nothing changed are skipped; the rest are built whole
+	unsigned int rebuilt = 0;
+	for (int group = a_firstGroup; group < a_lastGroup; group++)
+	{
+		int first = group * 4;
+		if (!dirty[first] && !dirty[first + 1] && !dirty[first + 2] && !dirty[first + 3])
+			continue;
+
+		BuildGroup(first);
+
+		for (int i = first; i < first + 4; i++)
+		{
+			if (dirty[i])
+			{
+				dirty[i] = false;
+				changed[i] = true;
+				rebuilt++;
+			}
+		}
+	}
+	frameRebuilds += rebuilt;
+}
+
+void TransformSystem::PropagateRange(int a_first, int a_last)
+{
+	unsigned int propagated = 0;
+	for (int i = a_first; i < a_last; i++)
+	{
+		int parent = parentSlots[i];
+		if (parent == -1)
+		{
+			if (changed[i])
+			{
+				worlds[i] = locals[i];
+				propagated++;
+			}
+		}
+		else if (changed[i] || changed[parent])
+		{
+			//Both are stored transposed, so parent * local is (local * parent)^T
+			XMMATRIX world = XMMatrixMultiply(XMLoadFloat4x4(&worlds[parent]), XMLoadFloat4x4(&locals[i]));
+			XMStoreFloat4x4(&worlds[i], world);
+			changed[i] = true;
+			propagated++;
+		}
+	}
+	framePropagated += propagated;
+}
+
+// Builds scale * rollPitchYaw * translation, transposed, for four
+// transforms at once.  Each vector holds one matrix element of all
+// four, so the math is plain multiply-adds with no shuffling until
+// the final 4x4 transposes turn element-vectors back into rows
+void TransformSystem::BuildGroup(int a_first)
+{
+	XMVECTOR pitch = XMLoadFloat4((const XMFLOAT4*)(rotX + a_first));
+	XMVECTOR yaw = XMLoadFloat4((const XMFLOAT4*)(rotY + a_first));
+	XMVECTOR roll = XMLoadFloat4((const XMFLOAT4*)(rotZ + a_first));
+
+	XMVECTOR sp, cp, sy, cy, sr, cr;
+	XMVectorSinCos(&sp, &cp, pitch);
+	XMVectorSinCos(&sy, &cy, yaw);
+	XMVectorSinCos(&sr, &cr, roll);
+
+	//Same rotation as XMMatrixRotationRollPitchYaw
+	XMVECTOR spsy = XMVectorMultiply(sp, sy);
+	XMVECTOR spcy = XMVectorMultiply(sp, cy);
+	XMVECTOR r00 = XMVectorMultiplyAdd(sr, spsy, XMVectorMultiply(cr, cy));
+	XMVECTOR r01 = XMVectorMultiply(sr, cp);
+	XMVECTOR r02 = XMVectorNegativeMultiplySubtract(cr, sy, XMVectorMultiply(sr, spcy));
+	XMVECTOR r10 = XMVectorNegativeMultiplySubtract(sr, cy, XMVectorMultiply(cr, spsy));
+	XMVECTOR r11 = XMVectorMultiply(cr, cp);
+	XMVECTOR r12 = XMVectorMultiplyAdd(cr, spcy, XMVectorMultiply(sr, sy));
+	XMVECTOR r20 = XMVectorMultiply(cp, sy);
+	XMVECTOR r21 = XMVectorNegate(sp);
+	XMVECTOR r22 = XMVectorMultiply(cp, cy);
+
+	XMVECTOR sx = XMLoadFloat4((const XMFLOAT4*)(scaleX + a_first));
+	XMVECTOR sY = XMLoadFloat4((const XMFLOAT4*)(scaleY + a_first));
+	XMVECTOR sz = XMLoadFloat4((const XMFLOAT4*)(scaleZ + a_first));
+
+	//Rows of the transposed matrix, one element-vector per column
+	XMMATRIX row0 = XMMatrixTranspose(XMMATRIX(
+		XMVectorMultiply(sx, r00), XMVectorMultiply(sY, r10), XMVectorMultiply(sz, r20),
+		XMLoadFloat4((const XMFLOAT4*)(posX + a_first))));
+	XMMATRIX row1 = XMMatrixTranspose(XMMATRIX(
+		XMVectorMultiply(sx, r01), XMVectorMultiply(sY, r11), XMVectorMultiply(sz, r21),
+		XMLoadFloat4((const XMFLOAT4*)(posY + a_first))));
+	XMMATRIX row2 = XMMatrixTranspose(XMMATRIX(
+		XMVectorMultiply(sx, r02), XMVectorMultiply(sY, r12), XMVectorMultiply(sz, r22),
+		XMLoadFloat4((const XMFLOAT4*)(posZ + a_first))));
+	XMVECTOR row3 = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+
+	for (int i = 0; i < 4; i++)
+	{
+		XMFLOAT4X4& local = locals[a_first + i];
+		XMStoreFloat4((XMFLOAT4*)local.m[0], row0.r[i]);
+		XMStoreFloat4((XMFLOAT4*)local.m[1], row1.r[i]);
+		XMStoreFloat4((XMFLOAT4*)local.m[2], row2.r[i]);
+		XMStoreFloat4((XMFLOAT4*)local.m[3], row3);
+	}
+}
+
+const XMFLOAT4X4& TransformSystem::GetWorldMatrix(TransformHandle a_handle)
+{
+	if (anyDirty)
+		UpdateWorldMatrices();
+	return worlds[slots[a_handle]];
+}
+
+XMFLOAT3 TransformSystem::GetWorldPosition(TransformHandle a_handle)
+{
+	//Transposed, so the translation is down the last column
+	const XMFLOAT4X4& world = GetWorldMatrix(a_handle);
+	return XMFLOAT3(world._14, world._24, world._34);
+}
+
+//Call once at the start of each frame
+void TransformSystem::BeginFrame()
+{
+	lastFrameRebuilds = frameRebuilds;
+	lastFramePropagated = framePropagated;
+	frameRebuilds = 0;
+	framePropagated = 0;
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <DirectXMath.h>
+
+using namespace DirectX;
+
+class JobPool;
+
+// Refers to one transform in a TransformSystem; stays valid while
+// other transforms come and go
+typedef uint32_t TransformHandle;
+const TransformHandle INVALID_TRANSFORM = 0xFFFFFFFF;
+
+// --------------------------------------------------------
+// Positions, rotations and scales of many objects kept in
+// separate tightly packed arrays (structure of arrays), so
+// world matrices can be built four at a time with SIMD in
+// one pass instead of one heap object at a time.
+//
+// Transforms can be parented to each other, making them
+// local to the parent.  The arrays are kept sorted by depth
+// in the hierarchy, so worlds are propagated one level at a
+// time, each level split across a JobPool, and only below
+// transforms that changed.
+//
+// Handles go through a lookup table, so they survive the
+// arrays being sorted and packed.
+// --------------------------------------------------------
+class TransformSystem
+{
+public:
+	TransformSystem(int a_capacity = 64);
+	~TransformSystem();
+
+	TransformHandle Create();
+
+	// Children of a destroyed transform become roots
+	void Destroy(TransformHandle a_handle);
+	bool IsValid(TransformHandle a_handle);
+
+	// Position, rotation and scale are relative to the parent
+	void SetPosition(TransformHandle a_handle, float x, float y, float z);
+	void SetRotation(TransformHandle a_handle, float x, float y, float z);
+	void SetScale(TransformHandle a_handle, float x, float y, float z);
+	XMFLOAT3 GetPosition(TransformHandle a_handle);
+	XMFLOAT3 GetRotation(TransformHandle a_handle);
+	XMFLOAT3 GetScale(TransformHandle a_handle);
+
+	// INVALID_TRANSFORM makes it a root again.  Refuses to make a
+	// transform its own ancestor
+	bool SetParent(TransformHandle a_child, TransformHandle a_parent);
+	TransformHandle GetParent(TransformHandle a_handle);
+
+	// Big levels are split across this pool; null keeps it on one thread
+	void SetJobPool(JobPool* a_jobs) { jobs = a_jobs; }
+
+	// Rebuilds every changed transform and everything below it
+	void UpdateWorldMatrices();
+
+	// Transposed, ready for a shader.  Brings everything up to
+	// date first if anything changed since the last update
+	const XMFLOAT4X4& GetWorldMatrix(TransformHandle a_handle);
+
+	// Where the transform ends up, parents included
+	XMFLOAT3 GetWorldPosition(TransformHandle a_handle);
+
+	int GetCount() { return count; }
+	int GetDepth() { return levelCount; }
+
+	// Local matrices rebuilt and world matrices propagated in the last full frame
+	void BeginFrame();
+	unsigned int GetRebuilds() { return lastFrameRebuilds; }
+	unsigned int GetPropagated() { return lastFramePropagated; }
+
+private:
+	int count;
+	int capacity;
+
+	//One array per component, padded to a multiple of four
+	float* posX;
+	float* posY;
+	float* posZ;
+	float* rotX;
+	float* rotY;
+	float* rotZ;
+	float* scaleX;
+	float* scaleY;
+	float* scaleZ;
+	bool* dirty;
+	XMFLOAT4X4* locals;
+	XMFLOAT4X4* worlds;
+
+	//Set on transforms whose world moved during an update, so children follow
+	bool* changed;
+
+	//Hierarchy; parentSlots is rebuilt from parents whenever the arrays are sorted
+	TransformHandle* parents;
+	int* parentSlots;
+
+	//Slots [levelStarts[d], levelStarts[d + 1]) are at depth d
+	static const int MAX_DEPTH = 32;
+	int levelStarts[MAX_DEPTH + 1];
+	int levelCount;
+	bool orderDirty;
+
+	//Handle -> slot in the arrays, and back
+	int* slots;
+	TransformHandle* handles;
+	TransformHandle* freeHandles;
+	int freeCount;
+	TransformHandle nextHandle;
+
+	JobPool* jobs;
+	bool anyDirty;
+
+	//Counted from worker threads
+	std::atomic<unsigned int> frameRebuilds;
+	std::atomic<unsigned int> framePropagated;
+	unsigned int lastFrameRebuilds;
+	unsigned int lastFramePropagated;
+
+	void Grow(int a_capacity);
+	void SortByDepth();
+	void BuildLocals(int a_firstGroup, int a_lastGroup);
+	void BuildGroup(int a_first);
+	void PropagateRange(int a_first, int a_last);
+	void MarkDirty(int a_slot);
+	void MoveSlot(int a_from, int a_to);
+	int GetDepthOf(int a_slot);
+};
@@ -0,0 +1,95 @@
+#include "TransientRing.h"
+#include <cstring>
+
+TransientRing::TransientRing(RenderBackend* a_backend, unsigned int a_bytes, int a_framesInFlight)
+{
+	backend = a_backend;
+	capacity = a_bytes;
+	buffers.resize(a_framesInFlight > 0 ? a_framesInFlight : 1, 0);
+	current = 0;
+	offset = 0;
+	grow = false;
+	memset(&frame, 0, sizeof(frame));
+	memset(&lastFrame, 0, sizeof(lastFrame));
+	frame.Capacity = capacity;
+	CreateBuffers();
+}
+
+TransientRing::~TransientRing()
+{
+	ReleaseBuffers();
+}
+
+void TransientRing::CreateBuffers()
+{
+	for (size_t i = 0; i < buffers.size(); i++)
+		buffers[i] = backend->CreateBuffer(RENDER_BUFFER_VERTEX, capacity, 0, true);
+}
+
+void TransientRing::ReleaseBuffers()
+{
+	for (size_t i = 0; i < buffers.size(); i++)
+	{
+		if (buffers[i])
+			backend->ReleaseBuffer(buffers[i]);
+		buffers[i] = 0;
+	}
+}
+
+void TransientRing::BeginFrame()
+{
+	//Last frame didn't fit, so no frame's buffer is big enough
+	if (grow)
+	{
+		ReleaseBuffers();
+		capacity *= 2;
+		CreateBuffers();
+		grow = false;
+	}
+
+	current = (current + 1) % (int)buffers.size();
+	offset = 0;
+
+	lastFrame = frame;
+	memset(&frame, 0, sizeof(frame));
+	frame.Capacity = capacity;
+}
+
+TransientAllocation TransientRing::Upload(const void* a_data, unsigned int a_bytes, unsigned int a_alignment)
+{
+	unsigned int start = offset;
+	if (a_alignment > 1)
+		start = (start + a_alignment - 1) / a_alignment * a_alignment;
+
+	//First write of the frame, or out of room: start over in a fresh buffer
+	bool discard = offset == 0;
+	if (start + a_bytes > capacity)
+	{
+		frame.Overflows++;
+		grow = true;
+		start = 0;
+		discard = true;
+
+		//Too big for any buffer; make this one big enough right away
+		if (a_bytes > capacity)
+		{
+			while (capacity < a_bytes)
+				capacity *= 2;
+			backend->ReleaseBuffer(buffers[current]);
+			buffers[current] = backend->CreateBuffer(RENDER_BUFFER_VERTEX, capacity, 0, true);
+			frame.Capacity = capacity;
+		}
+	}
+
+	backend->WriteBufferRange(buffers[current], start, a_data, a_bytes, discard);
+	frame.Allocations++;
+	frame.BytesUsed += start + a_bytes - (discard ? 0 : offset);
+	if (discard)
+		frame.Discards++;
+	offset = start + a_bytes;
+
+	TransientAllocation allocation;
+	allocation.Buffer = buffers[current];
+	allocation.Offset = start;
+	return allocation;
+}
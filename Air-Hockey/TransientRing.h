@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "RenderBackend.h"
+
+// Where an upload landed; bind Buffer with Offset
+struct TransientAllocation
+{
+	ID3D11Buffer* Buffer;
+	unsigned int Offset;
+};
+
+// What a frame put in the ring
+struct TransientRingStats
+{
+	uint32_t Allocations;
+	uint64_t BytesUsed;			// Including alignment padding
+	uint32_t Discards;			// Writes that threw the buffer's old contents away
+	uint32_t Overflows;			// Allocations that didn't fit in what was left
+	uint32_t Capacity;			// Bytes per buffer
+};
+
+// --------------------------------------------------------
+// Per-frame vertex data that's written once and drawn once
+// (particles, instance matrices) packed into one big dynamic
+// vertex buffer per frame in flight, instead of a dynamic
+// buffer of its own each rewritten whole every draw.
+//
+// Upload() bumps a pointer and writes just that range with
+// NO_OVERWRITE, so nothing the GPU is still reading from the
+// same buffer is disturbed.  Each frame starts on the next
+// buffer with one DISCARD write: D3D11 can't say when the GPU
+// is done with a buffer, so that lets the driver swap in a
+// fresh one if it's somehow still busy.
+//
+// When a frame runs out of room the buffer is discarded and
+// filled again from the start (earlier draws keep what they
+// saw), and every buffer doubles at the next BeginFrame().
+// --------------------------------------------------------
+class TransientRing
+{
+public:
+	TransientRing(RenderBackend* a_backend, unsigned int a_bytes, int a_framesInFlight = FRAMES_IN_FLIGHT);
+	~TransientRing();
+
+	// Moves on to the next frame's buffer
+	void BeginFrame();
+
+	// Copies a_bytes of a_data in, starting at a multiple of a_alignment
+	TransientAllocation Upload(const void* a_data, unsigned int a_bytes, unsigned int a_alignment = 16);
+
+	const TransientRingStats& GetFrameStats() { return frame; }
+	const TransientRingStats& GetLastFrameStats() { return lastFrame; }
+
+	RenderBackend* GetBackend() { return backend; }
+
+	// DXGI queues up to three frames by default
+	static const int FRAMES_IN_FLIGHT = 3;
+
+private:
+	RenderBackend* backend;
+	std::vector<ID3D11Buffer*> buffers;
+	unsigned int capacity;
+	int current;
+	unsigned int offset;
+	bool grow;
+
+	TransientRingStats frame;
+	TransientRingStats lastFrame;
+
+	void CreateBuffers();
+	void ReleaseBuffers();
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// --------------------------------------------------------
+// Hands the newest of a stream of values from one writer
+// thread to one reader thread without either one ever
+// waiting for the other.
+//
+// There are three copies: the one the writer is filling,
+// the one the reader is looking at, and the newest finished
+// one between them.  Publish() swaps the writer's copy for
+// the one in the middle and Acquire() swaps the reader's,
+// each with one atomic exchange, so neither side ever sees
+// a copy the other is still using.  Values published faster
+// than the reader acquires them are simply skipped.
+// --------------------------------------------------------
+template <typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer()
+	{
+		writeIndex = 0;
+		middle = 1;
+		readIndex = 2;
+	}
+
+	// Writer only: the copy to fill in.  It still holds whatever was
+	// written into it a few publishes ago, so overwrite all of it
+	T& GetWriteBuffer() { return buffers[writeIndex]; }
+
+	// Writer only: makes the write buffer the newest value
+	void Publish()
+	{
+		writeIndex = middle.exchange(writeIndex | FRESH, std::memory_order_acq_rel) & INDEX;
+	}
+
+	// Reader only: moves on to the newest value, if one was published
+	// since the last call.  False keeps the one already acquired
+	bool Acquire()
+	{
+		if (!(middle.load(std::memory_order_relaxed) & FRESH))
+			return false;
+
+		readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & INDEX;
+		return true;
+	}
+
+	// Reader only: the value last acquired
+	const T& GetReadBuffer() { return buffers[readIndex]; }
+
+private:
+	//The middle copy's index, and whether the reader has had it yet
+	static const uint8_t INDEX = 3;
+	static const uint8_t FRESH = 4;
+
+	T buffers[3];
+	std::atomic<uint8_t> middle;
+	uint8_t writeIndex;
+	uint8_t readIndex;
+};
@@ -5,23 +5,15 @@
 // - All non-pipeline variables that get their values from 
 //    our C++ code must be defined inside a Constant Buffer
 // - The name of the cbuffer itself is unimportant
+// - Only the world matrix changes per object; the camera and
+//    shadow matrices come from ShaderConstants.hlsli
 cbuffer externalData : register(b0)
 {
 	matrix world;
-	matrix view;
-	matrix projection;
-	
-	matrix shadowViewMat;
-	matrix shadowProjMat;
-	matrix CubeShadowProjMat;
-	matrix CubeShadowViewMat1;
-	matrix CubeShadowViewMat2;
-	matrix CubeShadowViewMat3;
-	matrix CubeShadowViewMat4;
-	matrix CubeShadowViewMat5;
-	matrix CubeShadowViewMat6;
 };
 
+#include "ShaderConstants.hlsli"
+
 // Struct representing a single vertex worth of data
 // - This should match the vertex definition in our C++ code
 // - By "match", I mean the size, order and number of members